@@ -5,8 +5,20 @@ in vec4 position;
 in vec2 tex_coord;
 in float depth;
 
-uniform mat4 model_view;
-uniform mat4 projection;
+// noggit::frame_uniform_data, shared by the world's programs
+layout (std140) uniform frame_block
+{
+  mat4 model_view;
+  mat4 projection;
+  vec4 camera;
+  vec4 fog_color;
+  vec4 light_dir;
+  vec4 terrain_light_dir;
+  vec4 diffuse_color;
+  vec4 ambient_color;
+  float fog_start;
+  float fog_end;
+} frame;
 uniform mat4 transform;
 
 uniform int use_transform = int(0);
@@ -21,10 +33,10 @@ void main()
 
   if(use_transform == 1)
   {
-    gl_Position = projection * model_view * transform * position;
+    gl_Position = frame.projection * frame.model_view * transform * position;
   }
   else
   {
-    gl_Position = projection * model_view * position;
+    gl_Position = frame.projection * frame.model_view * position;
   }
 }
@@ -13,18 +13,26 @@ uniform vec4 mesh_color;
 uniform sampler2D tex1;
 uniform sampler2D tex2;
 
-uniform vec4 fog_color;
-uniform float fog_start;
-uniform float fog_end;
+// noggit::frame_uniform_data, shared by the world's programs
+layout (std140) uniform frame_block
+{
+  mat4 model_view;
+  mat4 projection;
+  vec4 camera;
+  vec4 fog_color;
+  vec4 light_dir;
+  vec4 terrain_light_dir;
+  vec4 diffuse_color;
+  vec4 ambient_color;
+  float fog_start;
+  float fog_end;
+} frame;
+
 uniform int draw_fog;
 uniform int fog_mode;
 uniform int unfogged;
 uniform int unlit;
 
-uniform vec3 light_dir;
-uniform vec3 diffuse_color;
-uniform vec3 ambient_color;
-
 uniform float alpha_test;
 uniform int pixel_shader;
 
@@ -159,20 +167,20 @@ void main()
   if(unlit == 0)
   {
     // diffuse + ambient lighting  
-    color.rgb *= vec3(clamp (diffuse_color * max(dot(norm, light_dir), 0.0), 0.0, 1.0)) + ambient_color;
+    color.rgb *= vec3(clamp (frame.diffuse_color.rgb * max(dot(norm, frame.light_dir.xyz), 0.0), 0.0, 1.0)) + frame.ambient_color.rgb;
   }  
 
-  if(draw_fog == 1 && unfogged == 0 && camera_dist >= fog_end * fog_start)
+  if(draw_fog == 1 && unfogged == 0 && camera_dist >= frame.fog_end * frame.fog_start)
   {
-    float start = fog_end * fog_start;
-    float alpha = (camera_dist - start) / (fog_end - start);
+    float start = frame.fog_end * frame.fog_start;
+    float alpha = (camera_dist - start) / (frame.fog_end - start);
 
     vec3 fog;
 
     // see https://wowdev.wiki/M2/Rendering#Fog_Modes
     if(fog_mode == 1)
     {
-      fog = fog_color.rgb;
+      fog = frame.fog_color.rgb;
     }
     else if(fog_mode == 2)
     {
@@ -17,8 +17,20 @@ out vec2 uv2;
 out float camera_dist;
 out vec3 norm;
 
-uniform mat4 model_view;
-uniform mat4 projection;
+// noggit::frame_uniform_data, shared by the world's programs
+layout (std140) uniform frame_block
+{
+  mat4 model_view;
+  mat4 projection;
+  vec4 camera;
+  vec4 fog_color;
+  vec4 light_dir;
+  vec4 terrain_light_dir;
+  vec4 diffuse_color;
+  vec4 ambient_color;
+  float fog_start;
+  float fog_end;
+} frame;
 
 uniform int tex_unit_lookup_1;
 uniform int tex_unit_lookup_2;
@@ -58,7 +70,7 @@ vec2 get_texture_uv(int tex_unit_lookup, vec3 vert, vec3 norm)
 
 void main()
 {
-  vec4 vertex = model_view * transform * pos;
+  vec4 vertex = frame.model_view * transform * pos;
 
   // important to normalize because of the scaling !!
   norm = normalize(mat3(transform) * normal);
@@ -67,5 +79,5 @@ void main()
   uv2 = get_texture_uv(tex_unit_lookup_2, vertex.xyz, norm);
 
   camera_dist = -vertex.z;
-  gl_Position = projection * vertex;
+  gl_Position = frame.projection * vertex;
 }
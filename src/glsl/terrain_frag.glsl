@@ -1,22 +1,27 @@
 // This file is part of Noggit3, licensed under GNU General Public License (version 3).
 #version 330 core
 
-uniform sampler2D shadow_map;
 uniform sampler2D tex0;
 uniform sampler2D tex1;
 uniform sampler2D tex2;
 uniform sampler2D tex3;
-uniform vec2 tex_anim_0;
-uniform vec2 tex_anim_1;
-uniform vec2 tex_anim_2;
-uniform vec2 tex_anim_3;
-uniform sampler2D alphamap;
-uniform bool is_textured;
+// one layer per chunk: the alphamaps in rgb, the shadow in a
+uniform sampler2DArray alphamaps;
 uniform bool has_mccv;
-uniform bool cant_paint;
 uniform bool draw_areaid_overlay;
-uniform vec4 areaid_color;
-uniform bool draw_impassible_flag;
+
+struct chunk_parameters
+{
+  vec4 texture_animations[2];
+  vec4 areaid_color;
+  // is_textured, cant_paint, impassible
+  ivec4 flags;
+};
+
+layout (std140) uniform chunks
+{
+  chunk_parameters chunk[256];
+};
 uniform bool draw_terrain_height_contour;
 uniform bool draw_lines;
 uniform bool draw_hole_lines;
@@ -28,11 +33,22 @@ uniform float wireframe_width;
 uniform vec4 wireframe_color;
 uniform bool rainbow_wireframe;
 
-uniform vec3 camera;
+// noggit::frame_uniform_data, shared by the world's programs
+layout (std140) uniform frame_block
+{
+  mat4 model_view;
+  mat4 projection;
+  vec4 camera;
+  vec4 fog_color;
+  vec4 light_dir;
+  vec4 terrain_light_dir;
+  vec4 diffuse_color;
+  vec4 ambient_color;
+  float fog_start;
+  float fog_end;
+} frame;
+
 uniform bool draw_fog;
-uniform vec4 fog_color;
-uniform float fog_start;
-uniform float fog_end;
 
 uniform bool draw_cursor_circle;
 uniform vec3 cursor_position;
@@ -40,14 +56,11 @@ uniform float outer_cursor_radius;
 uniform float inner_cursor_ratio;
 uniform vec4 cursor_color;
 
-uniform vec3 light_dir;
-uniform vec3 diffuse_color;
-uniform vec3 ambient_color;
-
 in vec3 vary_position;
 in vec2 vary_texcoord;
 in vec3 vary_normal;
 in vec3 vary_mccv;
+flat in int vary_chunk;
 
 out vec4 out_color;
 
@@ -56,20 +69,22 @@ const float CHUNKSIZE = TILESIZE / 16.0;
 const float HOLESIZE  = CHUNKSIZE * 0.25;
 const float UNITSIZE = HOLESIZE * 0.5;
 
-vec4 texture_blend() 
+vec4 texture_blend(vec4 alphamap) 
 {
-  if(!is_textured)
+  if(chunk[vary_chunk].flags.x == 0)
     return vec4 (1.0, 1.0, 1.0, 1.0);
 
-  vec3 alpha = texture(alphamap, vary_texcoord / 8.0).rgb;
-  float a0 = alpha.r;  
-  float a1 = alpha.g;
-  float a2 = alpha.b;
+  float a0 = alphamap.r;  
+  float a1 = alphamap.g;
+  float a2 = alphamap.b;
 
-  vec3 t0 = texture(tex0, vary_texcoord + tex_anim_0).rgb;
-  vec3 t1 = texture(tex1, vary_texcoord + tex_anim_1).rgb;
-  vec3 t2 = texture(tex2, vary_texcoord + tex_anim_2).rgb;
-  vec3 t3 = texture(tex3, vary_texcoord + tex_anim_3).rgb;
+  vec4 tex_anim_01 = chunk[vary_chunk].texture_animations[0];
+  vec4 tex_anim_23 = chunk[vary_chunk].texture_animations[1];
+
+  vec3 t0 = texture(tex0, vary_texcoord + tex_anim_01.xy).rgb;
+  vec3 t1 = texture(tex1, vary_texcoord + tex_anim_01.zw).rgb;
+  vec3 t2 = texture(tex2, vary_texcoord + tex_anim_23.xy).rgb;
+  vec3 t3 = texture(tex3, vary_texcoord + tex_anim_23.zw).rgb;
 
   return vec4 (t0 * (1.0 - (a0 + a1 + a2)) + t1 * a0 + t2 * a1 + t3 * a2, 1.0);
 }
@@ -90,37 +105,39 @@ float contour_alpha(float unit_size, vec2 pos, vec2 line_width)
 
 void main()
 {
-  float dist_from_camera = distance(camera, vary_position);
+  float dist_from_camera = distance(frame.camera.xyz, vary_position);
 
-  if(draw_fog && dist_from_camera >= fog_end)
+  if(draw_fog && dist_from_camera >= frame.fog_end)
   {
-    out_color = fog_color;
+    out_color = frame.fog_color;
     return;
   } 
   vec3 fw = fwidth(vary_position.xyz);
 
-  out_color = texture_blend();
+  vec4 alphamap = texture(alphamaps, vec3(vary_texcoord / 8.0, vary_chunk));
+
+  out_color = texture_blend(alphamap);
   out_color.rgb *= vary_mccv;
 
   // diffuse + ambient lighting
-  out_color.rgb *= vec3(clamp (diffuse_color * max(dot(vary_normal, light_dir), 0.0), 0.0, 1.0)) + ambient_color;
+  out_color.rgb *= vec3(clamp (frame.diffuse_color.rgb * max(dot(vary_normal, frame.terrain_light_dir.xyz), 0.0), 0.0, 1.0)) + frame.ambient_color.rgb;
 
-  if(cant_paint)
+  if(chunk[vary_chunk].flags.y != 0)
   {
     out_color *= vec4(1.0, 0.0, 0.0, 1.0);
   }
   
   if(draw_areaid_overlay)
   {
-    out_color = out_color * 0.3 + areaid_color;
+    out_color = out_color * 0.3 + chunk[vary_chunk].areaid_color;
   }
 
-  if(draw_impassible_flag)
+  if(chunk[vary_chunk].flags.z != 0)
   {
     out_color.rgb = mix(vec3(1.0), out_color.rgb, 0.5);
   }
 
-  float shadow_alpha = texture(shadow_map, vary_texcoord / 8.0).r;
+  float shadow_alpha = alphamap.a;
 
   out_color = vec4 (out_color.rgb * (1.0 - shadow_alpha), 1.0);
 
@@ -152,11 +169,11 @@ void main()
     out_color.rgb = mix(out_color.rgb, color.rgb, color.a);
   }
 
-  if(draw_fog && dist_from_camera >= fog_end * fog_start)
+  if(draw_fog && dist_from_camera >= frame.fog_end * frame.fog_start)
   {
-    float start = fog_end * fog_start;
-    float alpha = (dist_from_camera - start) / (fog_end - start);
-    out_color.rgb = mix(out_color.rgb, fog_color.rgb, alpha);
+    float start = frame.fog_end * frame.fog_start;
+    float alpha = (dist_from_camera - start) / (frame.fog_end - start);
+    out_color.rgb = mix(out_color.rgb, frame.fog_color.rgb, alpha);
   }
 
   if(draw_wireframe && !lines_drawn)
@@ -6,19 +6,36 @@ in vec3 normal;
 in vec3 mccv;
 in vec2 texcoord;
 
-uniform mat4 model_view;
-uniform mat4 projection;
+// noggit::frame_uniform_data, shared by the world's programs
+layout (std140) uniform frame_block
+{
+  mat4 model_view;
+  mat4 projection;
+  vec4 camera;
+  vec4 fog_color;
+  vec4 light_dir;
+  vec4 terrain_light_dir;
+  vec4 diffuse_color;
+  vec4 ambient_color;
+  float fog_start;
+  float fog_end;
+} frame;
 
 out vec3 vary_position;
 out vec2 vary_texcoord;
 out vec3 vary_normal;
 out vec3 vary_mccv;
+flat out int vary_chunk;
+
+// the chunks of a tile follow each other in its vertex buffers
+const int vertices_per_chunk = 9 * 9 + 8 * 8;
 
 void main()
 {
-  gl_Position = projection * model_view * vec4(position, 1.0);
+  gl_Position = frame.projection * frame.model_view * vec4(position, 1.0);
   vary_normal = normal;
   vary_position = position;
   vary_texcoord = texcoord;
   vary_mccv = mccv;
+  vary_chunk = gl_VertexID / vertices_per_chunk;
 }
@@ -8,16 +8,23 @@ uniform bool use_vertex_color;
 
 uniform bool draw_fog;
 uniform bool unfogged;
-uniform float fog_start;
-uniform float fog_end;
-uniform vec3 fog_color;
-uniform vec3 camera;
+// noggit::frame_uniform_data, shared by the world's programs
+layout (std140) uniform frame_block
+{
+  mat4 model_view;
+  mat4 projection;
+  vec4 camera;
+  vec4 fog_color;
+  vec4 light_dir;
+  vec4 terrain_light_dir;
+  vec4 diffuse_color;
+  vec4 ambient_color;
+  float fog_start;
+  float fog_end;
+} frame;
 
 uniform bool unlit;
 uniform bool exterior_lit;
-uniform vec3 exterior_light_dir;
-uniform vec3 exterior_diffuse_color;
-uniform vec3 exterior_ambient_color;
 uniform vec3 ambient_color;
 
 uniform float alpha_test;
@@ -39,13 +46,13 @@ vec3 lighting(vec3 material)
 
   if(unlit)
   {
-    light_color = vertex_color + (exterior_lit ? exterior_ambient_color : ambient_color);
+    light_color = vertex_color + (exterior_lit ? frame.ambient_color.rgb : ambient_color);
   }
   else if(exterior_lit)
   {
-    vec3 ambient = exterior_ambient_color + vertex_color.rgb;
+    vec3 ambient = frame.ambient_color.rgb + vertex_color.rgb;
 
-    light_color = vec3(clamp (exterior_diffuse_color * max(dot(f_normal, exterior_light_dir), 0.0), 0.0, 1.0)) + ambient;
+    light_color = vec3(clamp (frame.diffuse_color.rgb * max(dot(f_normal, frame.light_dir.xyz), 0.0), 0.0, 1.0)) + ambient;
   }
   else
   {
@@ -57,12 +64,12 @@ vec3 lighting(vec3 material)
 
 void main()
 {
-  float dist_from_camera = distance(camera, f_position);
+  float dist_from_camera = distance(frame.camera.xyz, f_position);
   bool fog = draw_fog && !unfogged;
 
-  if(fog && dist_from_camera >= fog_end)
+  if(fog && dist_from_camera >= frame.fog_end)
   {
-    out_color = vec4(fog_color, 1.);
+    out_color = vec4(frame.fog_color.rgb, 1.);
     return;
   }
 
@@ -104,12 +111,12 @@ void main()
     out_color = vec4(lighting(tex.rgb), 1.);
   }
 
-  if(fog && (dist_from_camera >= fog_end * fog_start))
+  if(fog && (dist_from_camera >= frame.fog_end * frame.fog_start))
   {
-    float start = fog_end * fog_start;
-    float alpha = (dist_from_camera - start) / (fog_end - start);
+    float start = frame.fog_end * frame.fog_start;
+    float alpha = (dist_from_camera - start) / (frame.fog_end - start);
 
-    out_color.rgb = mix(out_color.rgb, fog_color, alpha);
+    out_color.rgb = mix(out_color.rgb, frame.fog_color.rgb, alpha);
   }
 
   if(out_color.a < alpha_test)
@@ -13,8 +13,20 @@ out vec2 f_texcoord;
 out vec2 f_texcoord_2;
 out vec4 f_vertex_color;
 
-uniform mat4 model_view;
-uniform mat4 projection;
+// noggit::frame_uniform_data, shared by the world's programs
+layout (std140) uniform frame_block
+{
+  mat4 model_view;
+  mat4 projection;
+  vec4 camera;
+  vec4 fog_color;
+  vec4 light_dir;
+  vec4 terrain_light_dir;
+  vec4 diffuse_color;
+  vec4 ambient_color;
+  float fog_start;
+  float fog_end;
+} frame;
 uniform mat4 transform;
 
 uniform int shader_id;
@@ -22,8 +34,8 @@ uniform int shader_id;
 void main()
 {
   vec4 pos = transform * position;
-  vec4 view_space_pos = model_view * pos;
-  gl_Position = projection * view_space_pos;
+  vec4 view_space_pos = frame.model_view * pos;
+  gl_Position = frame.projection * view_space_pos;
 
   f_position = pos.xyz;
   f_normal = mat3(transform) * normal;
@@ -2,6 +2,7 @@
 
 #include <math/frustum.hpp>
 
+#include <algorithm>
 #include <vector>
 
 namespace math
@@ -58,19 +59,24 @@ namespace math
                            , const vector_3d& v2
                            ) const
   {
-    std::vector<vector_3d> points;
-    points.emplace_back (v1.x, v1.y, v1.z);
-    points.emplace_back (v1.x, v1.y, v2.z);
-    points.emplace_back (v1.x, v2.y, v1.z);
-    points.emplace_back (v1.x, v2.y, v2.z);
-    points.emplace_back (v2.x, v1.y, v1.z);
-    points.emplace_back (v2.x, v1.y, v2.z);
-    points.emplace_back (v2.x, v2.y, v1.z);
-    points.emplace_back (v2.x, v2.y, v2.z);
+    // the box is outside when its corner the farthest along the normal of
+    // one of the planes is behind it
+    for (auto const& plane : _planes)
+    {
+      vector_3d const& normal (plane.normal());
+      vector_3d const farthest ( normal.x >= 0.f ? std::max (v1.x, v2.x) : std::min (v1.x, v2.x)
+                               , normal.y >= 0.f ? std::max (v1.y, v2.y) : std::min (v1.y, v2.y)
+                               , normal.z >= 0.f ? std::max (v1.z, v2.z) : std::min (v1.z, v2.z)
+                               );
 
-    return intersects (points);
-  }
+      if (!(normal * farthest > -plane.distance()))
+      {
+        return false;
+      }
+    }
 
+    return true;
+  }
 
   bool frustum::intersectsSphere ( const vector_3d& position
                                  , const float& radius
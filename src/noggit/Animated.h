@@ -6,8 +6,8 @@
 #include <noggit/MPQ.h>
 #include <noggit/ModelHeaders.h>
 
+#include <algorithm>
 #include <cassert>
-#include <map>
 #include <vector>
 #include <memory>
 
@@ -75,22 +75,42 @@ namespace Animation
 
     Animation::Interpolation::Type::Type_t _interpolationType;
 
-    std::map<AnimationIdType, TimestampTypeVectorType> times;
-    std::map<AnimationIdType, AnimatedTypeVectorType> data;
+    //! the keyframes of one animation
+    struct track
+    {
+      TimestampTypeVectorType times;
+      AnimatedTypeVectorType data;
 
-    // for nonlinear interpolations:
-    std::map<AnimationIdType, AnimatedTypeVectorType> in;
-    std::map<AnimationIdType, AnimatedTypeVectorType> out;
+      // for nonlinear interpolations:
+      AnimatedTypeVectorType in;
+      AnimatedTypeVectorType out;
+    };
 
-  public:
-    bool uses(AnimationIdType anim)
+    //! indexed by animation, they are numbered from 0
+    std::vector<track> _tracks;
+
+    track const* get_track (AnimationIdType anim) const
     {
       if (_globalSequenceID != NO_GLOBAL_SEQUENCE)
       {
         anim = AnimationIdType();
       }
 
-      return !data[anim].empty();
+      return anim < _tracks.size() ? &_tracks[anim] : nullptr;
+    }
+
+  public:
+    bool uses(AnimationIdType anim) const
+    {
+      track const* t = get_track (anim);
+      return t && !t->data.empty();
+    }
+
+    //! the value then depends on the global animation time instead of the
+    //! time in the current animation
+    bool uses_global_sequence() const
+    {
+      return _globalSequenceID != NO_GLOBAL_SEQUENCE;
     }
 
     AnimatedType getValue (AnimationIdType anim, TimestampType time, int animtime)
@@ -108,16 +128,16 @@ namespace Animation
         anim = AnimationIdType();
       }
 
-      TimestampTypeVectorType& timestampVector = times[anim];
-      AnimatedTypeVectorType& dataVector = data[anim];
-      AnimatedTypeVectorType& inVector = in[anim];
-      AnimatedTypeVectorType& outVector = out[anim];
-
-      if (dataVector.empty())
+      if (anim >= _tracks.size() || _tracks[anim].data.empty())
       {
         return AnimatedType();
       }
 
+      TimestampTypeVectorType const& timestampVector = _tracks[anim].times;
+      AnimatedTypeVectorType const& dataVector = _tracks[anim].data;
+      AnimatedTypeVectorType const& inVector = _tracks[anim].in;
+      AnimatedTypeVectorType const& outVector = _tracks[anim].out;
+
       AnimatedType result = dataVector[0];
 
       if (!timestampVector.empty())
@@ -132,14 +152,13 @@ namespace Animation
           time = TimestampType();
         }
 
+        // the key starting the interval containing time, the first one
+        // when there is none
         size_t pos = 0;
-        for (size_t i = 0; i < timestampVector.size() - 1; ++i)
+        auto const next = std::upper_bound (timestampVector.begin(), timestampVector.end(), time);
+        if (next != timestampVector.begin() && next != timestampVector.end())
         {
-          if (time >= timestampVector[i] && time < timestampVector[i + 1])
-          {
-            pos = i;
-            break;
-          }
+          pos = next - timestampVector.begin() - 1;
         }
 
         if (pos == timestampVector.size() - 1 || _interpolationType == Animation::Interpolation::Type::NONE)
@@ -189,16 +208,15 @@ namespace Animation
       const AnimationBlockHeader* timestampHeaders = file.get<AnimationBlockHeader>(animationBlock.ofsTimes);
       const AnimationBlockHeader* keyHeaders = file.get<AnimationBlockHeader>(animationBlock.ofsKeys);
 
+      _tracks.resize (std::max (animationBlock.nTimes, animationBlock.nKeys));
+
       for (size_t j = 0; j < animationBlock.nTimes; ++j)
       {
         const TimestampType* timestamps = j < animation_files.size() && animation_files[j] ?
           animation_files[j]->get<TimestampType>(timestampHeaders[j].ofsEntries) :
           file.get<TimestampType>(timestampHeaders[j].ofsEntries);
 
-        for (size_t i = 0; i < timestampHeaders[j].nEntries; ++i)
-        {
-          times[j].push_back(timestamps[i]);
-        }
+        _tracks[j].times.assign (timestamps, timestamps + timestampHeaders[j].nEntries);
       }
 
       for (size_t j = 0; j < animationBlock.nKeys; ++j)
@@ -211,18 +229,22 @@ namespace Animation
         {
         case Animation::Interpolation::Type::NONE:
         case Animation::Interpolation::Type::LINEAR:
+          _tracks[j].data.reserve (keyHeaders[j].nEntries);
           for (size_t i = 0; i < keyHeaders[j].nEntries; ++i)
           {
-            data[j].push_back(_conversion(keys[i]));
+            _tracks[j].data.push_back(_conversion(keys[i]));
           }
           break;
 
         case Animation::Interpolation::Type::HERMITE:
+          _tracks[j].data.reserve (keyHeaders[j].nEntries);
+          _tracks[j].in.reserve (keyHeaders[j].nEntries);
+          _tracks[j].out.reserve (keyHeaders[j].nEntries);
           for (size_t i = 0; i < keyHeaders[j].nEntries; ++i)
           {
-            data[j].push_back(_conversion(keys[i * 3]));
-            in[j].push_back(_conversion(keys[i * 3 + 1]));
-            out[j].push_back(_conversion(keys[i * 3 + 2]));
+            _tracks[j].data.push_back(_conversion(keys[i * 3]));
+            _tracks[j].in.push_back(_conversion(keys[i * 3 + 1]));
+            _tracks[j].out.push_back(_conversion(keys[i * 3 + 2]));
           }
           break;
         }
@@ -235,23 +257,23 @@ namespace Animation
       {
       case Animation::Interpolation::Type::NONE:
       case Animation::Interpolation::Type::LINEAR:
-        for (size_t i = 0; i < data.size(); ++i)
+        for (track& t : _tracks)
         {
-          for (size_t j = 0; j < data[i].size(); ++j)
+          for (size_t j = 0; j < t.data.size(); ++j)
           {
-            data[i][j] = function(data[i][j]);
+            t.data[j] = function(t.data[j]);
           }
         }
         break;
 
       case Animation::Interpolation::Type::HERMITE:
-        for (size_t i = 0; i < data.size(); ++i)
+        for (track& t : _tracks)
         {
-          for (size_t j = 0; j < data[i].size(); ++j)
+          for (size_t j = 0; j < t.data.size(); ++j)
           {
-            data[i][j] = function(data[i][j]);
-            in[i][j] = function(in[i][j]);
-            out[i][j] = function(out[i][j]);
+            t.data[j] = function(t.data[j]);
+            t.in[j] = function(t.in[j]);
+            t.out[j] = function(t.out[j]);
           }
         }
         break;
@@ -6,132 +6,365 @@
 #include <QtCore/QSettings>
 
 #include <algorithm>
-#include <list>
+#include <cmath>
+#include <tuple>
 
-void AsyncLoader::process()
+namespace
 {
-  AsyncObject* object = nullptr;
+  //! key of the object the current thread is loading, inherited by the
+  //! objects it queues
+  thread_local boost::optional<async_spatial_key> current_spatial_key;
 
+  float distance ( boost::optional<async_spatial_key> const& key
+                 , boost::optional<async_spatial_key> const& focus
+                 )
+  {
+    if (!key || !focus)
+    {
+      return 0.f;
+    }
+
+    return std::hypot (key->x - focus->x, key->z - focus->z);
+  }
+
+  //! heap comparator: true if lhs has to be loaded after rhs
+  struct load_later
+  {
+    template<typename Ticket>
+      bool operator() (Ticket const& lhs, Ticket const& rhs) const
+    {
+      return std::tie (lhs->distance, lhs->sequence)
+           > std::tie (rhs->distance, rhs->sequence);
+    }
+  };
+}
+
+AsyncLoader& AsyncLoader::instance()
+{
+  static AsyncLoader async_loader
+    ( []
+      {
+        QSettings settings;
+        int const threads (settings.value ("async_loader/threads", 0).toInt());
+
+        return threads > 0
+          ? threads
+          : std::max (1, static_cast<int> (std::thread::hardware_concurrency()));
+      }()
+    );
+  return async_loader;
+}
+
+void AsyncLoader::process (std::size_t worker_id)
+{
   QSettings settings;
   bool additional_log = settings.value("additional_file_loading_log", false).toBool();
 
   while (!_stop)
   {
-    {    
-      std::unique_lock<std::mutex> lock (_guard);
+    if (ticket_ptr ticket = next_ticket (worker_id))
+    {
+      --_pending;
+      load (*ticket, additional_log);
+      continue;
+    }
+
+    // _sleeping has to be visible before _pending is checked, see queue_for_load
+    ++_sleeping;
+    {
+      std::unique_lock<std::mutex> lock (_sleep_guard);
+      _work_available.wait (lock, [&] { return !!_stop || _pending.load() > 0; });
+    }
+    --_sleeping;
+  }
+}
+
+AsyncLoader::ticket_ptr AsyncLoader::next_ticket (std::size_t worker_id)
+{
+  worker& self (*_workers[worker_id]);
+
+  {
+    std::lock_guard<std::mutex> const lock (self.guard);
+    update_focus (self);
+  }
 
-      _state_changed.wait 
-      ( lock
-      , [&]
-        {
-          return !!_stop || std::any_of ( _to_load.begin(), _to_load.end()
-                                        , [](auto const& to_load) { return !to_load.empty(); }
-                                        );
-        }
-      );
+  // a lower priority is only looked at if no worker has anything more important
+  for (std::size_t priority (0); priority < priority_count; ++priority)
+  {
+    {
+      std::lock_guard<std::mutex> const lock (self.guard);
+
+      take_submissions (self, priority);
 
-      if (_stop)
+      if (ticket_ptr ticket = pop (self.to_load[priority]))
       {
-        return;
+        return ticket;
       }
+    }
 
-      for (auto& to_load : _to_load)
-      {
-        if (to_load.empty())
-        {
-          continue;
-        }
+    if (ticket_ptr ticket = steal (worker_id, priority))
+    {
+      return ticket;
+    }
+  }
+
+  return nullptr;
+}
 
-        object = to_load.front();
-        _currently_loading.emplace_back (object);
-        to_load.pop_front();
+void AsyncLoader::take_submissions (worker& self, std::size_t priority)
+{
+  submission* node (_submitted[priority].exchange (nullptr, std::memory_order_acquire));
 
-        break;
-      }
+  // the stack is LIFO, reverse it to keep the submission order
+  submission* reversed (nullptr);
+  while (node)
+  {
+    submission* next (node->next);
+    node->next = reversed;
+    reversed = node;
+    node = next;
+  }
+
+  auto& to_load (self.to_load[priority]);
+
+  while (reversed)
+  {
+    std::unique_ptr<submission> current (reversed);
+    reversed = current->next;
+
+    current->ticket->distance = distance (current->ticket->key, self.focus);
+    to_load.emplace_back (std::move (current->ticket));
+    std::push_heap (to_load.begin(), to_load.end(), load_later());
+  }
+}
+
+void AsyncLoader::update_focus (worker& self)
+{
+  unsigned const generation (_focus_generation.load());
+
+  if (generation == self.focus_generation)
+  {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> const lock (_focus_guard);
+    self.focus = _focus;
+  }
+  self.focus_generation = generation;
+
+  for (auto& to_load : self.to_load)
+  {
+    for (auto& ticket : to_load)
+    {
+      ticket->distance = distance (ticket->key, self.focus);
     }
 
-    try
+    std::make_heap (to_load.begin(), to_load.end(), load_later());
+  }
+}
+
+AsyncLoader::ticket_ptr AsyncLoader::pop (std::vector<ticket_ptr>& to_load)
+{
+  if (to_load.empty())
+  {
+    return nullptr;
+  }
+
+  std::pop_heap (to_load.begin(), to_load.end(), load_later());
+  ticket_ptr ticket (std::move (to_load.back()));
+  to_load.pop_back();
+  return ticket;
+}
+
+AsyncLoader::ticket_ptr AsyncLoader::steal (std::size_t thief_id, std::size_t priority)
+{
+  for (std::size_t i (1); i < _workers.size(); ++i)
+  {
+    worker& victim (*_workers[(thief_id + i) % _workers.size()]);
+
+    std::lock_guard<std::mutex> const lock (victim.guard);
+
+    // take the victim's closest object, it may be ranked on an outdated
+    // focus but will be re-ranked with the victim's next pick anyway
+    if (ticket_ptr ticket = pop (victim.to_load[priority]))
     {
-      if (additional_log)
-      {
-        std::lock_guard<std::mutex> const lock(_guard);
-        LogDebug << "Loading '" << object->filename << "'" << std::endl;
-      }
+      return ticket;
+    }
+  }
 
-      object->finishLoading();
+  return nullptr;
+}
 
-      if (additional_log)
-      {
-        std::lock_guard<std::mutex> const lock(_guard);
-        LogDebug << "Loaded  '" << object->filename << "'" << std::endl;
-      }
+void AsyncLoader::load (async_ticket& ticket, bool additional_log)
+{
+  auto expected (async_ticket_state::queued);
+  if (!ticket.state.compare_exchange_strong (expected, async_ticket_state::loading))
+  {
+    // cancelled by ensure_deletable, the object may already be gone
+    return;
+  }
 
-      {
-        std::lock_guard<std::mutex> const lock (_guard);
-        _currently_loading.remove (object);
-        _state_changed.notify_all();
-      }
+  AsyncObject* object (ticket.object);
+
+  current_spatial_key = ticket.key;
+
+  try
+  {
+    if (additional_log)
+    {
+      std::lock_guard<std::mutex> const lock(_guard);
+      LogDebug << "Loading '" << object->filename << "'" << std::endl;
     }
-    catch (...)
+
+    object->finishLoading();
+
+    if (additional_log)
     {
       std::lock_guard<std::mutex> const lock(_guard);
-      object->error_on_loading();
+      LogDebug << "Loaded  '" << object->filename << "'" << std::endl;
+    }
+  }
+  catch (...)
+  {
+    std::lock_guard<std::mutex> const lock(_guard);
+    object->error_on_loading();
 
-      if (object->is_required_when_saving())
-      {
-        _important_object_failed_loading = true;
-      }
+    if (object->is_required_when_saving())
+    {
+      _important_object_failed_loading = true;
     }
   }
+
+  current_spatial_key = boost::none;
+
+  {
+    std::lock_guard<std::mutex> const lock (_guard);
+    ticket.state = async_ticket_state::done;
+  }
+  _state_changed.notify_all();
 }
 
 void AsyncLoader::queue_for_load (AsyncObject* object)
 {
-  std::lock_guard<std::mutex> const lock (_guard);
-  _to_load[(size_t)object->loading_priority()].push_back (object);
-  _state_changed.notify_one();
+  auto key (object->spatial_key());
+  ticket_ptr ticket ( std::make_shared<async_ticket> ( object
+                                                     , object->loading_priority()
+                                                     , key ? key : current_spatial_key
+                                                     , _sequence++
+                                                     )
+                    );
+  std::atomic_store (&object->_loader_ticket, ticket);
+
+  // counted before it is published: a worker taking it right away must
+  // not decrement _pending below zero
+  ++_pending;
+
+  auto& head (_submitted[(std::size_t)ticket->priority]);
+  submission* node (new submission {std::move (ticket), head.load (std::memory_order_relaxed)});
+
+  while (!head.compare_exchange_weak (node->next, node, std::memory_order_release, std::memory_order_relaxed));
+
+  // only take the lock if a worker may be waiting for work, if none is
+  // sleeping yet it is guaranteed to see the new _pending value
+  if (_sleeping.load() > 0)
+  {
+    std::lock_guard<std::mutex> const lock (_sleep_guard);
+    _work_available.notify_one();
+  }
 }
 
 void AsyncLoader::ensure_deletable (AsyncObject* object)
 {
+  ticket_ptr const ticket (std::atomic_load (&object->_loader_ticket));
+
+  if (!ticket)
+  {
+    return;
+  }
+
+  // don't load it if it's just to delete it afterward, the worker
+  // picking up the ticket will drop it
+  auto expected (async_ticket_state::queued);
+  if (ticket->state.compare_exchange_strong (expected, async_ticket_state::cancelled))
+  {
+    return;
+  }
+
   std::unique_lock<std::mutex> lock (_guard);
   _state_changed.wait
-  ( lock
-  , [&]
-    {
-      auto& to_load = _to_load[(size_t)object->loading_priority()];
-      auto const& it = std::find (to_load.begin(), to_load.end(), object);
-      
-      // don't load it if it's just to delete it afterward
-      if (it != to_load.end())
-      {
-        to_load.erase(it);
-        return true;
-      }
-      else
-      {
-        return std::find (_currently_loading.begin(), _currently_loading.end(), object) == _currently_loading.end();
-      }
-    }
-  );
+    (lock, [&] { return ticket->state.load() != async_ticket_state::loading; });
+}
+
+bool AsyncLoader::try_cancel (AsyncObject* object)
+{
+  ticket_ptr const ticket (std::atomic_load (&object->_loader_ticket));
+
+  if (!ticket)
+  {
+    return true;
+  }
+
+  auto expected (async_ticket_state::queued);
+  return ticket->state.compare_exchange_strong (expected, async_ticket_state::cancelled)
+      || expected == async_ticket_state::cancelled
+      || expected == async_ticket_state::done;
+}
+
+void AsyncLoader::set_focus (async_spatial_key focus)
+{
+  std::lock_guard<std::mutex> const lock (_focus_guard);
+
+  if (_focus && _focus->x == focus.x && _focus->z == focus.z)
+  {
+    return;
+  }
+
+  _focus = focus;
+  ++_focus_generation;
 }
 
 AsyncLoader::AsyncLoader(int numThreads)
   : _stop (false)
 {
+  for (auto& head : _submitted)
+  {
+    head = nullptr;
+  }
+
+  // all workers have to exist before the first one may try to steal
   for (int i = 0; i < numThreads; ++i)
   {
-    _threads.emplace_back (&AsyncLoader::process, this);
+    _workers.emplace_back (std::make_unique<worker>());
+  }
+
+  for (std::size_t i = 0; i < _workers.size(); ++i)
+  {
+    _workers[i]->thread = std::thread (&AsyncLoader::process, this, i);
   }
 }
 
 AsyncLoader::~AsyncLoader()
 {
   _stop = true;
-  _state_changed.notify_all();
 
-  for (auto& thread : _threads)
   {
-    thread.join();
+    std::lock_guard<std::mutex> const lock (_sleep_guard);
+    _work_available.notify_all();
+  }
+
+  for (auto& loader_thread : _workers)
+  {
+    loader_thread->thread.join();
+  }
+
+  for (auto& head : _submitted)
+  {
+    submission* node (head.exchange (nullptr));
+    while (node)
+    {
+      std::unique_ptr<submission> current (node);
+      node = current->next;
+    }
   }
 }
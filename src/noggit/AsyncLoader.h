@@ -7,39 +7,96 @@
 #include <array>
 #include <atomic>
 #include <condition_variable>
-#include <list>
 #include <memory>
+#include <mutex>
 #include <thread>
+#include <vector>
 
 class AsyncLoader
 {
 public:
-  static AsyncLoader& instance()
-  {
-    static AsyncLoader async_loader(2);
-    return async_loader;
-  }
+  //! thread count is read from the "async_loader/threads" setting,
+  //! 0 (default) uses one thread per hardware thread.
+  static AsyncLoader& instance();
 
-  //! Ownership is _not_ transferred. Call ensure_deletable to ensure 
+  //! Ownership is _not_ transferred. Call ensure_deletable to ensure
   //! that a previously enqueued object can be destroyed.
+  //! \note lock-free, may be called from any thread
   void queue_for_load (AsyncObject*);
-  
+
+  //! O(1) when the object is still queued, otherwise waits for the
+  //! worker currently loading it to finish
   void ensure_deletable (AsyncObject*);
 
+  //! cancel the object if it is still queued, never waits.
+  //! \return true if the object will not be loaded and can be destroyed
+  bool try_cancel (AsyncObject*);
+
+  //! objects with a spatial key are loaded closest to the focus first
+  //! (within their priority), queued objects are re-ranked when it changes
+  void set_focus (async_spatial_key);
+
   AsyncLoader(int numThreads);
   ~AsyncLoader();
 
+  AsyncLoader (AsyncLoader const&) = delete;
+  AsyncLoader (AsyncLoader&&) = delete;
+  AsyncLoader& operator= (AsyncLoader const&) = delete;
+  AsyncLoader& operator= (AsyncLoader&&) = delete;
+
+  std::size_t thread_count() const { return _workers.size(); }
+
   bool important_object_failed_loading() const { return _important_object_failed_loading; }
   void reset_object_fail() { _important_object_failed_loading = false; }
 
 private:
-  void process();
+  static constexpr std::size_t priority_count = (std::size_t)async_priority::count;
+
+  using ticket_ptr = std::shared_ptr<async_ticket>;
 
+  //! node of the lock-free submission stacks, one stack per priority
+  struct submission
+  {
+    ticket_ptr ticket;
+    submission* next;
+  };
+
+  struct worker
+  {
+    std::mutex guard;
+    //! heaps ordered by distance to the focus, then submission order
+    std::array<std::vector<ticket_ptr>, priority_count> to_load;
+    boost::optional<async_spatial_key> focus;
+    unsigned focus_generation = 0;
+    std::thread thread;
+  };
+
+  void process (std::size_t worker_id);
+
+  ticket_ptr next_ticket (std::size_t worker_id);
+  void take_submissions (worker&, std::size_t priority);
+  void update_focus (worker&);
+  static ticket_ptr pop (std::vector<ticket_ptr>&);
+  ticket_ptr steal (std::size_t thief_id, std::size_t priority);
+
+  void load (async_ticket&, bool additional_log);
+
+  std::atomic<bool> _stop;
+  std::array<std::atomic<submission*>, priority_count> _submitted;
+  std::atomic<std::uint64_t> _sequence = {0};
+  std::atomic<std::size_t> _pending = {0};
+  std::atomic<std::size_t> _sleeping = {0};
+  std::mutex _sleep_guard;
+  std::condition_variable _work_available;
+
+  //! used to wait on objects which are currently being loaded
   std::mutex _guard;
   std::condition_variable _state_changed;
-  std::atomic<bool> _stop;
-  std::array<std::list<AsyncObject*>, (size_t)async_priority::count> _to_load;
-  std::list<AsyncObject*> _currently_loading;
-  std::list<std::thread> _threads;
-  bool _important_object_failed_loading = false;
+
+  std::mutex _focus_guard;
+  boost::optional<async_spatial_key> _focus;
+  std::atomic<unsigned> _focus_generation = {0};
+
+  std::vector<std::unique_ptr<worker>> _workers;
+  std::atomic<bool> _important_object_failed_loading = {false};
 };
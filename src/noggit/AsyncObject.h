@@ -4,8 +4,12 @@
 
 #include <noggit/Log.h>
 
+#include <boost/optional.hpp>
+
 #include <atomic>
+#include <cstdint>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
 #include <string>
 
@@ -17,10 +21,58 @@ enum class async_priority : int
   count
 };
 
+class AsyncObject;
+
+//! position, in tiles, of what an object is loaded for. Objects closer
+//! to the loader's focus (the camera) are loaded first.
+struct async_spatial_key
+{
+  float x;
+  float z;
+};
+
+enum class async_ticket_state : int
+{
+  queued,
+  loading,
+  done,
+  cancelled
+};
+
+//! AsyncLoader's handle to a queued object. It may outlive the object
+//! itself when the object got cancelled while still queued.
+struct async_ticket
+{
+  async_ticket ( AsyncObject* object_
+               , async_priority priority_
+               , boost::optional<async_spatial_key> key_
+               , std::uint64_t sequence_
+               )
+    : object (object_)
+    , priority (priority_)
+    , key (key_)
+    , sequence (sequence_)
+  {}
+
+  AsyncObject* const object;
+  async_priority const priority;
+  boost::optional<async_spatial_key> const key;
+  //! submission order, used to stay FIFO among equally distant objects
+  std::uint64_t const sequence;
+  std::atomic<async_ticket_state> state = {async_ticket_state::queued};
+
+  //! distance to the focus, only touched by the loader with the
+  //! queue holding the ticket locked
+  float distance = 0.f;
+};
+
 class AsyncObject
 {
 private: 
   bool _loading_failed = false;
+
+  friend class AsyncLoader;
+  std::shared_ptr<async_ticket> _loader_ticket;
 protected:
   std::atomic<bool> finished = {false};
   std::mutex _mutex;
@@ -80,5 +132,12 @@ public:
     return async_priority::medium;
   }
 
+  //! without a key, objects queued while loading another object inherit
+  //! its key, e.g. the textures and models of an adt
+  virtual boost::optional<async_spatial_key> spatial_key() const
+  {
+    return boost::none;
+  }
+
   virtual void finishLoading() = 0;
 };
@@ -98,6 +98,27 @@ void ChunkWater::fromFile(MPQFile &f, size_t basePos)
 }
 
 
+std::size_t ChunkWater::save_size()
+{
+  // remove empty layers
+  cleanup();
+
+  if (!hasData(0))
+  {
+    return 0;
+  }
+
+  std::size_t size = (Render.has_value() ? sizeof(MH2O_Render) : 0)
+                   + sizeof(MH2O_Information) * _layers.size();
+
+  for (liquid_layer const& layer : _layers)
+  {
+    size += layer.save_size();
+  }
+
+  return size;
+}
+
 void ChunkWater::save(sExtendableArray& adt, int base_pos, int& header_pos, int& current_pos)
 {
   MH2O_Header header;
@@ -112,7 +133,7 @@ void ChunkWater::save(sExtendableArray& adt, int base_pos, int& header_pos, int&
     if (Render.has_value())
     {
         header.ofsRenderMask = current_pos - base_pos;
-        adt.Insert(current_pos, sizeof(MH2O_Render), reinterpret_cast<char*>(&Render.value()));
+        adt.Write(current_pos, sizeof(MH2O_Render), reinterpret_cast<char*>(&Render.value()));
         current_pos += sizeof(MH2O_Render);
     }
     else
@@ -126,15 +147,13 @@ void ChunkWater::save(sExtendableArray& adt, int base_pos, int& header_pos, int&
     std::size_t info_size = sizeof(MH2O_Information) * _layers.size();
     current_pos += info_size;
 
-    adt.Extend(info_size);
-
     for (liquid_layer& layer : _layers)
     {
       layer.save(adt, base_pos, info_pos, current_pos);
     }
   }
 
-  memcpy(adt.GetPointer<char>(header_pos), &header, sizeof(MH2O_Header));
+  adt.Write(header_pos, sizeof(MH2O_Header), reinterpret_cast<char*>(&header));
   header_pos += sizeof(MH2O_Header);
 }
 
@@ -171,32 +190,51 @@ void ChunkWater::setType(int type, size_t layer)
   }
 }
 
-void ChunkWater::draw ( math::frustum const& frustum
-                      , const float& cull_distance
-                      , const math::vector_3d& camera
-                      , bool camera_moved
-                      , liquid_render& render
-                      , opengl::scoped::use_program& water_shader
-                      , int animtime
-                      , int layer
-                      , display_mode display
-                      )
+void ChunkWater::prepare_draw ( math::frustum const& frustum
+                              , noggit::liquid_tile_render& render
+                              , noggit::liquid_draw_list& draw_list
+                              , std::size_t slot
+                              , const float& cull_distance
+                              , const math::vector_3d& camera
+                              , int layer
+                              , display_mode display
+                              )
 {
   if (!is_visible (cull_distance, frustum, camera, display))
   {
     return;
   }
 
+  if (_need_layers_upload)
+  {
+    for (std::size_t i = 0; i < _layers.size(); ++i)
+    {
+      render.set_vertices (render.slot (slot, i), _layers[i]);
+    }
+    _need_layers_upload = false;
+  }
+
+  auto const add
+    ( [&] (std::size_t i)
+      {
+        liquid_layer const& lq_layer (_layers[i]);
+        draw_list.add ( lq_layer.liquidID()
+                      , render.slot (slot, i)
+                      , lq_layer.lod_ranges (lq_layer.get_lod_level (camera))
+                      );
+      }
+    );
+
   if (layer == -1)
   {
-    for (liquid_layer& lq_layer : _layers)
+    for (std::size_t i = 0; i < _layers.size(); ++i)
     {
-      lq_layer.draw (render, water_shader, camera, camera_moved, animtime);
+      add (i);
     }
   }
   else if (layer < _layers.size())
   {
-    _layers[layer].draw (render, water_shader, camera, camera_moved, animtime);
+    add (layer);
   }
 }
 
@@ -229,6 +267,8 @@ void ChunkWater::update_layers()
 
   _intersect_points.clear();
   _intersect_points = misc::intersection_points(vmin, vmax);
+
+  _need_layers_upload = true;
 }
 
 bool ChunkWater::hasData(size_t layer) const
@@ -320,6 +360,7 @@ void ChunkWater::cleanup()
     if (_layers[i].empty())
     {
       _layers.erase(_layers.begin() + i);
+      _need_layers_upload = true;
     }
   }
 }
@@ -4,7 +4,9 @@
 
 #include <math/frustum.hpp>
 #include <math/vector_3d.hpp>
+#include <noggit/liquid_draw_list.hpp>
 #include <noggit/liquid_layer.hpp>
+#include <noggit/liquid_tile_render.hpp>
 #include <noggit/MapHeaders.h>
 #include <noggit/tool_enums.hpp>
 
@@ -35,18 +37,28 @@ public:
 
   void from_mclq(std::vector<mclq>& layers);
   void fromFile(MPQFile &f, size_t basePos);
+  //! bytes written by save after the MH2O_Header, removes the empty layers
+  std::size_t save_size();
   void save(sExtendableArray& adt, int base_pos, int& header_pos, int& current_pos);
 
-  void draw ( math::frustum const& frustum
-            , const float& cull_distance
-            , const math::vector_3d& camera
-            , bool camera_moved
-            , liquid_render& render
-            , opengl::scoped::use_program& water_shader
-            , int animtime
-            , int layer
-            , display_mode display
-            );
+  //! sends its layers to render when they changed and adds them to
+  //! draw_list when visible, all of them for layer -1. slot is the chunk's
+  //! index in the tile.
+  void prepare_draw ( math::frustum const& frustum
+                    , noggit::liquid_tile_render& render
+                    , noggit::liquid_draw_list& draw_list
+                    , std::size_t slot
+                    , const float& cull_distance
+                    , const math::vector_3d& camera
+                    , int layer
+                    , display_mode display
+                    );
+
+  std::size_t layer_count() const { return _layers.size(); }
+  //! the layers changed since they were last sent to the tile's render
+  bool need_layers_upload() const { return _need_layers_upload; }
+  //! e.g. the tile's render lost them
+  void invalidate_layers_upload() { _need_layers_upload = true; }
 
   bool is_visible ( const float& cull_distance
                   , const math::frustum& frustum
@@ -94,6 +106,7 @@ private:
   std::optional<MH2O_Render> Render;
 
   std::vector<liquid_layer> _layers;
+  bool _need_layers_upload = true;
 
   friend class noggit::scripting::chunk;
 };
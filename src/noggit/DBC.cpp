@@ -47,8 +47,8 @@ std::string AreaDB::getAreaName(int pAreaID)
   try
   {
     AreaDB::Record rec = gAreaDB.getByID(pAreaID);
-    areaName = rec.getLocalizedString(AreaDB::Name);
-    regionID = rec.getUInt(AreaDB::Region);
+    areaName = rec.get<AreaDB::Name>();
+    regionID = rec.get<AreaDB::Region>();
   }
   catch (AreaDB::NotFound)
   {
@@ -59,7 +59,7 @@ std::string AreaDB::getAreaName(int pAreaID)
     try
     {
       AreaDB::Record rec = gAreaDB.getByID(regionID);
-      areaName = std::string(rec.getLocalizedString(AreaDB::Name)) + std::string(": ") + areaName;
+      areaName = std::string(rec.get<AreaDB::Name>()) + std::string(": ") + areaName;
     }
     catch (AreaDB::NotFound)
     {
@@ -81,7 +81,7 @@ std::uint32_t AreaDB::get_area_parent(int area_id)
   try
   {
     AreaDB::Record rec = gAreaDB.getByID(area_id);
-    return rec.getUInt(AreaDB::Region);
+    return rec.get<AreaDB::Region>();
   }
   catch (AreaDB::NotFound)
   {
@@ -96,7 +96,7 @@ std::string MapDB::getMapName(int pMapID)
   try
   {
     MapDB::Record rec = gMapDB.getByID(pMapID);
-    mapName = std::string(rec.getLocalizedString(MapDB::Name));
+    mapName = std::string(rec.get<MapDB::Name>());
   }
   catch (MapDB::NotFound)
   {
@@ -110,8 +110,8 @@ const char * getGroundEffectDoodad(unsigned int effectID, int DoodadNum)
 {
   try
   {
-    unsigned int doodadId = gGroundEffectTextureDB.getByID(effectID).getUInt(GroundEffectTextureDB::Doodads + DoodadNum);
-    return gGroundEffectDoodadDB.getByID(doodadId).getString(GroundEffectDoodadDB::Filename);
+    unsigned int doodadId = gGroundEffectTextureDB.getByID(effectID).get<GroundEffectTextureDB::Doodads>(DoodadNum);
+    return gGroundEffectDoodadDB.getByID(doodadId).get<GroundEffectDoodadDB::Filename>();
   }
   catch (DBCFile::NotFound)
   {
@@ -126,7 +126,7 @@ int LiquidTypeDB::getLiquidType(int pID)
   try
   {
     LiquidTypeDB::Record rec = gLiquidTypeDB.getByID(pID);
-    type = rec.getUInt(LiquidTypeDB::Type);
+    type = rec.get<LiquidTypeDB::Type>();
   }
   catch (LiquidTypeDB::NotFound)
   {
@@ -141,7 +141,7 @@ std::string  LiquidTypeDB::getLiquidName(int pID)
   try
   {
     LiquidTypeDB::Record rec = gLiquidTypeDB.getByID(pID);
-    type = std::string(rec.getString(LiquidTypeDB::Name));
+    type = std::string(rec.get<LiquidTypeDB::Name>());
   }
   catch (MapDB::NotFound)
   {
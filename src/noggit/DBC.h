@@ -10,15 +10,15 @@ class AreaDB : public DBCFile
 {
 public:
   AreaDB() :
-    DBCFile("DBFilesClient\\AreaTable.dbc")
+    DBCFile("DBFilesClient\\AreaTable.dbc", dbc::fields_end<AreaID, Continent, Region, Flags, Name>())
   { }
 
   /// Fields
-  static const size_t AreaID = 0;    // uint
-  static const size_t Continent = 1;  // uint
-  static const size_t Region = 2;    // uint [AreaID]
-  static const size_t Flags = 4;    // bit field
-  static const size_t Name = 11;    // localisation string
+  using AreaID = dbc::field<std::uint32_t, 0>;
+  using Continent = dbc::field<int, 1>;
+  using Region = dbc::field<std::uint32_t, 2>;    // [AreaID]
+  using Flags = dbc::field<std::uint32_t, 4>;    // bit field
+  using Name = dbc::field<dbc::localized_string, 11>;
 
   static std::string getAreaName(int pAreaID);
   static std::uint32_t get_area_parent(int area_id);
@@ -28,17 +28,17 @@ class MapDB : public DBCFile
 {
 public:
   MapDB() :
-    DBCFile("DBFilesClient\\Map.dbc")
+    DBCFile("DBFilesClient\\Map.dbc", dbc::fields_end<MapID, InternalName, AreaType, IsBattleground, Name, LoadingScreen>())
   { }
 
   /// Fields
-  static const size_t MapID = 0;        // uint
-  static const size_t InternalName = 1;    // string
-  static const size_t AreaType = 2;      // uint
-  static const size_t IsBattleground = 4;    // uint
-  static const size_t Name = 5;        // loc
+  using MapID = dbc::field<int, 0>;
+  using InternalName = dbc::field<dbc::string, 1>;
+  using AreaType = dbc::field<std::uint32_t, 2>;
+  using IsBattleground = dbc::field<std::uint32_t, 4>;
+  using Name = dbc::field<dbc::localized_string, 5>;
 
-  static const size_t LoadingScreen = 57;    // uint [LoadingScreen]
+  using LoadingScreen = dbc::field<std::uint32_t, 57>;    // [LoadingScreen]
   static std::string getMapName(int pMapID);
 };
 
@@ -46,134 +46,132 @@ class LoadingScreensDB : public DBCFile
 {
 public:
   LoadingScreensDB() :
-    DBCFile("DBFilesClient\\LoadingScreens.dbc")
+    DBCFile("DBFilesClient\\LoadingScreens.dbc", dbc::fields_end<ID, Name, Path>())
   { }
 
   /// Fields
-  static const size_t ID = 0;        // uint
-  static const size_t Name = 1;      // string
-  static const size_t Path = 2;      // string
+  using ID = dbc::field<std::uint32_t, 0>;
+  using Name = dbc::field<dbc::string, 1>;
+  using Path = dbc::field<dbc::string, 2>;
 };
 
 class LightDB : public DBCFile
 {
 public:
   LightDB() :
-    DBCFile("DBFilesClient\\Light.dbc")
+    DBCFile("DBFilesClient\\Light.dbc", dbc::fields_end<ID, Map, PositionX, PositionY, PositionZ, RadiusInner, RadiusOuter, DataIDs>())
   { }
 
   /// Fields
-  static const size_t ID = 0;        // uint
-  static const size_t Map = 1;      // uint
-  static const size_t PositionX = 2;    // float
-  static const size_t PositionY = 3;    // float
-  static const size_t PositionZ = 4;    // float
-  static const size_t RadiusInner = 5;  // float
-  static const size_t RadiusOuter = 6;  // float
-  static const size_t DataIDs = 7;    // uint[8]
+  using ID = dbc::field<std::uint32_t, 0>;
+  using Map = dbc::field<std::uint32_t, 1>;
+  using PositionX = dbc::field<float, 2>;
+  using PositionY = dbc::field<float, 3>;
+  using PositionZ = dbc::field<float, 4>;
+  using RadiusInner = dbc::field<float, 5>;
+  using RadiusOuter = dbc::field<float, 6>;
+  using DataIDs = dbc::field<std::uint32_t, 7, 8>;
 };
 
 class LightParamsDB : public DBCFile{
 public:
   LightParamsDB() :
-    DBCFile("DBFilesClient\\LightParams.dbc")
+    DBCFile("DBFilesClient\\LightParams.dbc", dbc::fields_end<ID, skybox, water_shallow_alpha, water_deep_alpha, ocean_shallow_alpha, ocean_deep_alpha>())
   { }
 
   /// Fields
-  static const size_t ID = 0;        // uint
-  static const size_t skybox = 2;      // uint ref to LightSkyBox
-  static const size_t water_shallow_alpha = 5;
-  static const size_t water_deep_alpha = 6;
-  static const size_t ocean_shallow_alpha = 7;
-  static const size_t ocean_deep_alpha = 8;
+  using ID = dbc::field<std::uint32_t, 0>;
+  using skybox = dbc::field<std::uint32_t, 2>;      // ref to LightSkyBox
+  using water_shallow_alpha = dbc::field<float, 5>;
+  using water_deep_alpha = dbc::field<float, 6>;
+  using ocean_shallow_alpha = dbc::field<float, 7>;
+  using ocean_deep_alpha = dbc::field<float, 8>;
 };
 
 class LightSkyboxDB : public DBCFile
 {
 public:
   LightSkyboxDB() :
-    DBCFile("DBFilesClient\\LightSkybox.dbc")
+    DBCFile("DBFilesClient\\LightSkybox.dbc", dbc::fields_end<ID, filename, flags>())
   { }
 
   /// Fields
-  static const size_t ID = 0;        // uint
-  static const size_t filename = 1;    // string
-  static const size_t flags = 2;      // uint
+  using ID = dbc::field<std::uint32_t, 0>;
+  using filename = dbc::field<dbc::string, 1>;
+  using flags = dbc::field<std::uint32_t, 2>;
 };
 
 class LightIntBandDB : public DBCFile
 {
 public:
   LightIntBandDB() :
-    DBCFile("DBFilesClient\\LightIntBand.dbc")
+    DBCFile("DBFilesClient\\LightIntBand.dbc", dbc::fields_end<ID, Entries, Times, Values>())
   { }
 
   /// Fields
-  static const size_t ID = 0;        // uint
-  static const size_t Entries = 1;    // uint
-  static const size_t Times = 2;      // uint
-  static const size_t Values = 18;    // uint
+  using ID = dbc::field<std::uint32_t, 0>;
+  using Entries = dbc::field<std::uint32_t, 1>;
+  using Times = dbc::field<std::uint32_t, 2, 16>;
+  using Values = dbc::field<std::uint32_t, 18, 16>;
 };
 
 class LightFloatBandDB : public DBCFile
 {
 public:
   LightFloatBandDB() :
-    DBCFile("DBFilesClient\\LightFloatBand.dbc")
+    DBCFile("DBFilesClient\\LightFloatBand.dbc", dbc::fields_end<ID, Entries, Times, Values>())
   { }
 
   /// Fields
-  static const size_t ID = 0;        // uint
-  static const size_t Entries = 1;    // uint
-  static const size_t Times = 2;      // uint
-  static const size_t Values = 18;    // float
+  using ID = dbc::field<std::uint32_t, 0>;
+  using Entries = dbc::field<std::uint32_t, 1>;
+  using Times = dbc::field<std::uint32_t, 2, 16>;
+  using Values = dbc::field<float, 18, 16>;
 };
 
 class GroundEffectTextureDB : public DBCFile
 {
 public:
   GroundEffectTextureDB() :
-    DBCFile("DBFilesClient\\GroundEffectTexture.dbc")
+    DBCFile("DBFilesClient\\GroundEffectTexture.dbc", dbc::fields_end<ID, Doodads, Weights, Amount, TerrainType>())
   { }
 
   /// Fields
-  static const size_t ID = 0;        // uint
-  static const size_t Doodads = 1;    // uint[4]
-  static const size_t Weights = 5;    // uint[4]
-  static const size_t Amount = 9;      // uint
-  static const size_t TerrainType = 10;  // uint
+  using ID = dbc::field<std::uint32_t, 0>;
+  using Doodads = dbc::field<std::uint32_t, 1, 4>;
+  using Weights = dbc::field<std::uint32_t, 5, 4>;
+  using Amount = dbc::field<std::uint32_t, 9>;
+  using TerrainType = dbc::field<std::uint32_t, 10>;
 };
 
 class GroundEffectDoodadDB : public DBCFile
 {
 public:
   GroundEffectDoodadDB() :
-    DBCFile("DBFilesClient\\GroundEffectDoodad.dbc")
+    DBCFile("DBFilesClient\\GroundEffectDoodad.dbc", dbc::fields_end<ID, InternalID, Filename>())
   { }
 
   /// Fields
-  static const size_t ID = 0;        // uint
-  static const size_t InternalID = 1;    // uint
-  static const size_t Filename = 2;    // string
+  using ID = dbc::field<std::uint32_t, 0>;
+  using InternalID = dbc::field<std::uint32_t, 1>;
+  using Filename = dbc::field<dbc::string, 2>;
 };
 
 class LiquidTypeDB : public DBCFile
 {
 public:
   LiquidTypeDB() :
-    DBCFile("DBFilesClient\\LiquidType.dbc")
+    DBCFile("DBFilesClient\\LiquidType.dbc", dbc::fields_end<ID, Name, Type, ShaderType, TextureFilenames, AnimationX, AnimationY>())
   { }
 
   /// Fields
-  static const size_t ID = 0;        // uint
-  static const size_t Name = 1;      // string
-  static const size_t Type = 3;      // uint
-  static const size_t ShaderType = 14;  // uint
-  static const size_t TextureFilenames = 15;    // string[6]
-  static const size_t TextureTilesPerBlock = 23;  // uint
-  static const size_t Rotation = 24;  // uint
-  static const size_t AnimationX = 23;  // uint
-  static const size_t AnimationY = 24;  // uint
+  using ID = dbc::field<std::uint32_t, 0>;
+  using Name = dbc::field<dbc::string, 1>;
+  using Type = dbc::field<std::uint32_t, 3>;
+  using ShaderType = dbc::field<std::uint32_t, 14>;
+  using TextureFilenames = dbc::field<dbc::string, 15, 6>;
+  using AnimationX = dbc::field<float, 23>;
+  using AnimationY = dbc::field<float, 24>;
 
   static int getLiquidType(int pID);
   static std::string getLiquidName(int pID);
@@ -5,9 +5,12 @@
 #include <noggit/MPQ.h>
 
 #include <string>
+#include <tuple>
+#include <utility>
 
-DBCFile::DBCFile(const std::string& _filename)
+DBCFile::DBCFile(const std::string& _filename, std::size_t required_field_count)
   : filename(_filename)
+  , _required_field_count(required_field_count)
 {}
 
 void DBCFile::open()
@@ -34,6 +37,10 @@ void DBCFile::open()
   {
     throw std::logic_error ("non four-byte-columns not supported");
   }
+  if (fieldCount < _required_field_count)
+  {
+    throw std::logic_error ("\"" + filename + "\" has less fields than expected");
+  }
 
   data.resize (recordSize * recordCount);
   f.read (data.data(), data.size());
@@ -42,4 +49,29 @@ void DBCFile::open()
   f.read (stringTable.data(), stringTable.size());
 
   f.close();
+
+  _id_index = std::make_unique<noggit::dbc_index> (data.data(), recordCount, recordSize, 0);
+}
+
+noggit::dbc_index const& DBCFile::index(size_t field)
+{
+  assert(data.empty() || field < fieldCount);
+
+  if (field == 0 && _id_index)
+  {
+    return *_id_index;
+  }
+
+  std::lock_guard<std::mutex> const lock (_indices_mutex);
+
+  auto it (_indices.find (field));
+  if (it == _indices.end())
+  {
+    it = _indices.emplace ( std::piecewise_construct
+                          , std::forward_as_tuple (field)
+                          , std::forward_as_tuple (data.data(), recordCount, recordSize, field)
+                          ).first;
+  }
+
+  return it->second;
 }
@@ -2,15 +2,52 @@
 
 #pragma once
 
+#include <noggit/dbc_index.hpp>
+
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <stdexcept>
 
+namespace dbc
+{
+  //! offset in the string table
+  struct string {};
+  //! one string per locale
+  struct localized_string {};
+
+  template<typename T> struct column_width { static constexpr std::size_t value = 1; };
+  template<> struct column_width<localized_string> { static constexpr std::size_t value = 9; };
+
+  //! Count consecutive columns of type T starting at Index
+  template<typename T, std::size_t Index, std::size_t Count = 1>
+    struct field
+  {
+    using type = T;
+    static constexpr std::size_t index = Index;
+    static constexpr std::size_t count = Count;
+    //! number of columns a file needs for this field to be valid
+    static constexpr std::size_t end = Index + Count * column_width<T>::value;
+  };
+
+  template<typename... Fields>
+    constexpr std::size_t fields_end()
+  {
+    return std::max ({std::size_t (0), Fields::end...});
+  }
+}
+
 class DBCFile
 {
 public:
-  explicit DBCFile(const std::string& filename);
+  //! \param required_field_count checked when opening so that the typed
+  //! record accessors don't have to
+  explicit DBCFile(const std::string& filename, std::size_t required_field_count = 0);
 
   // Open database. It must be openened before it can be used.
   void open();
@@ -67,7 +104,33 @@ public:
       assert(stringOffset < file.stringSize);
       return file.stringTable.data() + stringOffset;
     }
+
+    //! typed access to a field, e.g. get<AreaDB::Region>()
+    //! \param element for array fields
+    template<typename Field>
+      auto get(size_t element = 0) const
+    {
+      assert(element < Field::count);
+      return value(static_cast<typename Field::type const*>(nullptr), Field::index + element);
+    }
+
   private:
+    template<typename T>
+      T value(T const*, size_t field) const
+    {
+      return *reinterpret_cast<T const*>(offset + field * 4);
+    }
+    const char *value(dbc::string const*, size_t field) const
+    {
+      size_t stringOffset = value(static_cast<std::uint32_t const*>(nullptr), field);
+      assert(stringOffset < file.stringSize);
+      return file.stringTable.data() + stringOffset;
+    }
+    const char *value(dbc::localized_string const*, size_t field) const
+    {
+      return getLocalizedString(field);
+    }
+
     Record(const DBCFile &pfile, unsigned char *poffset) : file(pfile), offset(poffset) {}
     const DBCFile &file;
     unsigned char *offset;
@@ -121,22 +184,33 @@ public:
 
   inline size_t getRecordCount() const { return recordCount; }
   inline size_t getFieldCount() const { return fieldCount; }
+  //! first record with the given value in field, the ID field is indexed
+  //! when opening and the other ones on their first lookup
   inline Record getByID(unsigned int id, size_t field = 0)
   {
-    for (Iterator i = begin(); i != end(); ++i)
+    std::size_t const record (index(field).find(id));
+
+    if (record == noggit::dbc_index::npos)
     {
-      if (i->getUInt(field) == id)
-        return (*i);
+      throw NotFound();
     }
-    throw NotFound();
+
+    return getRecord(record);
   }
 
 private:
+  noggit::dbc_index const& index(size_t field);
+
   std::string filename;
+  std::size_t _required_field_count;
   size_t recordSize;
   size_t recordCount;
   size_t fieldCount;
   size_t stringSize;
   std::vector<unsigned char> data;
   std::vector<char> stringTable;
+
+  std::unique_ptr<noggit::dbc_index> _id_index;
+  std::mutex _indices_mutex;
+  std::map<std::size_t, noggit::dbc_index> _indices;
 };
@@ -3,22 +3,30 @@
 #include <noggit/AsyncLoader.h> // AsyncLoader
 #include <noggit/Log.h>
 #include <noggit/MPQ.h>
+#include <noggit/listfile_cache.hpp>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/optional.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 #include <boost/thread.hpp>
 
 #include <QtCore/QSettings>
+#include <QtCore/QStandardPaths>
 
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <cstdio>
 #include <cstring>
 #include <fstream>
 #include <list>
+#include <map>
 #include <sstream>
 #include <string>
 #include <vector>
+#include <unordered_map>
 #include <unordered_set>
 
 namespace
@@ -28,32 +36,226 @@ namespace
   ArchivesMap _openArchives;
 
   boost::mutex gListfileLoadingMutex;
-  boost::mutex gMPQFileMutex;
+  //! only guards _openArchives, the archives handle concurrent reads themselves
+  boost::shared_mutex gMPQFileMutex;
+
+  enum class file_location
+  {
+    disk,
+    archive,
+    missing,
+  };
+
+  struct indexed_file
+  {
+    file_location location;
+    MPQArchive const* archive;
+    std::size_t archive_order;
+    //! listfiles may name files the archive doesn't have, their entries
+    //! are checked with SFileHasFile on first use
+    bool verified;
+  };
+
+  //! normalized filename -> where to open it from, filled by the
+  //! listfiles, the project folder scan and every lookup not covered by
+  //! those. missing only means that no archive has the file: files written
+  //! to the project folder by other programs are looked for on disk again.
+  std::unordered_map<std::string, indexed_file> gFileIndex;
+  boost::shared_mutex gFileIndexMutex;
+
+  boost::optional<indexed_file> find_indexed (std::string const& normalized)
+  {
+    boost::shared_lock<boost::shared_mutex> const lock (gFileIndexMutex);
+
+    auto const it (gFileIndex.find (normalized));
+    if (it == gFileIndex.end())
+    {
+      return boost::none;
+    }
+    return it->second;
+  }
+
+  bool overrides (indexed_file const& entry, indexed_file const& existing)
+  {
+    switch (entry.location)
+    {
+    case file_location::disk:
+      return true;
+    case file_location::archive:
+      return existing.location == file_location::missing
+          || ( existing.location == file_location::archive
+            && entry.archive_order > existing.archive_order
+             );
+    case file_location::missing:
+      return false;
+    }
+    return false;
+  }
+
+  //! \note gFileIndexMutex has to be locked
+  void index_file_locked (std::string const& normalized, indexed_file const& entry)
+  {
+    auto const inserted (gFileIndex.emplace (normalized, entry));
+    if (!inserted.second && overrides (entry, inserted.first->second))
+    {
+      inserted.first->second = entry;
+    }
+  }
+
+  void index_file (std::string const& normalized, indexed_file const& entry)
+  {
+    boost::unique_lock<boost::shared_mutex> const lock (gFileIndexMutex);
+    index_file_locked (normalized, entry);
+  }
+
+  //! replaces the entry even if it doesn't override the indexed one, for
+  //! entries found to be wrong
+  void reindex_file (std::string const& normalized, indexed_file const& entry)
+  {
+    boost::unique_lock<boost::shared_mutex> const lock (gFileIndexMutex);
+    gFileIndex[normalized] = entry;
+  }
+
+  noggit::mpq::listfile_cache& listfile_cache()
+  {
+    static noggit::mpq::listfile_cache cache
+      ( boost::filesystem::path
+          (QStandardPaths::writableLocation (QStandardPaths::CacheLocation).toStdString())
+      / "listfile.cache"
+      );
+    return cache;
+  }
+
+  //! the entries of archive, of every archive if it is null, and the
+  //! missing files which another archive may have
+  void remove_archives_from_index (MPQArchive const* archive)
+  {
+    boost::unique_lock<boost::shared_mutex> const lock (gFileIndexMutex);
+
+    for (auto it (gFileIndex.begin()); it != gFileIndex.end();)
+    {
+      bool const remove
+        ( it->second.location == file_location::missing
+       || ( it->second.location == file_location::archive
+         && (!archive || it->second.archive == archive)
+          )
+        );
+      it = remove ? gFileIndex.erase (it) : std::next (it);
+    }
+  }
 }
 
 std::unordered_set<std::string> gListfile;
 
+class MPQArchive::scoped_handle
+{
+public:
+  scoped_handle (MPQArchive const& archive)
+    : _archive (archive)
+    , _handle (archive.acquire_handle())
+  {}
+  ~scoped_handle()
+  {
+    if (_handle)
+    {
+      _archive.release_handle (_handle);
+    }
+  }
+
+  scoped_handle (scoped_handle const&) = delete;
+  scoped_handle& operator= (scoped_handle const&) = delete;
+
+  HANDLE get() const { return _handle; }
+
+private:
+  MPQArchive const& _archive;
+  HANDLE const _handle;
+};
+
 void MPQArchive::loadMPQ (AsyncLoader* loader, std::string const& filename, bool doListfile)
 {
-  _openArchives.emplace_back (filename, std::make_unique<MPQArchive> (filename, doListfile));
-  loader->queue_for_load(_openArchives.back().second.get());
+  MPQArchive* archive;
+
+  {
+    boost::unique_lock<boost::shared_mutex> const lock (gMPQFileMutex);
+    _openArchives.emplace_back (filename, std::make_unique<MPQArchive> (filename, doListfile, _openArchives.size()));
+    archive = _openArchives.back().second.get();
+  }
+
+  // the new archive may have files which were missing so far
+  remove_archives_from_index (archive);
+
+  loader->queue_for_load(archive);
 }
 
-MPQArchive::MPQArchive(std::string const& filename, bool doListfile)
+MPQArchive::MPQArchive(std::string const& filename, bool doListfile, std::size_t order)
   : AsyncObject(filename)
-  ,_archiveHandle(nullptr)
+  , _order (order)
 {
-  if (!SFileOpenArchive (filename.c_str(), 0, MPQ_OPEN_NO_LISTFILE | STREAM_FLAG_READ_ONLY, &_archiveHandle))
+  if (HANDLE handle = open_handle())
+  {
+    _handles.emplace_back (handle);
+    _free_handles.emplace_back (handle);
+    LogDebug << "Opened archive " << filename << std::endl;
+  }
+  else
   {
     LogError << "Error opening archive: " << filename << std::endl;
     return;
   }
+
+  finished = !doListfile;
+}
+
+HANDLE MPQArchive::open_handle() const
+{
+  HANDLE handle (nullptr);
+  if (!SFileOpenArchive (filename.c_str(), 0, MPQ_OPEN_NO_LISTFILE | STREAM_FLAG_READ_ONLY, &handle))
+  {
+    return nullptr;
+  }
+  return handle;
+}
+
+HANDLE MPQArchive::acquire_handle() const
+{
+  {
+    std::lock_guard<std::mutex> const lock (_handles_guard);
+
+    if (_handles.empty())
+    {
+      // opening failed in the constructor already, don't retry on every read
+      return nullptr;
+    }
+
+    if (!_free_handles.empty())
+    {
+      HANDLE handle (_free_handles.back());
+      _free_handles.pop_back();
+      return handle;
+    }
+  }
+
+  // open outside of the lock, it reads the archive's header and tables
+  HANDLE handle (open_handle());
+
+  if (handle)
+  {
+    std::lock_guard<std::mutex> const lock (_handles_guard);
+    _handles.emplace_back (handle);
+  }
   else
   {
-    LogDebug << "Opened archive " << filename << std::endl;
+    LogError << "Error opening additional handle for archive: " << filename << std::endl;
   }
 
-  finished = !doListfile;
+  return handle;
+}
+
+void MPQArchive::release_handle (HANDLE handle) const
+{
+  std::lock_guard<std::mutex> const lock (_handles_guard);
+  _free_handles.emplace_back (handle);
 }
 
 void MPQArchive::finishLoading()
@@ -61,40 +263,34 @@ void MPQArchive::finishLoading()
   if (finished)
     return;
 
-  HANDLE fh;
+  // tokenize outside of the lock so archives are handled in parallel
+  boost::optional<std::vector<std::string>> names (listfile_cache().listfile (filename));
 
-  boost::mutex::scoped_lock lock2(gMPQFileMutex);
-  boost::mutex::scoped_lock lock(gListfileLoadingMutex);
-
-  if (SFileOpenFileEx(_archiveHandle, "(listfile)", 0, &fh))
+  if (!names)
   {
-    size_t filesize = SFileGetFileSize(fh, nullptr); //last nullptr for newer version of StormLib
-
-    std::vector<char> readbuffer (filesize);
-    SFileReadFile(fh, readbuffer.data(), filesize, nullptr, nullptr); //last nullptrs for newer version of StormLib
-    SFileCloseFile(fh);
-
-    std::string current;
-    for (char c : readbuffer)
+    std::vector<char> readbuffer;
+    if (readFile ("(listfile)", readbuffer))
     {
-      if (c == '\r')
-      {
-        continue;
-      }
-      if (c == '\n')
-      {
-        gListfile.emplace (noggit::mpq::normalized_filename (current));
-        current.resize (0);
-      }
-      else
-      {
-        current += c;
-      }
+      names = noggit::mpq::tokenize_listfile (readbuffer.data(), readbuffer.size());
+      listfile_cache().store (filename, *names);
     }
+  }
 
-    if (!current.empty())
+  boost::mutex::scoped_lock lock(gListfileLoadingMutex);
+
+  // allFinishLoading() may race with the loader thread
+  if (finished)
+    return;
+
+  if (names)
+  {
+    boost::unique_lock<boost::shared_mutex> const index_lock (gFileIndexMutex);
+    indexed_file const entry {file_location::archive, this, _order, false};
+
+    for (auto& name : *names)
     {
-      gListfile.emplace (noggit::mpq::normalized_filename (current));
+      index_file_locked (name, entry);
+      gListfile.emplace (std::move (name));
     }
   }
 
@@ -104,17 +300,21 @@ void MPQArchive::finishLoading()
   if (MPQArchive::allFinishedLoading())
   {
     LogDebug << "Completed listfile loading: " << gListfile.size() << " files\n";
+    listfile_cache().save();
   }
 }
 
 MPQArchive::~MPQArchive()
 {
-  if (_archiveHandle)
-    SFileCloseArchive(_archiveHandle);
+  for (HANDLE handle : _handles)
+  {
+    SFileCloseArchive (handle);
+  }
 }
 
 bool MPQArchive::allFinishedLoading()
 {
+  boost::shared_lock<boost::shared_mutex> const lock (gMPQFileMutex);
   return std::all_of ( _openArchives.begin(), _openArchives.end()
                      , [] (ArchiveEntry const& archive)
                        {
@@ -125,37 +325,65 @@ bool MPQArchive::allFinishedLoading()
 
 void MPQArchive::allFinishLoading()
 {
-  for (auto& archive : _openArchives)
+  std::vector<MPQArchive*> archives;
+
   {
-    archive.second->finishLoading();
+    boost::shared_lock<boost::shared_mutex> const lock (gMPQFileMutex);
+    for (auto& archive : _openArchives)
+    {
+      archives.emplace_back (archive.second.get());
+    }
+  }
+
+  for (MPQArchive* archive : archives)
+  {
+    archive->finishLoading();
   }
 }
 
 void MPQArchive::unloadAllMPQs()
 {
+  boost::unique_lock<boost::shared_mutex> const lock (gMPQFileMutex);
+  remove_archives_from_index (nullptr);
   _openArchives.clear();
 }
 
 bool MPQArchive::hasFile(std::string const& file) const
 {
-  return SFileHasFile(_archiveHandle, noggit::mpq::normalized_filename_insane (file).c_str());
+  scoped_handle const handle (*this);
+  return handle.get() && SFileHasFile(handle.get(), noggit::mpq::normalized_filename_insane (file).c_str());
 }
 
 void MPQArchive::unloadMPQ(std::string const& filename)
 {
+  boost::unique_lock<boost::shared_mutex> const lock (gMPQFileMutex);
+
   for (auto it = _openArchives.begin(); it != _openArchives.end(); ++it)
   {
     if (it->first == filename)
     {
+      remove_archives_from_index (it->second.get());
       _openArchives.erase(it);
+      break;
     }
   }
 }
 
-bool MPQArchive::openFile(std::string const& file, HANDLE* fileHandle) const
+bool MPQArchive::readFile(std::string const& file, std::vector<char>& buffer) const
 {
-  assert(fileHandle);
-  return SFileOpenFileEx(_archiveHandle, noggit::mpq::normalized_filename_insane (file).c_str(), 0, fileHandle);
+  scoped_handle const handle (*this);
+  HANDLE fileHandle;
+
+  if (!handle.get() || !SFileOpenFileEx(handle.get(), noggit::mpq::normalized_filename_insane (file).c_str(), 0, &fileHandle))
+  {
+    return false;
+  }
+
+  buffer.resize (SFileGetFileSize(fileHandle, nullptr));
+  SFileReadFile(fileHandle, buffer.data(), buffer.size(), nullptr, nullptr); //last nullptrs for newer version of StormLib
+  SFileCloseFile(fileHandle);
+
+  return true;
 }
 
 namespace
@@ -167,15 +395,161 @@ namespace
       / noggit::mpq::normalized_filename (pFilename);
   }
 
-  bool existsInMPQ (std::string const& filename)
+  bool map_loose_files()
+  {
+    static bool const enabled
+      (QSettings().value ("mmap_loose_files", true).toBool());
+    return enabled;
+  }
+
+  //! smaller files are copied: it costs little, and their content can't
+  //! disappear under a reader when another program truncates the file
+  std::uintmax_t const minimum_mapped_size (1 << 20);
+
+  //! \note gMPQFileMutex has to be locked
+  MPQArchive const* find_in_mpq (std::string const& filename)
+  {
+    // later archives are patches and override the earlier ones
+    auto const it ( std::find_if ( _openArchives.rbegin(), _openArchives.rend()
+                                 , [&] (ArchiveEntry const& archive)
+                                   {
+                                     return archive.second->hasFile (filename);
+                                   }
+                                 )
+                  );
+    return it == _openArchives.rend() ? nullptr : it->second.get();
+  }
+}
+
+namespace noggit
+{
+  namespace mpq
+  {
+    //! a loose file moved aside because it was overwritten while mapped,
+    //! deleted with the last mapping of it
+    struct retired_file
+    {
+      boost::filesystem::path path;
+
+      ~retired_file()
+      {
+        boost::system::error_code ec;
+        boost::filesystem::remove (path, ec);
+      }
+    };
+
+    class loose_file_mapping
+    {
+    public:
+      explicit loose_file_mapping (boost::filesystem::path const& path)
+        : _region ( boost::interprocess::file_mapping (path.string().c_str(), boost::interprocess::read_only)
+                  , boost::interprocess::read_only
+                  )
+      {}
+
+      char const* data() const { return static_cast<char const*> (_region.get_address()); }
+      std::size_t size() const { return _region.get_size(); }
+
+      void retire (std::shared_ptr<retired_file> file) { _retired = std::move (file); }
+
+    private:
+      // destroyed after the region, the file is deleted once unmapped
+      std::shared_ptr<retired_file> _retired;
+      boost::interprocess::mapped_region _region;
+    };
+  }
+}
+
+namespace
+{
+  //! the mappings of each loose file, to move it aside before it is
+  //! overwritten: truncating a mapped file makes reading it crash on
+  //! POSIX, and Windows refuses to replace it
+  std::mutex gMappedFilesMutex;
+  std::map<std::string, std::vector<std::weak_ptr<noggit::mpq::loose_file_mapping>>> gMappedFiles;
+  std::atomic<std::size_t> gRetiredFileCount (0);
+
+  std::string mapped_file_key (boost::filesystem::path const& path)
+  {
+    boost::system::error_code ec;
+    auto const canonical (boost::filesystem::weakly_canonical (path, ec));
+    return (ec ? path : canonical).generic_string();
+  }
+
+  //! \note gMappedFilesMutex has to be locked
+  std::vector<std::shared_ptr<noggit::mpq::loose_file_mapping>> live_mappings (std::string const& key)
+  {
+    std::vector<std::shared_ptr<noggit::mpq::loose_file_mapping>> mappings;
+
+    auto const it (gMappedFiles.find (key));
+    if (it == gMappedFiles.end())
+    {
+      return mappings;
+    }
+
+    for (auto const& weak_mapping : it->second)
+    {
+      if (auto mapping = weak_mapping.lock())
+      {
+        mappings.emplace_back (std::move (mapping));
+      }
+    }
+
+    if (mappings.empty())
+    {
+      gMappedFiles.erase (it);
+    }
+    else
+    {
+      it->second.assign (mappings.begin(), mappings.end());
+    }
+
+    return mappings;
+  }
+
+  std::shared_ptr<noggit::mpq::loose_file_mapping> map_loose_file (boost::filesystem::path const& path)
+  {
+    auto mapping (std::make_shared<noggit::mpq::loose_file_mapping> (path));
+
+    std::string const key (mapped_file_key (path));
+    std::lock_guard<std::mutex> const lock (gMappedFilesMutex);
+    live_mappings (key);
+    gMappedFiles[key].emplace_back (mapping);
+
+    return mapping;
+  }
+}
+
+void MPQFile::prepare_overwrite (boost::filesystem::path const& disk_path)
+{
+  std::string const key (mapped_file_key (disk_path));
+  std::lock_guard<std::mutex> const lock (gMappedFilesMutex);
+
+  auto const mappings (live_mappings (key));
+  if (mappings.empty())
+  {
+    return;
+  }
+
+  boost::filesystem::path const aside
+    (disk_path.string() + ".mapped." + std::to_string (gRetiredFileCount++));
+
+  boost::system::error_code ec;
+  boost::filesystem::rename (disk_path, aside, ec);
+  if (ec)
+  {
+    LogError << "Moving the mapped file " << disk_path << " aside failed: " << ec.message() << std::endl;
+    return;
+  }
+
+  auto const retired (std::make_shared<noggit::mpq::retired_file>());
+  retired->path = aside;
+  for (auto const& mapping : mappings)
   {
-    return std::any_of ( _openArchives.begin(), _openArchives.end()
-                       , [&] (ArchiveEntry const& archive)
-                         {
-                           return archive.second->hasFile (filename);
-                         }
-                       );
+    mapping->retire (retired);
   }
+
+  gMappedFiles.erase (key);
 }
 
 /*
@@ -183,49 +557,117 @@ namespace
 */
 MPQFile::MPQFile(std::string const& filename)
   : eof(true)
+  , _data(nullptr)
+  , _size(0)
   , pointer(0)
   , External(false)
   , _disk_path (getDiskPath (filename))
+  , _mpq_path (noggit::mpq::normalized_filename (filename))
 {
   if (filename.empty())
     throw std::runtime_error("MPQFile: filename empty");
 
-  boost::mutex::scoped_lock lock(gMPQFileMutex);
+  // shared: only keeps the archives alive, readers don't block each other
+  boost::shared_lock<boost::shared_mutex> const lock(gMPQFileMutex);
 
-  std::ifstream input(_disk_path.string(), std::ios_base::binary | std::ios_base::in);
-  if (input.is_open())
-  {
-    External = true;
-    eof = false;
+  auto const indexed (find_indexed (_mpq_path));
 
-    input.seekg(0, std::ios::end);
-    buffer.resize (input.tellg());
-    input.seekg(0, std::ios::beg);
+  // missing files may have been written to the project folder since
+  if ((!indexed || indexed->location != file_location::archive) && openFromDisk())
+  {
+    if (!indexed || indexed->location != file_location::disk)
+    {
+      index_file (_mpq_path, {file_location::disk, nullptr, 0, true});
+    }
+    return;
+  }
 
-    input.read(buffer.data(), buffer.size());
+  if (indexed && indexed->location == file_location::missing)
+  {
+    throw std::invalid_argument ("File '" + filename + "' does not exist.");
+  }
 
-    input.close();
+  if ( indexed && indexed->location == file_location::archive
+    && indexed->archive->readFile (filename, buffer)
+     )
+  {
+    eof = false;
+    _data = buffer.data();
+    _size = buffer.size();
     return;
   }
 
+  // not in any listfile, or not in the archive its listfile claims:
+  // probe the archives and remember the result
   for (ArchivesMap::reverse_iterator i = _openArchives.rbegin(); i != _openArchives.rend(); ++i)
   {
-    HANDLE fileHandle;
-
-    if (!i->second->openFile(filename, &fileHandle))
+    if (!i->second->readFile(filename, buffer))
       continue;
 
-    eof = false;
-    buffer.resize (SFileGetFileSize(fileHandle, nullptr));
-    SFileReadFile(fileHandle, buffer.data(), buffer.size(), nullptr, nullptr); //last nullptrs for newer version of StormLib
-    SFileCloseFile(fileHandle);
+    reindex_file (_mpq_path, {file_location::archive, i->second.get(), i->second->_order, true});
 
+    eof = false;
+    _data = buffer.data();
+    _size = buffer.size();
     return;
   }
 
+  reindex_file (_mpq_path, {file_location::missing, nullptr, 0, true});
+
   throw std::invalid_argument ("File '" + filename + "' does not exist.");
 }
 
+bool MPQFile::openFromDisk()
+{
+  boost::system::error_code ec;
+  auto const file_size (boost::filesystem::file_size (_disk_path, ec));
+
+  if (ec)
+  {
+    return false;
+  }
+
+  if (file_size >= minimum_mapped_size && map_loose_files())
+  {
+    try
+    {
+      _mapping = map_loose_file (_disk_path);
+
+      External = true;
+      eof = false;
+      _data = _mapping->data();
+      _size = _mapping->size();
+      return true;
+    }
+    catch (boost::interprocess::interprocess_exception const& e)
+    {
+      LogDebug << "Mapping " << _disk_path << " failed (" << e.what() << "), reading it instead" << std::endl;
+      _mapping.reset();
+    }
+  }
+
+  std::ifstream input(_disk_path.string(), std::ios_base::binary | std::ios_base::in);
+  if (!input.is_open())
+  {
+    return false;
+  }
+
+  External = true;
+  eof = false;
+
+  input.seekg(0, std::ios::end);
+  buffer.resize (input.tellg());
+  input.seekg(0, std::ios::beg);
+
+  input.read(buffer.data(), buffer.size());
+
+  input.close();
+
+  _data = buffer.data();
+  _size = buffer.size();
+  return true;
+}
+
 MPQFile::~MPQFile()
 {
   close();
@@ -233,11 +675,179 @@ MPQFile::~MPQFile()
 
 bool MPQFile::exists (std::string const& filename)
 {
-  return existsOnDisk (filename) || existsInMPQ (filename);
+  std::string const normalized (noggit::mpq::normalized_filename (filename));
+
+  boost::shared_lock<boost::shared_mutex> const lock (gMPQFileMutex);
+
+  auto const indexed (find_indexed (normalized));
+
+  if (indexed && indexed->location == file_location::disk)
+  {
+    return true;
+  }
+
+  if ( indexed && indexed->location == file_location::archive
+    && (indexed->verified || indexed->archive->hasFile (filename))
+     )
+  {
+    if (!indexed->verified)
+    {
+      reindex_file (normalized, {file_location::archive, indexed->archive, indexed->archive_order, true});
+    }
+    return true;
+  }
+
+  // a miss is checked on disk every time, the file may have been written
+  // to the project folder by another program
+  if (existsOnDisk (filename))
+  {
+    return true;
+  }
+
+  if (!indexed || indexed->location == file_location::archive)
+  {
+    if (MPQArchive const* archive = find_in_mpq (filename))
+    {
+      reindex_file (normalized, {file_location::archive, archive, archive->_order, true});
+      return true;
+    }
+  }
+
+  reindex_file (normalized, {file_location::missing, nullptr, 0, true});
+  return false;
 }
+boost::optional<std::string> MPQFile::content_stamp (std::string const& filename)
+{
+  if (!exists (filename))
+  {
+    return boost::none;
+  }
+
+  std::string const normalized (noggit::mpq::normalized_filename (filename));
+
+  boost::shared_lock<boost::shared_mutex> const lock (gMPQFileMutex);
+
+  auto const indexed (find_indexed (normalized));
+
+  // like the constructor, loose files win unless an archive is known to have it
+  if (!indexed || indexed->location != file_location::archive)
+  {
+    boost::filesystem::path const disk_path (getDiskPath (filename));
+    boost::system::error_code size_error;
+    boost::system::error_code time_error;
+    auto const size (boost::filesystem::file_size (disk_path, size_error));
+    auto const time (boost::filesystem::last_write_time (disk_path, time_error));
+
+    if (!size_error && !time_error)
+    {
+      return normalized + ":" + std::to_string (size) + ":" + std::to_string (time);
+    }
+  }
+
+  if (indexed && indexed->location == file_location::archive)
+  {
+    boost::system::error_code time_error;
+    auto const time (boost::filesystem::last_write_time (indexed->archive->filename, time_error));
+
+    return normalized + ":" + indexed->archive->filename + ":" + std::to_string (time_error ? 0 : time);
+  }
+
+  return boost::none;
+}
+
 bool MPQFile::existsOnDisk (std::string const& filename)
 {
-  return boost::filesystem::exists (getDiskPath (filename));
+  std::string const normalized (noggit::mpq::normalized_filename (filename));
+  auto const indexed (find_indexed (normalized));
+
+  if (indexed && indexed->location == file_location::disk)
+  {
+    return true;
+  }
+
+  if (!boost::filesystem::exists (getDiskPath (filename)))
+  {
+    return false;
+  }
+
+  index_file (normalized, {file_location::disk, nullptr, 0, true});
+  return true;
+}
+
+void MPQFile::index_written_file (boost::filesystem::path const& disk_path)
+{
+  QSettings settings;
+  boost::filesystem::path const project_path
+    (settings.value ("project/path").toString().toStdString());
+
+  boost::system::error_code ec;
+  auto const relative
+    ( boost::filesystem::relative ( boost::filesystem::weakly_canonical (disk_path, ec)
+                                  , boost::filesystem::weakly_canonical (project_path, ec)
+                                  , ec
+                                  )
+    );
+
+  if (ec || relative.empty() || *relative.begin() == "..")
+  {
+    return;
+  }
+
+  std::string const normalized (noggit::mpq::normalized_filename (relative.generic_string()));
+
+  // only found under the name MPQFile looks for, see getDiskPath
+  if (relative.generic_string() == normalized || boost::filesystem::exists (project_path / normalized))
+  {
+    index_file (normalized, {file_location::disk, nullptr, 0, true});
+  }
+}
+
+void MPQFile::index_project_directory (boost::filesystem::path const& project_path)
+{
+  boost::system::error_code ec;
+  std::size_t count (0);
+
+  boost::unique_lock<boost::shared_mutex> const lock (gFileIndexMutex);
+
+  for ( boost::filesystem::recursive_directory_iterator it (project_path, ec), end
+      ; !ec && it != end
+      ; it.increment (ec)
+      )
+  {
+    if (!boost::filesystem::is_regular_file (it->status()))
+    {
+      continue;
+    }
+
+    auto const relative (boost::filesystem::relative (it->path(), project_path, ec));
+    if (ec)
+    {
+      ec.clear();
+      continue;
+    }
+
+    std::string const normalized (noggit::mpq::normalized_filename (relative.generic_string()));
+
+    // files are opened by their normalized name, a name differing in case
+    // only exists on case insensitive file systems
+    if ( relative.generic_string() != normalized
+      && !boost::filesystem::exists (project_path / normalized)
+       )
+    {
+      continue;
+    }
+
+    index_file_locked (normalized, {file_location::disk, nullptr, 0, true});
+    ++count;
+  }
+
+  if (ec)
+  {
+    LogError << "Indexing the project folder " << project_path << " failed: " << ec.message() << std::endl;
+    return;
+  }
+
+  LogDebug << "Indexed " << count << " files in the project folder" << std::endl;
 }
 
 size_t MPQFile::read(void* dest, size_t bytes)
@@ -246,12 +856,12 @@ size_t MPQFile::read(void* dest, size_t bytes)
     return 0;
 
   size_t rpos = pointer + bytes;
-  if (rpos > buffer.size()) {
-    bytes = buffer.size() - pointer;
+  if (rpos > _size) {
+    bytes = _size - pointer;
     eof = true;
   }
 
-  memcpy(dest, &(buffer[pointer]), bytes);
+  memcpy(dest, _data + pointer, bytes);
 
   pointer = rpos;
 
@@ -266,13 +876,13 @@ bool MPQFile::isEof() const
 void MPQFile::seek(size_t offset)
 {
   pointer = offset;
-  eof = (pointer >= buffer.size());
+  eof = (pointer >= _size);
 }
 
 void MPQFile::seekRelative(size_t offset)
 {
   pointer += offset;
-  eof = (pointer >= buffer.size());
+  eof = (pointer >= _size);
 }
 
 void MPQFile::close()
@@ -282,7 +892,7 @@ void MPQFile::close()
 
 size_t MPQFile::getSize() const
 {
-  return buffer.size();
+  return _size;
 }
 
 size_t MPQFile::getPos() const
@@ -292,12 +902,22 @@ size_t MPQFile::getPos() const
 
 char const* MPQFile::getBuffer() const
 {
-  return buffer.data();
+  return _data;
 }
 
 char const* MPQFile::getPointer() const
 {
-  return buffer.data() + pointer;
+  return _data + pointer;
+}
+
+void MPQFile::setBuffer (std::vector<char> const& vec)
+{
+  // unmap first, the file may be overwritten by SaveFile afterwards
+  _mapping.reset();
+
+  buffer = vec;
+  _data = buffer.data();
+  _size = buffer.size();
 }
 
 void MPQFile::SaveFile()
@@ -312,16 +932,48 @@ void MPQFile::SaveFile()
     LogError << "Creating directory \"" << directory_name << "\" failed: " << ec << ". Saving is highly likely to fail." << std::endl;
   }
 
-  std::ofstream output(_disk_path.string(), std::ios_base::binary | std::ios_base::out);
-  if (output.is_open())
+  // the file backing the mapping is about to be replaced
+  if (_mapping)
+  {
+    setBuffer (std::vector<char> (_data, _data + _size));
+  }
+
+  // write next to the file and replace it afterwards so that an
+  // interrupted save never leaves a truncated file behind
+  boost::filesystem::path const temporary (_disk_path.string() + ".tmp");
+
   {
-    NOGGIT_LOG << "Saving file \"" << _disk_path << "\"." << std::endl;
+    std::ofstream output(temporary.string(), std::ios_base::binary | std::ios_base::out | std::ios_base::trunc);
+    if (!output.is_open())
+    {
+      LogError << "Could not open \"" << temporary << "\" for writing." << std::endl;
+      return;
+    }
 
-    output.write(buffer.data(), buffer.size());
+    output.write(_data, _size);
     output.close();
 
-    External = true;
+    if (!output)
+    {
+      LogError << "Writing \"" << temporary << "\" failed." << std::endl;
+      boost::filesystem::remove (temporary, ec);
+      return;
+    }
   }
+
+  prepare_overwrite (_disk_path);
+  boost::filesystem::rename (temporary, _disk_path, ec);
+  if (ec)
+  {
+    LogError << "Replacing \"" << _disk_path << "\" failed: " << ec.message() << std::endl;
+    boost::filesystem::remove (temporary, ec);
+    return;
+  }
+
+  NOGGIT_LOG << "Saved file \"" << _disk_path << "\"." << std::endl;
+
+  External = true;
+  index_file (_mpq_path, {file_location::disk, nullptr, 0, true});
 }
 
 namespace noggit
@@ -7,12 +7,23 @@
 #include <StormLib.h>
 
 #include <boost/filesystem/path.hpp>
+#include <boost/optional.hpp>
 
+#include <memory>
+#include <mutex>
 #include <set>
 #include <string>
 #include <unordered_set>
 #include <vector>
 
+namespace noggit
+{
+  namespace mpq
+  {
+    class loose_file_mapping;
+  }
+}
+
 class AsyncLoader;
 class MPQArchive;
 class MPQFile;
@@ -21,15 +32,28 @@ extern std::unordered_set<std::string> gListfile;
 
 class MPQArchive : public AsyncObject
 {
-  HANDLE _archiveHandle;
+  //! StormLib handles must not be shared between threads, so every
+  //! reader borrows one from the pool, opening a new one if all are taken
+  mutable std::mutex _handles_guard;
+  mutable std::vector<HANDLE> _free_handles;
+  mutable std::vector<HANDLE> _handles;
+
+  //! position in the load order, later archives override earlier ones
+  std::size_t const _order;
+
+  class scoped_handle;
+  HANDLE open_handle() const;
+  HANDLE acquire_handle() const;
+  void release_handle (HANDLE) const;
 
 public:
-  MPQArchive(const std::string& filename, bool doListfile);
+  MPQArchive(const std::string& filename, bool doListfile, std::size_t order);
 
   ~MPQArchive();
 
   bool hasFile(const std::string& filename) const;
-  bool openFile(const std::string& filename, HANDLE* fileHandle) const;
+  //! \return false if the archive doesn't contain the file
+  bool readFile(const std::string& filename, std::vector<char>& buffer) const;
 
   void finishLoading();
 
@@ -47,14 +71,23 @@ public:
 class MPQFile
 {
   bool eof;
+  //! owned content, used for files read from archives and set by setBuffer
   std::vector<char> buffer;
+  //! large loose files are mapped instead of copied into buffer
+  std::shared_ptr<noggit::mpq::loose_file_mapping> _mapping;
+  //! view on either buffer or _mapping
+  char const* _data;
+  size_t _size;
   size_t pointer;
 
 
   bool External;
   boost::filesystem::path _disk_path;
+  //! normalized name, the key into the file index
   std::string _mpq_path;
 
+  bool openFromDisk();
+
 public:
   explicit MPQFile(const std::string& pFilename);  // filenames are not case sensitive, the are if u dont use a filesystem which is kinda shitty...
 
@@ -82,19 +115,35 @@ public:
   template<typename T>
   const T* get(size_t offset) const
   {
-    return reinterpret_cast<T const*>(buffer.data() + offset);
+    return reinterpret_cast<T const*>(_data + offset);
   }
 
-  void setBuffer (std::vector<char> const& vec)
-  {
-    buffer = vec;
-  }
+  void setBuffer (std::vector<char> const& vec);
 
   void SaveFile();
 
+  //! has to be called before a loose file is overwritten or truncated in
+  //! place: if MPQFiles still map it, it is moved aside and deleted once
+  //! they are closed, so that they keep reading the old content
+  static void prepare_overwrite (boost::filesystem::path const& disk_path);
+
   static bool exists (std::string const& filename);
   static bool existsOnDisk (std::string const& filename);
 
+  //! identifies the content of a file without reading it: its name with
+  //! the size and modification time of the loose file, or the archive it
+  //! is read from and the modification time of that one
+  static boost::optional<std::string> content_stamp (std::string const& filename);
+
+  //! to be called after writing a file without SaveFile, so that it is
+  //! found even if the game's archives have a file of the same name
+  static void index_written_file (boost::filesystem::path const& disk_path);
+
+  //! add every file of the project folder to the file index. Files added
+  //! to the folder by other programs afterwards are only found if they
+  //! are not in the game's archives.
+  static void index_project_directory (boost::filesystem::path const& project_path);
+
   friend class MPQArchive;
 };
 
@@ -11,6 +11,7 @@
 #include <noggit/Misc.h>
 #include <noggit/World.h>
 #include <noggit/alphamap.hpp>
+#include <noggit/map_file_layout.hpp>
 #include <noggit/texture_set.hpp>
 #include <noggit/tool_enums.hpp>
 #include <noggit/ui/TexturingGUI.h>
@@ -153,15 +154,12 @@ MapChunk::MapChunk(MapTile *maintile, MPQFile *f, bool bigAlpha, tile_mode mode)
       }
       _shadow_map[63 * 64 + 63] = _shadow_map[62 * 64 + 62];
     }
-
-    _has_shadow = true;
   }
   else
   {
     /** We have no shadow map (MCSH), so we got no shadows at all!  **
     ** This results in everything being black.. Yay. Lets fake it! **/
     memset(_shadow_map, 0, 64 * 64);
-    _has_shadow = false;
   }
   // - MCCV ----------------------------------------------
   if(header.ofsMCCV)
@@ -240,47 +238,46 @@ void MapChunk::update_intersect_points()
 
   _intersect_points.clear();
   _intersect_points = misc::intersection_points(vmin, vmax);
+
+  _height_quadtree.update(mVertices);
 }
 
-void MapChunk::upload()
+void MapChunk::upload_changes(noggit::terrain_tile_render& render, std::size_t slot)
 {
-  // uid fix adt should never/can't be rendered
-  // add the check here once to avoid checks all over the place
-  // editing requires rendering anyway
-  if (_mode == tile_mode::uid_fix_all)
+  if (_need_vertices_upload)
   {
-    throw std::logic_error("Trying to render an ADT/chunk that is supposed to be used for the uid fix all only");
+    render.set_vertices(slot, mVertices);
+    _need_vertices_upload = false;
   }
 
-  _vertex_array.upload();
-  _buffers.upload();
-  lod_indices.upload();
-
-  update_shadows();
-
-  // fill vertex buffers
-  gl.bufferData<GL_ARRAY_BUFFER> (_vertices_vbo, sizeof(mVertices), mVertices, GL_STATIC_DRAW);
-  gl.bufferData<GL_ARRAY_BUFFER> (_normals_vbo, sizeof(mNormals), mNormals, GL_STATIC_DRAW);
-  gl.bufferData<GL_ARRAY_BUFFER> (_mccv_vbo, sizeof(mccv), mccv, GL_STATIC_DRAW);
-
-  update_indices_buffer();
-  _uploaded = true;
-}
+  if (_need_normals_upload)
+  {
+    render.set_normals(slot, mNormals);
+    _need_normals_upload = false;
+  }
 
-void MapChunk::update_indices_buffer()
-{
+  if (_need_mccv_upload)
   {
-    opengl::scoped::buffer_binder<GL_ELEMENT_ARRAY_BUFFER> const _ (_indices_buffer);
-    gl.bufferData (GL_ELEMENT_ARRAY_BUFFER, strip_with_holes.size() * sizeof (StripType), strip_with_holes.data(), GL_STATIC_DRAW);
+    render.set_colors(slot, mccv);
+    _need_mccv_upload = false;
   }
 
-  for (int lod_level = 0; lod_level < 4; ++lod_level)
+  if (_need_indice_buffer_update)
   {
-    opengl::scoped::buffer_binder<GL_ELEMENT_ARRAY_BUFFER> const _ (lod_indices[lod_level]);
-    gl.bufferData (GL_ELEMENT_ARRAY_BUFFER, strip_lods[lod_level].size() * sizeof (StripType), strip_lods[lod_level].data(), GL_STATIC_DRAW);
+    render.set_indices(slot, strip_with_holes, strip_lods);
+    _need_indice_buffer_update = false;
   }
 
-  _need_indice_buffer_update = false;
+  if (_need_shadow_upload || texture_set->alphamaps_changed())
+  {
+    std::array<uint8_t, noggit::terrain_alphamap_layer::texel_count * 4> alphamap;
+
+    texture_set->write_alphamaps(alphamap.data());
+    noggit::terrain_alphamap_layer::write_shadow(alphamap.data(), _shadow_map);
+
+    render.set_alphamap(slot, alphamap.data());
+    _need_shadow_upload = false;
+  }
 }
 
 boost::optional<int> MapChunk::get_lod_level(math::vector_3d const& camera_pos, display_mode display) const
@@ -341,59 +338,7 @@ bool MapChunk::shadow_map_is_empty() const
 
 void MapChunk::initStrip()
 {
-  strip_with_holes.clear();
-  strip_without_holes.clear();
-  strip_lods.clear();
-
-  for (int x = 0; x<8; ++x)
-  {
-    for (int y = 0; y<8; ++y)
-    {
-      strip_without_holes.emplace_back (indexLoD(y, x)); //9
-      strip_without_holes.emplace_back (indexNoLoD(y, x)); //0
-      strip_without_holes.emplace_back (indexNoLoD(y + 1, x)); //17
-      strip_without_holes.emplace_back (indexLoD(y, x)); //9
-      strip_without_holes.emplace_back (indexNoLoD(y + 1, x)); //17
-      strip_without_holes.emplace_back (indexNoLoD(y + 1, x + 1)); //18
-      strip_without_holes.emplace_back (indexLoD(y, x)); //9
-      strip_without_holes.emplace_back (indexNoLoD(y + 1, x + 1)); //18
-      strip_without_holes.emplace_back (indexNoLoD(y, x + 1)); //1
-      strip_without_holes.emplace_back (indexLoD(y, x)); //9
-      strip_without_holes.emplace_back (indexNoLoD(y, x + 1)); //1
-      strip_without_holes.emplace_back (indexNoLoD(y, x)); //0
-
-      if (isHole(x / 2, y / 2))
-        continue;
-
-      // todo: better hole check ?
-      for (int lod_level = 0; lod_level < 4; ++lod_level)
-      {
-        int n = 1 << lod_level;
-        if ((x % n) == 0 && (y % n) == 0)
-        {
-          strip_lods[lod_level].emplace_back (indexNoLoD(y, x)); //0
-          strip_lods[lod_level].emplace_back (indexNoLoD(y + n, x)); //17
-          strip_lods[lod_level].emplace_back (indexNoLoD(y + n, x + n)); //18
-          strip_lods[lod_level].emplace_back (indexNoLoD(y + n, x + n)); //18
-          strip_lods[lod_level].emplace_back (indexNoLoD(y, x + n)); //1
-          strip_lods[lod_level].emplace_back (indexNoLoD(y, x)); //0
-        }
-      }
-
-      strip_with_holes.emplace_back (indexLoD(y, x)); //9
-      strip_with_holes.emplace_back (indexNoLoD(y, x)); //0
-      strip_with_holes.emplace_back (indexNoLoD(y + 1, x)); //17
-      strip_with_holes.emplace_back (indexLoD(y, x)); //9
-      strip_with_holes.emplace_back (indexNoLoD(y + 1, x)); //17
-      strip_with_holes.emplace_back (indexNoLoD(y + 1, x + 1)); //18
-      strip_with_holes.emplace_back (indexLoD(y, x)); //9
-      strip_with_holes.emplace_back (indexNoLoD(y + 1, x + 1)); //18
-      strip_with_holes.emplace_back (indexNoLoD(y, x + 1)); //1
-      strip_with_holes.emplace_back (indexLoD(y, x)); //9
-      strip_with_holes.emplace_back (indexNoLoD(y, x + 1)); //1
-      strip_with_holes.emplace_back (indexNoLoD(y, x)); //0
-    }
-  }
+  noggit::terrain_tile_layout::build_strips(holes, strip_with_holes, strip_lods);
 
   _need_indice_buffer_update = true;
 }
@@ -485,13 +430,7 @@ void MapChunk::clearHeight()
 
   update_intersect_points();
 
-  if (_uploaded)
-  {
-    gl.bufferData<GL_ARRAY_BUFFER>
-      (_vertices_vbo, sizeof(mVertices), mVertices, GL_STATIC_DRAW);
-
-    _need_vao_update = true;
-  }
+  _need_vertices_upload = true;
 }
 
 bool MapChunk::is_visible ( const float& cull_distance
@@ -511,19 +450,6 @@ bool MapChunk::is_visible ( const float& cull_distance
 }
 
 
-void MapChunk::update_vao(opengl::scoped::use_program& mcnk_shader, GLuint const& tex_coord_vbo)
-{
-  opengl::scoped::vao_binder const _ (_vao);
-
-  mcnk_shader.attrib(_, "position", _vertices_vbo, 3, GL_FLOAT, GL_FALSE, 0, 0);
-  mcnk_shader.attrib(_, "normal", _normals_vbo, 3, GL_FLOAT, GL_FALSE, 0, 0);
-  mcnk_shader.attrib(_, "mccv", _mccv_vbo, 3, GL_FLOAT, GL_FALSE, 0, 0);
-  mcnk_shader.attrib(_, "texcoord", tex_coord_vbo, 2, GL_FLOAT, GL_FALSE, 0, 0);
-
-  _need_vao_update = false;
-  _need_indice_buffer_update = true;
-}
-
 void MapChunk::update_visibility ( const float& cull_distance
                                  , const math::frustum& frustum
                                  , const math::vector_3d& camera
@@ -534,28 +460,24 @@ void MapChunk::update_visibility ( const float& cull_distance
 
   _is_visible = is_visible(cull_distance, frustum, camera, display);
   _need_visibility_update = false;
-  _need_lod_update |= lod != _lod_level;
   _lod_level = lod;
 }
 
-void MapChunk::draw ( math::frustum const& frustum
-                    , opengl::scoped::use_program& mcnk_shader
-                    , GLuint const& tex_coord_vbo
-                    , const float& cull_distance
-                    , const math::vector_3d& camera
-                    , bool need_visibility_update
-                    , bool show_unpaintable_chunks
-                    , bool draw_paintability_overlay
-                    , bool draw_chunk_flag_overlay
-                    , bool draw_areaid_overlay
-                    , std::map<int, misc::random_color>& area_id_colors
-                    , int animtime
-                    , display_mode display
-                    , bool& previous_chunk_had_shadows
-                    , bool& previous_chunk_was_textured
-                    , bool& previous_chunk_could_be_painted
-                    , std::vector<int>& textures_bound
-                    )
+void MapChunk::prepare_draw ( math::frustum const& frustum
+                            , noggit::terrain_tile_render& render
+                            , noggit::terrain_draw_list& draw_list
+                            , std::size_t slot
+                            , const float& cull_distance
+                            , const math::vector_3d& camera
+                            , bool need_visibility_update
+                            , bool show_unpaintable_chunks
+                            , bool draw_paintability_overlay
+                            , bool draw_chunk_flag_overlay
+                            , bool draw_areaid_overlay
+                            , std::map<int, misc::random_color>& area_id_colors
+                            , int animtime
+                            , display_mode display
+                            )
 {
   if (need_visibility_update || _need_visibility_update)
   {
@@ -567,131 +489,74 @@ void MapChunk::draw ( math::frustum const& frustum
     return;
   }
 
-  if (!_uploaded)
-  {
-    upload();
-    // force lod update on upload
-    _need_lod_update = true;
-    update_visibility(cull_distance, frustum, camera, display);
-  }
-
-  // todo update lod too
-  if (_need_vao_update)
-  {
-    update_vao(mcnk_shader, tex_coord_vbo);
-  }
+  upload_changes(render, slot);
 
   int texture_count = texture_set->num();
-  bool is_textured = texture_count != 0;
+  noggit::terrain_chunk_parameters parameters {};
+  noggit::terrain_draw_list::texture_key textures = {-1, -1, -1, -1};
 
-  if (is_textured)
+  for (int i = 0; i < 4; ++i)
   {
-    texture_set->bind_alpha(0);
+    math::vector_2d anim;
 
-    for (int i = 0; i < texture_count; ++i)
+    if (i < texture_count)
     {
-      texture_set->bindTexture(i, i + 1, textures_bound);
+      textures[i] = texture_set->blp_id(i);
 
       if (texture_set->is_animated(i))
       {
-        mcnk_shader.uniform("tex_anim_"+ std::to_string(i), texture_set->anim_uv_offset(i, animtime));
+        anim = texture_set->anim_uv_offset(i, animtime);
       }
     }
-  }
 
-  // only update the shadow texture if there's a shadow map used
-  // OR if the last chunk had a shadow and this one doesn't (bind the default all 0 texture)
-  if (_has_shadow || previous_chunk_had_shadows)
-  {
-    opengl::texture::set_active_texture(5);
-    shadow.bind();
+    parameters.texture_animations[i / 2][(i % 2) * 2] = anim.x;
+    parameters.texture_animations[i / 2][(i % 2) * 2 + 1] = anim.y;
   }
-  previous_chunk_had_shadows = _has_shadow;
 
-  if (is_textured != previous_chunk_was_textured)
-  {
-    previous_chunk_was_textured = is_textured;
-    mcnk_shader.uniform("is_textured", (int)is_textured);
-  }
+  bool cant_paint = show_unpaintable_chunks
+    && draw_paintability_overlay
+    && texture_count == 4
+    && noggit::ui::selected_texture::get()
+    && !canPaintTexture(*noggit::ui::selected_texture::get());
 
-  if (show_unpaintable_chunks && draw_paintability_overlay)
-  {
-    bool cant_paint = texture_count == 4 
-      && noggit::ui::selected_texture::get()
-      && !canPaintTexture(*noggit::ui::selected_texture::get());
-
-    if (cant_paint == previous_chunk_could_be_painted)
-    {
-      mcnk_shader.uniform("cant_paint", (int)cant_paint);
-      previous_chunk_could_be_painted = !cant_paint;
-    }    
-  }
-
-  if (draw_chunk_flag_overlay)
-  {
-    mcnk_shader.uniform ("draw_impassible_flag", (int)header_flags.flags.impass);
-  }
-
-  if (draw_areaid_overlay)
-  {
-    mcnk_shader.uniform("areaid_color", (math::vector_4d)area_id_colors[areaID]);
-  }
-
-  gl.bindVertexArray(_vao);
-
-  if (_need_indice_buffer_update)
-  {
-    update_indices_buffer();
-    _need_lod_update = true;
-  }
+  parameters.areaid_color = draw_areaid_overlay
+                          ? (math::vector_4d)area_id_colors[areaID]
+                          : math::vector_4d();
+  parameters.flags = { texture_count != 0
+                     , cant_paint
+                     , draw_chunk_flag_overlay && header_flags.flags.impass
+                     , 0
+                     };
+  render.set_parameters(slot, parameters);
 
-  if (_need_lod_update)
+  if (!_lod_level)
   {
-    gl.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, !_lod_level ? _indices_buffer : lod_indices[*_lod_level]);
-    _lod_level_indice_count = !_lod_level ? strip_with_holes.size() : strip_lods[*_lod_level].size();
-    _need_lod_update = false;
+    draw_list.add ( textures
+                  , slot
+                  , noggit::terrain_tile_layout::first_index(slot, _lod_level)
+                  , strip_with_holes.size()
+                  );
   }
-
-  gl.drawElements(GL_TRIANGLES, _lod_level_indice_count, GL_UNSIGNED_SHORT, opengl::index_buffer_is_already_bound{});
-
-
-  for (int i = 0; i < texture_count; ++i)
+  else
   {
-    if (texture_set->is_animated(i))
-    {
-      mcnk_shader.uniform("tex_anim_" + std::to_string(i), math::vector_2d());
-    }
+    draw_list.add ( textures
+                  , slot
+                  , noggit::terrain_tile_layout::first_index(slot, _lod_level)
+                  , strip_lods[*_lod_level].size()
+                  );
   }
 }
 
 void MapChunk::intersect (math::ray const& ray, selection_result* results)
 {
-  if (!ray.intersect_bounds (vmin, vmax))
-  {
-    return;
-  }
-
-  for (int i (0); i < strip_without_holes.size(); i += 3)
-  {
-    if ( auto distance = ray.intersect_triangle ( mVertices[strip_without_holes[i + 0]]
-                                                , mVertices[strip_without_holes[i + 1]]
-                                                , mVertices[strip_without_holes[i + 2]]
-                                                )
-       )
-    {
-      results->emplace_back
-        ( *distance
-        , selected_chunk_type
-            ( this
-            , std::make_tuple ( strip_without_holes[i]
-                              , strip_without_holes[i + 1]
-                              , strip_without_holes[i + 2]
-                              )
-            , ray.position (*distance)
-            )
-        );
-    }
-  }
+  _height_quadtree.intersect
+    ( ray, mVertices
+    , [&] (float distance, std::tuple<int, int, int> const& triangle)
+      {
+        results->emplace_back
+          (distance, selected_chunk_type (this, triangle, ray.position (distance)));
+      }
+    );
 }
 
 void MapChunk::updateVerticesData()
@@ -707,118 +572,20 @@ void MapChunk::updateVerticesData()
 
   update_intersect_points();
 
-  if (_uploaded)
-  {
-    gl.bufferData<GL_ARRAY_BUFFER>(_vertices_vbo, sizeof(mVertices), mVertices, GL_STATIC_DRAW);
-    _need_vao_update = true;
-  }
+  _need_vertices_upload = true;
 }
 
-void MapChunk::recalcNorms (std::function<boost::optional<float> (float, float)> height)
+void MapChunk::recalcNorms ( noggit::terrain_normals::halo const& heights
+                           , math::vector_3d const& min
+                           , math::vector_3d const& max
+                           )
 {
-  auto point
-  (
-    [&] (math::vector_3d& v, float xdiff, float zdiff)
-    {
-      return math::vector_3d
-             ( v.x + xdiff
-             , height (v.x + xdiff, v.z + zdiff).get_value_or (v.y)
-             , v.z + zdiff
-             );
-    }
-  );
-
-  float const half_unit = UNITSIZE / 2.f;
-
-  for (int i = 0; i<mapbufsize; ++i)
+  if (!noggit::terrain_normals::compute (mVertices, heights, min, max, mNormals))
   {
-    math::vector_3d const P1 (point(mVertices[i], -half_unit, -half_unit));
-    math::vector_3d const P2 (point(mVertices[i],  half_unit, -half_unit));
-    math::vector_3d const P3 (point(mVertices[i],  half_unit,  half_unit));
-    math::vector_3d const P4 (point(mVertices[i], -half_unit,  half_unit));
-
-    math::vector_3d const N1 ((P2 - mVertices[i]) % (P1 - mVertices[i]));
-    math::vector_3d const N2 ((P3 - mVertices[i]) % (P2 - mVertices[i]));
-    math::vector_3d const N3 ((P4 - mVertices[i]) % (P3 - mVertices[i]));
-    math::vector_3d const N4 ((P1 - mVertices[i]) % (P4 - mVertices[i]));
-
-    math::vector_3d Norm (N1 + N2 + N3 + N4);
-    Norm.normalize();
-
-    Norm.x = std::floor(Norm.x * 127) / 127;
-    Norm.y = std::floor(Norm.y * 127) / 127;
-    Norm.z = std::floor(Norm.z * 127) / 127;
-
-    //! \todo: find out why recalculating normals without changing the terrain result in slightly different normals
-    mNormals[i] = {-Norm.z, Norm.y, -Norm.x};
-  }
-
-  if (_uploaded)
-  {
-    gl.bufferData<GL_ARRAY_BUFFER> (_normals_vbo, sizeof(mNormals), mNormals, GL_STATIC_DRAW);
-    _need_vao_update = true;
+    return;
   }
-}
-
-bool MapChunk::changeTerrain(math::vector_3d const& pos, float change, float radius, int BrushType, float inner_radius)
-{
-  float dist, xdiff, zdiff;
-  bool changed = false;
 
-  for (int i = 0; i < mapbufsize; ++i)
-  {
-    xdiff = mVertices[i].x - pos.x;
-    zdiff = mVertices[i].z - pos.z;
-    if (BrushType == eTerrainType_Quadra)
-    {
-      if ((std::abs(xdiff) < std::abs(radius / 2)) && (std::abs(zdiff) < std::abs(radius / 2)))
-      {
-        dist = std::sqrt(xdiff*xdiff + zdiff*zdiff);
-        mVertices[i].y += change * (1.0f - dist * inner_radius / radius);
-        changed = true;
-      }
-    }
-    else
-    {
-      dist = std::sqrt(xdiff*xdiff + zdiff*zdiff);
-      if (dist < radius)
-      {
-        changed = true;
-
-        switch (BrushType)
-        {
-          case eTerrainType_Flat:
-            mVertices[i].y += change;
-            break;
-          case eTerrainType_Linear:
-            mVertices[i].y += change * (1.0f - dist * (1.0f - inner_radius) / radius);
-            break;
-          case eTerrainType_Smooth:
-            mVertices[i].y += change / (1.0f + dist / radius);
-            break;
-          case eTerrainType_Polynom:
-            mVertices[i].y += change*((dist / radius)*(dist / radius) + dist / radius + 1.0f);
-            break;
-          case eTerrainType_Trigo:
-            mVertices[i].y += change*cos(dist / radius);
-            break;
-          case eTerrainType_Gaussian:
-            mVertices[i].y += dist < radius * inner_radius ? change * std::exp(-(std::pow(radius * inner_radius / radius, 2) / (2 * std::pow(0.39f, 2)))) : change * std::exp(-(std::pow(dist / radius, 2) / (2 * std::pow(0.39f, 2))));
-
-            break;
-          default:
-            LogError << "Invalid terrain edit type (" << BrushType << ")" << std::endl;
-            changed = false;
-            break;
-        }
-      }
-    }
-  }
-  if (changed)
-  {
-    updateVerticesData();
-  }
-  return changed;
+  _need_normals_upload = true;
 }
 
 bool MapChunk::hasColors()
@@ -880,10 +647,9 @@ bool MapChunk::ChangeMCCV(math::vector_3d const& pos, math::vector_4d const& col
       changed = true;
     }
   }
-  if (changed && _uploaded)
+  if (changed)
   {
-    gl.bufferData<GL_ARRAY_BUFFER> (_mccv_vbo, sizeof(mccv), mccv, GL_STATIC_DRAW);
-    _need_vao_update = true;
+    _need_mccv_upload = true;
   }
 
   return changed;
@@ -891,11 +657,7 @@ bool MapChunk::ChangeMCCV(math::vector_3d const& pos, math::vector_4d const& col
 
 void MapChunk::UpdateMCCV()
 {
-  if(_uploaded)
-  {
-    gl.bufferData<GL_ARRAY_BUFFER> (_mccv_vbo, sizeof(mccv), mccv, GL_STATIC_DRAW);
-    _need_vao_update = true;
-  }
+  _need_mccv_upload = true;
 }
 
 math::vector_3d MapChunk::pickMCCV(math::vector_3d const& pos)
@@ -923,140 +685,6 @@ math::vector_3d MapChunk::pickMCCV(math::vector_3d const& pos)
 
 }
 
-bool MapChunk::flattenTerrain ( math::vector_3d const& pos
-                              , float remain
-                              , float radius
-                              , int BrushType
-                              , flatten_mode const& mode
-                              , math::vector_3d const& origin
-                              , math::degrees angle
-                              , math::degrees orientation
-                              )
-{
-  bool changed (false);
-
-  for (int i(0); i < mapbufsize; ++i)
-  {
-	  float const dist(misc::dist(mVertices[i], pos));
-
-	  if (dist >= radius)
-	  {
-		  continue;
-	  }
-
-	  float const ah(origin.y
-		  + ((mVertices[i].x - origin.x) * math::cos(orientation)
-			  + (mVertices[i].z - origin.z) * math::sin(orientation)
-			  ) * math::tan(angle)
-	  );
-
-	  if ((!mode.lower && ah < mVertices[i].y)
-		  || (!mode.raise && ah > mVertices[i].y)
-		  )
-	  {
-		  continue;
-	  }
-
-	  if (BrushType == eFlattenType_Origin)
-	  {
-		  mVertices[i].y = origin.y;
-		  changed = true;
-		  continue;
-	  }
-
-    mVertices[i].y = math::interpolation::linear
-      ( BrushType == eFlattenType_Flat ? remain
-      : BrushType == eFlattenType_Linear ? remain * (1.f - dist / radius)
-      : BrushType == eFlattenType_Smooth ? pow (remain, 1.f + dist / radius)
-      : throw std::logic_error ("bad brush type")
-      , mVertices[i].y
-      , ah
-      );
-
-    changed = true;
-  }
-
-  if (changed)
-  {
-    updateVerticesData();
-  }
-
-  return changed;
-}
-
-bool MapChunk::blurTerrain ( math::vector_3d const& pos
-                           , float remain
-                           , float radius
-                           , int BrushType
-                           , flatten_mode const& mode
-                           , std::function<boost::optional<float> (float, float)> height
-                           )
-{
-  bool changed (false);
-
-  if (BrushType == eFlattenType_Origin)
-  {
-    return false;
-  }
-
-  for (int i (0); i < mapbufsize; ++i)
-  {
-    float const dist(misc::dist(mVertices[i], pos));
-
-    if (dist >= radius)
-    {
-      continue;
-    }
-
-    int Rad = (int)(radius / UNITSIZE);
-    float TotalHeight = 0;
-    float TotalWeight = 0;
-    for (int j = -Rad * 2; j <= Rad * 2; ++j)
-    {
-      float tz = pos.z + j * UNITSIZE / 2;
-      for (int k = -Rad; k <= Rad; ++k)
-      {
-        float tx = pos.x + k*UNITSIZE + (j % 2) * UNITSIZE / 2.0f;
-        float dist2 = misc::dist (tx, tz, mVertices[i].x, mVertices[i].z);
-        if (dist2 > radius)
-          continue;
-        auto h (height (tx, tz));
-        if (h)
-        {
-          TotalHeight += (1.0f - dist2 / radius) * h.get();
-          TotalWeight += (1.0f - dist2 / radius);
-        }
-      }
-    }
-
-    float target = TotalHeight / TotalWeight;
-    float& y = mVertices[i].y;
-
-    if ((target > y && !mode.raise) || (target < y && !mode.lower))
-    {
-      continue;
-    }
-
-    y = math::interpolation::linear
-      ( BrushType == eFlattenType_Flat ? remain
-      : BrushType == eFlattenType_Linear ? remain * (1.f - dist / radius)
-      : BrushType == eFlattenType_Smooth ? pow (remain, 1.f + dist / radius)
-      : throw std::logic_error ("bad brush type")
-      , y
-      , target
-      );
-
-    changed = true;
-  }
-
-  if (changed)
-  {
-    updateVerticesData();
-  }
-
-  return changed;
-}
-
 
 void MapChunk::eraseTextures()
 {
@@ -1078,11 +706,6 @@ void MapChunk::switchTexture(scoped_blp_texture_reference const& oldTexture, sco
   texture_set->replace_texture(oldTexture, std::move (newTexture));
 }
 
-bool MapChunk::paintTexture(math::vector_3d const& pos, Brush* brush, float strength, float pressure, scoped_blp_texture_reference texture)
-{
-  return texture_set->paintTexture(xbase, zbase, pos.x, pos.z, brush, strength, pressure, std::move (texture));
-}
-
 bool MapChunk::replaceTexture(math::vector_3d const& pos, float radius, scoped_blp_texture_reference const& old_texture, scoped_blp_texture_reference new_texture)
 {
   return texture_set->replace_texture(xbase, zbase, pos.x, pos.z, radius, old_texture, std::move (new_texture));
@@ -1093,25 +716,11 @@ bool MapChunk::canPaintTexture(scoped_blp_texture_reference texture)
   return texture_set->canPaintTexture(texture);
 }
 
-void MapChunk::update_shadows()
-{
-  shadow.bind();
-  gl.texImage2D(GL_TEXTURE_2D, 0, GL_RED, 64, 64, 0, GL_RED, GL_UNSIGNED_BYTE, _shadow_map);
-  gl.texParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  gl.texParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  gl.texParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-  gl.texParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-}
-
 void MapChunk::clear_shadows()
 {
-  _has_shadow = false;
   memset(_shadow_map, 0, 64 * 64);
 
-  if (_uploaded)
-  {
-    update_shadows();
-  }
+  _need_shadow_upload = true;
 }
 
 bool MapChunk::isHole(int i, int j)
@@ -1157,17 +766,62 @@ void MapChunk::setFlag(bool changeto, uint32_t flag)
   }
 }
 
-void MapChunk::save(sExtendableArray &lADTFile, int &lCurrentPosition, int &lMCIN_Position, std::map<std::string, int> &lTextures, std::vector<WMOInstance> &lObjectInstances, std::vector<ModelInstance>& lModelInstances)
+MapChunk::save_data MapChunk::prepare_save(std::vector<WMOInstance> const& lObjectInstances, std::vector<ModelInstance> const& lModelInstances)
+{
+  save_data data;
+
+  data.alphamaps = texture_set->save_alpha(use_big_alphamap);
+
+  math::vector_3d lChunkExtents[2];
+  lChunkExtents[0] = math::vector_3d(xbase, 0.0f, zbase);
+  lChunkExtents[1] = math::vector_3d(xbase + CHUNKSIZE, 0.0f, zbase + CHUNKSIZE);
+
+  // search all wmos that are inside this chunk
+  for (std::size_t lID = 0; lID < lObjectInstances.size(); ++lID)
+  {
+    if (lObjectInstances[lID].isInsideRect(lChunkExtents))
+    {
+      data.object_refs.push_back(lID);
+    }
+  }
+
+  // search all models that are inside this chunk
+  for (std::size_t lID = 0; lID < lModelInstances.size(); ++lID)
+  {
+    if (lModelInstances[lID].isInsideRect(lChunkExtents))
+    {
+      data.doodad_refs.push_back(lID);
+    }
+  }
+
+  data.has_shadow_map = shadow_map_is_empty();
+
+  std::size_t lMCAL_Size = 0;
+  for (auto const& alpha : data.alphamaps)
+  {
+    lMCAL_Size += alpha.size();
+  }
+
+  data.size = noggit::mcnk_size ({ hasMCCV
+                                 , texture_set->num()
+                                 , data.doodad_refs.size() + data.object_refs.size()
+                                 , data.has_shadow_map
+                                 , lMCAL_Size
+                                 });
+
+  return data;
+}
+
+void MapChunk::save(sExtendableArray &lADTFile, int &lCurrentPosition, int &lMCIN_Position, std::map<std::string, int> &lTextures, save_data const& data)
 {
   int lID;
   int lMCNK_Size = 0x80;
   int lMCNK_Position = lCurrentPosition;
-  lADTFile.Extend(8 + 0x80);  // This is only the size of the header. More chunks will increase the size.
   SetChunkHeader(lADTFile, lCurrentPosition, 'MCNK', lMCNK_Size);
   lADTFile.GetPointer<MCIN>(lMCIN_Position + 8)->mEntries[py * 16 + px].offset = lCurrentPosition; // check this
 
                                                                                                    // MCNK data
-  lADTFile.Insert(lCurrentPosition + 8, 0x80, reinterpret_cast<char*>(&(header)));
+  lADTFile.Write(lCurrentPosition + 8, 0x80, reinterpret_cast<char*>(&(header)));
   MapChunkHeader *lMCNK_header = lADTFile.GetPointer<MapChunkHeader>(lCurrentPosition + 8);
 
   header_flags.flags.do_not_fix_alpha_map = 1;
@@ -1218,7 +872,6 @@ void MapChunk::save(sExtendableArray &lADTFile, int &lCurrentPosition, int &lMCI
   // MCVT
   int lMCVT_Size = mapbufsize * 4;
 
-  lADTFile.Extend(8 + lMCVT_Size);
   SetChunkHeader(lADTFile, lCurrentPosition, 'MCVT', lMCVT_Size);
 
   lADTFile.GetPointer<MapChunkHeader>(lMCNK_Position + 8)->ofsHeight = lCurrentPosition - lMCNK_Position;
@@ -1236,7 +889,6 @@ void MapChunk::save(sExtendableArray &lADTFile, int &lCurrentPosition, int &lMCI
   if (hasMCCV)
   {
     lMCCV_Size = mapbufsize * sizeof(unsigned int);
-    lADTFile.Extend(8 + lMCCV_Size);
     SetChunkHeader(lADTFile, lCurrentPosition, 'MCCV', lMCCV_Size);
     lADTFile.GetPointer<MapChunkHeader>(lMCNK_Position + 8)->ofsMCCV = lCurrentPosition - lMCNK_Position;
 
@@ -1260,7 +912,6 @@ void MapChunk::save(sExtendableArray &lADTFile, int &lCurrentPosition, int &lMCI
   // MCNR
   int lMCNR_Size = mapbufsize * 3;
 
-  lADTFile.Extend(8 + lMCNR_Size);
   SetChunkHeader(lADTFile, lCurrentPosition, 'MCNR', lMCNR_Size);
 
   lADTFile.GetPointer<MapChunkHeader>(lMCNK_Position + 8)->ofsNormal = lCurrentPosition - lMCNK_Position;
@@ -1281,7 +932,6 @@ void MapChunk::save(sExtendableArray &lADTFile, int &lCurrentPosition, int &lMCI
   // Unknown MCNR bytes
   // These are not in as we have data or something but just to make the files more blizzlike.
   //        {
-  lADTFile.Extend(13);
   lCurrentPosition += 13;
   lMCNK_Size += 13;
   //        }
@@ -1290,13 +940,11 @@ void MapChunk::save(sExtendableArray &lADTFile, int &lCurrentPosition, int &lMCI
   //        {
   size_t lMCLY_Size = texture_set->num() * 0x10;
 
-  lADTFile.Extend(8 + lMCLY_Size);
   SetChunkHeader(lADTFile, lCurrentPosition, 'MCLY', lMCLY_Size);
 
   lADTFile.GetPointer<MapChunkHeader>(lMCNK_Position + 8)->ofsLayer = lCurrentPosition - lMCNK_Position;
   lADTFile.GetPointer<MapChunkHeader>(lMCNK_Position + 8)->nLayers = texture_set->num();
 
-  std::vector<std::vector<uint8_t>> alphamaps = texture_set->save_alpha(use_big_alphamap);
   int lMCAL_Size = 0;
 
   // MCLY data
@@ -1319,7 +967,7 @@ void MapChunk::save(sExtendableArray &lADTFile, int &lCurrentPosition, int &lMCI
       //! \todo find out why compression fuck up textures ingame
       lLayer->flags &= ~FLAG_ALPHA_COMPRESSED;
 
-      lMCAL_Size += alphamaps[j - 1].size();
+      lMCAL_Size += data.alphamaps[j - 1].size();
     }
   }
 
@@ -1329,58 +977,25 @@ void MapChunk::save(sExtendableArray &lADTFile, int &lCurrentPosition, int &lMCI
 
   // MCRF
   //        {
-  std::list<int> lDoodadIDs;
-  std::list<int> lObjectIDs;
-
-  math::vector_3d lChunkExtents[2];
-  lChunkExtents[0] = math::vector_3d(xbase, 0.0f, zbase);
-  lChunkExtents[1] = math::vector_3d(xbase + CHUNKSIZE, 0.0f, zbase + CHUNKSIZE);
-
-  // search all wmos that are inside this chunk
-  lID = 0;
-  for(auto const& wmo : lObjectInstances)
-  {
-    if (wmo.isInsideRect(lChunkExtents))
-    {
-      lObjectIDs.push_back(lID);
-    }
-
-    lID++;
-  }
-
-  // search all models that are inside this chunk
-  lID = 0;
-  for(auto const& model : lModelInstances)
-  {
-    if (model.isInsideRect (lChunkExtents))
-    {
-      lDoodadIDs.push_back(lID);
-    }
-    lID++;
-  }
-
-  int lMCRF_Size = 4 * (lDoodadIDs.size() + lObjectIDs.size());
-  lADTFile.Extend(8 + lMCRF_Size);
+  int lMCRF_Size = 4 * (data.doodad_refs.size() + data.object_refs.size());
   SetChunkHeader(lADTFile, lCurrentPosition, 'MCRF', lMCRF_Size);
 
   lADTFile.GetPointer<MapChunkHeader>(lMCNK_Position + 8)->ofsRefs = lCurrentPosition - lMCNK_Position;
-  lADTFile.GetPointer<MapChunkHeader>(lMCNK_Position + 8)->nDoodadRefs = lDoodadIDs.size();
-  lADTFile.GetPointer<MapChunkHeader>(lMCNK_Position + 8)->nMapObjRefs = lObjectIDs.size();
+  lADTFile.GetPointer<MapChunkHeader>(lMCNK_Position + 8)->nDoodadRefs = data.doodad_refs.size();
+  lADTFile.GetPointer<MapChunkHeader>(lMCNK_Position + 8)->nMapObjRefs = data.object_refs.size();
 
   // MCRF data
   int *lReferences = lADTFile.GetPointer<int>(lCurrentPosition + 8);
 
   lID = 0;
-  for (std::list<int>::iterator it = lDoodadIDs.begin(); it != lDoodadIDs.end(); ++it)
+  for (int ref : data.doodad_refs)
   {
-    lReferences[lID] = *it;
-    lID++;
+    lReferences[lID++] = ref;
   }
 
-  for (std::list<int>::iterator it = lObjectIDs.begin(); it != lObjectIDs.end(); ++it)
+  for (int ref : data.object_refs)
   {
-    lReferences[lID] = *it;
-    lID++;
+    lReferences[lID++] = ref;
   }
 
   lCurrentPosition += 8 + lMCRF_Size;
@@ -1388,21 +1003,18 @@ void MapChunk::save(sExtendableArray &lADTFile, int &lCurrentPosition, int &lMCI
   //        }
 
   // MCSH
-  if (shadow_map_is_empty())
+  if (data.has_shadow_map)
   {
     header_flags.flags.has_mcsh = 1;
 
     int lMCSH_Size = 0x200;
-    lADTFile.Extend(8 + lMCSH_Size);
     SetChunkHeader(lADTFile, lCurrentPosition, 'MCSH', lMCSH_Size);
 
     lADTFile.GetPointer<MapChunkHeader>(lMCNK_Position + 8)->ofsShadow = lCurrentPosition - lMCNK_Position;
     lADTFile.GetPointer<MapChunkHeader>(lMCNK_Position + 8)->sizeShadow = 0x200;
 
-    char * lLayer = lADTFile.GetPointer<char>(lCurrentPosition + 8);
-
     auto shadow_map = compressed_shadow_map();
-    memcpy(lLayer, shadow_map.data(), 0x200);
+    lADTFile.Write(lCurrentPosition + 8, 0x200, reinterpret_cast<char*>(shadow_map.data()));
 
     lCurrentPosition += 8 + lMCSH_Size;
     lMCNK_Size += 8 + lMCSH_Size;
@@ -1415,17 +1027,16 @@ void MapChunk::save(sExtendableArray &lADTFile, int &lCurrentPosition, int &lMCI
   }
 
   // MCAL
-  lADTFile.Extend(8 + lMCAL_Size);
   SetChunkHeader(lADTFile, lCurrentPosition, 'MCAL', lMCAL_Size);
 
   lADTFile.GetPointer<MapChunkHeader>(lMCNK_Position + 8)->ofsAlpha = lCurrentPosition - lMCNK_Position;
   lADTFile.GetPointer<MapChunkHeader>(lMCNK_Position + 8)->sizeAlpha = 8 + lMCAL_Size;
 
-  char * lAlphaMaps = lADTFile.GetPointer<char>(lCurrentPosition + 8);
+  int lAlphaMaps = lCurrentPosition + 8;
 
-  for (auto alpha : alphamaps)
+  for (auto const& alpha : data.alphamaps)
   {
-    memcpy(lAlphaMaps, alpha.data(), alpha.size());
+    lADTFile.Write(lAlphaMaps, alpha.size(), reinterpret_cast<char const*>(alpha.data()));
     lAlphaMaps += alpha.size();
   }
 
@@ -1438,7 +1049,6 @@ void MapChunk::save(sExtendableArray &lADTFile, int &lCurrentPosition, int &lMCI
 
   // MCSE
   int lMCSE_Size = 0;
-  lADTFile.Extend(8 + lMCSE_Size);
   SetChunkHeader(lADTFile, lCurrentPosition, 'MCSE', lMCSE_Size);
 
   lADTFile.GetPointer<MapChunkHeader>(lMCNK_Position + 8)->ofsSndEmitters = lCurrentPosition - lMCNK_Position;
@@ -1447,6 +1057,8 @@ void MapChunk::save(sExtendableArray &lADTFile, int &lCurrentPosition, int &lMCI
   lCurrentPosition += 8 + lMCSE_Size;
   lMCNK_Size += 8 + lMCSE_Size;
 
+  assert(lMCNK_Size + sizeof (sChunkHeader) == data.size);
+
   lADTFile.GetPointer<sChunkHeader>(lMCNK_Position)->mSize = lMCNK_Size;
   lADTFile.GetPointer<MCIN>(lMCIN_Position + 8)->mEntries[py * 16 + px].size = lMCNK_Size + sizeof (sChunkHeader);
 }
@@ -9,12 +9,15 @@
 #include <noggit/Selection.h>
 #include <noggit/TextureManager.h>
 #include <noggit/WMOInstance.h>
+#include <noggit/terrain_draw_list.hpp>
+#include <noggit/terrain_normals.hpp>
+#include <noggit/terrain_picking.hpp>
+#include <noggit/terrain_tile_render.hpp>
 #include <noggit/texture_set.hpp>
 #include <noggit/tool_enums.hpp>
-#include <opengl/scoped.hpp>
-#include <opengl/texture.hpp>
 #include <noggit/Misc.h>
 
+#include <array>
 #include <map>
 #include <memory>
 
@@ -24,7 +27,6 @@ namespace math
   class frustum;
   struct vector_4d;
 }
-class Brush;
 class ChunkWater;
 class sExtendableArray;
 
@@ -42,15 +44,10 @@ private:
 
   unsigned int areaID;
 
-  void update_shadows();
-
-  bool _has_shadow;
   uint8_t _shadow_map[64 * 64];
-  opengl::texture shadow;
 
   std::vector<StripType> strip_with_holes;
-  std::vector<StripType> strip_without_holes;
-  std::map<int, std::vector<StripType>> strip_lods;
+  std::array<std::vector<StripType>, 4> strip_lods;
 
   std::vector<uint8_t> compressed_shadow_map() const;
   bool shadow_map_is_empty() const;
@@ -61,6 +58,7 @@ private:
   int indexLoD(int z, int x);
 
   std::vector<math::vector_3d> _intersect_points;
+  noggit::terrain_picking::height_quadtree _height_quadtree;
 
   void update_intersect_points();
 
@@ -68,23 +66,16 @@ private:
                                     , display_mode display
                                     ) const;
 
-  bool _uploaded = false;
+  //! what changed since it was last sent to the tile's render, only the
+  //! visible chunks are sent
   bool _need_indice_buffer_update = true;
-  bool _need_lod_update = true;
-  bool _need_vao_update = true;
-
-  void upload();
-  void update_indices_buffer();
-  void update_vao(opengl::scoped::use_program& mcnk_shader, GLuint const& tex_coord_vbo);
-
-  opengl::scoped::deferred_upload_vertex_arrays<1> _vertex_array;
-  GLuint const& _vao = _vertex_array[0];
-  opengl::scoped::deferred_upload_buffers<4> _buffers;
-  GLuint const& _vertices_vbo = _buffers[0];
-  GLuint const& _normals_vbo = _buffers[1];
-  GLuint const& _indices_buffer = _buffers[2];
-  GLuint const& _mccv_vbo = _buffers[3];
-  opengl::scoped::deferred_upload_buffers<4> lod_indices;
+  bool _need_vertices_upload = true;
+  bool _need_normals_upload = true;
+  //! set by the brushes, which may run on other threads than the GL one
+  bool _need_mccv_upload = true;
+  bool _need_shadow_upload = true;
+
+  void upload_changes(noggit::terrain_tile_render& render, std::size_t slot);
 
 public:
   MapChunk(MapTile* mt, MPQFile* f, bool bigAlpha, tile_mode mode);
@@ -121,27 +112,26 @@ private:
   bool _is_visible = true; // visible by default
   bool _need_visibility_update = true;
   boost::optional<int> _lod_level = boost::none; // none = no lod
-  size_t _lod_level_indice_count = 0;
 public:
 
-  void draw ( math::frustum const& frustum
-            , opengl::scoped::use_program& mcnk_shader
-            , GLuint const& tex_coord_vbo
-            , const float& cull_distance
-            , const math::vector_3d& camera
-            , bool need_visibility_update
-            , bool show_unpaintable_chunks
-            , bool draw_paintability_overlay
-            , bool draw_chunk_flag_overlay
-            , bool draw_areaid_overlay
-            , std::map<int, misc::random_color>& area_id_colors
-            , int animtime
-            , display_mode display
-            , bool& previous_chunk_had_shadows
-            , bool& previous_chunk_was_textured
-            , bool& previous_chunk_could_be_painted
-            , std::vector<int>& textures_bound
-            );
+  //! sends what changed to render, writes the chunk's shader parameters
+  //! and adds it to draw_list when visible. slot is the chunk's index in
+  //! the tile, see noggit::terrain_tile_layout.
+  void prepare_draw ( math::frustum const& frustum
+                    , noggit::terrain_tile_render& render
+                    , noggit::terrain_draw_list& draw_list
+                    , std::size_t slot
+                    , const float& cull_distance
+                    , const math::vector_3d& camera
+                    , bool need_visibility_update
+                    , bool show_unpaintable_chunks
+                    , bool draw_paintability_overlay
+                    , bool draw_chunk_flag_overlay
+                    , bool draw_areaid_overlay
+                    , std::map<int, misc::random_color>& area_id_colors
+                    , int animtime
+                    , display_mode display
+                    );
   //! \todo only this function should be public, all others should be called from it
 
   void intersect (math::ray const&, selection_result*);
@@ -155,13 +145,10 @@ public:
   ChunkWater* liquid_chunk() const;
 
   void updateVerticesData();
-  void recalcNorms (std::function<boost::optional<float> (float, float)> height);
-
-  //! \todo implement Action stack for these
-  bool changeTerrain(math::vector_3d const& pos, float change, float radius, int BrushType, float inner_radius);
-  bool flattenTerrain(math::vector_3d const& pos, float remain, float radius, int BrushType, flatten_mode const& mode, const math::vector_3d& origin, math::degrees angle, math::degrees orientation);
-  bool blurTerrain ( math::vector_3d const& pos, float remain, float radius, int BrushType, flatten_mode const& mode
-                   , std::function<boost::optional<float> (float, float)> height
+  //! recomputes the normals of the vertices inside [min, max] on the xz plane
+  void recalcNorms ( noggit::terrain_normals::halo const& heights
+                   , math::vector_3d const& min
+                   , math::vector_3d const& max
                    );
 
   void selectVertex(math::vector_3d const& pos, float radius, std::set<math::vector_3d*>& vertices);
@@ -170,7 +157,6 @@ public:
   bool isBorderChunk(std::set<math::vector_3d*>& selected);
 
   //! \todo implement Action stack for these
-  bool paintTexture(math::vector_3d const& pos, Brush *brush, float strength, float pressure, scoped_blp_texture_reference texture);
   bool replaceTexture(math::vector_3d const& pos, float radius, scoped_blp_texture_reference const& old_texture, scoped_blp_texture_reference new_texture);
   bool canPaintTexture(scoped_blp_texture_reference texture);
   int addTexture(scoped_blp_texture_reference texture);
@@ -196,8 +182,21 @@ public:
 
   void clearHeight();
 
-  //! \todo this is ugly create a build struct or sth
-  void save(sExtendableArray &lADTFile, int &lCurrentPosition, int &lMCIN_Position, std::map<std::string, int> &lTextures, std::vector<WMOInstance> &lObjectInstances, std::vector<ModelInstance>& lModelInstances);
+  //! what save writes which is expensive to compute or needed to know its size
+  struct save_data
+  {
+    std::vector<std::vector<uint8_t>> alphamaps;
+    std::vector<int> doodad_refs;
+    std::vector<int> object_refs;
+    bool has_shadow_map;
+    //! size of the MCNK chunk including its header
+    std::size_t size;
+  };
+
+  //! the instances have to be in the order they are saved in
+  save_data prepare_save(std::vector<WMOInstance> const& lObjectInstances, std::vector<ModelInstance> const& lModelInstances);
+  //! writes into the data.size bytes already allocated at lCurrentPosition
+  void save(sExtendableArray &lADTFile, int &lCurrentPosition, int &lMCIN_Position, std::map<std::string, int> &lTextures, save_data const& data);
 
   // fix the gaps with the chunk to the left
   bool fixGapLeft(const MapChunk* chunk);
@@ -10,6 +10,7 @@
 #include <noggit/WMOInstance.h> // WMOInstance
 #include <noggit/World.h>
 #include <noggit/alphamap.hpp>
+#include <noggit/map_file_layout.hpp>
 #include <noggit/map_index.hpp>
 #include <noggit/texture_set.hpp>
 #include <opengl/scoped.hpp>
@@ -51,7 +52,11 @@ MapTile::MapTile( int pX
 
 MapTile::~MapTile()
 {
-  _world->remove_models_if_needed(uids);
+  // the instances of a tile loaded without its models aren't in the world
+  if (_load_models)
+  {
+    _world->remove_models_if_needed(uids);
+  }
 }
 
 void MapTile::finishLoading()
@@ -126,73 +131,70 @@ void MapTile::finishLoading()
     }
   }
 
-  if (_load_models)
-  {
-    // - MMDX ----------------------------------------------
+  // - MMDX ----------------------------------------------
 
-    theFile.seek(Header.mmdx + 0x14);
-    theFile.read(&fourcc, 4);
-    theFile.read(&size, 4);
+  theFile.seek(Header.mmdx + 0x14);
+  theFile.read(&fourcc, 4);
+  theFile.read(&size, 4);
 
-    assert(fourcc == 'MMDX');
+  assert(fourcc == 'MMDX');
 
-    {
-      char const* lCurPos = reinterpret_cast<char const*>(theFile.getPointer());
-      char const* lEnd = lCurPos + size;
+  {
+    char const* lCurPos = reinterpret_cast<char const*>(theFile.getPointer());
+    char const* lEnd = lCurPos + size;
 
-      while (lCurPos < lEnd)
-      {
-        mModelFilenames.push_back(noggit::mpq::normalized_filename(std::string(lCurPos)));
-        lCurPos += strlen(lCurPos) + 1;
-      }
+    while (lCurPos < lEnd)
+    {
+      mModelFilenames.push_back(noggit::mpq::normalized_filename(std::string(lCurPos)));
+      lCurPos += strlen(lCurPos) + 1;
     }
+  }
 
-    // - MWMO ----------------------------------------------
+  // - MWMO ----------------------------------------------
 
-    theFile.seek(Header.mwmo + 0x14);
-    theFile.read(&fourcc, 4);
-    theFile.read(&size, 4);
+  theFile.seek(Header.mwmo + 0x14);
+  theFile.read(&fourcc, 4);
+  theFile.read(&size, 4);
 
-    assert(fourcc == 'MWMO');
+  assert(fourcc == 'MWMO');
 
-    {
-      char const* lCurPos = reinterpret_cast<char const*>(theFile.getPointer());
-      char const* lEnd = lCurPos + size;
+  {
+    char const* lCurPos = reinterpret_cast<char const*>(theFile.getPointer());
+    char const* lEnd = lCurPos + size;
 
-      while (lCurPos < lEnd)
-      {
-        mWMOFilenames.push_back(noggit::mpq::normalized_filename(std::string(lCurPos)));
-        lCurPos += strlen(lCurPos) + 1;
-      }
+    while (lCurPos < lEnd)
+    {
+      mWMOFilenames.push_back(noggit::mpq::normalized_filename(std::string(lCurPos)));
+      lCurPos += strlen(lCurPos) + 1;
     }
+  }
 
-    // - MDDF ----------------------------------------------
+  // - MDDF ----------------------------------------------
 
-    theFile.seek(Header.mddf + 0x14);
-    theFile.read(&fourcc, 4);
-    theFile.read(&size, 4);
+  theFile.seek(Header.mddf + 0x14);
+  theFile.read(&fourcc, 4);
+  theFile.read(&size, 4);
 
-    assert(fourcc == 'MDDF');
+  assert(fourcc == 'MDDF');
 
-    ENTRY_MDDF const* mddf_ptr = reinterpret_cast<ENTRY_MDDF const*>(theFile.getPointer());
-    for (unsigned int i = 0; i < size / sizeof(ENTRY_MDDF); ++i)
-    {
-      lModelInstances.push_back(mddf_ptr[i]);
-    }
+  ENTRY_MDDF const* mddf_ptr = reinterpret_cast<ENTRY_MDDF const*>(theFile.getPointer());
+  for (unsigned int i = 0; i < size / sizeof(ENTRY_MDDF); ++i)
+  {
+    lModelInstances.push_back(mddf_ptr[i]);
+  }
 
-    // - MODF ----------------------------------------------
+  // - MODF ----------------------------------------------
 
-    theFile.seek(Header.modf + 0x14);
-    theFile.read(&fourcc, 4);
-    theFile.read(&size, 4);
+  theFile.seek(Header.modf + 0x14);
+  theFile.read(&fourcc, 4);
+  theFile.read(&size, 4);
 
-    assert(fourcc == 'MODF');
+  assert(fourcc == 'MODF');
 
-    ENTRY_MODF const* modf_ptr = reinterpret_cast<ENTRY_MODF const*>(theFile.getPointer());
-    for (unsigned int i = 0; i < size / sizeof(ENTRY_MODF); ++i)
-    {
-      lWMOInstances.push_back(modf_ptr[i]);
-    }
+  ENTRY_MODF const* modf_ptr = reinterpret_cast<ENTRY_MODF const*>(theFile.getPointer());
+  for (unsigned int i = 0; i < size / sizeof(ENTRY_MODF); ++i)
+  {
+    lWMOInstances.push_back(modf_ptr[i]);
   }
 
   // - MISC ----------------------------------------------
@@ -292,8 +294,12 @@ void MapTile::finishLoading()
     {
       add_model(_world->add_model_instance(ModelInstance(mModelFilenames[model.nameID], &model), _tile_is_being_reloaded));
     }
-
-    _world->need_model_updates = true;
+  }
+  else
+  {
+    // kept to be saved without adding them to the world
+    _file_model_entries = std::move(lModelInstances);
+    _file_wmo_entries = std::move(lWMOInstances);
   }
 
   // - Load chunks ---------------------------------------
@@ -354,9 +360,6 @@ void MapTile::draw ( math::frustum const& frustum
                    , std::map<int, misc::random_color>& area_id_colors
                    , int animtime
                    , display_mode display
-                   , bool& previous_chunk_had_shadows
-                   , bool& previous_chunk_was_textured
-                   , bool& previous_chunk_could_be_painted
                    , std::vector<int>& textures_bound
                    )
 {
@@ -365,48 +368,61 @@ void MapTile::draw ( math::frustum const& frustum
     return;
   }
 
+  if (!_terrain_render.uploaded())
+  {
+    // uid fix adt should never/can't be rendered
+    if (_mode == tile_mode::uid_fix_all)
+    {
+      throw std::logic_error("Trying to render an ADT/chunk that is supposed to be used for the uid fix all only");
+    }
+
+    _terrain_render.upload(mcnk_shader, tex_coord_vbo);
+  }
+
+  _terrain_draw_list.clear();
+
   for (int j = 0; j<16; ++j)
   {
     for (int i = 0; i<16; ++i)
     {
-      mChunks[j][i]->draw ( frustum
-                          , mcnk_shader
-                          , tex_coord_vbo
-                          , cull_distance
-                          , camera
-                          , need_visibility_update
-                          , show_unpaintable_chunks
-                          , draw_paintability_overlay
-                          , draw_chunk_flag_overlay
-                          , draw_areaid_overlay
-                          , area_id_colors
-                          , animtime
-                          , display
-                          , previous_chunk_had_shadows
-                          , previous_chunk_was_textured
-                          , previous_chunk_could_be_painted
-                          , textures_bound
-                          );
+      mChunks[j][i]->prepare_draw ( frustum
+                                  , _terrain_render
+                                  , _terrain_draw_list
+                                  , j * 16 + i
+                                  , cull_distance
+                                  , camera
+                                  , need_visibility_update
+                                  , show_unpaintable_chunks
+                                  , draw_paintability_overlay
+                                  , draw_chunk_flag_overlay
+                                  , draw_areaid_overlay
+                                  , area_id_colors
+                                  , animtime
+                                  , display
+                                  );
     }
   }
-}
 
-void MapTile::intersect (math::ray const& ray, selection_result* results) const
-{
-  if (!finished)
+  if (_terrain_draw_list.empty())
   {
     return;
   }
 
-  for (size_t j (0); j < 16; ++j)
-  {
-    for (size_t i (0); i < 16; ++i)
-    {
-      mChunks[j][i]->intersect (ray, results);
-    }
-  }
-}
+  _terrain_draw_list.finish();
+
+  _terrain_render.draw
+    ( _terrain_draw_list
+    , [&] (std::size_t chunk)
+      {
+        TextureSet& textures (*mChunks[chunk / 16][chunk % 16]->texture_set);
 
+        for (std::size_t i = 0; i < textures.num(); ++i)
+        {
+          textures.bindTexture(i, i + 1, textures_bound);
+        }
+      }
+    );
+}
 
 void MapTile::drawMFBO (opengl::scoped::use_program& mfbo_shader)
 {
@@ -459,7 +475,6 @@ void MapTile::drawMFBO (opengl::scoped::use_program& mfbo_shader)
 void MapTile::drawWater ( math::frustum const& frustum
                         , const float& cull_distance
                         , const math::vector_3d& camera
-                        , bool camera_moved
                         , liquid_render& render
                         , opengl::scoped::use_program& water_shader
                         , int animtime
@@ -475,7 +490,6 @@ void MapTile::drawWater ( math::frustum const& frustum
   Water.draw ( frustum
              , cull_distance
              , camera
-             , camera_moved
              , render
              , water_shader
              , animtime
@@ -549,38 +563,62 @@ bool MapTile::GetVertex(float x, float z, math::vector_3d *V)
 
 void MapTile::saveTile(World* world)
 {
-  NOGGIT_LOG << "Saving ADT \"" << filename << "\"." << std::endl;
+  std::vector<WMOInstance> lObjectInstances;
+  std::vector<ModelInstance> lModelInstances;
 
-  int lID;  // This is a global counting variable. Do not store something in here you need later.
+  // get every models on the tile, copied as the tiles are saved in parallel
+  std::vector<std::uint32_t> tile_uids;
+  {
+    std::lock_guard<std::mutex> const lock (_mutex);
+    tile_uids = uids;
+  }
+
+  for (std::uint32_t uid : world->copy_models(tile_uids, lModelInstances, lObjectInstances))
+  {
+    // todo: save elsewhere if this happens ? it shouldn't but still
+    LogError << "Could not fine model with uid=" << uid << " when saving " << filename << std::endl;
+  }
+
+  std::vector<char> const data (file_data(world, lModelInstances, lObjectInstances));
+
+  if (!data.empty())
+  {
+    MPQFile f(filename);
+    f.setBuffer(data);
+    f.SaveFile();
+  }
+}
+
+std::vector<char> MapTile::headless_file_data(World* world)
+{
   std::vector<WMOInstance> lObjectInstances;
   std::vector<ModelInstance> lModelInstances;
 
-  // Check which doodads and WMOs are on this ADT.
-  math::vector_3d lTileExtents[2];
-  lTileExtents[0] = math::vector_3d(xbase, 0.0f, zbase);
-  lTileExtents[1] = math::vector_3d(xbase + TILESIZE, 0.0f, zbase + TILESIZE);
+  for (auto const& object : _file_wmo_entries)
+  {
+    lObjectInstances.emplace_back(mWMOFilenames[object.nameID], &object);
+  }
 
-  // get every models on the tile
-  for (std::uint32_t uid : uids)
+  for (auto const& model : _file_model_entries)
   {
-    auto model = world->get_model(uid);
+    lModelInstances.emplace_back(mModelFilenames[model.nameID], &model);
+    // the doodad references of the chunks need the models' extents
+    lModelInstances.back().model->wait_until_loaded();
+  }
 
-    if (!model)
-    {
-      // todo: save elsewhere if this happens ? it shouldn't but still
-      LogError << "Could not fine model with uid=" << uid << " when saving " << filename << std::endl;
-    }
-    else
-    {
-      if (model.get().which() == eEntry_WMO)
-      {
-        lObjectInstances.emplace_back(*boost::get<selected_wmo_type>(model.get()));
-      }
-      else
-      {
-        lModelInstances.emplace_back(*boost::get<selected_model_type>(model.get()));
-      }
-    }
+  return file_data(world, lModelInstances, lObjectInstances);
+}
+
+std::vector<char> MapTile::file_data(World* world, std::vector<ModelInstance>& lModelInstances, std::vector<WMOInstance>& lObjectInstances)
+{
+  NOGGIT_LOG << "Saving ADT \"" << filename << "\"." << std::endl;
+
+  int lID;  // This is a global counting variable. Do not store something in here you need later.
+
+  // instances added since the last rendering still have outdated extents
+  for (auto& model : lModelInstances)
+  {
+    model.extents();
   }
 
   struct filenameOffsetThing
@@ -644,13 +682,72 @@ void MapTile::saveTile(World* world)
   for (auto& texture : lTextures)
     texture.second = lID++;
 
+  if(world->mapIndex.sort_models_by_size_class())
+  {
+    std::sort(lModelInstances.begin(), lModelInstances.end(), [](ModelInstance const& m1, ModelInstance const& m2)
+    {
+      return m1.size_cat > m2.size_cat;
+    });
+  }
+
+  // Compute the size of every chunk first to write the file in a single pass.
+  int lMTEX_Size = 0;
+  for (auto const& texture : lTextures)
+  {
+    lMTEX_Size += texture.first.size() + 1;
+  }
+
+  int lMMDX_Size = 0;
+  for (auto const& model : lModels)
+  {
+    lMMDX_Size += model.first.size() + 1;
+  }
+
+  int lMWMO_Size = 0;
+  for (auto const& object : lObjects)
+  {
+    lMWMO_Size += object.first.size() + 1;
+  }
+
+  int lMMID_Size = 4 * lModels.size();
+  int lMWID_Size = 4 * lObjects.size();
+  int lMDDF_Size = 0x24 * lModelInstances.size();
+  int lMODF_Size = 0x40 * lObjectInstances.size();
+  int lMH2O_Size = Water.save_size();
+  int lMFBO_Size = (mFlags & 1) ? sizeof(int16_t) * 9 * 2 : 0;
+
+  std::vector<MapChunk::save_data> lChunksData;
+  lChunksData.reserve(256);
+  std::size_t lChunks_Size = 0;
+
+  for (int y = 0; y < 16; ++y)
+  {
+    for (int x = 0; x < 16; ++x)
+    {
+      lChunksData.emplace_back(mChunks[y][x]->prepare_save(lObjectInstances, lModelInstances));
+      lChunks_Size += lChunksData.back().size;
+    }
+  }
+
+  std::size_t const lFileSize = noggit::adt_size ({ static_cast<std::size_t>(lMTEX_Size)
+                                                  , static_cast<std::size_t>(lMMDX_Size)
+                                                  , static_cast<std::size_t>(lMWMO_Size)
+                                                  , lModels.size()
+                                                  , lObjects.size()
+                                                  , lModelInstances.size()
+                                                  , lObjectInstances.size()
+                                                  , static_cast<std::size_t>(lMH2O_Size)
+                                                  , lMFBO_Size > 0
+                                                  , lChunks_Size
+                                                  });
+
   // Now write the file.
   sExtendableArray lADTFile;
+  lADTFile.Allocate(lFileSize);
 
   int lCurrentPosition = 0;
 
   // MVER
-  lADTFile.Extend(8 + 0x4);
   SetChunkHeader(lADTFile, lCurrentPosition, 'MVER', 4);
 
   // MVER data
@@ -659,7 +756,6 @@ void MapTile::saveTile(World* world)
 
   // MHDR
   int lMHDR_Position = lCurrentPosition;
-  lADTFile.Extend(8 + 0x40);
   SetChunkHeader(lADTFile, lCurrentPosition, 'MHDR', 0x40);
 
   lADTFile.GetPointer<MHDR>(lMHDR_Position + 8)->flags = mFlags;
@@ -670,16 +766,13 @@ void MapTile::saveTile(World* world)
   // MCIN
   int lMCIN_Position = lCurrentPosition;
 
-  lADTFile.Extend(8 + 256 * 0x10);
   SetChunkHeader(lADTFile, lCurrentPosition, 'MCIN', 256 * 0x10);
   lADTFile.GetPointer<MHDR>(lMHDR_Position + 8)->mcin = lCurrentPosition - 0x14;
 
   lCurrentPosition += 8 + 256 * 0x10;
 
   // MTEX
-  int lMTEX_Position = lCurrentPosition;
-  lADTFile.Extend(8 + 0);  // We don't yet know how big this will be.
-  SetChunkHeader(lADTFile, lCurrentPosition, 'MTEX');
+  SetChunkHeader(lADTFile, lCurrentPosition, 'MTEX', lMTEX_Size);
   lADTFile.GetPointer<MHDR>(lMHDR_Position + 8)->mtex = lCurrentPosition - 0x14;
 
   lCurrentPosition += 8 + 0;
@@ -687,35 +780,31 @@ void MapTile::saveTile(World* world)
   // MTEX data
   for (auto const& texture : lTextures)
   {
-    lADTFile.Insert(lCurrentPosition, texture.first.size() + 1, texture.first.c_str());
+    lADTFile.Write(lCurrentPosition, texture.first.size() + 1, texture.first.c_str());
 
     lCurrentPosition += texture.first.size() + 1;
-    lADTFile.GetPointer<sChunkHeader>(lMTEX_Position)->mSize += texture.first.size() + 1;
     LogDebug << "Added texture \"" << texture.first << "\"." << std::endl;
   }
 
   // MMDX
-  int lMMDX_Position = lCurrentPosition;
-  lADTFile.Extend(8 + 0);  // We don't yet know how big this will be.
-  SetChunkHeader(lADTFile, lCurrentPosition, 'MMDX');
+  SetChunkHeader(lADTFile, lCurrentPosition, 'MMDX', lMMDX_Size);
   lADTFile.GetPointer<MHDR>(lMHDR_Position + 8)->mmdx = lCurrentPosition - 0x14;
 
   lCurrentPosition += 8 + 0;
 
   // MMDX data
+  int lMMDX_Offset = 0;
   for (auto it = lModels.begin(); it != lModels.end(); ++it)
   {
-    it->second.filenamePosition = lADTFile.GetPointer<sChunkHeader>(lMMDX_Position)->mSize;
-    lADTFile.Insert(lCurrentPosition, it->first.size() + 1, misc::normalize_adt_filename(it->first).c_str());
+    it->second.filenamePosition = lMMDX_Offset;
+    lADTFile.Write(lCurrentPosition, it->first.size() + 1, misc::normalize_adt_filename(it->first).c_str());
     lCurrentPosition += it->first.size() + 1;
-    lADTFile.GetPointer<sChunkHeader>(lMMDX_Position)->mSize += it->first.size() + 1;
+    lMMDX_Offset += it->first.size() + 1;
     LogDebug << "Added model \"" << it->first << "\"." << std::endl;
   }
 
   // MMID
   // M2 model names
-  int lMMID_Size = 4 * lModels.size();
-  lADTFile.Extend(8 + lMMID_Size);
   SetChunkHeader(lADTFile, lCurrentPosition, 'MMID', lMMID_Size);
   lADTFile.GetPointer<MHDR>(lMHDR_Position + 8)->mmid = lCurrentPosition - 0x14;
 
@@ -732,26 +821,23 @@ void MapTile::saveTile(World* world)
   lCurrentPosition += 8 + lMMID_Size;
   
   // MWMO
-  int lMWMO_Position = lCurrentPosition;
-  lADTFile.Extend(8 + 0);  // We don't yet know how big this will be.
-  SetChunkHeader(lADTFile, lCurrentPosition, 'MWMO');
+  SetChunkHeader(lADTFile, lCurrentPosition, 'MWMO', lMWMO_Size);
   lADTFile.GetPointer<MHDR>(lMHDR_Position + 8)->mwmo = lCurrentPosition - 0x14;
 
   lCurrentPosition += 8 + 0;
 
   // MWMO data
+  int lMWMO_Offset = 0;
   for (auto& object : lObjects)
   {
-    object.second.filenamePosition = lADTFile.GetPointer<sChunkHeader>(lMWMO_Position)->mSize;
-    lADTFile.Insert(lCurrentPosition, object.first.size() + 1, misc::normalize_adt_filename(object.first).c_str());
+    object.second.filenamePosition = lMWMO_Offset;
+    lADTFile.Write(lCurrentPosition, object.first.size() + 1, misc::normalize_adt_filename(object.first).c_str());
     lCurrentPosition += object.first.size() + 1;
-    lADTFile.GetPointer<sChunkHeader>(lMWMO_Position)->mSize += object.first.size() + 1;
+    lMWMO_Offset += object.first.size() + 1;
     LogDebug << "Added object \"" << object.first << "\"." << std::endl;
   }
 
   // MWID
-  int lMWID_Size = 4 * lObjects.size();
-  lADTFile.Extend(8 + lMWID_Size);
   SetChunkHeader(lADTFile, lCurrentPosition, 'MWID', lMWID_Size);
   lADTFile.GetPointer<MHDR>(lMHDR_Position + 8)->mwid = lCurrentPosition - 0x14;
 
@@ -765,22 +851,12 @@ void MapTile::saveTile(World* world)
   lCurrentPosition += 8 + lMWID_Size;
 
   // MDDF
-  int lMDDF_Size = 0x24 * lModelInstances.size();
-  lADTFile.Extend(8 + lMDDF_Size);
   SetChunkHeader(lADTFile, lCurrentPosition, 'MDDF', lMDDF_Size);
   lADTFile.GetPointer<MHDR>(lMHDR_Position + 8)->mddf = lCurrentPosition - 0x14;
 
   // MDDF data
   ENTRY_MDDF* lMDDF_Data = lADTFile.GetPointer<ENTRY_MDDF>(lCurrentPosition + 8);
 
-  if(world->mapIndex.sort_models_by_size_class())
-  {
-    std::sort(lModelInstances.begin(), lModelInstances.end(), [](ModelInstance const& m1, ModelInstance const& m2)
-    {
-      return m1.size_cat > m2.size_cat;
-    });
-  }
-
   lID = 0;
   for (auto const& model : lModelInstances)
   {
@@ -788,7 +864,7 @@ void MapTile::saveTile(World* world)
     if (filename_to_offset_and_name == lModels.end())
     {
       LogError << "There is a problem with saving the doodads. We have a doodad that somehow changed the name during the saving function. However this got produced, you can get a reward from schlumpf by pasting him this line." << std::endl;
-      return;
+      return {};
     }
 
     lMDDF_Data[lID].nameID = filename_to_offset_and_name->second.nameID;
@@ -809,8 +885,6 @@ void MapTile::saveTile(World* world)
   LogDebug << "Added " << lID << " doodads to MDDF" << std::endl;
 
   // MODF
-  int lMODF_Size = 0x40 * lObjectInstances.size();
-  lADTFile.Extend(8 + lMODF_Size);
   SetChunkHeader(lADTFile, lCurrentPosition, 'MODF', lMODF_Size);
   lADTFile.GetPointer<MHDR>(lMHDR_Position + 8)->modf = lCurrentPosition - 0x14;
 
@@ -824,7 +898,7 @@ void MapTile::saveTile(World* world)
     if (filename_to_offset_and_name == lObjects.end())
     {
       LogError << "There is a problem with saving the objects. We have an object that somehow changed the name during the saving function. However this got produced, you can get a reward from schlumpf by pasting him this line." << std::endl;
-      return;
+      return {};
     }
 
     lMODF_Data[lID].nameID = filename_to_offset_and_name->second.nameID;
@@ -856,23 +930,24 @@ void MapTile::saveTile(World* world)
   lCurrentPosition += 8 + lMODF_Size;
 
   //MH2O
-  Water.saveToFile(lADTFile, lMHDR_Position, lCurrentPosition);
+  if (lMH2O_Size)
+  {
+    Water.saveToFile(lADTFile, lMHDR_Position, lCurrentPosition);
+  }
 
   // MCNK
   for (int y = 0; y < 16; ++y)
   {
     for (int x = 0; x < 16; ++x)
     {
-      mChunks[y][x]->save(lADTFile, lCurrentPosition, lMCIN_Position, lTextures, lObjectInstances, lModelInstances);
+      mChunks[y][x]->save(lADTFile, lCurrentPosition, lMCIN_Position, lTextures, lChunksData[y * 16 + x]);
     }
   }
 
   // MFBO
   if (mFlags & 1)
   {
-    size_t chunkSize = sizeof(int16_t) * 9 * 2;
-    lADTFile.Extend(8 + chunkSize);
-    SetChunkHeader(lADTFile, lCurrentPosition, 'MFBO', chunkSize);
+    SetChunkHeader(lADTFile, lCurrentPosition, 'MFBO', lMFBO_Size);
     lADTFile.GetPointer<MHDR>(lMHDR_Position + 8)->mfbo = lCurrentPosition - 0x14;
 
     int16_t *lMFBO_Data = lADTFile.GetPointer<int16_t>(lCurrentPosition + 8);
@@ -885,7 +960,7 @@ void MapTile::saveTile(World* world)
     for (int i = 0; i < 9; ++i)
       lMFBO_Data[lID++] = (int16_t)mMinimumValues[i].y;
 
-    lCurrentPosition += 8 + chunkSize;
+    lCurrentPosition += 8 + lMFBO_Size;
   }
 
   //! \todo Do not do bullshit here in MTFX.
@@ -909,18 +984,10 @@ void MapTile::saveTile(World* world)
   }
 #endif
 
-  lADTFile.Extend(lCurrentPosition - lADTFile.data.size()); // cleaning unused nulls at the end of file
+  assert(lCurrentPosition == static_cast<int>(lADTFile.data.size()));
 
 
-  {
-    MPQFile f(filename);
-    f.setBuffer(lADTFile.data);
-    f.SaveFile();
-  }
-
-  lObjectInstances.clear();
-  lModelInstances.clear();
-  lModels.clear();
+  return std::move(lADTFile.data);
 }
 
 
@@ -8,6 +8,8 @@
 #include <noggit/MapHeaders.h>
 #include <noggit/Selection.h>
 #include <noggit/TileWater.hpp>
+#include <noggit/terrain_draw_list.hpp>
+#include <noggit/terrain_tile_render.hpp>
 #include <noggit/tile_index.hpp>
 #include <noggit/tool_enums.hpp>
 #include <opengl/shader.fwd.hpp>
@@ -86,16 +88,11 @@ public:
             , std::map<int, misc::random_color>& area_id_colors
             , int animtime
             , display_mode display
-            , bool& previous_chunk_had_shadows
-            , bool& previous_chunk_was_textured
-            , bool& previous_chunk_could_be_painted
             , std::vector<int>& textures_bound
             );
-  void intersect (math::ray const&, selection_result*) const;
   void drawWater ( math::frustum const& frustum
                  , const float& cull_distance
                  , const math::vector_3d& camera
-                 , bool camera_moved
                  , liquid_render& render
                  , opengl::scoped::use_program& water_shader
                  , int animtime
@@ -108,6 +105,9 @@ public:
   bool GetVertex(float x, float z, math::vector_3d *V);
 
   void saveTile(World*);
+  //! the file of a tile loaded without its models, with the instances read
+  //! from it instead of the world's, leaving the world untouched
+  std::vector<char> headless_file_data(World*);
 	void CropWater();
 
   bool isTile(int pX, int pZ);
@@ -117,6 +117,11 @@ public:
     return async_priority::high;
   }
 
+  virtual boost::optional<async_spatial_key> spatial_key() const
+  {
+    return async_spatial_key {index.x + 0.5f, index.z + 0.5f};
+  }
+
   bool has_model(uint32_t uid) const
   {
     return std::find(uids.begin(), uids.end(), uid) != uids.end();
@@ -155,13 +160,21 @@ private:
   std::vector<std::string> mWMOFilenames;
   
   std::vector<uint32_t> uids;
+  //! the instances of a tile loaded without its models
+  std::vector<ENTRY_MDDF> _file_model_entries;
+  std::vector<ENTRY_MODF> _file_wmo_entries;
 
   std::unique_ptr<MapChunk> mChunks[16][16];
+
+  noggit::terrain_tile_render _terrain_render;
+  noggit::terrain_draw_list _terrain_draw_list;
   std::vector<TileWater*> chunksLiquids; //map chunks liquids for old style water render!!! (Not MH2O)
 
   bool _load_models;
   World* _world;
 
+  std::vector<char> file_data(World*, std::vector<ModelInstance>&, std::vector<WMOInstance>&);
+
   friend class MapChunk;
   friend class TextureSet;
 };
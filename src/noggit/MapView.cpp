@@ -52,6 +52,7 @@
 #include <QtWidgets/QApplication>
 #include <QtWidgets/QMenuBar>
 #include <QtWidgets/QMessageBox>
+#include <QtWidgets/QProgressDialog>
 #include <QtWidgets/QPushButton>
 #include <QtWidgets/QStatusBar>
 #include <QtWidgets/QComboBox>
@@ -650,18 +651,14 @@ void MapView::createGUI()
                 , "Map to big alpha"
                 , [this]
                   {
-                    makeCurrent();
-                    opengl::context::scoped_setter const _ (::gl, context());
-                    _world->convert_alphamap(true);
+                    convert_alphamap(true);
                   }
                 );
   ADD_ACTION_NS ( assist_menu
                 , "Map to old alpha"
                 , [this]
                   {
-                    makeCurrent();
-                    opengl::context::scoped_setter const _ (::gl, context());
-                    _world->convert_alphamap(false);
+                    convert_alphamap(false);
                   }
                 );
 
@@ -1143,6 +1140,8 @@ void MapView::createGUI()
                       boost::get<selected_wmo_type>(selection)->wmo->toggle_visibility();
                     }
                   }
+
+                  _world->instance_visibility_changed();
                 }
               }
             , [&] { return terrainMode == editing_mode::object; }
@@ -1172,6 +1171,7 @@ void MapView::createGUI()
               {
                 ModelManager::clear_hidden_models();
                 WMOManager::clear_hidden_wmos();
+                _world->instance_visibility_changed();
               }
             , [&] { return terrainMode == editing_mode::object; }
             );
@@ -1531,6 +1531,12 @@ void MapView::initializeGL()
 
 void MapView::paintGL()
 {
+  // the progress dialog processes events while saving
+  if (_saving_tiles)
+  {
+    return;
+  }
+
   opengl::context::scoped_setter const _ (::gl, context());
   const qreal now(_startup_time.elapsed() / 1000.0);
 
@@ -1540,6 +1546,8 @@ void MapView::paintGL()
 
   draw_map();
 
+  TextureManager::update_residency();
+
   tick (now - _last_update);
   _last_update = now;
 
@@ -2117,8 +2125,11 @@ void MapView::tick (float dt)
                         )
       / qreal (_last_frame_durations.size())
       );
+    auto const textures (TextureManager::residency().stats());
     _status_fps->setText ( "FPS: " + QString::number (int (1. / avg_frame_duration)) 
                          + " - Average frame time: " + QString::number(avg_frame_duration*1000.0) + "ms"
+                         + " - Textures: " + QString::number (textures.gpu_bytes >> 20)
+                         + " / " + QString::number (textures.budget >> 20) + " MB"
                          );
 
     _last_frame_durations.clear();
@@ -3003,6 +3014,41 @@ void MapView::mouseReleaseEvent (QMouseEvent* event)
   }
 }
 
+void MapView::convert_alphamap(bool to_big_alpha)
+{
+  makeCurrent();
+  opengl::context::scoped_setter const _ (::gl, context());
+
+  QProgressDialog progress_dialog ("Converting alphamaps...", "Cancel", 0, 0, this);
+  progress_dialog.setWindowModality (Qt::WindowModal);
+  progress_dialog.setMinimumDuration (500);
+
+  _saving_tiles = true;
+
+  bool const completed
+    ( _world->convert_alphamap
+        ( to_big_alpha
+        , [&] (std::size_t converted, std::size_t total)
+          {
+            progress_dialog.setMaximum (total);
+            progress_dialog.setValue (converted);
+            return !progress_dialog.wasCanceled();
+          }
+        )
+    );
+
+  _saving_tiles = false;
+
+  if (completed)
+  {
+    _main_window->statusBar()->showMessage("Alphamaps converted", 2000);
+  }
+  else
+  {
+    _main_window->statusBar()->showMessage("Alphamap conversion cancelled or failed, the map is unchanged", 5000);
+  }
+}
+
 void MapView::save(save_mode mode)
 {
   bool save = true;
@@ -3069,17 +3115,41 @@ void MapView::save(save_mode mode)
     makeCurrent();
     opengl::context::scoped_setter const _ (::gl, context());
 
+    QProgressDialog progress_dialog ("Saving tiles...", "Cancel", 0, 0, this);
+    progress_dialog.setWindowModality (Qt::WindowModal);
+    progress_dialog.setMinimumDuration (500);
+
+    auto const progress
+      ( [&] (std::size_t saved, std::size_t total)
+        {
+          progress_dialog.setMaximum (total);
+          progress_dialog.setValue (saved);
+          return !progress_dialog.wasCanceled();
+        }
+      );
+
+    _saving_tiles = true;
+
     switch (mode)
     {
     case save_mode::current: _world->mapIndex.saveTile(tile_index(_camera.position), _world.get()); break;
-    case save_mode::changed: _world->mapIndex.saveChanged(_world.get()); break;
-    case save_mode::all:     _world->mapIndex.saveall(_world.get()); break;
+    case save_mode::changed: _world->mapIndex.saveChanged(_world.get(), progress); break;
+    case save_mode::all:     _world->mapIndex.saveall(_world.get(), progress); break;
     }    
 
+    _saving_tiles = false;
+
     AsyncLoader::instance().reset_object_fail();
 
 
-    _main_window->statusBar()->showMessage("Map saved", 2000);
+    if (progress_dialog.wasCanceled())
+    {
+      _main_window->statusBar()->showMessage("Saving cancelled, some tiles are still unsaved", 5000);
+    }
+    else
+    {
+      _main_window->statusBar()->showMessage("Map saved", 2000);
+    }
 
   }
   else
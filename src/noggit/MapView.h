@@ -173,10 +173,13 @@ private:
   bool _from_bookmark;
 
   bool Saving = false;
+  //! nothing may be edited or unloaded while the tiles are saved in parallel
+  bool _saving_tiles = false;
 
   noggit::ui::toolbar* _toolbar;
 
   void save(save_mode mode);
+  void convert_alphamap(bool to_big_alpha);
 
   QSettings* _settings;
 
@@ -179,13 +179,6 @@ namespace misc
   }
 }
 
-void SetChunkHeader(sExtendableArray& pArray, int pPosition, int pMagix, int pSize)
-{
-  sChunkHeader* Header = pArray.GetPointer<sChunkHeader>(pPosition);
-  Header->mMagic = pMagix;
-  Header->mSize = pSize;
-}
-
 bool pointInside(math::vector_3d point, math::vector_3d extents[2])
 {
   minmax(&extents[0], &extents[1]);
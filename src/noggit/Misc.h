@@ -134,6 +134,14 @@ public:
     data.insert (data.begin() + pPosition, pAdditionalData, pAdditionalData + pAddition);
 	}
 
+  //! copy into the already allocated data, unlike Insert it never
+  //! reallocates or moves what follows pPosition
+  void Write (unsigned long pPosition, unsigned long pSize, const char * pData)
+  {
+    assert (pPosition + pSize <= data.size());
+    std::memcpy (data.data() + pPosition, pData, pSize);
+  }
+
 	template<typename To>
 	To * GetPointer(unsigned long pPosition = 0)
 	{
@@ -152,7 +160,12 @@ struct sChunkHeader
   int mSize;
 };
 
-void SetChunkHeader(sExtendableArray& pArray, int pPosition, int pMagix, int pSize = 0);
+inline void SetChunkHeader(sExtendableArray& pArray, int pPosition, int pMagix, int pSize = 0)
+{
+  sChunkHeader* Header = pArray.GetPointer<sChunkHeader>(pPosition);
+  Header->mMagic = pMagix;
+  Header->mSize = pSize;
+}
 
 bool pointInside(math::vector_3d point, math::vector_3d extents[2]);
 void minmax(math::vector_3d* a, math::vector_3d* b);
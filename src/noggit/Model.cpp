@@ -7,14 +7,23 @@
 #include <noggit/ModelInstance.h>
 #include <noggit/TextureManager.h> // TextureManager, Texture
 #include <noggit/World.h>
+#include <noggit/worker_pool.hpp>
 #include <opengl/scoped.hpp>
 #include <opengl/shader.hpp>
 
 #include <algorithm>
 #include <cassert>
 #include <map>
+#include <set>
 #include <sstream>
 #include <string>
+#include <utility>
+
+namespace
+{
+  // below that, splitting the skinning costs more than it saves
+  std::size_t const skinning_block_size = 4096;
+}
 
 Model::Model(const std::string& filename)
   : AsyncObject(filename)
@@ -74,6 +83,8 @@ void Model::finishLoading()
 
   f.close();
 
+  build_bvh();
+
   finished = true;
   _state_changed.notify_all();
 }
@@ -1014,7 +1025,17 @@ void Model::initAnimated(const MPQFile& f)
     {
       bones.emplace_back(f, mb[i], _global_sequences.data(), animation_files);
     }
-  }  
+
+    _bone_pose = noggit::bone_pose(bones.size());
+    _bone_poses_cacheable = std::all_of ( bones.begin(), bones.end()
+                                        , [] (Bone const& bone) { return bone.only_depends_on_animation_time(); }
+                                        );
+  }
+
+  if (animGeometry)
+  {
+    _skinning = noggit::model_skinning(_vertices);
+  }
 
   if (animTextures) 
   {
@@ -1077,6 +1098,82 @@ void Model::calcBones( math::matrix_4x4 const& model_view
   }
 }
 
+void Model::update_bone_pose(math::matrix_4x4 const& model_view, int time)
+{
+  // the poses are only quantized when they are cached, the others are
+  // evaluated at the exact time
+  bool const cached = _bone_poses_cacheable && _bone_poses.fits(_bone_pose.byte_size());
+
+  if (cached)
+  {
+    time = noggit::bone_pose_cache::quantize(time);
+
+    if (auto pose = _bone_poses.find(_current_anim_seq, time))
+    {
+      // the particles, ribbons and lights read the bones themselves
+      if (!_particles.empty() || !_ribbons.empty() || header.nLights)
+      {
+        for (size_t i = 0; i < bones.size(); ++i)
+        {
+          bones[i].mat = pose->matrix(i);
+          bones[i].mrot = pose->rotation(i);
+        }
+      }
+
+      _current_bone_pose = pose;
+      return;
+    }
+  }
+
+  calcBones(model_view, _current_anim_seq, time, _global_animtime);
+
+  if (!cached && !animGeometry)
+  {
+    return;
+  }
+
+  for (size_t i = 0; i < bones.size(); ++i)
+  {
+    _bone_pose.set(i, bones[i].mat, bones[i].mrot);
+  }
+
+  _current_bone_pose = &_bone_pose;
+
+  if (cached)
+  {
+    if (auto pose = _bone_poses.insert(_current_anim_seq, time, _bone_pose))
+    {
+      _current_bone_pose = pose;
+    }
+  }
+}
+
+void Model::skin_vertices()
+{
+  if (_current_vertices.size() != _vertices.size())
+  {
+    _current_vertices = _vertices;
+  }
+
+  std::size_t const count (_skinning.size());
+  std::size_t const blocks ((count + skinning_block_size - 1) / skinning_block_size);
+
+  if (blocks < 2)
+  {
+    _skinning.apply(*_current_bone_pose, _current_vertices.data(), 0, count);
+    return;
+  }
+
+  noggit::worker_pool::instance().for_each (blocks, [&] (std::size_t block)
+  {
+    _skinning.apply ( *_current_bone_pose
+                    , _current_vertices.data()
+                    , block * skinning_block_size
+                    , std::min (count, (block + 1) * skinning_block_size)
+                    );
+  });
+}
+
 void Model::animate(math::matrix_4x4 const& model_view, int anim_id, int anim_time)
 {
   if (_animations_seq_per_id.empty() || _animations_seq_per_id[anim_id].empty())
@@ -1117,33 +1214,12 @@ void Model::animate(math::matrix_4x4 const& model_view, int anim_id, int anim_ti
 
   if (animBones) 
   {
-    calcBones(model_view, _current_anim_seq, t, _global_animtime);
+    update_bone_pose(model_view, t);
   }
 
   if (animGeometry) 
   {
-    // transform vertices
-    _current_vertices = _vertices;
-
-    for (auto& vertex : _current_vertices)
-    {
-      ::math::vector_3d v(0, 0, 0), n(0, 0, 0);
-
-      for (size_t b (0); b < 4; ++b)
-      {
-        if (vertex.weights[b] <= 0)
-          continue;
-
-        ::math::vector_3d tv = bones[vertex.bones[b]].mat * vertex.position;
-        ::math::vector_3d tn = bones[vertex.bones[b]].mrot * vertex.normal;
-
-        v += tv * (static_cast<float> (vertex.weights[b]) / 255.0f);
-        n += tn * (static_cast<float> (vertex.weights[b]) / 255.0f);
-      }
-
-      vertex.position = v;
-      vertex.normal = n.normalized();
-    }
+    skin_vertices();
 
     opengl::scoped::buffer_binder<GL_ARRAY_BUFFER> const binder (_vertices_buffer);
     gl.bufferData (GL_ARRAY_BUFFER, _current_vertices.size() * sizeof (ModelVertex), _current_vertices.data(), GL_STREAM_DRAW);
@@ -1266,6 +1342,14 @@ Bone::Bone( const MPQFile& f,
   scale.apply(fixCoordSystem2);
 }
 
+bool Bone::only_depends_on_animation_time() const
+{
+  return !flags.billboard
+    && !trans.uses_global_sequence()
+    && !rot.uses_global_sequence()
+    && !scale.uses_global_sequence();
+}
+
 void Bone::calcMatrix( math::matrix_4x4 const& model_view
                      , Bone *allbones
                      , int anim
@@ -1411,18 +1495,13 @@ void Model::draw( math::matrix_4x4 const& model_view
 }
 
 void Model::draw ( math::matrix_4x4 const& model_view
-                 , std::vector<ModelInstance*> instances
+                 , noggit::instance_batch const& instances
                  , opengl::scoped::use_program& m2_shader
-                 , math::frustum const& frustum
-                 , const float& cull_distance
-                 , const math::vector_3d& camera
-                 , bool // draw_fog
                  , int animtime
                  , bool draw_particles
                  , bool all_boxes
                  , std::unordered_map<Model*, std::size_t>& models_with_particles
                  , std::unordered_map<Model*, std::size_t>& model_boxes_to_draw
-                 , display_mode display
                  )
 {
   if (!finishedLoading() || loading_failed())
@@ -1441,15 +1520,7 @@ void Model::draw ( math::matrix_4x4 const& model_view
     animcalc = true;
   }
 
-  std::vector<math::matrix_4x4> transform_matrix;
-
-  for (ModelInstance* mi : instances)
-  {
-    if (mi->is_visible(frustum, cull_distance, camera, display))
-    {
-      transform_matrix.push_back(mi->transform_matrix_transposed());
-    }    
-  }
+  std::vector<math::matrix_4x4> const& transform_matrix = instances.transforms;
 
   if (transform_matrix.empty())
   {
@@ -1470,7 +1541,11 @@ void Model::draw ( math::matrix_4x4 const& model_view
 
   {
     opengl::scoped::buffer_binder<GL_ARRAY_BUFFER> const transform_binder (_transform_buffer);
-    gl.bufferData(GL_ARRAY_BUFFER, transform_matrix.size() * sizeof(::math::matrix_4x4), transform_matrix.data(), GL_DYNAMIC_DRAW);
+    if (_transform_buffer_version != instances.version)
+    {
+      gl.bufferData(GL_ARRAY_BUFFER, transform_matrix.size() * sizeof(::math::matrix_4x4), transform_matrix.data(), GL_DYNAMIC_DRAW);
+      _transform_buffer_version = instances.version;
+    }
     m2_shader.attrib(_, "transform", opengl::array_buffer_is_already_bound{}, static_cast<math::matrix_4x4*> (nullptr), 1);
   }
   
@@ -1535,40 +1610,69 @@ void Model::draw_box (opengl::scoped::use_program& m2_box_shader, std::size_t bo
 }
 
 
-std::vector<float> Model::intersect (math::matrix_4x4 const& model_view, math::ray const& ray, int animtime)
+void Model::build_bvh()
 {
-  std::vector<float> results;
+  std::vector<noggit::triangle_bvh::triangle> triangles;
 
-  if (!finishedLoading() || loading_failed())
+  if (use_fake_geometry())
   {
-    return results;
-  }
+    auto const& fake_geom = _fake_geometry.get();
 
-  if (animated && (!animcalc || _per_instance_animation))
-  {
-    animate (model_view, 0, animtime);
-    animcalc = true;
+    for (size_t i = 0; i < fake_geom.indices.size(); i += 3)
+    {
+      triangles.push_back ({ fake_geom.vertices[fake_geom.indices[i + 0]]
+                           , fake_geom.vertices[fake_geom.indices[i + 1]]
+                           , fake_geom.vertices[fake_geom.indices[i + 2]]
+                           }
+                          );
+    }
   }
-
-  if (use_fake_geometry())
+  else if (!animGeometry)
   {
-    auto& fake_geom = _fake_geometry.get();
+    // several passes can draw the same geoset
+    std::set<std::pair<uint16_t, uint16_t>> ranges;
+    for (auto const& pass : _render_passes)
+    {
+      ranges.emplace (pass.index_start, pass.index_count);
+    }
 
-    for (size_t i = 0; i < fake_geom.indices.size(); i += 3)
+    for (auto const& range : ranges)
     {
-      if (auto distance
-        = ray.intersect_triangle(fake_geom.vertices[fake_geom.indices[i + 0]],
-          fake_geom.vertices[fake_geom.indices[i + 1]],
-          fake_geom.vertices[fake_geom.indices[i + 2]])
-        )
+      for (size_t i (range.first); i < range.first + range.second; i += 3)
       {
-        results.emplace_back (*distance);
+        triangles.push_back ({ _current_vertices[_indices[i + 0]].position
+                             , _current_vertices[_indices[i + 1]].position
+                             , _current_vertices[_indices[i + 2]].position
+                             }
+                            );
       }
     }
+  }
 
+  _bvh = noggit::triangle_bvh (std::move (triangles));
+}
+
+std::vector<float> Model::intersect (math::matrix_4x4 const& model_view, math::ray const& ray, int animtime)
+{
+  std::vector<float> results;
+
+  if (!finishedLoading() || loading_failed())
+  {
     return results;
   }
 
+  if (use_fake_geometry() || !animGeometry)
+  {
+    _bvh.intersect (ray, &results);
+    return results;
+  }
+
+  if (!animcalc || _per_instance_animation)
+  {
+    animate (model_view, 0, animtime);
+    animcalc = true;
+  }
+
   for (auto&& pass : _render_passes)
   {
     for (size_t i (pass.index_start); i < pass.index_start + pass.index_count; i += 3)
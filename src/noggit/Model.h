@@ -11,12 +11,16 @@
 #include <noggit/AsyncObject.h> // AsyncObject
 #include <noggit/MPQ.h>
 #include <noggit/ModelHeaders.h>
+#include <noggit/instance_batches.hpp>
+#include <noggit/model_skinning.hpp>
 #include <noggit/Particle.h>
 #include <noggit/TextureManager.h>
 #include <noggit/tool_enums.hpp>
+#include <noggit/triangle_bvh.hpp>
 #include <opengl/scoped.hpp>
 #include <opengl/shader.fwd.hpp>
 
+#include <map>
 #include <string>
 #include <vector>
 
@@ -69,6 +73,9 @@ public:
          const std::vector<std::unique_ptr<MPQFile>>& animation_files
        );
 
+  //! false when the matrices also depend on the view (billboards) or on
+  //! the global time (global sequences)
+  bool only_depends_on_animation_time() const;
 };
 
 
@@ -224,19 +231,16 @@ public:
            , bool all_boxes
            , display_mode display
            );
+  //! draws the visible instances of the batch, their transforms are
+  //! only uploaded when the version of the batch changed
   void draw ( math::matrix_4x4 const& model_view
-            , std::vector<ModelInstance*> instances
+            , noggit::instance_batch const& instances
             , opengl::scoped::use_program& m2_shader
-            , math::frustum const& frustum
-            , const float& cull_distance
-            , const math::vector_3d& camera
-            , bool draw_fog
             , int animtime
             , bool draw_particles
             , bool all_boxes
             , std::unordered_map<Model*, std::size_t>& models_with_particles
             , std::unordered_map<Model*, std::size_t>& model_boxes_to_draw
-            , display_mode display
             );
   void draw_particles( math::matrix_4x4 const& model_view
                      , opengl::scoped::use_program& particles_shader
@@ -307,6 +311,9 @@ private:
 
   void animate(math::matrix_4x4 const& model_view, int anim_id, int anim_time);
   void calcBones(math::matrix_4x4 const& model_view, int anim, int time, int animation_time);
+  //! sets _current_bone_pose, from the cache when possible
+  void update_bone_pose(math::matrix_4x4 const& model_view, int time);
+  void skin_vertices();
 
   void lightsOn(opengl::light lbase);
   void lightsOff(opengl::light lbase);
@@ -323,6 +330,7 @@ private:
 
   GLuint const& _vao = _vertex_arrays[0];
   GLuint const& _transform_buffer = _buffers[0];
+  std::size_t _transform_buffer_version = 0;
   GLuint const& _vertices_buffer = _buffers[1];
 
   GLuint const& _box_vao = _vertex_arrays[1];
@@ -335,11 +343,26 @@ private:
   std::vector<ModelVertex> _vertices;
   std::vector<ModelVertex> _current_vertices;
 
+  //! only for the models with animated geometry
+  noggit::model_skinning _skinning;
+
+  //! the bones of the current frame, and the ones of the frames already
+  //! evaluated when they only depend on the animation time
+  noggit::bone_pose _bone_pose;
+  noggit::bone_pose const* _current_bone_pose = nullptr;
+  noggit::bone_pose_cache _bone_poses;
+  bool _bone_poses_cacheable = false;
+
   std::vector<uint16_t> _indices;
 
   std::vector<ModelRenderPass> _render_passes;
   boost::optional<FakeGeometry> _fake_geometry;
 
+  //! only built for the models whose vertices aren't animated, the others
+  //! have to be animated and tested triangle by triangle
+  noggit::triangle_bvh _bvh;
+  void build_bvh();
+
   // ===============================
   // Animation
   // ===============================
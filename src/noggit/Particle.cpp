@@ -5,17 +5,11 @@
 #include <opengl/context.hpp>
 #include <opengl/shader.hpp>
 
+#include <algorithm>
 #include <list>
 
 static const unsigned int MAX_PARTICLES = 10000;
 
-template<class T>
-T lifeRamp(float life, float mid, const T &a, const T &b, const T &c)
-{
-  if (life <= mid) return math::interpolation::linear(life / mid, a, b);
-  else return math::interpolation::linear((life - mid) / (1.0f - mid), b, c);
-}
-
 ParticleSystem::ParticleSystem(Model* model_, const MPQFile& f, const ModelParticleEmitterDef &mta, int *globals)
   : model (model_)
   , emitter_type(mta.EmitterType)
@@ -38,6 +32,7 @@ ParticleSystem::ParticleSystem(Model* model_, const MPQFile& f, const ModelParti
   , slowdown (mta.p.slowdown)
   , pos (fixCoordSystem(mta.pos))
   , _texture_id (mta.texture)
+  , particles (MAX_PARTICLES)
   , blend (mta.blend)
   , order (mta.ParticleType > 0 ? -1 : 0)
   , type (mta.ParticleType)
@@ -196,11 +191,10 @@ void ParticleSystem::update(float dt)
     else {
       int tospawn = (int)ftospawn;
 
-      if ((tospawn + particles.size()) > MAX_PARTICLES) // Error check to prevent the program from trying to load insane amounts of particles.
-        tospawn = particles.size() - MAX_PARTICLES;
-
       rem = ftospawn - static_cast<float>(tospawn);
 
+      // the pool holds at most MAX_PARTICLES, the ones above aren't spawned
+      tospawn = std::min<int> (tospawn, particles.capacity() - particles.size());
 
       float w = areal.getValue(manim, mtime, manimtime) * 0.5f;
       float l = areaw.getValue(manim, mtime, manimtime) * 0.5f;
@@ -215,42 +209,13 @@ void ParticleSystem::update(float dt)
       //rem = 0;
       if (en) {
         for (int i = 0; i<tospawn; ++i) {
-          Particle p = emitter->newParticle(this, manim, mtime, manimtime, w, l, spd, var, spr, spr2);
-          // sanity check:
-          //if (particles.size() < MAX_PARTICLES) // No need to check this every loop iteration. Already checked above.
-          particles.push_back(p);
+          particles.add (emitter->newParticle(this, manim, mtime, manimtime, w, l, spd, var, spr, spr2));
         }
       }
     }
   }
 
-  float mspeed = 1.0f;
-
-  for (ParticleList::iterator it = particles.begin(); it != particles.end();) {
-    Particle &p = *it;
-    p.speed += p.down * grav * dt - p.dir * deaccel * dt;
-
-    if (slowdown>0) {
-      mspeed = expf(-1.0f * slowdown * p.life);
-    }
-    p.pos += p.speed * mspeed * dt;
-
-    p.life += dt;
-    float rlife = p.life / p.maxlife;
-    // calculate size and color based on lifetime
-    p.size = lifeRamp<float>(rlife, mid, sizes[0], sizes[1], sizes[2]);
-    p.color = lifeRamp<math::vector_4d>(rlife, mid, colors[0], colors[1], colors[2]);
-
-    // kill off old particles
-    if (rlife >= 1.0f)
-    {
-      it = particles.erase (it);
-    }
-    else
-    {
-      ++it;
-    }
-  }
+  particles.update (dt, grav, deaccel, slowdown, {mid, sizes, colors});
 }
 
 void ParticleSystem::setup(int anim, int time, int animtime)
@@ -350,62 +315,71 @@ void ParticleSystem::draw( math::matrix_4x4 const& model_view
     if (billboard) 
     {
       //! \todo per-particle rotation in a non-expensive way?? :|
-      for (ParticleList::iterator it = particles.begin(); it != particles.end(); ++it) 
+      for (std::size_t i = 0; i < particles.size(); ++i) 
       {
-        if (tiles.size() - 1 < it->tile) // Alfred, 2009.08.07, error prevent
+        unsigned int const tile = particles.tile(i);
+        if (tiles.size() - 1 < tile) // Alfred, 2009.08.07, error prevent
         {
           break;
         }
 
-        const float size = it->size;// / 2;
+        math::vector_3d const position = particles.position(i);
+        math::vector_4d const color = particles.color(i);
+        const float size = particles.particle_size(i);// / 2;
+
 
-        texcoords.push_back(tiles[it->tile].tc[0]);
-        vertices.push_back(it->pos);
+        texcoords.push_back(tiles[tile].tc[0]);
+        vertices.push_back(position);
         offsets.push_back(-(vRight + vUp) * size);
-        colors_data.push_back(it->color);
+        colors_data.push_back(color);
 
-        texcoords.push_back(tiles[it->tile].tc[1]);
-        vertices.push_back(it->pos);
+        texcoords.push_back(tiles[tile].tc[1]);
+        vertices.push_back(position);
         offsets.push_back((vRight - vUp) * size);
-        colors_data.push_back(it->color);
+        colors_data.push_back(color);
 
-        texcoords.push_back(tiles[it->tile].tc[2]);
-        vertices.push_back(it->pos);
+        texcoords.push_back(tiles[tile].tc[2]);
+        vertices.push_back(position);
         offsets.push_back((vRight + vUp) * size);
-        colors_data.push_back(it->color);
+        colors_data.push_back(color);
 
-        texcoords.push_back(tiles[it->tile].tc[3]);
-        vertices.push_back(it->pos);
+        texcoords.push_back(tiles[tile].tc[3]);
+        vertices.push_back(position);
         offsets.push_back(-(vRight - vUp) * size);
-        colors_data.push_back(it->color);
+        colors_data.push_back(color);
 
         add_quad_indices(indices, indice);
       }
     }
     else 
     {
-      for (ParticleList::iterator it = particles.begin(); it != particles.end(); ++it) 
+      for (std::size_t i = 0; i < particles.size(); ++i) 
       {
-        if (tiles.size() - 1 < it->tile) // Alfred, 2009.08.07, error prevent
+        unsigned int const tile = particles.tile(i);
+        if (tiles.size() - 1 < tile) // Alfred, 2009.08.07, error prevent
         {
           break;
         }
 
-        texcoords.push_back(tiles[it->tile].tc[0]);
-        vertices.push_back(it->pos + it->corners[0] * it->size);
-        colors_data.push_back(it->color);
+        math::vector_3d const position = particles.position(i);
+        math::vector_4d const color = particles.color(i);
+        const float size = particles.particle_size(i);
 
-        texcoords.push_back(tiles[it->tile].tc[1]);
-        vertices.push_back(it->pos + it->corners[1] * it->size);
-        colors_data.push_back(it->color);
+        texcoords.push_back(tiles[tile].tc[0]);
+        vertices.push_back(position + particles.corner(i, 0) * size);
+        colors_data.push_back(color);
 
-        texcoords.push_back(tiles[it->tile].tc[2]);
-        vertices.push_back(it->pos + it->corners[2] * it->size);
-        colors_data.push_back(it->color);
+        texcoords.push_back(tiles[tile].tc[1]);
+        vertices.push_back(position + particles.corner(i, 1) * size);
+        colors_data.push_back(color);
 
-        texcoords.push_back(tiles[it->tile].tc[3]);
-        vertices.push_back(it->pos + it->corners[3] * it->size);
-        colors_data.push_back(it->color);
+        texcoords.push_back(tiles[tile].tc[2]);
+        vertices.push_back(position + particles.corner(i, 2) * size);
+        colors_data.push_back(color);
+
+        texcoords.push_back(tiles[tile].tc[3]);
+        vertices.push_back(position + particles.corner(i, 3) * size);
+        colors_data.push_back(color);
 
         add_quad_indices(indices, indice);
       }
@@ -423,28 +397,33 @@ void ParticleSystem::draw( math::matrix_4x4 const& model_view
     bv1 = mbb * math::vector_3d(1.0f,0,0);
     */
 
-    for (ParticleList::iterator it = particles.begin(); it != particles.end(); ++it) 
+    for (std::size_t i = 0; i < particles.size(); ++i) 
     {
-      if (tiles.size() - 1 < it->tile) // Alfred, 2009.08.07, error prevent
+      unsigned int const tile = particles.tile(i);
+      if (tiles.size() - 1 < tile) // Alfred, 2009.08.07, error prevent
       {
         break;
       }
 
-      texcoords.push_back(tiles[it->tile].tc[0]);
-      vertices.push_back(it->pos + bv0 * it->size);
-      colors_data.push_back(it->color);
+      math::vector_3d const position = particles.position(i);
+      math::vector_4d const color = particles.color(i);
+      const float size = particles.particle_size(i);
+
+      texcoords.push_back(tiles[tile].tc[0]);
+      vertices.push_back(position + bv0 * size);
+      colors_data.push_back(color);
 
-      texcoords.push_back(tiles[it->tile].tc[1]);
-      vertices.push_back(it->pos + bv1 * it->size);
-      colors_data.push_back(it->color);
+      texcoords.push_back(tiles[tile].tc[1]);
+      vertices.push_back(position + bv1 * size);
+      colors_data.push_back(color);
 
-      texcoords.push_back(tiles[it->tile].tc[2]);
-      vertices.push_back(it->origin + bv1 * it->size);
-      colors_data.push_back(it->color);
+      texcoords.push_back(tiles[tile].tc[2]);
+      vertices.push_back(particles.origin(i) + bv1 * size);
+      colors_data.push_back(color);
 
-      texcoords.push_back(tiles[it->tile].tc[3]);
-      vertices.push_back(it->origin + bv0 * it->size);
-      colors_data.push_back(it->color);
+      texcoords.push_back(tiles[tile].tc[3]);
+      vertices.push_back(particles.origin(i) + bv0 * size);
+      colors_data.push_back(color);
 
       add_quad_indices(indices, indice);
     }
@@ -5,6 +5,7 @@
 #include <noggit/Animated.h> // Animation::M2Value
 #include <noggit/Model.h>
 #include <noggit/TextureManager.h>
+#include <noggit/particle_pool.hpp>
 #include <opengl/scoped.hpp>
 #include <opengl/shader.fwd.hpp>
 
@@ -17,17 +18,6 @@ class Model;
 class ParticleSystem;
 class RibbonEmitter;
 
-struct Particle {
-  math::vector_3d pos, speed, down, origin, dir;
-  math::vector_3d  corners[4];
-  //math::vector_3d tpos;
-  float size, life, maxlife;
-  unsigned int tile;
-  math::vector_4d color;
-};
-
-typedef std::list<Particle> ParticleList;
-
 class ParticleEmitter {
 public:
   explicit ParticleEmitter() {}
@@ -63,7 +53,7 @@ class ParticleSystem
   float mid, slowdown;
   math::vector_3d pos;
   uint16_t _texture_id;
-  ParticleList particles;
+  noggit::particle_pool particles;
   int blend, order, type;
   int manim, mtime;
   int manimtime;
@@ -23,9 +23,9 @@ SkyColor::SkyColor(int t, int col)
 
 Sky::Sky(DBCFile::Iterator data)
 {
-  pos = math::vector_3d(data->getFloat(LightDB::PositionX) / skymul, data->getFloat(LightDB::PositionY) / skymul, data->getFloat(LightDB::PositionZ) / skymul);
-  r1 = data->getFloat(LightDB::RadiusInner) / skymul;
-  r2 = data->getFloat(LightDB::RadiusOuter) / skymul;
+  pos = math::vector_3d(data->get<LightDB::PositionX>() / skymul, data->get<LightDB::PositionY>() / skymul, data->get<LightDB::PositionZ>() / skymul);
+  r1 = data->get<LightDB::RadiusInner>() / skymul;
+  r2 = data->get<LightDB::RadiusOuter>() / skymul;
 
   for (int i = 0; i < 36; ++i)
   {
@@ -34,7 +34,7 @@ Sky::Sky(DBCFile::Iterator data)
 
   global = (pos.x == 0.0f && pos.y == 0.0f && pos.z == 0.0f);
 
-  int light_param_0 = data->getInt(LightDB::DataIDs);
+  int light_param_0 = data->get<LightDB::DataIDs>();
   int light_int_start = light_param_0 * NUM_SkyColorNames - 17; // cromons light fix ;) Thanks
 
   for (int i = 0; i < NUM_SkyColorNames; ++i)
@@ -42,7 +42,7 @@ Sky::Sky(DBCFile::Iterator data)
     try
     {
       DBCFile::Record rec = gLightIntBandDB.getByID(light_int_start + i);
-      int entries = rec.getInt(LightIntBandDB::Entries);
+      int entries = rec.get<LightIntBandDB::Entries>();
 
       if (entries == 0)
       {
@@ -50,19 +50,19 @@ Sky::Sky(DBCFile::Iterator data)
       }
       else
       {
-        mmin[i] = rec.getInt(LightIntBandDB::Times);
+        mmin[i] = rec.get<LightIntBandDB::Times>();
         for (int l = 0; l < entries; l++)
         {
-          SkyColor sc(rec.getInt(LightIntBandDB::Times + l), rec.getInt(LightIntBandDB::Values + l));
+          SkyColor sc(rec.get<LightIntBandDB::Times>(l), rec.get<LightIntBandDB::Values>(l));
           colorRows[i].push_back(sc);
         }
       }
     }
     catch (...)
     {
-      LogError << "When trying to intialize sky " << data->getInt(LightDB::ID) << ", there was an error with getting an entry in a DBC (" << i << "). Sorry." << std::endl;
+      LogError << "When trying to intialize sky " << data->get<LightDB::ID>() << ", there was an error with getting an entry in a DBC (" << i << "). Sorry." << std::endl;
       DBCFile::Record rec = gLightIntBandDB.getByID(i);
-      int entries = rec.getInt(LightIntBandDB::Entries);
+      int entries = rec.get<LightIntBandDB::Entries>();
 
       if (entries == 0)
       {
@@ -70,10 +70,10 @@ Sky::Sky(DBCFile::Iterator data)
       }
       else
       {
-        mmin[i] = rec.getInt(LightIntBandDB::Times);
+        mmin[i] = rec.get<LightIntBandDB::Times>();
         for (int l = 0; l < entries; l++)
         {
-          SkyColor sc(rec.getInt(LightIntBandDB::Times + l), rec.getInt(LightIntBandDB::Values + l));
+          SkyColor sc(rec.get<LightIntBandDB::Times>(l), rec.get<LightIntBandDB::Values>(l));
           colorRows[i].push_back(sc);
         }
       }
@@ -83,16 +83,16 @@ Sky::Sky(DBCFile::Iterator data)
   try
   {
     DBCFile::Record light_param = gLightParamsDB.getByID(light_param_0);
-    int skybox_id = light_param.getInt(LightParamsDB::skybox);
+    int skybox_id = light_param.get<LightParamsDB::skybox>();
 
-    _river_shallow_alpha = light_param.getFloat(LightParamsDB::water_shallow_alpha);
-    _river_deep_alpha = light_param.getFloat(LightParamsDB::water_deep_alpha);
-    _ocean_shallow_alpha = light_param.getFloat(LightParamsDB::ocean_shallow_alpha);
-    _ocean_deep_alpha = light_param.getFloat(LightParamsDB::ocean_deep_alpha);
+    _river_shallow_alpha = light_param.get<LightParamsDB::water_shallow_alpha>();
+    _river_deep_alpha = light_param.get<LightParamsDB::water_deep_alpha>();
+    _ocean_shallow_alpha = light_param.get<LightParamsDB::ocean_shallow_alpha>();
+    _ocean_deep_alpha = light_param.get<LightParamsDB::ocean_deep_alpha>();
 
     if (skybox_id)
     {
-      skybox.emplace(gLightSkyboxDB.getByID(skybox_id).getString(LightSkyboxDB::filename));
+      skybox.emplace(gLightSkyboxDB.getByID(skybox_id).get<LightSkyboxDB::filename>());
     }
   }
   catch (...)
@@ -169,7 +169,7 @@ Skies::Skies(unsigned int mapid)
 {
   for (DBCFile::Iterator i = gLightDB.begin(); i != gLightDB.end(); ++i)
   {
-    if (mapid == i->getUInt(LightDB::Map))
+    if (mapid == i->get<LightDB::Map>())
     {
       Sky s(i);
       skies.push_back(s);
@@ -181,7 +181,7 @@ Skies::Skies(unsigned int mapid)
   {
     for (DBCFile::Iterator i = gLightDB.begin(); i != gLightDB.end(); ++i)
     {
-      if (0 == i->getUInt(LightDB::Map))
+      if (0 == i->get<LightDB::Map>())
       {
         Sky s(i);
         skies.push_back(s);
@@ -1,24 +1,57 @@
 // This file is part of Noggit3, licensed under GNU General Public License (version 3).
 
-#include <math/vector_2d.hpp>
 #include <noggit/TextureManager.h>
+#include <noggit/blp_decoder.hpp>
+#include <noggit/AsyncLoader.h>
 #include <noggit/Log.h> // LogDebug
+#include <noggit/thumbnail_cache.hpp>
 #include <opengl/context.hpp>
-#include <opengl/scoped.hpp>
-#include <opengl/shader.hpp>
 
 #include <QtCore/QString>
-#include <QtGui/QOffscreenSurface>
-#include <QtGui/QOpenGLFramebufferObjectFormat>
 #include <QtGui/QPixmap>
-#include <QtOpenGL/QGLPixelBuffer>
 
 #include <algorithm>
+#include <unordered_set>
+#include <utility>
 
 std::atomic<int> blp_texture::blp_tex_counter = {0};
 
+// before the textures, which unregister from it when destroyed
+noggit::texture_residency TextureManager::_residency (std::size_t (1024) << 20);
 decltype (TextureManager::_) TextureManager::_;
 
+noggit::texture_residency& TextureManager::residency()
+{
+  return _residency;
+}
+
+void TextureManager::update_residency()
+{
+  std::vector<int> const loaded (residency().take_loaded_promotions());
+  std::vector<int> const demoted (residency().next_frame());
+
+  if (loaded.empty() && demoted.empty())
+  {
+    return;
+  }
+
+  std::unordered_set<int> const loaded_ids (loaded.begin(), loaded.end());
+  std::unordered_set<int> const demoted_ids (demoted.begin(), demoted.end());
+  _.apply ( [&] (std::string const&, blp_texture& texture)
+            {
+              // already done if the texture was drawn since
+              if (loaded_ids.count (texture.public_id))
+              {
+                texture.finish_promotion();
+              }
+              if (demoted_ids.count (texture.public_id))
+              {
+                texture.demote();
+              }
+            }
+          );
+}
+
 void TextureManager::report()
 {
   std::string output = "Still in the Texture manager:\n";
@@ -28,29 +61,29 @@ void TextureManager::report()
             }
           );
   LogDebug << output;
-}
 
-#include <cstdint>
-//! \todo Cross-platform syntax for packed structs.
-#pragma pack(push,1)
-struct BLPHeader
-{
-  int32_t magix;
-  int32_t version;
-  uint8_t attr_0_compression;
-  uint8_t attr_1_alphadepth;
-  uint8_t attr_2_alphatype;
-  uint8_t attr_3_mipmaplevels;
-  int32_t resx;
-  int32_t resy;
-  int32_t offsets[16];
-  int32_t sizes[16];
-};
-#pragma pack(pop)
+  auto const stats (residency().stats());
+  LogDebug << "Texture memory: " << (stats.gpu_bytes >> 20) << " MB on the gpu, "
+           << (stats.cpu_bytes >> 20) << " MB on the cpu, "
+           << stats.low_detail_textures << " of " << stats.textures << " textures at low detail, "
+           << stats.promotions << " promotions, " << stats.demotions << " demotions" << std::endl;
+}
 
 #include <boost/thread.hpp>
 #include <noggit/MPQ.h>
 
+blp_texture::blp_texture(const std::string& filenameArg)
+  : AsyncObject(filenameArg)
+  , public_id(blp_tex_counter++)
+{
+  TextureManager::residency().add(public_id);
+}
+
+blp_texture::~blp_texture()
+{
+  TextureManager::residency().remove(public_id);
+}
+
 void blp_texture::bind()
 {
   opengl::texture::bind();
@@ -60,169 +93,194 @@ void blp_texture::bind()
     return;
   }
 
-  if (!_uploaded)
+  if (!_uploaded_first_level)
+  {
+    upload(_low_detail_levels, _low_detail_level);
+  }
+  else
+  {
+    finish_promotion();
+  }
+
+  TextureManager::residency().used(public_id);
+
+  if ( *_uploaded_first_level > 0
+    && !_promoting
+    && !_promotion_failed
+    && TextureManager::residency().try_promote(public_id, _full_detail_bytes)
+     )
   {
-    upload();
+    _promoting = true;
+    AsyncLoader::instance().queue_for_load(this);
   }
 }
 
-void blp_texture::upload()
+void blp_texture::finish_promotion()
 {
-  if (_uploaded)
+  if (!_promotion_loaded)
   {
     return;
   }
 
-  int width = _width, height = _height;
+  upload(_promoted_levels, 0);
+
+  _promoted_levels.clear();
+  _promotion_loaded = false;
+  _promoting = false;
+  TextureManager::residency().set_cpu_bytes(public_id, levels_size(_low_detail_levels));
+}
 
-  if (!_compression_format)
+void blp_texture::demote()
+{
+  if (!_uploaded_first_level || *_uploaded_first_level == _low_detail_level || _promoting)
   {
-    for (int i = 0; i < _data.size(); ++i)
-    {
-      gl.texImage2D(GL_TEXTURE_2D, i, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, _data[i].data());
+    return;
+  }
 
-      width = std::max(width >> 1, 1);
-      height = std::max(height >> 1, 1);
-    }
+  upload(_low_detail_levels, _low_detail_level);
+}
 
-    _data.clear();
-  }
-  else
+void blp_texture::upload(levels const& data, int first_level)
+{
+  // a new texture object, for the driver to release the levels it replaces
+  static_cast<opengl::texture&>(*this) = opengl::texture();
+  opengl::texture::bind();
+
+  for (std::size_t i = 0; i < data.size(); ++i)
   {
-    for (int i = 0; i < _compressed_data.size(); ++i)
-    {
-      gl.compressedTexImage2D(GL_TEXTURE_2D, i, _compression_format.get(), width, height, 0, _compressed_data[i].size(), _compressed_data[i].data());
+    int const level = first_level + static_cast<int>(i);
+    int const width = noggit::blp::mip_size(_width, level);
+    int const height = noggit::blp::mip_size(_height, level);
 
-      width = std::max(width >> 1, 1);
-      height = std::max(height >> 1, 1);
+    if (!_compression_format)
+    {
+      gl.texImage2D(GL_TEXTURE_2D, i, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data[i].data());
+    }
+    else
+    {
+      gl.compressedTexImage2D(GL_TEXTURE_2D, i, _compression_format.get(), width, height, 0, data[i].size(), data[i].data());
     }
-
-    gl.texParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, _compressed_data.size() - 1);
-    _compressed_data.clear();
   }
 
+  gl.texParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, data.size() - 1);
   gl.texParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
   gl.texParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-  _uploaded = true;
+  _uploaded_first_level = first_level;
+  TextureManager::residency().set_gpu_bytes(public_id, levels_size(data), first_level == 0);
 }
 
-void blp_texture::loadFromUncompressedData(BLPHeader const* lHeader, char const* lData)
+std::size_t blp_texture::levels_size(levels const& data)
 {
-  unsigned int const* pal = reinterpret_cast<unsigned int const*>(lData + sizeof(BLPHeader));
-
-  unsigned char const* buf;
-  unsigned int *p;
-  unsigned char const* c;
-  unsigned char const* a;
-
-  int alphabits = lHeader->attr_1_alphadepth;
-  bool hasalpha = alphabits != 0;
+  std::size_t size = 0;
+  for (auto const& level : data)
+  {
+    size += level.size();
+  }
+  return size;
+}
 
-  int width = _width, height = _height;
+blp_texture::levels blp_texture::loadFromUncompressedData(BLPHeader const* lHeader, char const* lData, std::size_t size, int first_level) const
+{
+  levels data;
 
-  for (int i = 0; i<16; ++i)
+  for (int i = first_level; i < _level_count; ++i)
   {
-    width = std::max(1, width);
-    height = std::max(1, height);
-
-    if (lHeader->offsets[i] > 0 && lHeader->sizes[i] > 0)
-    {
-      buf = reinterpret_cast<unsigned char const*>(&lData[lHeader->offsets[i]]);
+    std::vector<std::uint8_t> level ( noggit::blp::mip_size(_width, i)
+                                    * noggit::blp::mip_size(_height, i)
+                                    * sizeof(std::uint32_t)
+                                    );
+    noggit::blp::decode_palettized(*lHeader, lData, size, i, reinterpret_cast<std::uint32_t*>(level.data()));
+    data.emplace_back(std::move(level));
+  }
 
-      std::vector<uint32_t> data(lHeader->sizes[i]);
+  return data;
+}
 
-      int cnt = 0;
-      p = data.data();
-      c = buf;
-      a = buf + width*height;
-      for (int y = 0; y<height; y++)
-      {
-        for (int x = 0; x<width; x++)
-        {
-          unsigned int k = pal[*c++];
-          k = ((k & 0x00FF0000) >> 16) | ((k & 0x0000FF00)) | ((k & 0x000000FF) << 16);
-          int alpha = 0xFF;
-          if (hasalpha)
-          {
-            if (alphabits == 8)
-            {
-              alpha = (*a++);
-            }
-            else if (alphabits == 1)
-            {
-              alpha = (*a & (1 << cnt++)) ? 0xff : 0;
-              if (cnt == 8)
-              {
-                cnt = 0;
-                a++;
-              }
-            }
-          }
+blp_texture::levels blp_texture::loadFromCompressedData(BLPHeader const* lHeader, char const* lData, int first_level) const
+{
+  levels data;
 
-          k |= alpha << 24;
-          *p++ = k;
-        }
-      }
+  for (int i = first_level; i < _level_count; ++i)
+  {
+    // make sure the vector is of the right size, blizzard seems to fuck those up for some small mipmaps
+    std::vector<std::uint8_t> level(compressed_level_size(lHeader, i));
 
-      _data[i] = data;
-    }
-    else
-    {
-      return;
-    }
+    char const* start = lData + lHeader->offsets[i];
+    std::copy(start, start + lHeader->sizes[i], level.begin());
 
-    width >>= 1;
-    height >>= 1;
+    data.emplace_back(std::move(level));
   }
+
+  return data;
 }
 
-void blp_texture::loadFromCompressedData(BLPHeader const* lHeader, char const* lData)
+std::size_t blp_texture::compressed_level_size(BLPHeader const* lHeader, int level) const
 {
-  //                         0 (0000) & 3 == 0                1 (0001) & 3 == 1                    7 (0111) & 3 == 3
-  const int alphatypes[] = { GL_COMPRESSED_RGB_S3TC_DXT1_EXT, GL_COMPRESSED_RGBA_S3TC_DXT3_EXT, 0, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT };
   const int blocksizes[] = { 8, 16, 0, 16 };
 
-  int alpha_type = lHeader->attr_2_alphatype & 3;
-  GLint format = alphatypes[alpha_type];
-  _compression_format = format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? (lHeader->attr_1_alphadepth == 1 ? GL_COMPRESSED_RGBA_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT) : format;
+  return ((noggit::blp::mip_size(_width, level) + 3) / 4)
+       * ((noggit::blp::mip_size(_height, level) + 3) / 4)
+       * blocksizes[lHeader->attr_2_alphatype & 3];
+}
 
-  int width = _width, height = _height;
+void blp_texture::read_header(BLPHeader const* lHeader)
+{
+  _width = lHeader->resx;
+  _height = lHeader->resy;
+  _level_count = noggit::blp::mip_count(*lHeader);
 
-  for (int i = 0; i < 16; ++i)
+  if (lHeader->attr_0_compression == 2)
   {
-    if (lHeader->sizes[i] <= 0 || lHeader->offsets[i] <= 0)
-    {
-      return;
-    }
+    //                         0 (0000) & 3 == 0                1 (0001) & 3 == 1                    7 (0111) & 3 == 3
+    const int alphatypes[] = { GL_COMPRESSED_RGB_S3TC_DXT1_EXT, GL_COMPRESSED_RGBA_S3TC_DXT3_EXT, 0, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT };
 
-    // make sure the vector is of the right size, blizzard seems to fuck those up for some small mipmaps
-    int size = std::floor((width + 3) / 4) * std::floor((height + 3) / 4) * blocksizes[alpha_type];
+    GLint format = alphatypes[lHeader->attr_2_alphatype & 3];
+    _compression_format = format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? (lHeader->attr_1_alphadepth == 1 ? GL_COMPRESSED_RGBA_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT) : format;
 
-    if (size < lHeader->sizes[i])
+    for (int i = 0; i < _level_count; ++i)
     {
-      LogDebug << "mipmap size mismatch in '" << filename << "'" << std::endl;
-      return;
+      if (compressed_level_size(lHeader, i) < static_cast<std::size_t>(lHeader->sizes[i]))
+      {
+        LogDebug << "mipmap size mismatch in '" << filename << "'" << std::endl;
+        _level_count = i;
+      }
     }
+  }
 
-    _compressed_data[i].resize(size);
-
-    char const* start = lData + lHeader->offsets[i];
-    std::copy(start, start + lHeader->sizes[i], _compressed_data[i].begin());
+  if (!_level_count)
+  {
+    throw std::runtime_error("no mipmap in " + filename);
+  }
 
-    width = std::max(width >> 1, 1);
-    height = std::max(height >> 1, 1);
+  _low_detail_level = 0;
+  while ( _low_detail_level + 1 < _level_count
+       && std::max(noggit::blp::mip_size(_width, _low_detail_level), noggit::blp::mip_size(_height, _low_detail_level))
+          > noggit::texture_residency::low_detail_size
+        )
+  {
+    ++_low_detail_level;
   }
-}
 
-blp_texture::blp_texture(const std::string& filenameArg)
-  : AsyncObject(filenameArg)
-  , public_id(blp_tex_counter++)
-{
+  _full_detail_bytes = 0;
+  for (int i = 0; i < _level_count; ++i)
+  {
+    _full_detail_bytes += _compression_format
+                        ? compressed_level_size(lHeader, i)
+                        : noggit::blp::mip_size(_width, i) * noggit::blp::mip_size(_height, i) * sizeof(std::uint32_t);
+  }
 }
 
 void blp_texture::finishLoading()
 {
+  // only the low detail levels are read at first, then all of them when
+  // the texture is drawn
+  if (_promoting)
+  {
+    load_promotion();
+    return;
+  }
+
   bool exists = MPQFile::exists(filename);
   if (!exists)
   {
@@ -238,155 +296,89 @@ void blp_texture::finishLoading()
 
   char const* lData = f.getPointer();
   BLPHeader const* lHeader = reinterpret_cast<BLPHeader const*>(lData);
-  _width = lHeader->resx;
-  _height = lHeader->resy;
 
-  if (lHeader->attr_0_compression == 1)
-  {
-    loadFromUncompressedData(lHeader, lData);
-  }
-  else if (lHeader->attr_0_compression == 2)
-  {
-    loadFromCompressedData(lHeader, lData);
-  }
-  else
+  if (lHeader->attr_0_compression != 1 && lHeader->attr_0_compression != 2)
   {
     finished = true;
     throw std::logic_error ("unimplemented BLP colorEncoding");
   }
 
+  read_header(lHeader);
+
+  levels data = lHeader->attr_0_compression == 1
+              ? loadFromUncompressedData(lHeader, lData, f.getSize(), _low_detail_level)
+              : loadFromCompressedData(lHeader, lData, _low_detail_level);
+
   f.close();
+
+  _low_detail_levels = std::move(data);
+  TextureManager::residency().set_cpu_bytes(public_id, levels_size(_low_detail_levels));
+
   finished = true;
   _state_changed.notify_all();
 }
 
-namespace noggit
+void blp_texture::load_promotion()
 {
-  QPixmap render_blp_to_pixmap ( std::string const& blp_filename
-                               , int width
-                               , int height
-                               )
-  {
-    opengl::context::save_current_context const context_save (::gl);
-
-    QOpenGLContext context;
-    context.create();
-
-    QOpenGLFramebufferObjectFormat fmt;
-    fmt.setSamples(1);
-    fmt.setInternalTextureFormat(GL_RGBA8);
-
-    QOffscreenSurface surface;
-    surface.create();
+  levels data;
 
-    context.makeCurrent(&surface);
-
-    opengl::context::scoped_setter const context_set (::gl, &context);
-
-    opengl::scoped::bool_setter<GL_CULL_FACE, GL_FALSE> cull;
-    opengl::scoped::bool_setter<GL_DEPTH_TEST, GL_FALSE> depth;
-
-    opengl::scoped::deferred_upload_vertex_arrays<1> vao;
-    vao.upload();
-    opengl::scoped::deferred_upload_buffers<3> buffers;
-    buffers.upload();
-    GLuint const& indices_vbo = buffers[0];
-    GLuint const& vertices_vbo = buffers[1];
-    GLuint const& texcoords_vbo = buffers[2];
-
-    opengl::texture::set_active_texture(0);
-    blp_texture texture(blp_filename);
-    texture.finishLoading();
+  try
+  {
+    // no fallback texture: its levels wouldn't match the uploaded ones
+    if (!MPQFile::exists(filename))
+    {
+      throw std::runtime_error("file not found");
+    }
 
-    width = width == -1 ? texture.width() : width;
-    height = height == -1 ? texture.height() : height;
+    MPQFile f(filename);
+    if (f.isEof())
+    {
+      throw std::runtime_error("empty file");
+    }
 
-    float h = static_cast<float>(height);
-    float w = static_cast<float>(width);
-    float half_h = h * 0.5f;
-    float half_w = w * 0.5f;
+    char const* lData = f.getPointer();
+    BLPHeader const* lHeader = reinterpret_cast<BLPHeader const*>(lData);
 
-    std::vector<math::vector_2d> vertices =
+    if (lHeader->attr_0_compression != 1 && lHeader->attr_0_compression != 2)
     {
-       {-half_w, -half_h}
-      ,{-half_w, half_h}
-      ,{ half_w, half_h}
-      ,{ half_w, -half_h}
-    };
-    std::vector<math::vector_2d> texcoords =
+      throw std::logic_error("unimplemented BLP colorEncoding");
+    }
+    if (lHeader->resx != _width || lHeader->resy != _height)
     {
-       {0.f, 0.f}
-      ,{0.f, h}
-      ,{w, h}
-      ,{w, 0.f}
-    };
-    std::vector<std::uint16_t> indices = {0,1,2, 2,3,0};
-
-    gl.bufferData<GL_ARRAY_BUFFER, math::vector_2d>(vertices_vbo, vertices, GL_STATIC_DRAW);
-    gl.bufferData<GL_ARRAY_BUFFER, math::vector_2d>(texcoords_vbo, texcoords, GL_STATIC_DRAW);
-    gl.bufferData<GL_ELEMENT_ARRAY_BUFFER, std::uint16_t>(indices_vbo, indices, GL_STATIC_DRAW);
-
-    QOpenGLFramebufferObject pixel_buffer(width, height, fmt);
-    pixel_buffer.bind();
-
-    gl.viewport(0, 0, w, h);
-    gl.clearColor(.0f, .0f, .0f, 1.f);
-    gl.clear(GL_COLOR_BUFFER_BIT);
-
-    opengl::program program
-    (
-      {
-        {
-          GL_VERTEX_SHADER, R"code(
-#version 330 core
-
-in vec4 position;
-in vec2 tex_coord;
-out vec2 f_tex_coord;
-
-void main()
-{
-f_tex_coord = vec2(tex_coord.x, -tex_coord.y);
-gl_Position = position;
-}
-)code"
-        },
-        {
-          GL_FRAGMENT_SHADER,
-          R"code(
-#version 330 core
+      throw std::runtime_error("the size changed since it was loaded");
+    }
 
-uniform sampler2D tex;
+    data = lHeader->attr_0_compression == 1
+         ? loadFromUncompressedData(lHeader, lData, f.getSize(), 0)
+         : loadFromCompressedData(lHeader, lData, 0);
 
-in vec2 f_tex_coord;
+    f.close();
+  }
+  catch (std::exception const& e)
+  {
+    LogError << "loading all the levels of '" << filename << "' failed: " << e.what() << std::endl;
 
-layout(location = 0) out vec4 out_color;
+    _promotion_failed = true;
+    TextureManager::residency().promotion_failed(public_id);
+    _promoting = false;
+    return;
+  }
 
-void main()
-{
-out_color = vec4(texture(tex, f_tex_coord/2.f + vec2(0.5)).rgb, 1.);
+  _promoted_levels = std::move(data);
+  TextureManager::residency().set_cpu_bytes(public_id, levels_size(_low_detail_levels) + levels_size(_promoted_levels));
+  _promotion_loaded = true;
+  TextureManager::residency().promotion_loaded(public_id);
 }
-)code"
-        }
-      }
-    );
-
-    opengl::scoped::use_program shader (program);
-
-    shader.uniform("tex", 0);
-    texture.bind();
-
-    opengl::scoped::vao_binder const _ (vao[0]);
 
-    shader.attrib(_, "position", vertices_vbo, 2, GL_FLOAT, GL_FALSE, 0, 0);
-    shader.attrib(_, "tex_coord", texcoords_vbo, 2, GL_FLOAT, GL_FALSE, 0, 0);
-    opengl::scoped::buffer_binder<GL_ELEMENT_ARRAY_BUFFER> indices_binder(indices_vbo);
-
-    gl.drawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, indices_vbo);
-
-    QPixmap pixmap (QPixmap::fromImage (pixel_buffer.toImage()));
-
-    pixel_buffer.release();
+namespace noggit
+{
+  QPixmap render_blp_to_pixmap ( std::string const& blp_filename
+                               , int width
+                               , int height
+                               )
+  {
+    QPixmap pixmap
+      (QPixmap::fromImage (thumbnail_cache::instance().thumbnail (blp_filename, width, height)));
 
     if (pixmap.isNull())
     {
@@ -4,11 +4,14 @@
 
 #include <noggit/AsyncObject.h>
 #include <noggit/multimap_with_normalized_key.hpp>
+#include <noggit/texture_residency.hpp>
 #include <opengl/texture.hpp>
 
 #include <boost/optional.hpp>
 
-#include <map>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -17,16 +20,19 @@ struct BLPHeader;
 struct blp_texture : public opengl::texture, AsyncObject
 {
   blp_texture (std::string const& filename);
+  ~blp_texture();
   void finishLoading();
 
-  void loadFromUncompressedData(BLPHeader const* lHeader, char const* lData);
-  void loadFromCompressedData(BLPHeader const* lHeader, char const* lData);
-
+  //! full size
   int width() const { return _width; }
   int height() const { return _height; }
 
+  //! uploads the loaded levels and asks for all of them once drawn
   void bind();
-  void upload();
+  //! back to the low detail levels, see noggit::texture_residency
+  void demote();
+  //! uploads the levels of a loaded promotion, if any
+  void finish_promotion();
 
   virtual async_priority loading_priority() const
   {
@@ -36,15 +42,37 @@ struct blp_texture : public opengl::texture, AsyncObject
   int const public_id;
 
 private:
-  bool _uploaded = false;
+  //! data of consecutive mip levels
+  using levels = std::vector<std::vector<std::uint8_t>>;
+
+  void read_header(BLPHeader const* lHeader);
+  //! reads all the levels, without failing the already usable texture
+  void load_promotion();
+  levels loadFromUncompressedData(BLPHeader const* lHeader, char const* lData, std::size_t size, int first_level) const;
+  levels loadFromCompressedData(BLPHeader const* lHeader, char const* lData, int first_level) const;
+  std::size_t compressed_level_size(BLPHeader const* lHeader, int level) const;
+
+  void upload(levels const& data, int first_level);
+  static std::size_t levels_size(levels const& data);
 
   int _width;
   int _height;
-
-private:
-  std::map<int, std::vector<uint32_t>> _data;
-  std::map<int, std::vector<uint8_t>> _compressed_data;
+  int _level_count;
   boost::optional<GLint> _compression_format;
+  std::size_t _full_detail_bytes;
+
+  //! the first level of at most texture_residency::low_detail_size, kept
+  //! with the next ones to demote without reading the file again
+  int _low_detail_level;
+  levels _low_detail_levels;
+
+  boost::optional<int> _uploaded_first_level;
+
+  std::atomic<bool> _promoting = {false};
+  std::atomic<bool> _promotion_loaded = {false};
+  //! the full detail levels couldn't be read, the texture stays in low detail
+  std::atomic<bool> _promotion_failed = {false};
+  levels _promoted_levels;
 
   static std::atomic<int> blp_tex_counter;
 };
@@ -55,8 +83,15 @@ class TextureManager
 public:
   static void report();
 
+  static noggit::texture_residency& residency();
+  //! once per frame, with the context current, to upload the promotions
+  //! loaded for the textures not drawn since and demote the textures over
+  //! the budget
+  static void update_residency();
+
 private:
   friend struct scoped_blp_texture_reference;
+  static noggit::texture_residency _residency;
   static noggit::async_object_multimap_with_normalized_key<blp_texture> _;
 };
 
@@ -35,7 +35,6 @@ void TileWater::readFromFile(MPQFile &theFile, size_t basePos)
 void TileWater::draw ( math::frustum const& frustum
                      , const float& cull_distance
                      , const math::vector_3d& camera
-                     , bool camera_moved
                      , liquid_render& render
                      , opengl::scoped::use_program& water_shader
                      , int animtime
@@ -43,22 +42,65 @@ void TileWater::draw ( math::frustum const& frustum
                      , display_mode display
                      )
 {
+  if (!_render.uploaded())
+  {
+    _render.upload(water_shader, render.lod_indices());
+  }
+
+  // the slots of every changed chunk first, the buffers may have to grow
+  for (int z = 0; z < 16; ++z)
+  {
+    for (int x = 0; x < 16; ++x)
+    {
+      if (chunks[z][x]->need_layers_upload())
+      {
+        _render.set_layer_count(z * 16 + x, chunks[z][x]->layer_count());
+      }
+    }
+  }
+
+  if (_render.reserve())
+  {
+    for (int z = 0; z < 16; ++z)
+    {
+      for (int x = 0; x < 16; ++x)
+      {
+        chunks[z][x]->invalidate_layers_upload();
+      }
+    }
+  }
+
+  _draw_list.clear();
+
   for (int z = 0; z < 16; ++z)
   {
     for (int x = 0; x < 16; ++x)
     {
-      chunks[z][x]->draw ( frustum
-                         , cull_distance
-                         , camera
-                         , camera_moved
-                         , render
-                         , water_shader                         
-                         , animtime
-                         , layer
-                         , display
-                         );
+      chunks[z][x]->prepare_draw ( frustum
+                                 , _render
+                                 , _draw_list
+                                 , z * 16 + x
+                                 , cull_distance
+                                 , camera
+                                 , layer
+                                 , display
+                                 );
     }
   }
+
+  if (_draw_list.empty())
+  {
+    return;
+  }
+
+  _draw_list.finish();
+
+  _render.draw ( _draw_list
+               , [&] (int liquid_id)
+                 {
+                   render.prepare_draw(water_shader, liquid_id, animtime);
+                 }
+               );
 }
 
 ChunkWater* TileWater::getChunk(int x, int z)
@@ -77,21 +119,34 @@ void TileWater::autoGen(float factor)
   }
 }
 
-void TileWater::saveToFile(sExtendableArray &lADTFile, int &lMHDR_Position, int &lCurrentPosition)
+std::size_t TileWater::save_size()
 {
   if (!hasData(0))
   {
-    return;
+    return 0;
+  }
+
+  std::size_t size = 8 + 256 * sizeof(MH2O_Header);
+
+  for (int z = 0; z < 16; ++z)
+  {
+    for (int x = 0; x < 16; ++x)
+    {
+      size += chunks[z][x]->save_size();
+    }
   }
 
+  return size;
+}
+
+void TileWater::saveToFile(sExtendableArray &lADTFile, int &lMHDR_Position, int &lCurrentPosition)
+{
   int ofsW = lCurrentPosition + 0x8; //water Header pos
 
   lADTFile.GetPointer<MHDR>(lMHDR_Position + 8)->mh2o = lCurrentPosition - 0x14; //setting offset to MH2O data in Header
 
   int headers_size = 256 * sizeof(MH2O_Header);
-  // 8 empty bytes for the chunk header
-  lADTFile.Extend(8 + headers_size);
-  // set current pos after the mh2o headers
+  // set current pos after the chunk header and the mh2o headers
   lCurrentPosition = ofsW + headers_size;
   int header_pos = ofsW;
 
@@ -4,6 +4,9 @@
 
 #include <math/vector_3d.hpp>
 #include <noggit/ChunkWater.hpp>
+#include <noggit/liquid_draw_list.hpp>
+#include <noggit/liquid_render.hpp>
+#include <noggit/liquid_tile_render.hpp>
 #include <noggit/MPQ.h>
 #include <noggit/MapHeaders.h>
 #include <noggit/tool_enums.hpp>
@@ -21,12 +24,16 @@ public:
   ChunkWater* getChunk(int x, int z);
 
   void readFromFile(MPQFile &theFile, size_t basePos);
+  //! size of the MH2O chunk, 0 if there is none to write. Has to be
+  //! called before saveToFile as it removes the empty layers.
+  std::size_t save_size();
+  //! writes into the space reserved for save_size()
   void saveToFile(sExtendableArray &lADTFile, int &lMHDR_Position, int &lCurrentPosition);
 
+  //! draws the visible layers with a multi draw per liquid
   void draw ( math::frustum const& frustum
             , const float& cull_distance
             , const math::vector_3d& camera
-            , bool camera_moved
             , liquid_render& render
             , opengl::scoped::use_program& water_shader
             , int animtime
@@ -46,6 +53,9 @@ private:
   MapTile *tile;
   std::unique_ptr<ChunkWater> chunks[16][16];
 
+  noggit::liquid_tile_render _render;
+  noggit::liquid_draw_list _draw_list;
+
   float xbase;
   float zbase;
 };
@@ -316,6 +316,13 @@ void WMO::finishLoading ()
   for (auto& group : groups)
     group.load();
 
+  std::vector<noggit::triangle_bvh::triangle> triangles;
+  for (auto const& group : groups)
+  {
+    group.triangles (&triangles);
+  }
+  _bvh = noggit::triangle_bvh (std::move (triangles));
+
   finished = true;
   _state_changed.notify_all();
 }
@@ -398,10 +405,7 @@ std::vector<float> WMO::intersect (math::ray const& ray) const
     return results;
   }
 
-  for (auto& group : groups)
-  {
-    group.intersect (ray, &results);
-  }
+  _bvh.intersect (ray, &results);
 
   return results;
 }
@@ -1222,27 +1226,14 @@ void WMOGroup::draw( opengl::scoped::use_program& wmo_shader
   }
 }
 
-void WMOGroup::intersect (math::ray const& ray, std::vector<float>* results) const
+void WMOGroup::triangles (std::vector<noggit::triangle_bvh::triangle>* triangles) const
 {
-  if (!ray.intersect_bounds (VertexBoxMin, VertexBoxMax))
-  {
-    return;
-  }
-
   //! \todo Also allow clicking on doodads and liquids.
   for (auto&& batch : _batches)
   {
     for (size_t i (batch.index_start); i < batch.index_start + batch.index_count; i += 3)
     {
-      if ( auto&& distance
-         = ray.intersect_triangle ( _vertices[_indices[i + 0]]
-                                  , _vertices[_indices[i + 1]]
-                                  , _vertices[_indices[i + 2]]
-                                  )
-         )
-      {
-        results->emplace_back (*distance);
-      }
+      triangles->push_back ({_vertices[_indices[i + 0]], _vertices[_indices[i + 1]], _vertices[_indices[i + 2]]});
     }
   }
 }
@@ -11,6 +11,7 @@
 #include <noggit/multimap_with_normalized_key.hpp>
 #include <noggit/TextureManager.h>
 #include <noggit/tool_enums.hpp>
+#include <noggit/triangle_bvh.hpp>
 #include <noggit/wmo_liquid.hpp>
 
 #include <boost/optional.hpp>
@@ -135,7 +136,8 @@ public:
 
   void setupFog (bool draw_fog, std::function<void (bool)> setup_fog);
 
-  void intersect (math::ray const&, std::vector<float>* results) const;
+  //! appends the triangles of the batches, for picking
+  void triangles (std::vector<noggit::triangle_bvh::triangle>* triangles) const;
 
   // todo: portal culling
   bool is_visible( math::matrix_4x4 const& transform_matrix
@@ -301,6 +303,8 @@ public:
   bool _finished_upload;
 
   std::vector<WMOGroup> groups;
+  //! all the groups' triangles, for picking
+  noggit::triangle_bvh _bvh;
   std::vector<WMOMaterial> materials;
   math::vector_3d extents[2];
   std::vector<scoped_blp_texture_reference> textures;
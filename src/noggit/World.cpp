@@ -15,10 +15,15 @@
 #include <noggit/TileWater.hpp>// tile water
 #include <noggit/WMOInstance.h> // WMOInstance
 #include <noggit/map_index.hpp>
+#include <noggit/terrain_brush.hpp>
+#include <noggit/terrain_picking.hpp>
+#include <noggit/terrain_tile_render.hpp>
 #include <noggit/texture_set.hpp>
 #include <noggit/tool_enums.hpp>
 #include <noggit/ui/ObjectEditor.h>
+#include <noggit/ui/SettingsPanel.h>
 #include <noggit/ui/TexturingGUI.h>
+#include <noggit/worker_pool.hpp>
 #include <opengl/scoped.hpp>
 #include <opengl/shader.hpp>
 
@@ -29,11 +34,14 @@
 #include <QtWidgets/QMessageBox>
 
 #include <algorithm>
+#include <array>
 #include <cassert>
+#include <cmath>
 #include <ctime>
 #include <forward_list>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <sstream>
 #include <string>
@@ -47,7 +55,7 @@ bool World::IsEditableWorld(int pMapId)
   try
   {
     DBCFile::Record map = gMapDB.getByID((unsigned int)pMapId);
-    lMapName = map.getString(MapDB::InternalName);
+    lMapName = map.get<MapDB::InternalName>();
   }
   catch (int)
   {
@@ -109,6 +117,19 @@ World::World(const std::string& name, int map_id)
   , _view_distance(_settings->value ("view_distance", 1000.f).toFloat())
 {
   LogDebug << "Loading world \"" << name << "\"." << std::endl;
+
+  read_settings();
+}
+
+void World::read_settings()
+{
+  _settings_saved_count = noggit::ui::settings::saved_count();
+
+  _wireframe.type = _settings->value("wireframe/type", 0).toInt();
+  _wireframe.radius = _settings->value("wireframe/radius", 1.5f).toFloat();
+  _wireframe.width = _settings->value ("wireframe/width", 1.f).toFloat();
+  QColor c = _settings->value("wireframe/color").value<QColor>();
+  _wireframe.color = {c.redF(), c.greenF(), c.blueF(), c.alphaF()};
 }
 
 void World::update_selection_pivot()
@@ -282,7 +303,6 @@ void World::reset_selection()
 void World::delete_selected_models()
 {
   _model_instance_storage.delete_instances(_current_selection);
-  need_model_updates = true;
   reset_selection();
 }
 
@@ -746,8 +766,16 @@ void World::initGlobalVBOs(GLuint* pDetailTexCoords, GLuint* pAlphaTexCoords)
       }
     }
 
+    // the same for every chunk of a tile, which share their vertex buffers
+    std::vector<math::vector_2d> tile_texcoords;
+    tile_texcoords.reserve(noggit::terrain_tile_layout::chunk_count * mapbufsize);
+    for (std::size_t chunk = 0; chunk < noggit::terrain_tile_layout::chunk_count; ++chunk)
+    {
+      tile_texcoords.insert(tile_texcoords.end(), temp, temp + mapbufsize);
+    }
+
     gl.genBuffers(1, pDetailTexCoords);
-    gl.bufferData<GL_ARRAY_BUFFER> (*pDetailTexCoords, sizeof(temp), temp, GL_STATIC_DRAW);
+    gl.bufferData<GL_ARRAY_BUFFER> (*pDetailTexCoords, tile_texcoords, GL_STATIC_DRAW);
 
     // init texture coordinates for alpha map:
     vt = temp;
@@ -837,6 +865,11 @@ void World::draw ( math::matrix_4x4 const& model_view
     _display_initialized = true;
   }
 
+  if (_settings_saved_count != noggit::ui::settings::saved_count())
+  {
+    read_settings();
+  }
+
   math::matrix_4x4 const mvp(model_view * projection);
   math::frustum const frustum (mvp);
 
@@ -850,6 +883,7 @@ void World::draw ( math::matrix_4x4 const& model_view
           , { GL_FRAGMENT_SHADER, opengl::shader::src_from_qrc("m2_fs") }
           }
       );
+    noggit::frame_uniforms::bind_block(*_m2_program);
   }
   if (!_m2_instanced_program)
   {
@@ -859,6 +893,7 @@ void World::draw ( math::matrix_4x4 const& model_view
           , { GL_FRAGMENT_SHADER, opengl::shader::src_from_qrc("m2_fs") }
           }
       );
+    noggit::frame_uniforms::bind_block(*_m2_instanced_program);
   }
   if (!_m2_box_program)
   {
@@ -895,6 +930,10 @@ void World::draw ( math::matrix_4x4 const& model_view
           , { GL_FRAGMENT_SHADER, opengl::shader::src_from_qrc("terrain_fs") }
           }
       );
+    noggit::frame_uniforms::bind_block(*_mcnk_program);
+
+    opengl::scoped::use_program mcnk_shader{ *_mcnk_program.get() };
+    mcnk_shader.uniform_block("chunks", noggit::terrain_tile_render::parameters_binding);
   }
   if (!_mfbo_program)
   {
@@ -908,6 +947,7 @@ void World::draw ( math::matrix_4x4 const& model_view
   if (!_liquid_render)
   {
     _liquid_render.emplace();
+    noggit::frame_uniforms::bind_block(_liquid_render->shader_program());
   }
   if (!_wmo_program)
   {
@@ -917,6 +957,7 @@ void World::draw ( math::matrix_4x4 const& model_view
           , { GL_FRAGMENT_SHADER, opengl::shader::src_from_qrc("wmo_fs") }
           }
       );
+    noggit::frame_uniforms::bind_block(*_wmo_program);
   }
 
   gl.disable(GL_DEPTH_TEST);
@@ -934,29 +975,43 @@ void World::draw ( math::matrix_4x4 const& model_view
   math::vector_3d diffuse_color(skies->color_set[LIGHT_GLOBAL_DIFFUSE] * outdoorLightStats.dayIntensity);
   math::vector_3d ambient_color(skies->color_set[LIGHT_GLOBAL_AMBIENT] * outdoorLightStats.ambientIntensity);
 
+  {
+    noggit::frame_uniform_data frame;
+    frame.model_view = model_view;
+    frame.projection = projection;
+    frame.camera = {camera_pos, 1.f};
+    frame.fog_color = {skies->color_set[FOG_COLOR], 1.f};
+    frame.light_dir = {light_dir, 0.f};
+    frame.terrain_light_dir = {terrain_light_dir, 0.f};
+    frame.diffuse_color = {diffuse_color, 1.f};
+    frame.ambient_color = {ambient_color, 1.f};
+    // !\ todo use light dbcs values
+    frame.fog_start = 0.5f;
+    frame.fog_end = fogdistance;
+
+    _frame_uniforms.update(frame);
+  }
+
   // only draw the sky in 3D
   if(display == display_mode::in_3D)
   {
     opengl::scoped::use_program m2_shader {*_m2_program.get()};
 
-    m2_shader.uniform("model_view", model_view);
-    m2_shader.uniform("projection", projection);
     m2_shader.uniform("tex1", 0);
     m2_shader.uniform("tex2", 1);
 
     m2_shader.uniform("draw_fog", 0);
 
-    m2_shader.uniform("light_dir", light_dir);
-    m2_shader.uniform("diffuse_color", diffuse_color);
-    m2_shader.uniform("ambient_color", ambient_color);
-
     bool hadSky = false;
 
     if (draw_wmo || mapIndex.hasAGlobalWMO())
     {
-      _model_instance_storage.for_each_wmo_instance
-      (
-        [&] (WMOInstance& wmo)
+      _model_instance_storage.for_each_wmo_instance_in
+      ( [&] (math::vector_3d const& min, math::vector_3d const& max)
+        {
+          return camera_pos.is_inside_of(min, max);
+        }
+      , [&] (WMOInstance& wmo)
         {
           if (wmo.wmo->finishedLoading() && wmo.wmo->skybox)
           {
@@ -1015,40 +1070,18 @@ void World::draw ( math::matrix_4x4 const& model_view
   {
     opengl::scoped::use_program mcnk_shader{ *_mcnk_program.get() };
 
-    mcnk_shader.uniform("model_view", model_view);
-    mcnk_shader.uniform("projection", projection);
-
     mcnk_shader.uniform ("draw_lines", (int)draw_lines);
     mcnk_shader.uniform ("draw_hole_lines", (int)draw_hole_lines);
     mcnk_shader.uniform("draw_areaid_overlay", (int)draw_areaid_overlay);
     mcnk_shader.uniform ("draw_terrain_height_contour", (int)draw_contour);
 
-    // the flag stays on if the last chunk drawn before leaving the editing tool has it
-    if (!draw_chunk_flag_overlay)
-    {
-      mcnk_shader.uniform ("draw_impassible_flag", 0);
-    }
-
     mcnk_shader.uniform ("draw_wireframe", (int)draw_wireframe);
-    mcnk_shader.uniform ("wireframe_type", _settings->value("wireframe/type", 0).toInt());
-    mcnk_shader.uniform ("wireframe_radius", _settings->value("wireframe/radius", 1.5f).toFloat());
-    mcnk_shader.uniform ("wireframe_width", _settings->value ("wireframe/width", 1.f).toFloat());
-    // !\ todo store the color somewhere ?
-    QColor c = _settings->value("wireframe/color").value<QColor>();
-    math::vector_4d wireframe_color(c.redF(), c.greenF(), c.blueF(), c.alphaF());
-    mcnk_shader.uniform ("wireframe_color", wireframe_color);
+    mcnk_shader.uniform ("wireframe_type", _wireframe.type);
+    mcnk_shader.uniform ("wireframe_radius", _wireframe.radius);
+    mcnk_shader.uniform ("wireframe_width", _wireframe.width);
+    mcnk_shader.uniform ("wireframe_color", _wireframe.color);
 
     mcnk_shader.uniform ("draw_fog", (int)draw_fog);
-    mcnk_shader.uniform ("fog_color", math::vector_4d(skies->color_set[FOG_COLOR], 1));
-    // !\ todo use light dbcs values
-    mcnk_shader.uniform ("fog_end", fogdistance);
-    mcnk_shader.uniform ("fog_start", 0.5f);
-    mcnk_shader.uniform ("camera", camera_pos);
-
-    mcnk_shader.uniform("light_dir", terrain_light_dir);
-    mcnk_shader.uniform("diffuse_color", diffuse_color);
-    mcnk_shader.uniform("ambient_color", ambient_color);
-
 
     if (cursor == cursor_mode::terrain)
     {
@@ -1063,28 +1096,14 @@ void World::draw ( math::matrix_4x4 const& model_view
       mcnk_shader.uniform ("draw_cursor_circle", 0);
     }
 
-    mcnk_shader.uniform("alphamap", 0);
+    mcnk_shader.uniform("alphamaps", 0);
     mcnk_shader.uniform("tex0", 1);
     mcnk_shader.uniform("tex1", 2);
     mcnk_shader.uniform("tex2", 3);
     mcnk_shader.uniform("tex3", 4);
-    mcnk_shader.uniform("shadow_map", 5);
-
-    mcnk_shader.uniform("tex_anim_0", math::vector_2d());
-    mcnk_shader.uniform("tex_anim_1", math::vector_2d());
-    mcnk_shader.uniform("tex_anim_2", math::vector_2d());
-    mcnk_shader.uniform("tex_anim_3", math::vector_2d());
-
-    bool previous_chunk_could_be_painted = true;
-    bool previous_chunk_was_textured = true;
-    mcnk_shader.uniform("cant_paint", 0);
-    mcnk_shader.uniform("is_textured", 1);
 
     std::vector<int> textures_bound = { -1, -1, -1, -1 };
 
-    // start true so the first chunk update the shadow texture regardless of whether it has shadows or not
-    bool previous_chunk_had_shadows = true;    
-
     for (MapTile* tile : mapIndex.loaded_tiles())
     {
       tile->draw ( frustum
@@ -1100,9 +1119,6 @@ void World::draw ( math::matrix_4x4 const& model_view
                  , area_id_colors
                  , animtime
                  , display
-                 , previous_chunk_had_shadows
-                 , previous_chunk_was_textured
-                 , previous_chunk_could_be_painted
                  , textures_bound
                  );
     }
@@ -1154,19 +1170,14 @@ void World::draw ( math::matrix_4x4 const& model_view
     _sphere_render.draw(mvp, vertexCenter(), cursor_color, 2.f);
   }
 
-  std::unordered_map<std::string, std::vector<ModelInstance*>> _wmo_doodads;
-
-  bool draw_doodads_wmo = draw_wmo && draw_wmo_doodads;
-  if (draw_doodads_wmo)
-  {
-    _model_instance_storage.for_each_wmo_instance([&] (WMOInstance& wmo)
-    {
-      for (auto& doodad : wmo.get_visible_doodads(frustum, culldistance, camera_pos, draw_hidden_models, display))
+  auto const in_frustum
+    ( [&] (math::vector_3d const& min, math::vector_3d const& max)
       {
-        _wmo_doodads[doodad->model->filename].push_back(doodad);
+        return frustum.intersects(min, max);
       }
-    });
-  }
+    );
+
+  bool draw_doodads_wmo = draw_wmo && draw_wmo_doodads;
 
   std::unordered_map<Model*, std::size_t> model_with_particles;
 
@@ -1178,9 +1189,14 @@ void World::draw ( math::matrix_4x4 const& model_view
       ModelManager::resetAnim();
     }
 
-    if (need_model_updates)
+    noggit::instance_view const view
+      { model_view, projection, culldistance, display
+      , draw_models, draw_doodads_wmo, draw_hidden_models
+      };
+
+    if (_instance_batches.need_update(view, _model_instance_storage.version()))
     {
-      update_models_by_filename();
+      update_instance_batches(view, frustum, camera_pos);
     }
 
     std::unordered_map<Model*, std::size_t> model_boxes_to_draw;
@@ -1188,64 +1204,22 @@ void World::draw ( math::matrix_4x4 const& model_view
     {
       opengl::scoped::use_program m2_shader {*_m2_instanced_program.get()};
 
-      m2_shader.uniform("model_view", model_view);
-      m2_shader.uniform("projection", projection);
       m2_shader.uniform("tex1", 0);
       m2_shader.uniform("tex2", 1);
 
-      m2_shader.uniform("fog_color", math::vector_4d(skies->color_set[FOG_COLOR], 1));
-      // !\ todo use light dbcs values
-      m2_shader.uniform("fog_end", fogdistance);
-      m2_shader.uniform("fog_start", 0.5f);
       m2_shader.uniform("draw_fog", (int)draw_fog);
 
-      m2_shader.uniform("light_dir", light_dir);
-      m2_shader.uniform("diffuse_color", diffuse_color);
-      m2_shader.uniform("ambient_color", ambient_color);
-
-      if (draw_models)
+      for (auto& it : _instance_batches.batches())
       {
-        for (auto& it : _models_by_filename)
-        {
-          if (draw_hidden_models || !it.second[0]->model->is_hidden())
-          {
-            it.second[0]->model->draw( model_view
-                                     , it.second
-                                     , m2_shader
-                                     , frustum
-                                     , culldistance
-                                     , camera_pos
-                                     , false
-                                     , animtime
-                                     , draw_model_animations
-                                     , draw_models_with_box
-                                     , model_with_particles
-                                     , model_boxes_to_draw
-                                     , display
-                                     );
-          }
-        }
-      }
-
-      if (draw_doodads_wmo)
-      {
-        for (auto& it : _wmo_doodads)
-        {
-          it.second[0]->model->draw( model_view
-                                   , it.second
-                                   , m2_shader
-                                   , frustum
-                                   , culldistance
-                                   , camera_pos
-                                   , false
-                                   , animtime
-                                   , draw_model_animations
-                                   , draw_models_with_box
-                                   , model_with_particles
-                                   , model_boxes_to_draw
-                                   , display
-                                   );
-        }
+        it.first->draw( model_view
+                      , it.second
+                      , m2_shader
+                      , animtime
+                      , draw_model_animations
+                      , draw_models_with_box
+                      , model_with_particles
+                      , model_boxes_to_draw
+                      );
       }
     }
 
@@ -1292,9 +1266,6 @@ void World::draw ( math::matrix_4x4 const& model_view
     opengl::scoped::use_program water_shader {_liquid_render->shader_program()};
     water_shader.uniform("animtime", static_cast<float>(animtime) / 2880.f);
 
-    water_shader.uniform("model_view", model_view);
-    water_shader.uniform("projection", projection);
-
     math::vector_4d ocean_color_light(skies->color_set[OCEAN_COLOR_LIGHT], skies->ocean_shallow_alpha());
     math::vector_4d ocean_color_dark(skies->color_set[OCEAN_COLOR_DARK], skies->ocean_deep_alpha());
     math::vector_4d river_color_light(skies->color_set[RIVER_COLOR_LIGHT], skies->river_shallow_alpha());
@@ -1317,28 +1288,14 @@ void World::draw ( math::matrix_4x4 const& model_view
     {
       opengl::scoped::use_program wmo_program {*_wmo_program.get()};
 
-      wmo_program.uniform("model_view", model_view);
-      wmo_program.uniform("projection", projection);
       wmo_program.uniform("tex1", 0);
       wmo_program.uniform("tex2", 1);
 
       wmo_program.uniform("draw_fog", (int)draw_fog);
 
-      if (draw_fog)
-      {
-        wmo_program.uniform("fog_end", fogdistance);
-        wmo_program.uniform("fog_start", 0.5f);
-        wmo_program.uniform("fog_color", skies->color_set[FOG_COLOR]);
-        wmo_program.uniform("camera", camera_pos);
-      }
-
-      wmo_program.uniform("exterior_light_dir", light_dir);
-      wmo_program.uniform("exterior_diffuse_color", diffuse_color);
-      wmo_program.uniform("exterior_ambient_color", ambient_color);
-
       wmo_group_uniform_data wmo_uniform_data;
 
-      _model_instance_storage.for_each_wmo_instance([&] (WMOInstance& wmo)
+      _model_instance_storage.for_each_wmo_instance_in(in_frustum, [&] (WMOInstance& wmo)
       {
         bool is_hidden = wmo.wmo->is_hidden();
         if (draw_hidden_models || !is_hidden)
@@ -1431,7 +1388,6 @@ void World::draw ( math::matrix_4x4 const& model_view
       tile->drawWater ( frustum
                       , culldistance
                       , camera_pos
-                      , camera_moved
                       , _liquid_render.get()
                       , water_shader
                       , animtime
@@ -1520,17 +1476,41 @@ selection_result World::intersect ( math::matrix_4x4 const& model_view
 
   if (draw_terrain)
   {
-    for (auto&& tile : mapIndex.loaded_tiles())
+    // only the chunks under the ray are tested, inside the loaded area
+    int begin_x (64), begin_z (64), end_x (0), end_z (0);
+    for (MapTile* tile : mapIndex.loaded_tiles())
     {
-      tile->intersect (ray, &results);
+      begin_x = std::min (begin_x, static_cast<int> (tile->index.x));
+      begin_z = std::min (begin_z, static_cast<int> (tile->index.z));
+      end_x = std::max (end_x, static_cast<int> (tile->index.x) + 1);
+      end_z = std::max (end_z, static_cast<int> (tile->index.z) + 1);
     }
+
+    noggit::terrain_picking::walk_grid
+      ( ray, CHUNKSIZE, begin_x * 16, begin_z * 16, end_x * 16, end_z * 16
+      , [&] (int x, int z)
+        {
+          tile_index const tile (x / 16, z / 16);
+          if (mapIndex.tileLoaded (tile))
+          {
+            mapIndex.getTile (tile)->getChunk (x % 16, z % 16)->intersect (ray, &results);
+          }
+        }
+      );
   }
 
   if (!pOnlyMap && do_objects)
   {
+    auto const on_ray
+      ( [&] (math::vector_3d const& min, math::vector_3d const& max)
+        {
+          return !!ray.intersect_bounds(min, max);
+        }
+      );
+
     if (draw_models)
     {
-      _model_instance_storage.for_each_m2_instance([&] (ModelInstance& model_instance)
+      _model_instance_storage.for_each_m2_instance_in(on_ray, [&] (ModelInstance& model_instance)
       {
         if (draw_hidden_models || !model_instance.model->is_hidden())
         {
@@ -1541,7 +1521,7 @@ selection_result World::intersect ( math::matrix_4x4 const& model_view
 
     if (draw_wmo)
     {
-      _model_instance_storage.for_each_wmo_instance([&] (WMOInstance& wmo_instance)
+      _model_instance_storage.for_each_wmo_instance_in(on_ray, [&] (WMOInstance& wmo_instance)
       {
         if (draw_hidden_models || !wmo_instance.wmo->is_hidden())
         {
@@ -1554,6 +1534,75 @@ selection_result World::intersect ( math::matrix_4x4 const& model_view
   return results;
 }
 
+void World::update_instance_batches ( noggit::instance_view const& view
+                                    , math::frustum const& frustum
+                                    , math::vector_3d const& camera_pos
+                                    )
+{
+  auto const in_frustum
+    ( [&] (math::vector_3d const& min, math::vector_3d const& max)
+      {
+        return frustum.intersects(min, max);
+      }
+    );
+
+  // an instance whose model is still loading can't be culled yet
+  bool complete = true;
+
+  _instance_batches.begin_update(view, _model_instance_storage.version());
+
+  auto const add_if_visible
+    ( [&] (ModelInstance& instance)
+      {
+        if (!instance.model->finishedLoading())
+        {
+          complete = false;
+        }
+        else if ( !instance.model->loading_failed()
+               && instance.is_visible(frustum, view.cull_distance, camera_pos, view.display)
+                )
+        {
+          _instance_batches.add(instance.model.get(), instance.transform_matrix_transposed());
+        }
+      }
+    );
+
+  if (view.draw_models)
+  {
+    _model_instance_storage.for_each_m2_instance_in(in_frustum, [&] (ModelInstance& model_instance)
+    {
+      if (view.draw_hidden_models || !model_instance.model->is_hidden())
+      {
+        add_if_visible(model_instance);
+      }
+    });
+  }
+
+  if (view.draw_wmo_doodads)
+  {
+    _model_instance_storage.for_each_wmo_instance_in(in_frustum, [&] (WMOInstance& wmo)
+    {
+      if (!wmo.wmo->finishedLoading())
+      {
+        complete = false;
+        return;
+      }
+
+      for (auto& doodad : wmo.get_visible_doodads(frustum, view.cull_distance, camera_pos, view.draw_hidden_models, view.display))
+      {
+        add_if_visible(*doodad);
+      }
+    });
+  }
+
+  _instance_batches.end_update(complete);
+}
+
+void World::instance_visibility_changed()
+{
+  _instance_batches.invalidate();
+}
+
 void World::update_models_emitters(float dt)
 {
   while (dt > 0.1f)
@@ -1582,7 +1631,6 @@ void World::clearHeight(math::vector_3d const& pos)
 void World::clearAllModelsOnADT(tile_index const& tile)
 {
   _model_instance_storage.delete_instances_from_tile(tile);
-  update_models_by_filename();
 }
 
 void World::CropWaterADT(const tile_index& pos)
@@ -1679,14 +1727,60 @@ template<typename Fun, typename Post>
   return changed;
 }
 
+std::vector<MapChunk*> World::chunks_in_range (math::vector_3d const& pos, float radius)
+{
+  std::vector<MapChunk*> chunks;
+
+  for (MapTile* tile : mapIndex.tiles_in_range (pos, radius))
+  {
+    if (!tile->finishedLoading())
+    {
+      continue;
+    }
+
+    for (MapChunk* chunk : tile->chunks_in_range (pos, radius))
+    {
+      chunks.emplace_back (chunk);
+    }
+  }
+
+  return chunks;
+}
+
+template<typename Fun, typename Post>
+  bool World::for_all_chunks_in_parallel (std::vector<MapChunk*> const& chunks, Fun&& fun, Post&& post)
+{
+  std::vector<char> changed (chunks.size(), false);
+
+  noggit::worker_pool::instance().for_each
+    (chunks.size(), [&] (std::size_t i) { changed[i] = fun (i); });
+
+  bool any_changed (false);
+
+  for (std::size_t i (0); i < chunks.size(); ++i)
+  {
+    if (changed[i])
+    {
+      any_changed = true;
+      mapIndex.setChanged (chunks[i]->mt);
+      post (i);
+    }
+  }
+
+  return any_changed;
+}
+
 void World::changeShader(math::vector_3d const& pos, math::vector_4d const& color, float change, float radius, bool editMode)
 {
-  for_all_chunks_in_range
-    ( pos, radius
-    , [&] (MapChunk* chunk)
+  std::vector<MapChunk*> const chunks (chunks_in_range (pos, radius));
+
+  for_all_chunks_in_parallel
+    ( chunks
+    , [&] (std::size_t i)
       {
-        return chunk->ChangeMCCV(pos, color, change, radius, editMode);
+        return chunks[i]->ChangeMCCV(pos, color, change, radius, editMode);
       }
+    , [] (std::size_t) {}
     );
 }
 
@@ -1705,80 +1799,206 @@ math::vector_3d World::pickShaderColor(math::vector_3d const& pos)
   return color;
 }
 
-void World::changeTerrain(math::vector_3d const& pos, float change, float radius, int BrushType, float inner_radius)
+template<typename Kernel>
+  void World::apply_terrain_brush (math::vector_3d const& pos, float radius, Kernel&& kernel)
 {
-  for_all_chunks_in_range
-    ( pos, radius
-    , [&] (MapChunk* chunk)
+  std::vector<MapChunk*> const chunks (chunks_in_range (pos, radius));
+  noggit::terrain_brush::vertices vertices;
+
+  for (MapChunk* chunk : chunks)
+  {
+    vertices.append (chunk->mVertices, mapbufsize);
+  }
+
+  if (!kernel (vertices))
+  {
+    return;
+  }
+
+  math::vector_3d dirty_min (std::numeric_limits<float>::max(), 0.f, std::numeric_limits<float>::max());
+  math::vector_3d dirty_max (std::numeric_limits<float>::lowest(), 0.f, std::numeric_limits<float>::lowest());
+
+  for (std::size_t c (0); c < chunks.size(); ++c)
+  {
+    bool changed (false);
+
+    for (int i (0); i < mapbufsize; ++i)
+    {
+      if (vertices.changed[c * mapbufsize + i])
       {
-        return chunk->changeTerrain(pos, change, radius, BrushType, inner_radius);
+        math::vector_3d& vertex (chunks[c]->mVertices[i]);
+        vertex.y = vertices.y[c * mapbufsize + i];
+        changed = true;
+
+        dirty_min.x = std::min (dirty_min.x, vertex.x);
+        dirty_min.z = std::min (dirty_min.z, vertex.z);
+        dirty_max.x = std::max (dirty_max.x, vertex.x);
+        dirty_max.z = std::max (dirty_max.z, vertex.z);
       }
-    , [this] (MapChunk* chunk)
+    }
+
+    if (changed)
+    {
+      chunks[c]->updateVerticesData();
+      mapIndex.setChanged (chunks[c]->mt);
+    }
+  }
+
+  // a normal depends on the vertices half a unit away diagonally, which
+  // may be in chunks out of the brush's range. Done once all heights are set.
+  math::vector_3d const margin (UNITSIZE / 2.f + 0.01f, 0.f, UNITSIZE / 2.f + 0.01f);
+  recalc_norms_between (dirty_min - margin, dirty_max + margin);
+}
+
+void World::changeTerrain(math::vector_3d const& pos, float change, float radius, int BrushType, float inner_radius)
+{
+  apply_terrain_brush
+    ( pos, radius
+    , [&] (noggit::terrain_brush::vertices& vertices)
       {
-        recalc_norms (chunk);
+        return noggit::terrain_brush::change (vertices, pos, change, radius, BrushType, inner_radius);
       }
     );
 }
 
 void World::flattenTerrain(math::vector_3d const& pos, float remain, float radius, int BrushType, flatten_mode const& mode, const math::vector_3d& origin, math::degrees angle, math::degrees orientation)
 {
-  for_all_chunks_in_range
+  apply_terrain_brush
     ( pos, radius
-    , [&] (MapChunk* chunk)
-      {
-        return chunk->flattenTerrain(pos, remain, radius, BrushType, mode, origin, angle, orientation);
-      }
-    , [this] (MapChunk* chunk)
+    , [&] (noggit::terrain_brush::vertices& vertices)
       {
-        recalc_norms (chunk);
+        return noggit::terrain_brush::flatten
+          (vertices, pos, remain, radius, BrushType, mode, origin, angle, orientation);
       }
     );
 }
 
 void World::blurTerrain(math::vector_3d const& pos, float remain, float radius, int BrushType, flatten_mode const& mode)
 {
-  for_all_chunks_in_range
+  apply_terrain_brush
     ( pos, radius
-    , [&] (MapChunk* chunk)
-      {
-        return chunk->blurTerrain ( pos
-                                  , remain
-                                  , radius
-                                  , BrushType
-                                  , mode
-                                  , [this] (float x, float z) -> boost::optional<float>
-                                    {
-                                      math::vector_3d vec;
-                                      auto res (GetVertex (x, z, &vec));
-                                      return boost::make_optional (res, vec.y);
-                                    }
-                                  );
-      }
-    , [this] (MapChunk* chunk)
+    , [&] (noggit::terrain_brush::vertices& vertices)
       {
-        recalc_norms (chunk);
+        return noggit::terrain_brush::blur
+          ( vertices
+          , pos
+          , remain
+          , radius
+          , BrushType
+          , mode
+          , [this] (float x, float z) -> boost::optional<float>
+            {
+              math::vector_3d vec;
+              auto res (GetVertex (x, z, &vec));
+              return boost::make_optional (res, vec.y);
+            }
+          , [this] (std::size_t count, std::function<void (std::size_t)> const& fun)
+            {
+              noggit::worker_pool::instance().for_each (count, fun);
+            }
+          );
       }
     );
 }
 
+MapChunk* World::loaded_chunk (int x, int z) const
+{
+  if (x < 0 || z < 0)
+  {
+    return nullptr;
+  }
+
+  tile_index const tile (x / 16, z / 16);
+
+  if (!tile.is_valid() || !mapIndex.tileLoaded (tile))
+  {
+    return nullptr;
+  }
+
+  MapTile* adt (mapIndex.getTile (tile));
+
+  return adt->finishedLoading() ? adt->getChunk (x % 16, z % 16) : nullptr;
+}
+
 void World::recalc_norms (MapChunk* chunk) const
 {
-  chunk->recalcNorms ( [this] (float x, float z) -> boost::optional<float>
-                       {
-                         math::vector_3d vec;
-                         auto res (GetVertex (x, z, &vec));
-                         return boost::make_optional (res, vec.y);
-                       }
-                     );
+  math::vector_3d const margin (UNITSIZE, 0.f, UNITSIZE);
+
+  recalc_norms ( chunk
+               , math::vector_3d (chunk->xbase, 0.f, chunk->zbase) - margin
+               , math::vector_3d (chunk->xbase + CHUNKSIZE, 0.f, chunk->zbase + CHUNKSIZE) + margin
+               );
+}
+
+void World::recalc_norms (MapChunk* chunk, math::vector_3d const& min, math::vector_3d const& max) const
+{
+  int const x (static_cast<int> (chunk->mt->index.x) * 16 + chunk->px);
+  int const z (static_cast<int> (chunk->mt->index.z) * 16 + chunk->py);
+
+  std::array<math::vector_3d const*, 9> neighbours;
+  for (int dz (-1); dz <= 1; ++dz)
+  {
+    for (int dx (-1); dx <= 1; ++dx)
+    {
+      MapChunk const* neighbour (dx || dz ? loaded_chunk (x + dx, z + dz) : chunk);
+      neighbours[(dz + 1) * 3 + dx + 1] = neighbour ? neighbour->mVertices : nullptr;
+    }
+  }
+
+  chunk->recalcNorms (noggit::terrain_normals::make_halo (neighbours), min, max);
+}
+
+void World::recalc_norms_between (math::vector_3d const& min, math::vector_3d const& max)
+{
+  int const x_begin (std::floor (min.x / CHUNKSIZE));
+  int const x_end (std::floor (max.x / CHUNKSIZE));
+  int const z_begin (std::floor (min.z / CHUNKSIZE));
+  int const z_end (std::floor (max.z / CHUNKSIZE));
+
+  for (int z (z_begin); z <= z_end; ++z)
+  {
+    for (int x (x_begin); x <= x_end; ++x)
+    {
+      if (MapChunk* chunk = loaded_chunk (x, z))
+      {
+        recalc_norms (chunk, min, max);
+        mapIndex.setChanged (chunk->mt);
+      }
+    }
+  }
 }
 
 bool World::paintTexture(math::vector_3d const& pos, Brush* brush, float strength, float pressure, scoped_blp_texture_reference texture)
 {
-  return for_all_chunks_in_range
-    ( pos, brush->getRadius()
-    , [&] (MapChunk* chunk)
+  std::vector<MapChunk*> const chunks (chunks_in_range (pos, brush->getRadius()));
+
+  // only the alphamaps are painted in parallel, adding and releasing
+  // textures is done here
+  std::vector<int> layers;
+  for (MapChunk* chunk : chunks)
+  {
+    layers.emplace_back
+      (chunk->texture_set->prepare_paint (chunk->xbase, chunk->zbase, pos.x, pos.z, brush, strength, texture));
+  }
+
+  return for_all_chunks_in_parallel
+    ( chunks
+    , [&] (std::size_t i)
       {
-        return chunk->paintTexture(pos, brush, strength, pressure, texture);
+        if (layers[i] == -1)
+        {
+          return chunks[i]->texture_set->num() == 1;
+        }
+
+        return chunks[i]->texture_set->paint_layer
+          (chunks[i]->xbase, chunks[i]->zbase, pos.x, pos.z, brush, strength, pressure, layers[i]);
+      }
+    , [&] (std::size_t i)
+      {
+        if (layers[i] != -1)
+        {
+          chunks[i]->texture_set->finish_paint();
+        }
       }
     );
 }
@@ -1900,41 +2120,14 @@ MapChunk * World::get_chunk_at(math::vector_3d const& pos)
   return nullptr;
 }
 
-void World::convert_alphamap(bool to_big_alpha)
+bool World::convert_alphamap(bool to_big_alpha, MapIndex::conversion_progress const& progress)
 {
   if (to_big_alpha == mapIndex.hasBigAlpha())
   {
-    return;
-  }
-
-  for (size_t z = 0; z < 64; z++)
-  {
-    for (size_t x = 0; x < 64; x++)
-    {
-      tile_index tile(x, z);
-
-      bool unload = !mapIndex.tileLoaded(tile) && !mapIndex.tileAwaitingLoading(tile);
-      MapTile* mTile = mapIndex.loadTile(tile);
-
-      if (mTile)
-      {
-        mTile->wait_until_loaded();
-
-        mTile->convert_alphamap(to_big_alpha);
-        mTile->saveTile(this);
-        mapIndex.markOnDisc (tile, true);
-        mapIndex.unsetChanged(tile);
-
-        if (unload)
-        {
-          mapIndex.unloadTile(tile);
-        }
-      }
-    }
+    return true;
   }
 
-  mapIndex.convert_alphamap(to_big_alpha);
-  mapIndex.save();
+  return mapIndex.convert_alphamaps(this, to_big_alpha, progress);
 }
 
 void World::saveMap (int, int)
@@ -1972,7 +2165,6 @@ void World::delete_duplicate_model_and_wmo_instances()
   reset_selection();
 
   _model_instance_storage.clear_duplicates();
-  need_model_updates = true;
 }
 
 void World::unload_every_model_and_wmo_instance()
@@ -1980,8 +2172,6 @@ void World::unload_every_model_and_wmo_instance()
   reset_selection();
 
   _model_instance_storage.clear();
-
-  _models_by_filename.clear();
 }
 
 ModelInstance* World::addM2 ( std::string const& filename
@@ -2025,9 +2215,7 @@ ModelInstance* World::addM2 ( std::string const& filename
   model_instance.recalcExtents();
 
   std::uint32_t uid = _model_instance_storage.add_model_instance(std::move(model_instance), true);
-  auto model = _model_instance_storage.get_model_instance(uid).get();
-  _models_by_filename[filename].push_back(model);
-  return model;
+  return _model_instance_storage.get_model_instance(uid).get();
 }
 
 WMOInstance* World::addWMO ( std::string const& filename
@@ -2064,6 +2252,14 @@ boost::optional<selection_type> World::get_model(std::uint32_t uid)
   return _model_instance_storage.get_instance(uid);
 }
 
+std::vector<std::uint32_t> World::copy_models ( std::vector<std::uint32_t> const& uids
+                                              , std::vector<ModelInstance>& models
+                                              , std::vector<WMOInstance>& wmos
+                                              )
+{
+  return _model_instance_storage.copy_instances(uids, models, wmos);
+}
+
 void World::remove_models_if_needed(std::vector<uint32_t> const& uids)
 {
   // todo: manage instances properly
@@ -2085,8 +2281,6 @@ void World::remove_models_if_needed(std::vector<uint32_t> const& uids)
   {
     reset_selection();
   }
-
-  update_models_by_filename();
 }
 
 void World::reload_tile(tile_index const& tile)
@@ -2109,11 +2303,22 @@ void World::updateTilesEntry(selection_type const& entry, model_update type)
 
 void World::updateTilesWMO(WMOInstance* wmo, model_update type)
 {
+  // none: the doodad set changed
+  if (type != model_update::remove)
+  {
+    _model_instance_storage.update_spatial_index(wmo->mUniqueID);
+  }
+
   _tile_update_queue.queue_update(wmo, type);
 }
 
 void World::updateTilesModel(ModelInstance* m2, model_update type)
 {
+  if (type == model_update::add)
+  {
+    _model_instance_storage.update_spatial_index(m2->uid);
+  }
+
   _tile_update_queue.queue_update(m2, type);
 }
 
@@ -2330,7 +2535,6 @@ void World::selectVertices(math::vector_3d const& pos, float radius)
 void World::delete_models(std::vector<selection_type> const& types)
 {
   _model_instance_storage.delete_instances(types);
-  need_model_updates = true;
 }
 
 void World::selectVertices(math::vector_3d const& pos1, math::vector_3d const& pos2)
@@ -2510,17 +2714,3 @@ std::set<MapChunk*>& World::vertexBorderChunks()
   }
   return _vertex_border_chunks;
 }
-
-void World::update_models_by_filename()
-{
-  _models_by_filename.clear();
-
-  _model_instance_storage.for_each_m2_instance([&] (ModelInstance& model_instance)
-  {
-    _models_by_filename[model_instance.model->filename].push_back(&model_instance);
-    // to make sure the transform matrix are up to date
-    model_instance.recalcExtents();
-  });
-
-  need_model_updates = false;
-}
@@ -5,6 +5,8 @@
 #include <math/frustum.hpp>
 #include <math/trig.hpp>
 #include <noggit/cursor_render.hpp>
+#include <noggit/frame_uniforms.hpp>
+#include <noggit/instance_batches.hpp>
 #include <noggit/Misc.h>
 #include <noggit/Model.h> // ModelManager
 #include <noggit/Selection.h>
@@ -46,7 +48,6 @@ using StripType = uint16_t;
 class World
 {
 private:
-  std::unordered_map<std::string, std::vector<ModelInstance*>> _models_by_filename;
   noggit::world_model_instances_storage _model_instance_storage;
   noggit::world_tile_update_queue _tile_update_queue;
 public:
@@ -256,6 +257,11 @@ public:
   std::uint32_t add_wmo_instance(WMOInstance wmo_instance, bool from_reloading);
 
   boost::optional<selection_type> get_model(std::uint32_t uid);
+  // thread safe copy of the instances, return the uids not found
+  std::vector<std::uint32_t> copy_models ( std::vector<std::uint32_t> const& uids
+                                         , std::vector<ModelInstance>& models
+                                         , std::vector<WMOInstance>& wmos
+                                         );
   void remove_models_if_needed(std::vector<uint32_t> const& uids);
 
   void reload_tile(tile_index const& tile);
@@ -301,7 +307,8 @@ public:
 
   void fixAllGaps();
 
-  void convert_alphamap(bool to_big_alpha);
+  //! false if cancelled or a tile failed to convert
+  bool convert_alphamap(bool to_big_alpha, MapIndex::conversion_progress const& progress = MapIndex::conversion_progress());
 
   bool deselectVertices(math::vector_3d const& pos, float radius);
   void selectVertices(math::vector_3d const& pos, float radius);
@@ -329,6 +336,19 @@ public:
     _model_instance_storage.for_each_m2_instance(function);
   }
 
+  //! only the instances whose bounds may pass the test
+  template<typename Fun>
+  void for_each_wmo_instance_in(noggit::instance_grid::bounds_test const& test, Fun&& function)
+  {
+    _model_instance_storage.for_each_wmo_instance_in(test, function);
+  }
+
+  template<typename Fun>
+  void for_each_m2_instance_in(noggit::instance_grid::bounds_test const& test, Fun&& function)
+  {
+    _model_instance_storage.for_each_m2_instance_in(test, function);
+  }
+
   void moveVertices(float h);
   void orientVertices ( math::vector_3d const& ref_pos
                       , math::degrees vertex_angle
@@ -343,11 +363,39 @@ public:
   math::vector_3d const& vertexCenter();
 
   void recalc_norms (MapChunk*) const;
+  //! recomputes the normals of the vertices inside [min, max] on the xz
+  //! plane in all the loaded chunks, their tiles are marked as changed
+  void recalc_norms_between (math::vector_3d const& min, math::vector_3d const& max);
 
-  bool need_model_updates = false;
+  //! to call when models or wmos were hidden or shown
+  void instance_visibility_changed();
 
 private:
-  void update_models_by_filename();
+  //! gathers the visible M2s and wmo doodads into _instance_batches
+  void update_instance_batches ( noggit::instance_view const& view
+                               , math::frustum const& frustum
+                               , math::vector_3d const& camera_pos
+                               );
+
+  //! gathers the vertices of all chunks in range, runs the brush kernel
+  //! on them (noggit::terrain_brush::vertices& -> bool changed) and
+  //! writes the changed heights back
+  template<typename Kernel>
+    void apply_terrain_brush (math::vector_3d const& pos, float radius, Kernel&&);
+
+  //! the chunks in range of loaded tiles, in a stable order
+  std::vector<MapChunk*> chunks_in_range (math::vector_3d const& pos, float radius);
+  //! calls fun (std::size_t index -> bool changed) for every chunk on the
+  //! brush workers, it may only touch chunks[index] and can't make GL
+  //! calls. The tiles of the changed chunks are then marked as changed
+  //! and post (std::size_t index -> void) is called for them in order.
+  template<typename Fun, typename Post>
+    bool for_all_chunks_in_parallel (std::vector<MapChunk*> const& chunks, Fun&&, Post&&);
+
+  //! x and z count chunks from the map's origin
+  //! \return nullptr when the chunk's tile isn't loaded
+  MapChunk* loaded_chunk (int x, int z) const;
+  void recalc_norms (MapChunk*, math::vector_3d const& min, math::vector_3d const& max) const;
 
   std::set<MapChunk*>& vertexBorderChunks();
 
@@ -359,6 +407,8 @@ private:
   bool _vertex_center_updated = false;
   bool _vertex_border_updated = false;
 
+  noggit::instance_batches _instance_batches;
+
   std::unique_ptr<noggit::map_horizon::render> _horizon_render;
 
   bool _display_initialized = false;
@@ -367,6 +417,19 @@ private:
 
   float _view_distance;
 
+  // read from the settings when they are saved instead of every frame
+  void read_settings();
+  std::size_t _settings_saved_count;
+  struct
+  {
+    int type;
+    float radius;
+    float width;
+    math::vector_4d color;
+  } _wireframe;
+
+  noggit::frame_uniforms _frame_uniforms;
+
   std::unique_ptr<opengl::program> _mcnk_program;;
   std::unique_ptr<opengl::program> _mfbo_program;
   std::unique_ptr<opengl::program> _m2_program;
@@ -1,10 +1,9 @@
 // This file is part of Noggit3, licensed under GNU General Public License (version 3).
 
 #include <noggit/alphamap.hpp>
+#include <noggit/alphamap_codec.hpp>
 #include <opengl/context.hpp>
 
-#include <boost/optional/optional.hpp>
-
 Alphamap::Alphamap()
 {
   createNew();
@@ -32,58 +31,19 @@ Alphamap::Alphamap(MPQFile *f, unsigned int flags, bool use_big_alphamaps, bool
   }
 }
 
-namespace
-{
-  struct compressed_mcal_entry
-  {
-    enum mode_t
-    {
-      copy = 0,              // append value[0..count - 1]
-      fill = 1,              // append value[0] count times
-    };
-    uint8_t count : 7;
-    uint8_t mode : 1;
-
-    uint8_t value[];
-  };
-}
-
 void Alphamap::readCompressed(MPQFile *f)
 {
-  // compressed
-  char const* input = f->getPointer();
-
-  for (std::size_t offset_output(0); offset_output < 4096;)
+  bool valid;
+  noggit::alphamap_codec::decompress
+    ( reinterpret_cast<std::uint8_t const*>(f->getPointer())
+    , f->getSize() - f->getPos()
+    , amap
+    , &valid
+    );
+
+  if (!valid)
   {
-    compressed_mcal_entry const* e = reinterpret_cast<compressed_mcal_entry const*>(input);
-
-    int count = e->count;
-
-    if (offset_output + count > 4096)
-    {
-      LogError << "Invalid MCAL, uncompressed size is greater than 4096" << std::endl;
-      count = 4096 - offset_output;
-    }
-
-    ++input;
-
-    if (count == 0)
-    {
-      continue;
-    }
-
-    if (e->mode == compressed_mcal_entry::fill)
-    {
-      memset(&amap[offset_output], e->value[0], count);
-      ++input;
-    }
-    else
-    {
-      memcpy(&amap[offset_output], e->value, count);
-      input += count;
-    }
-
-    offset_output += count;
+    LogError << "Invalid MCAL, compressed data doesn't match an uncompressed size of 4096" << std::endl;
   }
 }
 
@@ -95,26 +55,11 @@ void Alphamap::readBigAlpha(MPQFile *f)
 
 void Alphamap::readNotCompressed(MPQFile *f, bool do_not_fix_alpha_map)
 {
-  char const* abuf = f->getPointer();
-
-  for (std::size_t x(0); x < 64; ++x)
-  {
-    for (std::size_t y(0); y < 64; y += 2)
-    {
-      amap[x * 64 + y + 0] = ((*abuf & 0x0f) << 4) | (*abuf & 0x0f);
-      amap[x * 64 + y + 1] = ((*abuf & 0xf0) >> 4) | (*abuf & 0xf0);
-      ++abuf;
-    }
-  }
+  noggit::alphamap_codec::expand_4bit(reinterpret_cast<std::uint8_t const*>(f->getPointer()), amap);
 
   if (!do_not_fix_alpha_map)
   {
-    for (std::size_t i(0); i < 64; ++i)
-    {
-      amap[i * 64 + 63] = amap[i * 64 + 62];
-      amap[63 * 64 + i] = amap[62 * 64 + i];
-    }
-    amap[63 * 64 + 63] = amap[62 * 64 + 62];
+    noggit::alphamap_codec::fix_last_row_and_column(amap);
   }
   f->seekRelative(0x800);
 }
@@ -146,85 +91,11 @@ const unsigned char *Alphamap::getAlpha()
 
 std::vector<uint8_t> Alphamap::compress() const
 {
-  std::vector<uint8_t> data(amap, amap+4096);
-  auto current (data.begin());
-  auto const end (data.end());
-  int column_pos = 0;
-
-  auto const consume_fill
-  ( 
-    [&]
-    {
-      int8_t count (0);
-      column_pos %= 64;
-
-      while ((current + 1 < end) && *current == *(current + 1) && column_pos < 63)
-      {
-        ++current;
-        ++count;
-        ++column_pos;
-      }
-
-      // include current (current is incremented in the for loop)
-      if (count)
-      {
-        ++count;
-        ++column_pos;
-      }
-
-      return count;
-    }
-  );
-
-  std::vector<uint8_t> result;
-  boost::optional<std::size_t> current_copy_entry_offset (boost::none);
-  auto const current_copy_entry
-  ( 
-    [&]
-    {
-      return reinterpret_cast<compressed_mcal_entry*> (&*(result.begin() + *current_copy_entry_offset));
-    }
-  );
-
-  for (; current != end; ++current)
-  {
-    auto const fill (consume_fill());
-    if (fill)
-    {
-      current_copy_entry_offset = boost::none;
-
-      result.emplace_back();
-      result.emplace_back(*current);
-
-      compressed_mcal_entry* e (reinterpret_cast<compressed_mcal_entry*> (&*(result.rbegin() + 1)));
-      e->mode = compressed_mcal_entry::fill;
-      e->count = fill;
-
-      column_pos %= 64;
-    }
-    else
-    {
-      if ( current_copy_entry_offset == boost::none
-          || column_pos == 64
-          )
-      {
-        current_copy_entry_offset = result.size();
-        result.emplace_back();
-        result.emplace_back(*current);
-        current_copy_entry()->mode = compressed_mcal_entry::copy;
-        current_copy_entry()->count = 1;
-
-        column_pos %= 64;
-      }
-      else
-      {
-        result.emplace_back(*current);
-        current_copy_entry()->count++;
-      }
-
-      column_pos++;
-    }
-  }
+  uint8_t buffer[noggit::alphamap_codec::max_compressed_size];
+  return std::vector<uint8_t>(buffer, buffer + compress(buffer));
+}
 
-  return result;
+std::size_t Alphamap::compress(uint8_t* output) const
+{
+  return noggit::alphamap_codec::compress(amap, output);
 }
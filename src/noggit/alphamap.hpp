@@ -19,6 +19,9 @@ public:
   const unsigned char *getAlpha();
 
   std::vector<uint8_t> compress() const;
+  //! output needs alphamap_codec::max_compressed_size bytes
+  //! \return the compressed size
+  std::size_t compress(uint8_t* output) const;
 
 private:
   void readCompressed(MPQFile *f);
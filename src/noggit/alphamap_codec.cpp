@@ -0,0 +1,302 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/alphamap_codec.hpp>
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define NOGGIT_ALPHAMAP_SSE2
+  #include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+  #define NOGGIT_ALPHAMAP_AVX2
+  #include <immintrin.h>
+#endif
+#if defined(_MSC_VER)
+  #include <intrin.h>
+#endif
+
+namespace noggit
+{
+  namespace alphamap_codec
+  {
+    namespace
+    {
+      std::uint8_t const fill_mode = 0x80;
+
+      //! x != 0
+      unsigned count_trailing_zeros (std::uint64_t x)
+      {
+#if defined(_MSC_VER) && defined(_M_X64)
+        unsigned long index;
+        _BitScanForward64 (&index, x);
+        return index;
+#elif defined(_MSC_VER)
+        unsigned long index;
+        if (_BitScanForward (&index, static_cast<std::uint32_t> (x)))
+        {
+          return index;
+        }
+        _BitScanForward (&index, static_cast<std::uint32_t> (x >> 32));
+        return index + 32;
+#else
+        return __builtin_ctzll (x);
+#endif
+      }
+
+      //! bit i is set if row[i] == row[i + 1], never set for the last column
+      std::uint64_t equal_neighbours (std::uint8_t const* row)
+      {
+        std::uint64_t mask (0);
+
+#if defined(NOGGIT_ALPHAMAP_AVX2)
+        __m256i const a0 (_mm256_loadu_si256 (reinterpret_cast<__m256i const*> (row)));
+        __m256i const a1 (_mm256_loadu_si256 (reinterpret_cast<__m256i const*> (row + 32)));
+        __m256i const b0 (_mm256_loadu_si256 (reinterpret_cast<__m256i const*> (row + 1)));
+        // shift by one byte without reading past the row, the last alphamap
+        // row is also the end of the buffer
+        __m256i const b1 (_mm256_alignr_epi8 (_mm256_permute2x128_si256 (a1, a1, 0x81), a1, 1));
+
+        mask = std::uint64_t (std::uint32_t (_mm256_movemask_epi8 (_mm256_cmpeq_epi8 (a0, b0))))
+             | std::uint64_t (std::uint32_t (_mm256_movemask_epi8 (_mm256_cmpeq_epi8 (a1, b1)))) << 32;
+#elif defined(NOGGIT_ALPHAMAP_SSE2)
+        for (std::size_t i (0); i < 64; i += 16)
+        {
+          __m128i const a (_mm_loadu_si128 (reinterpret_cast<__m128i const*> (row + i)));
+          __m128i const b ( i + 16 < 64
+                          ? _mm_loadu_si128 (reinterpret_cast<__m128i const*> (row + i + 1))
+                          : _mm_srli_si128 (a, 1)
+                          );
+
+          mask |= std::uint64_t (std::uint32_t (_mm_movemask_epi8 (_mm_cmpeq_epi8 (a, b)))) << i;
+        }
+#else
+        for (std::size_t i (0); i < 63; ++i)
+        {
+          mask |= std::uint64_t (row[i] == row[i + 1]) << i;
+        }
+#endif
+
+        return mask & ~(std::uint64_t (1) << 63);
+      }
+    }
+
+    std::size_t compress (std::uint8_t const* alpha, std::uint8_t* output)
+    {
+      std::uint8_t* out (output);
+
+      for (std::size_t row (0); row < 64; ++row)
+      {
+        std::uint8_t const* values (alpha + row * 64);
+        std::uint64_t const equal (equal_neighbours (values));
+
+        for (unsigned column (0); column < 64;)
+        {
+          std::uint64_t const rest (equal >> column);
+
+          if (rest & 1)
+          {
+            // the last column is never set so the run ends in this row
+            unsigned const count (count_trailing_zeros (~rest) + 1);
+
+            *out++ = fill_mode | count;
+            *out++ = values[column];
+            column += count;
+          }
+          else
+          {
+            // copy up to the start of the next fill
+            unsigned const count (rest ? count_trailing_zeros (rest) : 64 - column);
+
+            *out++ = count;
+            std::memcpy (out, values + column, count);
+            out += count;
+            column += count;
+          }
+        }
+      }
+
+      return out - output;
+    }
+
+    std::size_t decompress ( std::uint8_t const* input
+                           , std::size_t input_size
+                           , std::uint8_t* alpha
+                           , bool* valid
+                           )
+    {
+      std::uint8_t const* in (input);
+      std::uint8_t const* const end (input + input_size);
+      bool ok (true);
+
+      for (std::size_t offset (0); offset < alphamap_size;)
+      {
+        if (in == end)
+        {
+          ok = false;
+          break;
+        }
+
+        std::uint8_t const entry (*in++);
+        std::size_t count (entry & 0x7f);
+
+        if (offset + count > alphamap_size)
+        {
+          ok = false;
+          count = alphamap_size - offset;
+        }
+
+        if (count == 0)
+        {
+          continue;
+        }
+
+        if (entry & fill_mode)
+        {
+          if (in == end)
+          {
+            ok = false;
+            break;
+          }
+
+          std::memset (alpha + offset, *in++, count);
+        }
+        else
+        {
+          if (std::size_t (end - in) < count)
+          {
+            ok = false;
+            break;
+          }
+
+          std::memcpy (alpha + offset, in, count);
+          in += count;
+        }
+
+        offset += count;
+      }
+
+      if (valid)
+      {
+        *valid = ok;
+      }
+
+      return in - input;
+    }
+
+    void expand_4bit (std::uint8_t const* input, std::uint8_t* alpha)
+    {
+#if defined(NOGGIT_ALPHAMAP_AVX2)
+      __m256i const low_nibble (_mm256_set1_epi8 (0x0f));
+
+      for (std::size_t i (0); i < packed_4bit_size; i += 32)
+      {
+        __m256i const packed (_mm256_loadu_si256 (reinterpret_cast<__m256i const*> (input + i)));
+        __m256i lo (_mm256_and_si256 (packed, low_nibble));
+        __m256i hi (_mm256_and_si256 (_mm256_srli_epi16 (packed, 4), low_nibble));
+        // n * 0x11, the shifted nibbles can't cross into the neighbour byte
+        lo = _mm256_or_si256 (lo, _mm256_slli_epi16 (lo, 4));
+        hi = _mm256_or_si256 (hi, _mm256_slli_epi16 (hi, 4));
+
+        // unpack works per 128 bit lane, put the halves back in order
+        __m256i const first (_mm256_unpacklo_epi8 (lo, hi));
+        __m256i const second (_mm256_unpackhi_epi8 (lo, hi));
+        _mm256_storeu_si256 ( reinterpret_cast<__m256i*> (alpha + 2 * i)
+                            , _mm256_permute2x128_si256 (first, second, 0x20)
+                            );
+        _mm256_storeu_si256 ( reinterpret_cast<__m256i*> (alpha + 2 * i + 32)
+                            , _mm256_permute2x128_si256 (first, second, 0x31)
+                            );
+      }
+#elif defined(NOGGIT_ALPHAMAP_SSE2)
+      __m128i const low_nibble (_mm_set1_epi8 (0x0f));
+
+      for (std::size_t i (0); i < packed_4bit_size; i += 16)
+      {
+        __m128i const packed (_mm_loadu_si128 (reinterpret_cast<__m128i const*> (input + i)));
+        __m128i lo (_mm_and_si128 (packed, low_nibble));
+        __m128i hi (_mm_and_si128 (_mm_srli_epi16 (packed, 4), low_nibble));
+        // n * 0x11, the shifted nibbles can't cross into the neighbour byte
+        lo = _mm_or_si128 (lo, _mm_slli_epi16 (lo, 4));
+        hi = _mm_or_si128 (hi, _mm_slli_epi16 (hi, 4));
+
+        _mm_storeu_si128 (reinterpret_cast<__m128i*> (alpha + 2 * i), _mm_unpacklo_epi8 (lo, hi));
+        _mm_storeu_si128 (reinterpret_cast<__m128i*> (alpha + 2 * i + 16), _mm_unpackhi_epi8 (lo, hi));
+      }
+#else
+      for (std::size_t i (0); i < packed_4bit_size; ++i)
+      {
+        alpha[2 * i + 0] = (input[i] & 0x0f) * 0x11;
+        alpha[2 * i + 1] = (input[i] >> 4) * 0x11;
+      }
+#endif
+    }
+
+    void pack_4bit (std::uint8_t const* alpha, std::uint8_t* output)
+    {
+#if defined(NOGGIT_ALPHAMAP_AVX2)
+      __m256i const low_nibble (_mm256_set1_epi16 (0x000f));
+      __m256i const high_nibble (_mm256_set1_epi16 (0x00f0));
+
+      // each 16 bit lane holds two values, the result is < 256
+      auto const pack
+        ( [&] (__m256i values)
+          {
+            return _mm256_or_si256 ( _mm256_and_si256 (_mm256_srli_epi16 (values, 4), low_nibble)
+                                   , _mm256_and_si256 (_mm256_srli_epi16 (values, 8), high_nibble)
+                                   );
+          }
+        );
+
+      for (std::size_t i (0); i < packed_4bit_size; i += 32)
+      {
+        __m256i const first (_mm256_loadu_si256 (reinterpret_cast<__m256i const*> (alpha + 2 * i)));
+        __m256i const second (_mm256_loadu_si256 (reinterpret_cast<__m256i const*> (alpha + 2 * i + 32)));
+
+        // packus works per 128 bit lane, put the quarters back in order
+        __m256i const packed (_mm256_packus_epi16 (pack (first), pack (second)));
+        _mm256_storeu_si256 ( reinterpret_cast<__m256i*> (output + i)
+                            , _mm256_permute4x64_epi64 (packed, 0xd8)
+                            );
+      }
+#elif defined(NOGGIT_ALPHAMAP_SSE2)
+      __m128i const low_nibble (_mm_set1_epi16 (0x000f));
+      __m128i const high_nibble (_mm_set1_epi16 (0x00f0));
+
+      // each 16 bit lane holds two values, the result is < 256
+      auto const pack
+        ( [&] (__m128i values)
+          {
+            return _mm_or_si128 ( _mm_and_si128 (_mm_srli_epi16 (values, 4), low_nibble)
+                                , _mm_and_si128 (_mm_srli_epi16 (values, 8), high_nibble)
+                                );
+          }
+        );
+
+      for (std::size_t i (0); i < packed_4bit_size; i += 16)
+      {
+        __m128i const first (_mm_loadu_si128 (reinterpret_cast<__m128i const*> (alpha + 2 * i)));
+        __m128i const second (_mm_loadu_si128 (reinterpret_cast<__m128i const*> (alpha + 2 * i + 16)));
+
+        _mm_storeu_si128 ( reinterpret_cast<__m128i*> (output + i)
+                         , _mm_packus_epi16 (pack (first), pack (second))
+                         );
+      }
+#else
+      for (std::size_t i (0); i < packed_4bit_size; ++i)
+      {
+        output[i] = ((alpha[2 * i] & 0xf0) >> 4) | (alpha[2 * i + 1] & 0xf0);
+      }
+#endif
+    }
+
+    void fix_last_row_and_column (std::uint8_t* alpha)
+    {
+      for (std::size_t row (0); row < 63; ++row)
+      {
+        alpha[row * 64 + 63] = alpha[row * 64 + 62];
+      }
+      std::memcpy (alpha + 63 * 64, alpha + 62 * 64, 64);
+    }
+  }
+}
@@ -0,0 +1,42 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+//! Conversions between the 64x64 alphamaps and their MCAL encodings.
+//! Uses SSE2 / AVX2 when the compiler targets them, scalar code otherwise.
+//! Every function writes into caller provided buffers.
+namespace noggit
+{
+  namespace alphamap_codec
+  {
+    static constexpr std::size_t alphamap_size = 64 * 64;
+    static constexpr std::size_t packed_4bit_size = alphamap_size / 2;
+    //! entries never span rows, the worst row alternates copies of one
+    //! value and fills of two (4 bytes per 3 values): 21 * 4 + 2 bytes
+    static constexpr std::size_t max_compressed_size = 64 * 86;
+
+    //! RLE compression of a big alphamap
+    //! \return the number of bytes written, at most max_compressed_size
+    std::size_t compress (std::uint8_t const* alpha, std::uint8_t* output);
+
+    //! \return the number of bytes read from input, decompression stops
+    //! early (leaving the rest of alpha untouched) if input is truncated
+    std::size_t decompress ( std::uint8_t const* input
+                           , std::size_t input_size
+                           , std::uint8_t* alpha
+                           , bool* valid = nullptr
+                           );
+
+    //! 2048 bytes of 4 bit alpha to 4096 bytes of 8 bit alpha
+    void expand_4bit (std::uint8_t const* input, std::uint8_t* alpha);
+    //! keeps the high nibble of each value, 4096 bytes to 2048
+    void pack_4bit (std::uint8_t const* alpha, std::uint8_t* output);
+
+    //! copy the 63th row and column to the last ones, the 4 bit alphamaps
+    //! don't store meaningful values there
+    void fix_last_row_and_column (std::uint8_t* alpha);
+  }
+}
@@ -217,6 +217,8 @@ Noggit::Noggit(int argc, char *argv[])
   QSettings settings;
   doAntiAliasing = settings.value("antialiasing", false).toBool();
   fullscreen = settings.value("fullscreen", false).toBool();
+  TextureManager::residency().set_budget
+    (std::size_t (settings.value ("texture_budget", 1024).toInt()) << 20);
 
 
   srand(::time(nullptr));
@@ -246,6 +248,7 @@ Noggit::Noggit(int argc, char *argv[])
   settings.setValue ("project/game_path", path.absolutePath());
   settings.setValue ("project/path", QString::fromStdString(project_path));
 
+  MPQFile::index_project_directory (project_path);
   loadMPQs(); // listfiles are not available straight away! They are async! Do not rely on anything at this point!
   OpenDBs();
 
@@ -0,0 +1,326 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/blp_decoder.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace noggit
+{
+  namespace blp
+  {
+    namespace
+    {
+      std::uint32_t rgba (std::uint32_t r, std::uint32_t g, std::uint32_t b, std::uint32_t a)
+      {
+        return r | (g << 8) | (b << 16) | (a << 24);
+      }
+
+      //! throws if the needed bytes of the level are not in the file
+      void check_level (BLPHeader const& header, std::size_t size, int level, std::size_t needed)
+      {
+        if ( header.offsets[level] <= 0
+          || std::size_t (header.offsets[level]) > size
+          || size - header.offsets[level] < needed
+           )
+        {
+          throw std::runtime_error ("mip level " + std::to_string (level) + " is truncated");
+        }
+      }
+
+      struct dxt_color_block
+      {
+        std::array<std::array<std::uint8_t, 4>, 4> colors;
+        std::uint32_t indices;
+      };
+
+      dxt_color_block read_color_block (std::uint8_t const* block, bool four_colors_only, bool transparent_black)
+      {
+        std::uint16_t const c0 (block[0] | (block[1] << 8));
+        std::uint16_t const c1 (block[2] | (block[3] << 8));
+
+        auto const expand
+          ( [] (std::uint16_t c) -> std::array<std::uint8_t, 4>
+            {
+              std::uint8_t const r ((c >> 11) & 0x1f);
+              std::uint8_t const g ((c >> 5) & 0x3f);
+              std::uint8_t const b (c & 0x1f);
+              return {{ std::uint8_t ((r << 3) | (r >> 2))
+                      , std::uint8_t ((g << 2) | (g >> 4))
+                      , std::uint8_t ((b << 3) | (b >> 2))
+                      , 0xff
+                     }};
+            }
+          );
+
+        dxt_color_block result;
+        result.colors[0] = expand (c0);
+        result.colors[1] = expand (c1);
+
+        for (int channel (0); channel < 3; ++channel)
+        {
+          int const a (result.colors[0][channel]);
+          int const b (result.colors[1][channel]);
+
+          if (four_colors_only || c0 > c1)
+          {
+            result.colors[2][channel] = std::uint8_t ((2 * a + b) / 3);
+            result.colors[3][channel] = std::uint8_t ((a + 2 * b) / 3);
+          }
+          else
+          {
+            result.colors[2][channel] = std::uint8_t ((a + b) / 2);
+            result.colors[3][channel] = 0;
+          }
+        }
+        result.colors[2][3] = 0xff;
+        result.colors[3][3] = (!four_colors_only && c0 <= c1 && transparent_black) ? 0 : 0xff;
+
+        result.indices = block[4] | (block[5] << 8) | (block[6] << 16) | (std::uint32_t (block[7]) << 24);
+
+        return result;
+      }
+
+      std::array<std::uint8_t, 16> read_explicit_alpha (std::uint8_t const* block)
+      {
+        std::array<std::uint8_t, 16> alpha;
+        for (int i (0); i < 16; ++i)
+        {
+          std::uint8_t const nibble ((block[i / 2] >> ((i % 2) * 4)) & 0xf);
+          alpha[i] = std::uint8_t (nibble * 17);
+        }
+        return alpha;
+      }
+
+      std::array<std::uint8_t, 16> read_interpolated_alpha (std::uint8_t const* block)
+      {
+        int const a0 (block[0]);
+        int const a1 (block[1]);
+
+        std::array<std::uint8_t, 8> values;
+        values[0] = std::uint8_t (a0);
+        values[1] = std::uint8_t (a1);
+        if (a0 > a1)
+        {
+          for (int i (1); i < 7; ++i)
+          {
+            values[i + 1] = std::uint8_t (((7 - i) * a0 + i * a1) / 7);
+          }
+        }
+        else
+        {
+          for (int i (1); i < 5; ++i)
+          {
+            values[i + 1] = std::uint8_t (((5 - i) * a0 + i * a1) / 5);
+          }
+          values[6] = 0;
+          values[7] = 0xff;
+        }
+
+        std::uint64_t indices (0);
+        for (int i (0); i < 6; ++i)
+        {
+          indices |= std::uint64_t (block[2 + i]) << (8 * i);
+        }
+
+        std::array<std::uint8_t, 16> alpha;
+        for (int i (0); i < 16; ++i)
+        {
+          alpha[i] = values[(indices >> (3 * i)) & 0x7];
+        }
+        return alpha;
+      }
+    }
+
+    int mip_size (int size, int level)
+    {
+      return std::max (1, size >> level);
+    }
+
+    int mip_count (BLPHeader const& header)
+    {
+      int count (0);
+      while (count < 16 && header.offsets[count] > 0 && header.sizes[count] > 0)
+      {
+        ++count;
+      }
+      return count;
+    }
+
+    int mip_for_size (BLPHeader const& header, int width, int height)
+    {
+      if (width <= 0 || height <= 0)
+      {
+        return 0;
+      }
+
+      int const count (mip_count (header));
+      int level (0);
+      while ( level + 1 < count
+           && mip_size (header.resx, level + 1) >= width
+           && mip_size (header.resy, level + 1) >= height
+            )
+      {
+        ++level;
+      }
+      return level;
+    }
+
+    void decode_palettized ( BLPHeader const& header
+                           , char const* data
+                           , std::size_t size
+                           , int level
+                           , std::uint32_t* out
+                           )
+    {
+      std::size_t const palette_size (256 * sizeof (std::uint32_t));
+      if (size < sizeof (BLPHeader) + palette_size)
+      {
+        throw std::runtime_error ("palette is truncated");
+      }
+
+      std::array<std::uint32_t, 256> palette;
+      std::memcpy (palette.data(), data + sizeof (BLPHeader), palette_size);
+
+      int const width (mip_size (header.resx, level));
+      int const height (mip_size (header.resy, level));
+      std::size_t const pixel_count (std::size_t (width) * height);
+
+      int const alphabits (header.attr_1_alphadepth);
+      std::size_t alpha_size (0);
+      switch (alphabits)
+      {
+      case 0: break;
+      case 1: alpha_size = (pixel_count + 7) / 8; break;
+      case 4: alpha_size = (pixel_count + 1) / 2; break;
+      case 8: alpha_size = pixel_count; break;
+      default:
+        throw std::runtime_error ("unsupported alpha depth " + std::to_string (alphabits));
+      }
+
+      check_level (header, size, level, pixel_count + alpha_size);
+
+      auto const indices (reinterpret_cast<std::uint8_t const*> (data + header.offsets[level]));
+      auto const alpha (indices + pixel_count);
+
+      for (std::size_t i (0); i < pixel_count; ++i)
+      {
+        // bgra
+        std::uint32_t const k (palette[indices[i]]);
+
+        std::uint32_t a (0xff);
+        switch (alphabits)
+        {
+        case 1: a = (alpha[i / 8] >> (i % 8)) & 1 ? 0xff : 0; break;
+        case 4: a = ((alpha[i / 2] >> ((i % 2) * 4)) & 0xf) * 17; break;
+        case 8: a = alpha[i]; break;
+        }
+
+        out[i] = rgba ((k >> 16) & 0xff, (k >> 8) & 0xff, k & 0xff, a);
+      }
+    }
+
+    void decode_dxt ( BLPHeader const& header
+                    , char const* data
+                    , std::size_t size
+                    , int level
+                    , std::uint32_t* out
+                    )
+    {
+      int const alpha_type (header.attr_2_alphatype & 3);
+      if (alpha_type == 2)
+      {
+        throw std::runtime_error ("unsupported DXT alpha type");
+      }
+
+      bool const dxt1 (alpha_type == 0);
+      bool const dxt5 (alpha_type == 3);
+      std::size_t const block_size (dxt1 ? 8 : 16);
+
+      int const width (mip_size (header.resx, level));
+      int const height (mip_size (header.resy, level));
+      int const blocks_x ((width + 3) / 4);
+      int const blocks_y ((height + 3) / 4);
+      std::size_t const needed (std::size_t (blocks_x) * blocks_y * block_size);
+
+      check_level (header, size, level, 0);
+      // some small levels are shorter than they should be
+      std::size_t const available
+        (std::min ({needed, std::size_t (std::max (header.sizes[level], 0)), size - header.offsets[level]}));
+
+      std::vector<std::uint8_t> blocks (needed, 0);
+      std::memcpy (blocks.data(), data + header.offsets[level], available);
+
+      for (int by (0); by < blocks_y; ++by)
+      {
+        for (int bx (0); bx < blocks_x; ++bx)
+        {
+          std::uint8_t const* block (blocks.data() + (std::size_t (by) * blocks_x + bx) * block_size);
+
+          std::array<std::uint8_t, 16> alpha;
+          alpha.fill (0xff);
+          if (!dxt1)
+          {
+            alpha = dxt5 ? read_interpolated_alpha (block) : read_explicit_alpha (block);
+            block += 8;
+          }
+
+          dxt_color_block const colors
+            (read_color_block (block, !dxt1, header.attr_1_alphadepth != 0));
+
+          for (int y (0); y < 4 && by * 4 + y < height; ++y)
+          {
+            for (int x (0); x < 4 && bx * 4 + x < width; ++x)
+            {
+              int const i (y * 4 + x);
+              auto const& color (colors.colors[(colors.indices >> (2 * i)) & 0x3]);
+
+              out[std::size_t (by * 4 + y) * width + bx * 4 + x]
+                = rgba (color[0], color[1], color[2], dxt1 ? color[3] : alpha[i]);
+            }
+          }
+        }
+      }
+    }
+
+    image decode (char const* data, std::size_t size, int width, int height)
+    {
+      if (size < sizeof (BLPHeader))
+      {
+        throw std::runtime_error ("header is truncated");
+      }
+
+      BLPHeader header;
+      std::memcpy (&header, data, sizeof (BLPHeader));
+
+      if (header.resx <= 0 || header.resy <= 0 || !mip_count (header))
+      {
+        throw std::runtime_error ("no image");
+      }
+
+      int const level (mip_for_size (header, width, height));
+
+      image result;
+      result.width = mip_size (header.resx, level);
+      result.height = mip_size (header.resy, level);
+      result.pixels.resize (std::size_t (result.width) * result.height);
+
+      switch (compression (header.attr_0_compression))
+      {
+      case compression::palettized:
+        decode_palettized (header, data, size, level, result.pixels.data());
+        break;
+      case compression::dxt:
+        decode_dxt (header, data, size, level, result.pixels.data());
+        break;
+      default:
+        throw std::runtime_error ("unimplemented BLP colorEncoding");
+      }
+
+      return result;
+    }
+  }
+}
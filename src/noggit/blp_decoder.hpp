@@ -0,0 +1,81 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//! \todo Cross-platform syntax for packed structs.
+#pragma pack(push,1)
+struct BLPHeader
+{
+  int32_t magix;
+  int32_t version;
+  uint8_t attr_0_compression;
+  uint8_t attr_1_alphadepth;
+  uint8_t attr_2_alphatype;
+  uint8_t attr_3_mipmaplevels;
+  int32_t resx;
+  int32_t resy;
+  int32_t offsets[16];
+  int32_t sizes[16];
+};
+#pragma pack(pop)
+
+namespace noggit
+{
+  //! Decoding of BLP files on the CPU, for the images shown by the ui
+  //! which don't need a GL context. Pixels are RGBA bytes, rows top down.
+  namespace blp
+  {
+    enum class compression : std::uint8_t
+    {
+      palettized = 1,
+      dxt = 2,
+    };
+
+    struct image
+    {
+      int width = 0;
+      int height = 0;
+      std::vector<std::uint32_t> pixels;
+    };
+
+    //! dimensions of a mip level, at least 1 * 1
+    int mip_size (int size, int level);
+
+    //! number of mip levels present in the file, the ones after the first
+    //! missing one are ignored
+    int mip_count (BLPHeader const&);
+
+    //! the smallest mip level still at least width * height, 0 if either
+    //! is not positive
+    int mip_for_size (BLPHeader const&, int width, int height);
+
+    //! decodes a palettized mip level of width * height pixels into out,
+    //! with 0, 1, 4 or 8 bits alpha
+    //! \throws std::runtime_error if the level is not entirely in data
+    void decode_palettized ( BLPHeader const&
+                           , char const* data
+                           , std::size_t size
+                           , int level
+                           , std::uint32_t* out
+                           );
+
+    //! decodes the DXT1, 3 or 5 blocks of a width * height mip level into
+    //! out. Blocks missing at the end of a short level are black.
+    //! \throws std::runtime_error on an unknown alpha type or if the level
+    //! is not in data
+    void decode_dxt ( BLPHeader const&
+                    , char const* data
+                    , std::size_t size
+                    , int level
+                    , std::uint32_t* out
+                    );
+
+    //! decodes the mip level of a whole file chosen by mip_for_size
+    //! \throws std::runtime_error on a truncated or unsupported file
+    image decode (char const* data, std::size_t size, int width = -1, int height = -1);
+  }
+}
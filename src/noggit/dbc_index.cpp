@@ -0,0 +1,61 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/dbc_index.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+namespace noggit
+{
+  dbc_index::dbc_index ( unsigned char const* records
+                       , std::size_t record_count
+                       , std::size_t record_size
+                       , std::size_t field
+                       )
+  {
+    auto const value
+      ( [&] (std::size_t record)
+        {
+          std::uint32_t v;
+          std::memcpy (&v, records + record * record_size + field * 4, sizeof (v));
+          return v;
+        }
+      );
+
+    if (!record_count)
+    {
+      return;
+    }
+
+    std::uint32_t min (value (0));
+    std::uint32_t max (min);
+    for (std::size_t i (1); i < record_count; ++i)
+    {
+      min = std::min (min, value (i));
+      max = std::max (max, value (i));
+    }
+
+    // a table up to 4 times larger than the number of records is still
+    // smaller than the hash map's nodes
+    if (std::uint64_t (max) - min < 4 * std::uint64_t (record_count) + 64)
+    {
+      _dense_begin = min;
+      _dense.resize (std::size_t (max - min) + 1, npos);
+
+      // the linear lookup returned the first match, keep it for duplicates
+      for (std::size_t i (record_count); i-- > 0;)
+      {
+        _dense[value (i) - min] = i;
+      }
+    }
+    else
+    {
+      _sparse.reserve (record_count);
+
+      for (std::size_t i (0); i < record_count; ++i)
+      {
+        _sparse.emplace (value (i), i);
+      }
+    }
+  }
+}
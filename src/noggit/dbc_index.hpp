@@ -0,0 +1,44 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace noggit
+{
+  //! maps the values of one four byte column of a DBC to the first record
+  //! holding them. Uses a table when the values are compact enough, like
+  //! most ID columns, and a hash map otherwise.
+  class dbc_index
+  {
+  public:
+    static constexpr std::size_t npos = static_cast<std::size_t> (-1);
+
+    dbc_index ( unsigned char const* records
+              , std::size_t record_count
+              , std::size_t record_size
+              , std::size_t field
+              );
+
+    //! \return the record number or npos
+    std::size_t find (std::uint32_t value) const
+    {
+      if (!_dense.empty())
+      {
+        std::uint32_t const slot (value - _dense_begin);
+        return slot < _dense.size() ? _dense[slot] : npos;
+      }
+
+      auto const it (_sparse.find (value));
+      return it == _sparse.end() ? npos : it->second;
+    }
+
+  private:
+    std::uint32_t _dense_begin = 0;
+    std::vector<std::size_t> _dense;
+    std::unordered_map<std::uint32_t, std::size_t> _sparse;
+  };
+}
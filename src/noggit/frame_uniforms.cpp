@@ -0,0 +1,35 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/frame_uniforms.hpp>
+#include <opengl/context.hpp>
+#include <opengl/shader.hpp>
+
+#include <cstring>
+
+namespace noggit
+{
+  void frame_uniforms::bind_block (opengl::program const& program)
+  {
+    opengl::scoped::use_program shader {program};
+    shader.uniform_block ("frame_block", binding);
+  }
+
+  void frame_uniforms::update (frame_uniform_data const& data)
+  {
+    if (!_uploaded)
+    {
+      _buffer.upload();
+    }
+    else if (!std::memcmp (&_data, &data, sizeof (data)))
+    {
+      gl.bindBufferBase (GL_UNIFORM_BUFFER, binding, _buffer[0]);
+      return;
+    }
+
+    _data = data;
+    gl.bufferData<GL_UNIFORM_BUFFER> (_buffer[0], sizeof (_data), &_data, GL_DYNAMIC_DRAW);
+    gl.bindBufferBase (GL_UNIFORM_BUFFER, binding, _buffer[0]);
+
+    _uploaded = true;
+  }
+}
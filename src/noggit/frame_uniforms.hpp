@@ -0,0 +1,56 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <math/matrix_4x4.hpp>
+#include <math/vector_4d.hpp>
+#include <opengl/scoped.hpp>
+#include <opengl/shader.fwd.hpp>
+
+namespace noggit
+{
+  //! What the world's shaders share for a frame, with the std140 layout of
+  //! the frame_block uniform block they declare.
+  struct frame_uniform_data
+  {
+    math::matrix_4x4 model_view = math::matrix_4x4::unit;
+    math::matrix_4x4 projection = math::matrix_4x4::unit;
+    //! xyz
+    math::vector_4d camera;
+    math::vector_4d fog_color;
+    //! xyz, for the models
+    math::vector_4d light_dir;
+    //! xyz
+    math::vector_4d terrain_light_dir;
+    //! rgb
+    math::vector_4d diffuse_color;
+    //! rgb
+    math::vector_4d ambient_color;
+    //! ratio of fog_end
+    float fog_start = 0.f;
+    float fog_end = 0.f;
+    float padding[2] = {0.f, 0.f};
+  };
+  static_assert (sizeof (frame_uniform_data) == 2 * 64 + 6 * 16 + 16, "std140 layout of frame_block");
+
+  //! The uniform buffer of frame_block, set once per frame instead of each
+  //! program setting the same uniforms.
+  class frame_uniforms
+  {
+  public:
+    //! terrain_tile_render uses 0
+    static constexpr GLuint binding = 1;
+
+    //! makes program read its frame_block from this buffer
+    static void bind_block (opengl::program const&);
+
+    //! uploads data if it changed since the last frame
+    void update (frame_uniform_data const& data);
+
+  private:
+    bool _uploaded = false;
+    frame_uniform_data _data;
+
+    opengl::scoped::deferred_upload_buffers<1> _buffer;
+  };
+}
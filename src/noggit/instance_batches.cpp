@@ -0,0 +1,90 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/instance_batches.hpp>
+
+#include <atomic>
+#include <cstring>
+#include <utility>
+
+namespace noggit
+{
+  namespace
+  {
+    bool same_matrix (math::matrix_4x4 const& lhs, math::matrix_4x4 const& rhs)
+    {
+      return !std::memcmp (&lhs, &rhs, sizeof (math::matrix_4x4));
+    }
+
+    bool same_transforms ( std::vector<math::matrix_4x4> const& lhs
+                         , std::vector<math::matrix_4x4> const& rhs
+                         )
+    {
+      return lhs.size() == rhs.size()
+        && (lhs.empty() || !std::memcmp (lhs.data(), rhs.data(), lhs.size() * sizeof (math::matrix_4x4)));
+    }
+
+    // shared by every world so that a model drawn by another one doesn't
+    // mistake a batch for the one it uploaded last
+    std::size_t next_version()
+    {
+      static std::atomic<std::size_t> version (0);
+      return ++version;
+    }
+  }
+
+  bool instance_view::operator== (instance_view const& other) const
+  {
+    return same_matrix (model_view, other.model_view)
+      && same_matrix (projection, other.projection)
+      && cull_distance == other.cull_distance
+      && display == other.display
+      && draw_models == other.draw_models
+      && draw_wmo_doodads == other.draw_wmo_doodads
+      && draw_hidden_models == other.draw_hidden_models;
+  }
+
+  bool instance_batches::need_update (instance_view const& view, std::size_t instances_version) const
+  {
+    return !_valid || instances_version != _instances_version || !(view == _view);
+  }
+
+  void instance_batches::begin_update (instance_view const& view, std::size_t instances_version)
+  {
+    _view = view;
+    _instances_version = instances_version;
+
+    for (auto& it : _batches)
+    {
+      std::swap (it.second.transforms, it.second._previous_transforms);
+      it.second.transforms.clear();
+    }
+  }
+
+  void instance_batches::add (Model* model, math::matrix_4x4 const& transform)
+  {
+    _batches[model].transforms.push_back (transform);
+  }
+
+  void instance_batches::end_update (bool complete)
+  {
+    for (auto it = _batches.begin(); it != _batches.end();)
+    {
+      instance_batch& batch (it->second);
+
+      if (batch.transforms.empty())
+      {
+        it = _batches.erase (it);
+        continue;
+      }
+
+      if (!batch.version || !same_transforms (batch.transforms, batch._previous_transforms))
+      {
+        batch.version = next_version();
+      }
+
+      ++it;
+    }
+
+    _valid = complete;
+  }
+}
@@ -0,0 +1,73 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <math/matrix_4x4.hpp>
+#include <noggit/tool_enums.hpp>
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+class Model;
+
+namespace noggit
+{
+  //! everything the visibility of the instances depends on, besides the
+  //! instances themselves
+  struct instance_view
+  {
+    math::matrix_4x4 model_view = math::matrix_4x4::unit;
+    math::matrix_4x4 projection = math::matrix_4x4::unit;
+    float cull_distance = 0.f;
+    display_mode display = display_mode::in_3D;
+    bool draw_models = false;
+    bool draw_wmo_doodads = false;
+    bool draw_hidden_models = false;
+
+    bool operator== (instance_view const&) const;
+  };
+
+  //! transforms of the visible instances of a model
+  struct instance_batch
+  {
+    std::vector<math::matrix_4x4> transforms;
+    //! changes whenever the transforms do, unique across all the batches
+    //! so that a model knows when its instance buffer is outdated
+    std::size_t version = 0;
+
+  private:
+    friend class instance_batches;
+
+    std::vector<math::matrix_4x4> _previous_transforms;
+  };
+
+  //! The visible instances grouped by model, kept across frames: they are
+  //! only gathered again when the view or the instances changed, and a
+  //! batch only gets a new version, and so a new upload, when its
+  //! transforms changed.
+  class instance_batches
+  {
+  public:
+    bool need_update (instance_view const&, std::size_t instances_version) const;
+    //! to call when something else than the view or the instances changes
+    //! which instances are visible, e.g. models being hidden
+    void invalidate() { _valid = false; }
+
+    //! empties the batches, keeping their storage
+    void begin_update (instance_view const&, std::size_t instances_version);
+    void add (Model* model, math::matrix_4x4 const& transform);
+    //! drops the empty batches and versions the changed ones. Not complete
+    //! when some instances couldn't be tested yet, e.g. their model is
+    //! still loading, the next frame gathers them again then.
+    void end_update (bool complete);
+
+    std::unordered_map<Model*, instance_batch>& batches() { return _batches; }
+
+  private:
+    std::unordered_map<Model*, instance_batch> _batches;
+    instance_view _view;
+    std::size_t _instances_version = 0;
+    bool _valid = false;
+  };
+}
@@ -0,0 +1,136 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/MapHeaders.h>
+#include <noggit/instance_grid.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace noggit
+{
+  // finite so that the plane tests of the frustum stay meaningful
+  math::vector_3d const instance_grid::unbounded_min (-1e7f, -1e7f, -1e7f);
+  math::vector_3d const instance_grid::unbounded_max (1e7f, 1e7f, 1e7f);
+
+  namespace
+  {
+    std::size_t cell (float position, float size, std::size_t count)
+    {
+      float const index (std::floor (position / size));
+      return index < 0.f ? 0 : std::min (count - 1, static_cast<std::size_t> (index));
+    }
+  }
+
+  void instance_grid::insert ( std::uint32_t uid
+                             , math::vector_3d const& position
+                             , math::vector_3d const& min
+                             , math::vector_3d const& max
+                             )
+  {
+    remove (uid);
+
+    std::size_t const tile_x (cell (position.x, TILESIZE, 64));
+    std::size_t const tile_z (cell (position.z, TILESIZE, 64));
+    std::size_t const chunk_x (cell (position.x - tile_x * TILESIZE, CHUNKSIZE, 16));
+    std::size_t const chunk_z (cell (position.z - tile_z * TILESIZE, CHUNKSIZE, 16));
+    std::size_t const tile_index (tile_z * 64 + tile_x);
+    std::size_t const chunk_index (chunk_z * 16 + chunk_x);
+
+    auto& t (_tiles[tile_index]);
+    if (!t)
+    {
+      t = std::make_unique<tile>();
+    }
+
+    chunk& c (t->chunks[chunk_index]);
+    c.entries.push_back ({uid, min, max});
+    c.min = math::min (c.min, min);
+    c.max = math::max (c.max, max);
+
+    t->min = math::min (t->min, min);
+    t->max = math::max (t->max, max);
+    ++t->count;
+
+    _cells.emplace (uid, std::make_pair (tile_index, chunk_index));
+  }
+
+  void instance_grid::remove (std::uint32_t uid)
+  {
+    auto const it (_cells.find (uid));
+    if (it == _cells.end())
+    {
+      return;
+    }
+
+    auto& t (_tiles[it->second.first]);
+    chunk& c (t->chunks[it->second.second]);
+    _cells.erase (it);
+
+    c.entries.erase ( std::find_if ( c.entries.begin(), c.entries.end()
+                                   , [&] (entry const& e) { return e.uid == uid; }
+                                   )
+                    );
+
+    if (--t->count == 0)
+    {
+      t.reset();
+      return;
+    }
+
+    // the bounds only shrink back here, they grow on insertion
+    c.min = math::vector_3d::max();
+    c.max = math::vector_3d::min();
+    for (entry const& e : c.entries)
+    {
+      c.min = math::min (c.min, e.min);
+      c.max = math::max (c.max, e.max);
+    }
+
+    t->min = math::vector_3d::max();
+    t->max = math::vector_3d::min();
+    for (chunk const& other : t->chunks)
+    {
+      if (!other.entries.empty())
+      {
+        t->min = math::min (t->min, other.min);
+        t->max = math::max (t->max, other.max);
+      }
+    }
+  }
+
+  void instance_grid::clear()
+  {
+    for (auto& t : _tiles)
+    {
+      t.reset();
+    }
+    _cells.clear();
+  }
+
+  void instance_grid::query (bounds_test const& test, std::function<void (std::uint32_t)> const& fun) const
+  {
+    for (auto const& t : _tiles)
+    {
+      if (!t || !test (t->min, t->max))
+      {
+        continue;
+      }
+
+      for (chunk const& c : t->chunks)
+      {
+        if (c.entries.empty() || !test (c.min, c.max))
+        {
+          continue;
+        }
+
+        for (entry const& e : c.entries)
+        {
+          if (test (e.min, e.max))
+          {
+            fun (e.uid);
+          }
+        }
+      }
+    }
+  }
+}
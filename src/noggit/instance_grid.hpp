@@ -0,0 +1,73 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <math/vector_3d.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace noggit
+{
+  //! Loose grid of instances keyed by the tile and chunk of their position.
+  //! The bounds of each chunk and tile grow to contain the bounds of all of
+  //! their instances, so that a query only looks at the instances of the
+  //! chunks whose bounds it touches.
+  class instance_grid
+  {
+  public:
+    using bounds_test = std::function<bool (math::vector_3d const& min, math::vector_3d const& max)>;
+
+    //! bounds for the instances whose size isn't known yet, always found
+    static math::vector_3d const unbounded_min;
+    static math::vector_3d const unbounded_max;
+
+    //! replaces the instance if it is already stored
+    void insert ( std::uint32_t uid
+                , math::vector_3d const& position
+                , math::vector_3d const& min
+                , math::vector_3d const& max
+                );
+    void remove (std::uint32_t uid);
+    void clear();
+
+    std::size_t size() const { return _cells.size(); }
+
+    //! calls fun with the uid of every instance whose bounds pass the test,
+    //! the bounds of the tiles and chunks are tested first
+    void query (bounds_test const& test, std::function<void (std::uint32_t)> const& fun) const;
+
+  private:
+    struct entry
+    {
+      std::uint32_t uid;
+      math::vector_3d min;
+      math::vector_3d max;
+    };
+
+    struct chunk
+    {
+      std::vector<entry> entries;
+      math::vector_3d min = math::vector_3d::max();
+      math::vector_3d max = math::vector_3d::min();
+    };
+
+    struct tile
+    {
+      std::array<chunk, 256> chunks;
+      math::vector_3d min = math::vector_3d::max();
+      math::vector_3d max = math::vector_3d::min();
+      std::size_t count = 0;
+    };
+
+    std::array<std::unique_ptr<tile>, 64 * 64> _tiles;
+    //! uid -> tile, chunk
+    std::unordered_map<std::uint32_t, std::pair<std::size_t, std::size_t>> _cells;
+  };
+}
@@ -0,0 +1,141 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/liquid_draw_list.hpp>
+
+#include <algorithm>
+
+namespace noggit
+{
+  namespace
+  {
+    bool has_water (std::uint64_t subchunks, int x, int z, int size)
+    {
+      for (int pz (z); pz < z + size; ++pz)
+      {
+        for (int px (x); px < x + size; ++px)
+        {
+          if ((subchunks >> (pz * 8 + px)) & 1)
+          {
+            return true;
+          }
+        }
+      }
+      return false;
+    }
+  }
+
+  std::vector<liquid_lod_indices::index_type> liquid_lod_indices::indices()
+  {
+    std::vector<index_type> indices;
+
+    for (int lod_level (0); lod_level < lod_count; ++lod_level)
+    {
+      int const n (1 << lod_level);
+
+      for (int z (0); z < 8; z += n)
+      {
+        for (int x (0); x < 8; x += n)
+        {
+          int const p (z * 9 + x);
+
+          for (int i : {p, p + n * 9, p + n * 9 + n, p + n * 9 + n, p + n, p})
+          {
+            indices.emplace_back (static_cast<index_type> (i));
+          }
+        }
+      }
+    }
+
+    return indices;
+  }
+
+  std::size_t liquid_lod_indices::first_index (int lod_level)
+  {
+    std::size_t first (0);
+    for (int lod (0); lod < lod_level; ++lod)
+    {
+      first += lod_sizes[lod];
+    }
+    return first;
+  }
+
+  std::vector<liquid_lod_indices::range> liquid_lod_indices::ranges
+    (std::uint64_t subchunks, int lod_level)
+  {
+    std::vector<range> ranges;
+
+    int const n (1 << lod_level);
+    std::size_t index (first_index (lod_level));
+
+    for (int z (0); z < 8; z += n)
+    {
+      for (int x (0); x < 8; x += n, index += 6)
+      {
+        if (!has_water (subchunks, x, z, n))
+        {
+          continue;
+        }
+
+        // the quads of a lod level are consecutive, across rows too
+        if (!ranges.empty() && ranges.back().first + ranges.back().count == index)
+        {
+          ranges.back().count += 6;
+        }
+        else
+        {
+          ranges.push_back ({index, 6});
+        }
+      }
+    }
+
+    return ranges;
+  }
+
+  void liquid_draw_list::clear()
+  {
+    _ranges.clear();
+    _batches.clear();
+    _counts.clear();
+    _index_offsets.clear();
+    _base_vertices.clear();
+  }
+
+  void liquid_draw_list::add ( int liquid_id
+                             , std::size_t slot
+                             , std::vector<liquid_lod_indices::range> const& ranges
+                             )
+  {
+    for (liquid_lod_indices::range const& range : ranges)
+    {
+      _ranges.push_back ({liquid_id, slot, range});
+    }
+  }
+
+  void liquid_draw_list::finish()
+  {
+    // stable to keep drawing a liquid front to back like the chunks were
+    std::stable_sort ( _ranges.begin(), _ranges.end()
+                     , [] (layer_range const& lhs, layer_range const& rhs)
+                       {
+                         return lhs.liquid_id < rhs.liquid_id;
+                       }
+                     );
+
+    for (std::size_t i (0); i < _ranges.size(); ++i)
+    {
+      layer_range const& range (_ranges[i]);
+
+      if (_batches.empty() || _batches.back().liquid_id != range.liquid_id)
+      {
+        _batches.push_back ({range.liquid_id, i, 0});
+      }
+      ++_batches.back().count;
+
+      _counts.push_back (static_cast<std::int32_t> (range.indices.count));
+      _index_offsets.push_back
+        (reinterpret_cast<void const*> (range.indices.first * sizeof (liquid_lod_indices::index_type)));
+      _base_vertices.push_back
+        (static_cast<std::int32_t> (range.slot * liquid_lod_indices::vertices_per_layer));
+    }
+  }
+}
@@ -0,0 +1,80 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace noggit
+{
+  //! The indices of a liquid layer's 9 * 9 vertices, shared by every layer.
+  //! Each lod level has the quads of 1, 2, 4 and 8 subchunks wide, row by
+  //! row, as two triangles. A layer draws the ranges of them covering its
+  //! subchunks, relative to its first vertex.
+  struct liquid_lod_indices
+  {
+    using index_type = std::uint16_t;
+
+    static constexpr int lod_count = 4;
+    static constexpr std::size_t vertices_per_layer = 9 * 9;
+    //! 8 * 8, 4 * 4, 2 * 2 and 1 quads of 2 triangles
+    static constexpr std::array<std::size_t, lod_count> lod_sizes = {8 * 8 * 6, 4 * 4 * 6, 2 * 2 * 6, 6};
+
+    struct range
+    {
+      std::size_t first;
+      std::size_t count;
+    };
+
+    //! of every lod level after each other
+    static std::vector<index_type> indices();
+    static std::size_t first_index (int lod_level);
+    //! the consecutive quads of lod_level with water in any of their
+    //! subchunks, a bit per subchunk like liquid_layer's mask
+    static std::vector<range> ranges (std::uint64_t subchunks, int lod_level);
+  };
+
+  //! The visible liquid layers of a tile grouped by liquid, so that a tile
+  //! is drawn with one multi draw per liquid instead of one draw per layer.
+  //! The arrays of a batch are the ones glMultiDrawElementsBaseVertex takes.
+  class liquid_draw_list
+  {
+  public:
+    struct batch
+    {
+      int liquid_id;
+      //! into counts(), index_offsets() and base_vertices()
+      std::size_t first;
+      std::size_t count;
+    };
+
+    void clear();
+    //! slot is where the layer's vertices are, in vertices_per_layer units
+    void add (int liquid_id, std::size_t slot, std::vector<liquid_lod_indices::range> const& ranges);
+    //! groups the layers added since clear()
+    void finish();
+
+    bool empty() const { return _ranges.empty(); }
+    std::vector<batch> const& batches() const { return _batches; }
+    std::vector<std::int32_t> const& counts() const { return _counts; }
+    //! in bytes, as pointers like the GL takes them
+    std::vector<void const*> const& index_offsets() const { return _index_offsets; }
+    std::vector<std::int32_t> const& base_vertices() const { return _base_vertices; }
+
+  private:
+    struct layer_range
+    {
+      int liquid_id;
+      std::size_t slot;
+      liquid_lod_indices::range indices;
+    };
+
+    std::vector<layer_range> _ranges;
+    std::vector<batch> _batches;
+    std::vector<std::int32_t> _counts;
+    std::vector<void const*> _index_offsets;
+    std::vector<std::int32_t> _base_vertices;
+  };
+}
@@ -4,7 +4,9 @@
 #include <noggit/liquid_layer.hpp>
 #include <noggit/Log.h>
 #include <noggit/MapChunk.h>
+#include <noggit/map_file_layout.hpp>
 #include <noggit/Misc.h>
+#include <noggit/MPQ.h>
 
 #include <boost/filesystem.hpp>
 #include <boost/format.hpp>
@@ -166,192 +168,32 @@ liquid_layer::liquid_layer(MPQFile &f, std::size_t base_pos, math::vector_3d con
   }
 }
 
-liquid_layer::liquid_layer(liquid_layer&& other)
-  : _liquid_id(other._liquid_id)
-  , _liquid_vertex_format(other._liquid_vertex_format)
-  , _minimum(other._minimum)
-  , _maximum(other._maximum)
-  , _subchunks(other._subchunks)
-  , _vertices(other._vertices)
-  , _depth(other._depth)
-  , _tex_coords(other._tex_coords)
-  , _indices_by_lod(other._indices_by_lod)
-  , _need_buffer_update(true)
-  , pos(other.pos)
+MH2O_Information liquid_layer::save_info(std::uint64_t& mask) const
 {
-  changeLiquidID(_liquid_id);
-}
-
-liquid_layer::liquid_layer(liquid_layer const& other)
-  : _liquid_id(other._liquid_id)
-  , _liquid_vertex_format(other._liquid_vertex_format)
-  , _minimum(other._minimum)
-  , _maximum(other._maximum)
-  , _subchunks(other._subchunks)
-  , _vertices(other._vertices)
-  , _depth(other._depth)
-  , _tex_coords(other._tex_coords)
-  , _indices_by_lod(other._indices_by_lod)
-  , _need_buffer_update(true)
-  , pos(other.pos)
-{
-  changeLiquidID(_liquid_id);
-}
-
-liquid_layer& liquid_layer::operator= (liquid_layer&& other)
-{
-  std::swap(_liquid_id, other._liquid_id);
-  std::swap(_liquid_vertex_format, other._liquid_vertex_format);
-  std::swap(_minimum, other._minimum);
-  std::swap(_maximum, other._maximum);
-  std::swap(_subchunks, other._subchunks);
-  std::swap(_vertices, other._vertices);
-  std::swap(_depth, other._depth);
-  std::swap(_tex_coords, other._tex_coords);
-  std::swap(pos, other.pos);
-  std::swap(_indices_by_lod, other._indices_by_lod);
-
-  _need_buffer_update = true;
-  other._need_buffer_update = true;
-
-  changeLiquidID(_liquid_id);
-  other.changeLiquidID(other._liquid_id);
-
-  return *this;
-}
-
-liquid_layer& liquid_layer::operator=(liquid_layer const& other)
-{
-  changeLiquidID(other._liquid_id);
-  _liquid_vertex_format = other._liquid_vertex_format;
-  _minimum = other._minimum;
-  _maximum = other._maximum;
-  _subchunks = other._subchunks;
-  _vertices = other._vertices;
-  _depth = other._depth;
-  _tex_coords = other._tex_coords;
-  pos = other.pos;
-  _indices_by_lod = other._indices_by_lod;
-  _need_buffer_update = true;
-
-  return *this;
-}
-
-void liquid_layer::save(sExtendableArray& adt, int base_pos, int& info_pos, int& current_pos) const
-{
-  int min_x = 9, min_z = 9, max_x = 0, max_z = 0;
-  bool filled = true;
-
-  for (int z = 0; z < 8; ++z)
-  {
-    for (int x = 0; x < 8; ++x)
-    {
-      if (hasSubchunk(x, z))
-      {
-        min_x = std::min(x, min_x);
-        min_z = std::min(z, min_z);
-        max_x = std::max(x + 1, max_x);
-        max_z = std::max(z + 1, max_z);
-      }
-      else
-      {
-        filled = false;
-      }
-    }
-  }
-
-  MH2O_Information info;
-  std::uint64_t mask = 0;
+  MH2O_Information info (noggit::mh2o::layer_info(_subchunks, mask));
 
   info.liquid_id = _liquid_id;
   info.liquid_vertex_format = _liquid_vertex_format;
   info.minHeight = _minimum;
   info.maxHeight = _maximum;
-  info.xOffset = min_x;
-  info.yOffset = min_z;
-  info.width = max_x - min_x;
-  info.height = max_z - min_z;
-
-  if (filled)
-  {
-    info.ofsInfoMask = 0;
-  }
-  else
-  {
-    std::uint64_t value = 1;
-    for (int z = info.yOffset; z < info.yOffset + info.height; ++z)
-    {
-      for (int x = info.xOffset; x < info.xOffset + info.width; ++x)
-      {
-        if (hasSubchunk(x, z))
-        {
-          mask |= value;
-        }
-        value <<= 1;
-      }
-    }
-
-    if (mask > 0)
-    {
-      info.ofsInfoMask = current_pos - base_pos;
-      adt.Insert(current_pos, 8, reinterpret_cast<char*>(&mask));
-      current_pos += 8;
-    }
-  }
-
-  info.ofsHeightMap = current_pos - base_pos;
 
-  int vertices_count = (info.width + 1) * (info.height + 1);
-
-  if (_liquid_vertex_format == 0 || _liquid_vertex_format == 1)
-  {
-    adt.Extend(vertices_count * sizeof(float));
-
-    for (int z = info.yOffset; z <= info.yOffset + info.height; ++z)
-    {
-      for (int x = info.xOffset; x <= info.xOffset + info.width; ++x)
-      {
-        memcpy(adt.GetPointer<char>(current_pos), &_vertices[z * 9 + x].y, sizeof(float));
-        current_pos += sizeof(float);
-      }
-    }
-  }
-
-  if (_liquid_vertex_format == 1)
-  {
-    adt.Extend(vertices_count * sizeof(mh2o_uv));
-
-    for (int z = info.yOffset; z <= info.yOffset + info.height; ++z)
-    {
-      for (int x = info.xOffset; x <= info.xOffset + info.width; ++x)
-      {
-        mh2o_uv uv;
-        uv.x = static_cast<std::uint16_t>(std::min(_tex_coords[z * 9 + x].x * 255.f, 65535.f));
-        uv.y = static_cast<std::uint16_t>(std::min(_tex_coords[z * 9 + x].y * 255.f, 65535.f));
+  return info;
+}
 
-        memcpy(adt.GetPointer<char>(current_pos), &uv, sizeof(mh2o_uv));
-        current_pos += sizeof(mh2o_uv);
-      }
-    }
-  }
+std::size_t liquid_layer::save_size() const
+{
+  std::uint64_t mask;
+  MH2O_Information const info (save_info(mask));
 
-  if (_liquid_vertex_format == 0 || _liquid_vertex_format == 2)
-  {
-    adt.Extend(vertices_count * sizeof(std::uint8_t));
+  return noggit::mh2o::layer_size(info, mask);
+}
 
-    for (int z = info.yOffset; z <= info.yOffset + info.height; ++z)
-    {
-      for (int x = info.xOffset; x <= info.xOffset + info.width; ++x)
-      {
-        std::uint8_t depth = static_cast<std::uint8_t>(std::min(_depth[z * 9 + x] * 255.0f, 255.f));
-        memcpy(adt.GetPointer<char>(current_pos), &depth, sizeof(std::uint8_t));
-        current_pos += sizeof(std::uint8_t);
-      }
-    }
-  }
+void liquid_layer::save(sExtendableArray& adt, int base_pos, int& info_pos, int& current_pos) const
+{
+  std::uint64_t mask;
+  MH2O_Information const info (save_info(mask));
 
-  memcpy(adt.GetPointer<char>(info_pos), &info, sizeof(MH2O_Information));
-  info_pos += sizeof(MH2O_Information);
+  noggit::mh2o::write_layer(adt, base_pos, info_pos, current_pos, info, mask, _vertices, _depth, _tex_coords);
 }
 
 void liquid_layer::changeLiquidID(int id)
@@ -362,7 +204,7 @@ void liquid_layer::changeLiquidID(int id)
   {
     DBCFile::Record lLiquidTypeRow = gLiquidTypeDB.getByID(_liquid_id);
 
-    switch (lLiquidTypeRow.getInt(LiquidTypeDB::Type))
+    switch (lLiquidTypeRow.get<LiquidTypeDB::Type>())
     {
     case 2: // magma
     case 3: // slime
@@ -380,123 +222,10 @@ void liquid_layer::changeLiquidID(int id)
 
 void liquid_layer::update_indices()
 {
-  _indices_by_lod.clear();
-
-  for (int z = 0; z < 8; ++z)
-  {
-    for (int x = 0; x < 8; ++x)
-    {
-      size_t p = z * 9 + x;
-      
-      for (int lod_level = 0; lod_level < lod_count; ++lod_level)
-      {
-        int n = 1 << lod_level;
-        if ((z % n) == 0 && (x % n) == 0)
-        {
-          if (hasSubchunk(x, z, n))
-          {
-            _indices_by_lod[lod_level].emplace_back (p);
-            _indices_by_lod[lod_level].emplace_back (p + n * 9);
-            _indices_by_lod[lod_level].emplace_back (p + n * 9 + n);
-            _indices_by_lod[lod_level].emplace_back(p + n * 9 + n);
-            _indices_by_lod[lod_level].emplace_back (p + n);
-            _indices_by_lod[lod_level].emplace_back(p);
-          }                    
-        }
-        else
-        {
-          break;
-        }
-      }      
-    }
-  }
-
-  _need_buffer_update = true;
-}
-
-void liquid_layer::upload()
-{
-  _index_buffer.upload();
-  _buffers.upload();
-  _vertex_array.upload();
-
-  _uploaded = true;
-}
-
-// todo: update only buffer that needs to be updated
-void liquid_layer::update_buffers()
-{
-  for (int i = 0; i < lod_count; ++i)
+  for (int lod_level = 0; lod_level < noggit::liquid_lod_indices::lod_count; ++lod_level)
   {
-    opengl::scoped::buffer_binder<GL_ELEMENT_ARRAY_BUFFER> const index_buffer (_index_buffer[i]);
-    gl.bufferData (GL_ELEMENT_ARRAY_BUFFER, _indices_by_lod[i].size() * sizeof (uint16_t), _indices_by_lod[i].data(), GL_STATIC_DRAW);
+    _ranges_by_lod[lod_level] = noggit::liquid_lod_indices::ranges(_subchunks, lod_level);
   }
-
-  gl.bufferData<GL_ARRAY_BUFFER>(_vertices_vbo, sizeof(*_vertices.data()) * _vertices.size(), _vertices.data(), GL_STATIC_DRAW);
-  gl.bufferData<GL_ARRAY_BUFFER>(_depth_vbo, sizeof(*_depth.data()) * _depth.size(), _depth.data(), GL_STATIC_DRAW);
-  gl.bufferData<GL_ARRAY_BUFFER>(_tex_coord_vbo, sizeof(*_tex_coords.data()) * _tex_coords.size(), _tex_coords.data(), GL_STATIC_DRAW);
-
-  _need_buffer_update = false;
-  _vao_need_update = true;
-}
-
-void liquid_layer::update_vao(opengl::scoped::vao_binder const& bound_vao, opengl::scoped::use_program& water_shader)
-{
-  water_shader.attrib(bound_vao, "position", _vertices_vbo, 3, GL_FLOAT, GL_FALSE, 0, 0);
-  water_shader.attrib(bound_vao, "depth", _depth_vbo, 1, GL_FLOAT, GL_FALSE, 0, 0);
-  water_shader.attrib(bound_vao, "tex_coord", _tex_coord_vbo, 2, GL_FLOAT, GL_FALSE, 0, 0);
-
-  _vao_need_update = false;
-}
-
-void liquid_layer::draw ( liquid_render& render
-                        , opengl::scoped::use_program& water_shader
-                        , math::vector_3d const& camera
-                        , bool camera_moved
-                        , int animtime
-                        )
-{
-  bool lod_changed = false;
-
-  if (!_uploaded)
-  {
-    upload();
-    lod_changed = true;
-    set_lod_level(get_lod_level(camera));
-  }
-
-  if (_need_buffer_update)
-  {
-    update_buffers();
-  }
-
-  opengl::scoped::vao_binder const _ (_vao);
-
-  if (_vao_need_update)
-  {
-    update_vao(_, water_shader);
-    set_lod_level(get_lod_level(camera));
-  }
-
-  if (camera_moved)
-  {
-    int new_lod = get_lod_level(camera);
-
-    if (new_lod != _current_lod_level)
-    {
-      lod_changed = true;
-      set_lod_level(new_lod);
-    }
-  }
-
-  render.prepare_draw (water_shader, _liquid_id, animtime);
-
-  if (lod_changed)
-  {
-    gl.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, _index_buffer[_current_lod_level]);
-  }
-  
-  gl.drawElements (GL_TRIANGLES, _current_lod_indices_count, GL_UNSIGNED_SHORT, opengl::index_buffer_is_already_bound{});
 }
 
 void liquid_layer::crop(MapChunk* chunk)
@@ -677,9 +406,3 @@ int liquid_layer::get_lod_level(math::vector_3d const& camera_pos) const
        : dist < 4000.f ? 2
        : 3;
 }
-
-void liquid_layer::set_lod_level(int lod_level)
-{
-  _current_lod_level = lod_level;
-  _current_lod_indices_count = _indices_by_lod[lod_level].size();
-}
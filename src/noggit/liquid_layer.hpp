@@ -3,11 +3,17 @@
 #pragma once
 
 #include <math/trig.hpp>
+#include <math/vector_2d.hpp>
+#include <math/vector_3d.hpp>
 #include <noggit/MapHeaders.h>
-#include <noggit/liquid_render.hpp>
-#include <opengl/scoped.hpp>
+#include <noggit/liquid_draw_list.hpp>
+
+#include <array>
+#include <cstdint>
+#include <vector>
 
 class MapChunk;
+class MPQFile;
 class sExtendableArray;
 
 
@@ -20,21 +26,23 @@ public:
   liquid_layer(math::vector_3d const& base, mclq& liquid, int liquid_id);
   liquid_layer(MPQFile &f, std::size_t base_pos, math::vector_3d const& base, MH2O_Information const& info, std::uint64_t infomask);
 
-  liquid_layer(liquid_layer const& other);
-  liquid_layer (liquid_layer&&);
+  liquid_layer(liquid_layer const& other) = default;
+  liquid_layer (liquid_layer&&) = default;
 
-  liquid_layer& operator=(liquid_layer&&);
-  liquid_layer& operator=(liquid_layer const& other);
+  liquid_layer& operator=(liquid_layer&&) = default;
+  liquid_layer& operator=(liquid_layer const& other) = default;
 
+  //! bytes written by save after the MH2O_Information
+  std::size_t save_size() const;
   void save(sExtendableArray& adt, int base_pos, int& info_pos, int& current_pos) const;
 
-  void draw ( liquid_render& render
-            , opengl::scoped::use_program& water_shader
-            , math::vector_3d const& camera
-            , bool camera_moved
-            , int animtime
-            );
+  //! the liquid_lod_indices ranges of each lod level covering its subchunks
   void update_indices();
+  std::vector<noggit::liquid_lod_indices::range> const& lod_ranges(int lod_level) const
+  {
+    return _ranges_by_lod[lod_level];
+  }
+  int get_lod_level(math::vector_3d const& camera_pos) const;
   void changeLiquidID(int id);
 
   void crop(MapChunk* chunk);
@@ -45,6 +53,11 @@ public:
   float max() const { return _maximum; }
   int liquidID() const { return _liquid_id; }
 
+  //! the 9 * 9 vertices, row by row
+  std::vector<math::vector_3d> const& vertices() const { return _vertices; }
+  std::vector<float> const& depth() const { return _depth; }
+  std::vector<math::vector_2d> const& tex_coords() const { return _tex_coords; }
+
   bool hasSubchunk(int x, int z, int size = 1) const;
   void setSubchunk(int x, int z, bool water);
 
@@ -67,23 +80,10 @@ public:
   void copy_subchunk_height(int x, int z, liquid_layer const& from);
 
 private:
+  //! mask is only set if the layer doesn't cover every subchunk
+  MH2O_Information save_info(std::uint64_t& mask) const;
   void update_min_max();
   void update_vertex_opacity(int x, int z, MapChunk* chunk, float factor);
-  int get_lod_level(math::vector_3d const& camera_pos) const;
-  void set_lod_level(int lod_level);
-
-  static int const lod_count = 4;
-
-  int _current_lod_level = -1;
-  int _current_lod_indices_count = 0;
-
-  opengl::scoped::deferred_upload_buffers<lod_count> _index_buffer;
-  opengl::scoped::deferred_upload_buffers<3> _buffers;
-  GLuint const& _vertices_vbo = _buffers[0];
-  GLuint const& _depth_vbo = _buffers[1];
-  GLuint const& _tex_coord_vbo = _buffers[2];
-  opengl::scoped::deferred_upload_vertex_arrays<1> _vertex_array;
-  GLuint const& _vao = _vertex_array[0];
 
   int _liquid_id;
   int _liquid_vertex_format;
@@ -93,16 +93,7 @@ private:
   std::vector<math::vector_3d> _vertices;
   std::vector<float> _depth;
   std::vector<math::vector_2d> _tex_coords;
-  std::map<int, std::vector<std::uint16_t>> _indices_by_lod;
-
-  bool _need_buffer_update = true;
-  bool _vao_need_update = true;
-  bool _uploaded = false;
+  std::array<std::vector<noggit::liquid_lod_indices::range>, noggit::liquid_lod_indices::lod_count> _ranges_by_lod;
 
-  void upload();
-  void update_buffers();
-  void update_vao(opengl::scoped::vao_binder const& bound_vao, opengl::scoped::use_program& water_shader);
-
-private:
   math::vector_3d pos;
 };
@@ -1,7 +1,9 @@
 // This file is part of Noggit3, licensed under GNU General Public License (version 3).
 
 #include <noggit/DBC.h>
+#include <noggit/liquid_draw_list.hpp>
 #include <noggit/liquid_layer.hpp>
+#include <noggit/liquid_render.hpp>
 #include <noggit/Log.h>
 #include <noggit/TextureManager.h> // TextureManager, Texture
 #include <noggit/World.h>
@@ -61,6 +63,27 @@ void liquid_render::force_texture_update()
   _current_liquid_id.reset();
 }
 
+GLuint liquid_render::lod_indices()
+{
+  if (!_lod_indices_uploaded)
+  {
+    _lod_indices_buffer.upload();
+
+    std::vector<noggit::liquid_lod_indices::index_type> const indices (noggit::liquid_lod_indices::indices());
+
+    // not through GL_ELEMENT_ARRAY_BUFFER, which belongs to the bound vao
+    gl.bufferData<GL_ARRAY_BUFFER> ( _lod_indices_buffer[0]
+                                   , indices.size() * sizeof (indices[0])
+                                   , indices.data()
+                                   , GL_STATIC_DRAW
+                                   );
+
+    _lod_indices_uploaded = true;
+  }
+
+  return _lod_indices_buffer[0];
+}
+
 std::size_t liquid_render::get_texture_index(int liquid_id, int animtime) const
 {
   return static_cast<std::size_t> (animtime / 60) % _textures_by_liquid_id.at(liquid_id).size();
@@ -77,14 +100,14 @@ void liquid_render::add_liquid_id(int liquid_id)
   {
     DBCFile::Record lLiquidTypeRow = gLiquidTypeDB.getByID(liquid_id);
 
-    _liquid_id_types[liquid_id] = lLiquidTypeRow.getInt(LiquidTypeDB::Type);
+    _liquid_id_types[liquid_id] = lLiquidTypeRow.get<LiquidTypeDB::Type>();
     _float_param_by_liquid_id[liquid_id] = 
-      math::vector_2d( lLiquidTypeRow.getFloat(LiquidTypeDB::AnimationX)
-                     , lLiquidTypeRow.getFloat(LiquidTypeDB::AnimationY)
+      math::vector_2d( lLiquidTypeRow.get<LiquidTypeDB::AnimationX>()
+                     , lLiquidTypeRow.get<LiquidTypeDB::AnimationY>()
                      );
 
     // fix to now crash when using procedural water (id 100)
-    if (lLiquidTypeRow.getInt(LiquidTypeDB::ShaderType) == 3)
+    if (lLiquidTypeRow.get<LiquidTypeDB::ShaderType>() == 3)
     {
       filename = "XTextures\\river\\lake_a.%d.blp";
       // default param for water
@@ -92,7 +115,7 @@ void liquid_render::add_liquid_id(int liquid_id)
     }
     else
     {
-      filename = lLiquidTypeRow.getString(LiquidTypeDB::TextureFilenames);
+      filename = lLiquidTypeRow.get<LiquidTypeDB::TextureFilenames>();
     }
   }
   catch (...)
@@ -5,6 +5,7 @@
 
 #include <noggit/MPQ.h>
 #include <noggit/TextureManager.h>
+#include <opengl/scoped.hpp>
 #include <opengl/shader.hpp>
 
 #include <string>
@@ -26,6 +27,9 @@ public:
   }
 
   void force_texture_update();
+
+  //! the buffer of noggit::liquid_lod_indices, shared by every tile
+  GLuint lod_indices();
   std::size_t get_texture_index(int liquid_id, int animtime) const;
 
 private:
@@ -34,6 +38,9 @@ private:
   boost::optional<int> _current_liquid_id;
   int _current_anim_time = 0;
 
+  opengl::scoped::deferred_upload_buffers<1> _lod_indices_buffer;
+  bool _lod_indices_uploaded = false;
+
   opengl::program program
     { { GL_VERTEX_SHADER,   opengl::shader::src_from_qrc("liquid_vs") }
     , { GL_FRAGMENT_SHADER, opengl::shader::src_from_qrc("liquid_fs") }
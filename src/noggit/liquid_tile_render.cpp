@@ -0,0 +1,123 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/liquid_layer.hpp>
+#include <noggit/liquid_tile_render.hpp>
+#include <opengl/context.hpp>
+#include <opengl/scoped.hpp>
+#include <opengl/shader.hpp>
+
+#include <algorithm>
+
+namespace noggit
+{
+  namespace
+  {
+    std::size_t const vertices_per_slot (liquid_lod_indices::vertices_per_layer);
+  }
+
+  void liquid_tile_render::upload (opengl::scoped::use_program& water_shader, GLuint lod_indices)
+  {
+    _vertex_array.upload();
+    _buffers.upload();
+
+    opengl::scoped::vao_binder const _ (_vao);
+
+    water_shader.attrib (_, "position", _vertices_vbo, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    water_shader.attrib (_, "depth", _depth_vbo, 1, GL_FLOAT, GL_FALSE, 0, 0);
+    water_shader.attrib (_, "tex_coord", _tex_coord_vbo, 2, GL_FLOAT, GL_FALSE, 0, 0);
+
+    // the shared index buffer stays bound to the vao
+    gl.bindBuffer (GL_ELEMENT_ARRAY_BUFFER, lod_indices);
+
+    _uploaded = true;
+  }
+
+  void liquid_tile_render::set_layer_count (std::size_t chunk, std::size_t count)
+  {
+    std::vector<std::size_t>& chunk_slots (_chunk_slots[chunk]);
+
+    while (chunk_slots.size() > count)
+    {
+      _free_slots.emplace_back (chunk_slots.back());
+      chunk_slots.pop_back();
+    }
+
+    while (chunk_slots.size() < count)
+    {
+      if (_free_slots.empty())
+      {
+        chunk_slots.emplace_back (_slot_count++);
+      }
+      else
+      {
+        chunk_slots.emplace_back (_free_slots.back());
+        _free_slots.pop_back();
+      }
+    }
+  }
+
+  bool liquid_tile_render::reserve()
+  {
+    if (_slot_count <= _slot_capacity)
+    {
+      return false;
+    }
+
+    // most tiles have a layer in some chunks only, a few have several
+    _slot_capacity = std::max<std::size_t> (16, _slot_capacity);
+    while (_slot_capacity < _slot_count)
+    {
+      _slot_capacity *= 2;
+    }
+
+    std::size_t const vertices (_slot_capacity * vertices_per_slot);
+
+    gl.bufferData<GL_ARRAY_BUFFER> (_vertices_vbo, vertices * sizeof (math::vector_3d), nullptr, GL_STATIC_DRAW);
+    gl.bufferData<GL_ARRAY_BUFFER> (_depth_vbo, vertices * sizeof (float), nullptr, GL_STATIC_DRAW);
+    gl.bufferData<GL_ARRAY_BUFFER> (_tex_coord_vbo, vertices * sizeof (math::vector_2d), nullptr, GL_STATIC_DRAW);
+
+    return true;
+  }
+
+  void liquid_tile_render::set_vertices (std::size_t slot, liquid_layer const& layer)
+  {
+    std::size_t const first (slot * vertices_per_slot);
+
+    gl.bufferSubData<GL_ARRAY_BUFFER> ( _vertices_vbo
+                                      , first * sizeof (math::vector_3d)
+                                      , vertices_per_slot * sizeof (math::vector_3d)
+                                      , layer.vertices().data()
+                                      );
+    gl.bufferSubData<GL_ARRAY_BUFFER> ( _depth_vbo
+                                      , first * sizeof (float)
+                                      , vertices_per_slot * sizeof (float)
+                                      , layer.depth().data()
+                                      );
+    gl.bufferSubData<GL_ARRAY_BUFFER> ( _tex_coord_vbo
+                                      , first * sizeof (math::vector_2d)
+                                      , vertices_per_slot * sizeof (math::vector_2d)
+                                      , layer.tex_coords().data()
+                                      );
+  }
+
+  void liquid_tile_render::draw ( liquid_draw_list const& draw_list
+                                , std::function<void (int liquid_id)> const& prepare
+                                )
+  {
+    opengl::scoped::vao_binder const _ (_vao);
+
+    for (liquid_draw_list::batch const& batch : draw_list.batches())
+    {
+      prepare (batch.liquid_id);
+
+      gl.multiDrawElementsBaseVertex ( GL_TRIANGLES
+                                     , draw_list.counts().data() + batch.first
+                                     , GL_UNSIGNED_SHORT
+                                     , opengl::index_buffer_is_already_bound{}
+                                     , draw_list.index_offsets().data() + batch.first
+                                     , batch.count
+                                     , draw_list.base_vertices().data() + batch.first
+                                     );
+    }
+  }
+}
@@ -0,0 +1,59 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <noggit/liquid_draw_list.hpp>
+#include <opengl/scoped.hpp>
+#include <opengl/shader.fwd.hpp>
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+class liquid_layer;
+
+namespace noggit
+{
+  //! The GL objects of a tile's liquids: the layers of its chunks have
+  //! their vertices in slots of the same vertex buffers and are drawn with
+  //! the liquid_lod_indices shared by every tile, with a multi draw per
+  //! liquid_draw_list batch.
+  class liquid_tile_render
+  {
+  public:
+    bool uploaded() const { return _uploaded; }
+    //! lod_indices is the buffer holding liquid_lod_indices::indices()
+    void upload (opengl::scoped::use_program& water_shader, GLuint lod_indices);
+
+    //! gives a chunk slots for count layers, keeping the ones it had
+    void set_layer_count (std::size_t chunk, std::size_t count);
+    //! grows the vertex buffers if set_layer_count ran out of room. They
+    //! lose what they held then, and true is returned.
+    bool reserve();
+
+    std::size_t slot (std::size_t chunk, std::size_t layer) const { return _chunk_slots[chunk][layer]; }
+    void set_vertices (std::size_t slot, liquid_layer const& layer);
+
+    //! prepare sets up the shader for the liquid of a batch
+    void draw ( liquid_draw_list const&
+              , std::function<void (int liquid_id)> const& prepare
+              );
+
+  private:
+    bool _uploaded = false;
+
+    opengl::scoped::deferred_upload_vertex_arrays<1> _vertex_array;
+    GLuint const& _vao = _vertex_array[0];
+    opengl::scoped::deferred_upload_buffers<3> _buffers;
+    GLuint const& _vertices_vbo = _buffers[0];
+    GLuint const& _depth_vbo = _buffers[1];
+    GLuint const& _tex_coord_vbo = _buffers[2];
+
+    std::array<std::vector<std::size_t>, 16 * 16> _chunk_slots;
+    std::vector<std::size_t> _free_slots;
+    //! given to the chunks, and the room for them in the buffers
+    std::size_t _slot_count = 0;
+    std::size_t _slot_capacity = 0;
+  };
+}
@@ -0,0 +1,301 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/listfile_cache.hpp>
+
+#include <noggit/Log.h>
+#include <noggit/MPQ.h>
+
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace noggit
+{
+  namespace mpq
+  {
+    namespace
+    {
+      char const magic[4] = {'N', 'L', 'F', 'C'};
+
+      //! bounds checked reading of the mapped cache file
+      struct reader
+      {
+        char const* pos;
+        char const* end;
+
+        template<typename T>
+          bool read (T& value)
+        {
+          if (std::size_t (end - pos) < sizeof (T))
+          {
+            return false;
+          }
+          std::memcpy (&value, pos, sizeof (T));
+          pos += sizeof (T);
+          return true;
+        }
+
+        bool skip (std::size_t size, char const** begin)
+        {
+          if (std::size_t (end - pos) < size)
+          {
+            return false;
+          }
+          *begin = pos;
+          pos += size;
+          return true;
+        }
+      };
+
+      template<typename T>
+        void write (std::ostream& stream, T const& value)
+      {
+        stream.write (reinterpret_cast<char const*> (&value), sizeof (T));
+      }
+    }
+
+    std::vector<std::string> tokenize_listfile (char const* data, std::size_t size)
+    {
+      std::vector<std::string> names;
+      names.reserve (size / 48);
+
+      char const* const end (data + size);
+      while (data < end)
+      {
+        char const* line_end (std::find (data, end, '\n'));
+        char const* name_end (line_end);
+
+        if (name_end != data && *(name_end - 1) == '\r')
+        {
+          --name_end;
+        }
+
+        if (name_end != data)
+        {
+          names.emplace_back (normalized_filename (std::string (data, name_end)));
+        }
+
+        data = line_end == end ? end : line_end + 1;
+      }
+
+      return names;
+    }
+
+    listfile_cache::listfile_cache (boost::filesystem::path file)
+      : _file (std::move (file))
+    {
+      read();
+    }
+
+    listfile_cache::~listfile_cache() = default;
+
+    void listfile_cache::read()
+    {
+      boost::system::error_code ec;
+      if (boost::filesystem::file_size (_file, ec) == 0 || ec)
+      {
+        return;
+      }
+
+      try
+      {
+        boost::interprocess::file_mapping const file
+          (_file.string().c_str(), boost::interprocess::read_only);
+        _mapping = std::make_unique<boost::interprocess::mapped_region>
+          (file, boost::interprocess::read_only);
+      }
+      catch (boost::interprocess::interprocess_exception const& e)
+      {
+        LogError << "Could not map listfile cache " << _file << ": " << e.what() << std::endl;
+        return;
+      }
+
+      char const* const data (static_cast<char const*> (_mapping->get_address()));
+      reader in {data, data + _mapping->get_size()};
+
+      char file_magic[4];
+      std::uint32_t file_version;
+      std::uint32_t archive_count;
+
+      if ( !in.read (file_magic) || std::memcmp (file_magic, magic, sizeof (magic))
+        || !in.read (file_version) || file_version != version
+        || !in.read (archive_count)
+         )
+      {
+        LogDebug << "Ignoring outdated listfile cache " << _file << std::endl;
+        _mapping.reset();
+        return;
+      }
+
+      for (std::uint32_t i (0); i < archive_count; ++i)
+      {
+        std::uint32_t path_size;
+        char const* path;
+        mapped_entry entry;
+        std::uint64_t names_size;
+
+        if ( !in.read (path_size) || !in.skip (path_size, &path)
+          || !in.read (entry.key.size) || !in.read (entry.key.mtime)
+          || !in.read (entry.name_count)
+          || !in.read (names_size) || !in.skip (names_size, &entry.names)
+           )
+        {
+          LogError << "Listfile cache " << _file << " is truncated, ignoring it" << std::endl;
+          _mapped_entries.clear();
+          _mapping.reset();
+          return;
+        }
+
+        entry.names_size = names_size;
+        _mapped_entries.emplace (std::string (path, path_size), entry);
+      }
+
+      LogDebug << "Loaded listfile cache of " << _mapped_entries.size() << " archives" << std::endl;
+    }
+
+    boost::optional<listfile_cache::archive_key> listfile_cache::key_of (std::string const& archive_path)
+    {
+      boost::system::error_code ec;
+      auto const size (boost::filesystem::file_size (archive_path, ec));
+      if (ec)
+      {
+        return boost::none;
+      }
+      auto const mtime (boost::filesystem::last_write_time (archive_path, ec));
+      if (ec)
+      {
+        return boost::none;
+      }
+      return archive_key {size, static_cast<std::int64_t> (mtime)};
+    }
+
+    boost::optional<std::vector<std::string>> listfile_cache::listfile (std::string const& archive_path)
+    {
+      auto const key (key_of (archive_path));
+      if (!key)
+      {
+        return boost::none;
+      }
+
+      std::lock_guard<std::mutex> const lock (_mutex);
+
+      auto const it (_mapped_entries.find (archive_path));
+      if ( it == _mapped_entries.end()
+        || it->second.key.size != key->size
+        || it->second.key.mtime != key->mtime
+         )
+      {
+        return boost::none;
+      }
+
+      mapped_entry const& entry (it->second);
+
+      std::vector<std::string> names;
+      names.reserve (entry.name_count);
+
+      char const* pos (entry.names);
+      char const* const end (entry.names + entry.names_size);
+      while (pos < end)
+      {
+        char const* name_end (std::find (pos, end, '\n'));
+        names.emplace_back (pos, name_end);
+        pos = name_end + 1;
+      }
+
+      // keep it for the next save
+      _entries[archive_path] = { entry.key
+                               , entry.name_count
+                               , std::string (entry.names, entry.names_size)
+                               };
+
+      return names;
+    }
+
+    void listfile_cache::store (std::string const& archive_path, std::vector<std::string> const& names)
+    {
+      auto const key (key_of (archive_path));
+      if (!key)
+      {
+        return;
+      }
+
+      pending_entry entry {*key, static_cast<std::uint32_t> (names.size()), {}};
+      for (auto const& name : names)
+      {
+        entry.names += name;
+        entry.names += '\n';
+      }
+      if (!entry.names.empty())
+      {
+        entry.names.pop_back();
+      }
+
+      std::lock_guard<std::mutex> const lock (_mutex);
+      _entries[archive_path] = std::move (entry);
+      _changed = true;
+    }
+
+    void listfile_cache::save()
+    {
+      std::lock_guard<std::mutex> const lock (_mutex);
+
+      if (!_changed)
+      {
+        return;
+      }
+
+      // the file can't be replaced while it is mapped (on windows)
+      _mapped_entries.clear();
+      _mapping.reset();
+
+      boost::system::error_code ec;
+      boost::filesystem::create_directories (_file.parent_path(), ec);
+
+      boost::filesystem::path const temporary (_file.string() + ".tmp");
+
+      {
+        std::ofstream output (temporary.string(), std::ios_base::binary | std::ios_base::out | std::ios_base::trunc);
+        if (!output.is_open())
+        {
+          LogError << "Could not write listfile cache " << temporary << std::endl;
+          return;
+        }
+
+        output.write (magic, sizeof (magic));
+        write (output, version);
+        write (output, static_cast<std::uint32_t> (_entries.size()));
+
+        for (auto const& archive : _entries)
+        {
+          write (output, static_cast<std::uint32_t> (archive.first.size()));
+          output.write (archive.first.data(), archive.first.size());
+          write (output, archive.second.key.size);
+          write (output, archive.second.key.mtime);
+          write (output, archive.second.name_count);
+          write (output, static_cast<std::uint64_t> (archive.second.names.size()));
+          output.write (archive.second.names.data(), archive.second.names.size());
+        }
+
+        if (!output)
+        {
+          LogError << "Could not write listfile cache " << temporary << std::endl;
+          return;
+        }
+      }
+
+      boost::filesystem::rename (temporary, _file, ec);
+      if (ec)
+      {
+        LogError << "Could not replace listfile cache " << _file << ": " << ec.message() << std::endl;
+        return;
+      }
+
+      _changed = false;
+      LogDebug << "Saved listfile cache of " << _entries.size() << " archives" << std::endl;
+    }
+  }
+}
@@ -0,0 +1,90 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <boost/filesystem/path.hpp>
+#include <boost/optional.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace boost
+{
+  namespace interprocess
+  {
+    class mapped_region;
+  }
+}
+
+namespace noggit
+{
+  namespace mpq
+  {
+    //! split a (listfile) into normalized filenames
+    std::vector<std::string> tokenize_listfile (char const* data, std::size_t size);
+
+    //! Normalized listfile content of each archive, persisted between
+    //! runs. An archive's entry is only used if its path, size and
+    //! modification time still match.
+    class listfile_cache
+    {
+    public:
+      static constexpr std::uint32_t version = 1;
+
+      //! maps the cache file if it exists and has the current version
+      listfile_cache (boost::filesystem::path file);
+      ~listfile_cache();
+
+      listfile_cache (listfile_cache const&) = delete;
+      listfile_cache& operator= (listfile_cache const&) = delete;
+
+      boost::optional<std::vector<std::string>> listfile (std::string const& archive_path);
+      void store (std::string const& archive_path, std::vector<std::string> const& names);
+
+      //! rewrite the file if any archive's entry was stored since opening.
+      //! Entries of archives neither looked up nor stored are dropped.
+      void save();
+
+    private:
+      struct archive_key
+      {
+        std::uint64_t size;
+        std::int64_t mtime;
+      };
+
+      //! points into the mapped file, names are separated by '\n'
+      struct mapped_entry
+      {
+        archive_key key;
+        std::uint32_t name_count;
+        char const* names;
+        std::size_t names_size;
+      };
+
+      struct pending_entry
+      {
+        archive_key key;
+        std::uint32_t name_count;
+        std::string names;
+      };
+
+      static boost::optional<archive_key> key_of (std::string const& archive_path);
+      void read();
+
+      boost::filesystem::path const _file;
+
+      std::mutex _mutex;
+      std::unique_ptr<boost::interprocess::mapped_region> _mapping;
+      std::unordered_map<std::string, mapped_entry> _mapped_entries;
+
+      //! what is going to be written by save()
+      std::unordered_map<std::string, pending_entry> _entries;
+      bool _changed = false;
+    };
+  }
+}
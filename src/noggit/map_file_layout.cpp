@@ -0,0 +1,250 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/map_file_layout.hpp>
+#include <noggit/Misc.h>
+
+#include <algorithm>
+#include <cassert>
+
+namespace noggit
+{
+  namespace
+  {
+    // the vertices of a chunk's MCVT, MCCV and MCNR
+    std::size_t const vertices_per_chunk (9 * 9 + 8 * 8);
+  }
+
+  namespace mh2o
+  {
+    MH2O_Information layer_info (std::uint64_t subchunks, std::uint64_t& mask)
+    {
+      auto const has_subchunk
+        ( [&] (int x, int z)
+          {
+            return (subchunks >> (z * 8 + x)) & 1;
+          }
+        );
+
+      int min_x = 9, min_z = 9, max_x = 0, max_z = 0;
+      bool filled = true;
+
+      for (int z = 0; z < 8; ++z)
+      {
+        for (int x = 0; x < 8; ++x)
+        {
+          if (has_subchunk (x, z))
+          {
+            min_x = std::min (x, min_x);
+            min_z = std::min (z, min_z);
+            max_x = std::max (x + 1, max_x);
+            max_z = std::max (z + 1, max_z);
+          }
+          else
+          {
+            filled = false;
+          }
+        }
+      }
+
+      MH2O_Information info;
+      mask = 0;
+
+      info.xOffset = min_x;
+      info.yOffset = min_z;
+      info.width = max_x - min_x;
+      info.height = max_z - min_z;
+
+      if (!filled)
+      {
+        std::uint64_t value = 1;
+        for (int z = info.yOffset; z < info.yOffset + info.height; ++z)
+        {
+          for (int x = info.xOffset; x < info.xOffset + info.width; ++x)
+          {
+            if (has_subchunk (x, z))
+            {
+              mask |= value;
+            }
+            value <<= 1;
+          }
+        }
+      }
+
+      return info;
+    }
+
+    std::size_t layer_size (MH2O_Information const& info, std::uint64_t mask)
+    {
+      std::size_t const vertices_count = (info.width + 1) * (info.height + 1);
+      std::size_t size = mask > 0 ? sizeof (std::uint64_t) : 0;
+
+      if (info.liquid_vertex_format == 0 || info.liquid_vertex_format == 1)
+      {
+        size += vertices_count * sizeof (float);
+      }
+      if (info.liquid_vertex_format == 1)
+      {
+        size += vertices_count * sizeof (mh2o_uv);
+      }
+      if (info.liquid_vertex_format == 0 || info.liquid_vertex_format == 2)
+      {
+        size += vertices_count * sizeof (std::uint8_t);
+      }
+
+      return size;
+    }
+
+    void write_layer ( sExtendableArray& adt
+                     , int base_pos
+                     , int& info_pos
+                     , int& current_pos
+                     , MH2O_Information info
+                     , std::uint64_t mask
+                     , std::vector<math::vector_3d> const& vertices
+                     , std::vector<float> const& depth
+                     , std::vector<math::vector_2d> const& tex_coords
+                     )
+    {
+      if (mask > 0)
+      {
+        info.ofsInfoMask = current_pos - base_pos;
+        adt.Write (current_pos, 8, reinterpret_cast<char const*> (&mask));
+        current_pos += 8;
+      }
+
+      info.ofsHeightMap = current_pos - base_pos;
+
+      if (info.liquid_vertex_format == 0 || info.liquid_vertex_format == 1)
+      {
+        for (int z = info.yOffset; z <= info.yOffset + info.height; ++z)
+        {
+          for (int x = info.xOffset; x <= info.xOffset + info.width; ++x)
+          {
+            adt.Write (current_pos, sizeof (float), reinterpret_cast<char const*> (&vertices[z * 9 + x].y));
+            current_pos += sizeof (float);
+          }
+        }
+      }
+
+      if (info.liquid_vertex_format == 1)
+      {
+        for (int z = info.yOffset; z <= info.yOffset + info.height; ++z)
+        {
+          for (int x = info.xOffset; x <= info.xOffset + info.width; ++x)
+          {
+            mh2o_uv uv;
+            uv.x = static_cast<std::uint16_t> (std::min (tex_coords[z * 9 + x].x * 255.f, 65535.f));
+            uv.y = static_cast<std::uint16_t> (std::min (tex_coords[z * 9 + x].y * 255.f, 65535.f));
+
+            adt.Write (current_pos, sizeof (mh2o_uv), reinterpret_cast<char const*> (&uv));
+            current_pos += sizeof (mh2o_uv);
+          }
+        }
+      }
+
+      if (info.liquid_vertex_format == 0 || info.liquid_vertex_format == 2)
+      {
+        for (int z = info.yOffset; z <= info.yOffset + info.height; ++z)
+        {
+          for (int x = info.xOffset; x <= info.xOffset + info.width; ++x)
+          {
+            std::uint8_t const value = static_cast<std::uint8_t> (std::min (depth[z * 9 + x] * 255.0f, 255.f));
+            adt.Write (current_pos, sizeof (std::uint8_t), reinterpret_cast<char const*> (&value));
+            current_pos += sizeof (std::uint8_t);
+          }
+        }
+      }
+
+      adt.Write (info_pos, sizeof (MH2O_Information), reinterpret_cast<char const*> (&info));
+      info_pos += sizeof (MH2O_Information);
+    }
+  }
+
+  std::size_t mcnk_size (mcnk_layout const& layout)
+  {
+    return 8 + 0x80                                                             // MCNK
+         + 8 + vertices_per_chunk * 4                                           // MCVT
+         + (layout.has_mccv ? 8 + vertices_per_chunk * sizeof (unsigned int) : 0) // MCCV
+         + 8 + vertices_per_chunk * 3 + 13                                      // MCNR
+         + 8 + layout.texture_layers * 0x10                                     // MCLY
+         + 8 + 4 * layout.references                                            // MCRF
+         + (layout.has_shadow_map ? 8 + 0x200 : 0)                              // MCSH
+         + 8 + layout.alphamaps_size                                            // MCAL
+         + 8;                                                                   // MCSE
+  }
+
+  std::size_t adt_size (adt_layout const& layout)
+  {
+    return 8 + 0x4                                      // MVER
+         + 8 + 0x40                                     // MHDR
+         + 8 + 256 * 0x10                               // MCIN
+         + 8 + layout.textures_size                     // MTEX
+         + 8 + layout.models_size                       // MMDX
+         + 8 + 4 * layout.model_count                   // MMID
+         + 8 + layout.objects_size                      // MWMO
+         + 8 + 4 * layout.object_count                  // MWID
+         + 8 + 0x24 * layout.model_instances            // MDDF
+         + 8 + 0x40 * layout.object_instances           // MODF
+         + layout.mh2o_size                             // MH2O
+         + layout.chunks_size                           // MCNK
+         + (layout.has_mfbo ? 8 + 2 * 9 * 2 : 0);       // MFBO
+  }
+
+  std::vector<char> write_wdt ( MPHD const& header
+                              , std::vector<std::uint32_t> const& tile_flags
+                              , boost::optional<wdt_global_wmo> const& global_wmo
+                              )
+  {
+    assert (tile_flags.size() == 64 * 64);
+
+    std::size_t const size = 8 + 0x4
+                           + 8 + sizeof (MPHD)
+                           + 8 + 64 * 64 * 8
+                           + (global_wmo ? 8 + global_wmo->name.size() + 8 + sizeof (ENTRY_MODF) : 0);
+
+    sExtendableArray wdt;
+    wdt.Allocate (size);
+    int position = 0;
+
+    // MVER
+    SetChunkHeader (wdt, position, 'MVER', 4);
+    *(wdt.GetPointer<int> (position + 8)) = 18;
+    position += 8 + 0x4;
+
+    // MPHD
+    SetChunkHeader (wdt, position, 'MPHD', sizeof (MPHD));
+    position += 8;
+    wdt.Write (position, sizeof (MPHD), reinterpret_cast<char const*> (&header));
+    position += sizeof (MPHD);
+
+    // MAIN
+    SetChunkHeader (wdt, position, 'MAIN', 64 * 64 * 8);
+    position += 8;
+
+    for (std::uint32_t const& flags : tile_flags)
+    {
+      // flags followed by 4 unused bytes
+      wdt.Write (position, 4, reinterpret_cast<char const*> (&flags));
+      position += 8;
+    }
+
+    if (global_wmo)
+    {
+      // MWMO
+      SetChunkHeader (wdt, position, 'MWMO', global_wmo->name.size());
+      position += 8;
+      wdt.Write (position, global_wmo->name.size(), global_wmo->name.data());
+      position += global_wmo->name.size();
+
+      // MODF
+      SetChunkHeader (wdt, position, 'MODF', sizeof (ENTRY_MODF));
+      position += 8;
+      wdt.Write (position, sizeof (ENTRY_MODF), reinterpret_cast<char const*> (&global_wmo->entry));
+      position += sizeof (ENTRY_MODF);
+    }
+
+    assert (position == static_cast<int> (wdt.data.size()));
+
+    return std::move (wdt.data);
+  }
+}
@@ -0,0 +1,88 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <math/vector_2d.hpp>
+#include <math/vector_3d.hpp>
+#include <noggit/MapHeaders.h>
+
+#include <boost/optional.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class sExtendableArray;
+
+namespace noggit
+{
+  //! The sizes and layouts of the ADT and WDT chunks, apart from the tiles
+  //! and chunks they are saved from, so that the writers can allocate the
+  //! file once and write it front to back.
+  namespace mh2o
+  {
+    //! the bounds of the subchunks of a layer, a bit per subchunk. mask is
+    //! the info mask to write, 0 if the layer fills its bounds.
+    MH2O_Information layer_info (std::uint64_t subchunks, std::uint64_t& mask);
+    //! bytes written by write_layer after the MH2O_Information
+    std::size_t layer_size (MH2O_Information const& info, std::uint64_t mask);
+    //! vertices, depth and tex_coords are the 9 * 9 of the layer
+    void write_layer ( sExtendableArray& adt
+                     , int base_pos
+                     , int& info_pos
+                     , int& current_pos
+                     , MH2O_Information info
+                     , std::uint64_t mask
+                     , std::vector<math::vector_3d> const& vertices
+                     , std::vector<float> const& depth
+                     , std::vector<math::vector_2d> const& tex_coords
+                     );
+  }
+
+  struct mcnk_layout
+  {
+    bool has_mccv;
+    std::size_t texture_layers;
+    //! doodads and objects in MCRF
+    std::size_t references;
+    bool has_shadow_map;
+    std::size_t alphamaps_size;
+  };
+
+  //! including the MCNK chunk header
+  std::size_t mcnk_size (mcnk_layout const&);
+
+  struct adt_layout
+  {
+    //! of the names with their terminating zero
+    std::size_t textures_size;
+    std::size_t models_size;
+    std::size_t objects_size;
+    //! the MMID and MWID entries
+    std::size_t model_count;
+    std::size_t object_count;
+    //! the MDDF and MODF entries
+    std::size_t model_instances;
+    std::size_t object_instances;
+    //! the whole MH2O chunk, 0 without liquids
+    std::size_t mh2o_size;
+    bool has_mfbo;
+    //! the mcnk_size of the 256 chunks
+    std::size_t chunks_size;
+  };
+
+  std::size_t adt_size (adt_layout const&);
+
+  struct wdt_global_wmo
+  {
+    std::string name;
+    ENTRY_MODF entry;
+  };
+
+  //! tile_flags are the flags of the 64 * 64 tiles, row by row
+  std::vector<char> write_wdt ( MPHD const& header
+                              , std::vector<std::uint32_t> const& tile_flags
+                              , boost::optional<wdt_global_wmo> const& global_wmo
+                              );
+}
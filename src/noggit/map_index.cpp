@@ -10,14 +10,20 @@
 #ifdef USE_MYSQL_UID_STORAGE
   #include <mysql/mysql.h>
 #endif
+#include <noggit/map_file_layout.hpp>
 #include <noggit/map_index.hpp>
 #include <noggit/uid_storage.hpp>
+#include <noggit/worker_pool.hpp>
 
 #include <QtCore/QSettings>
 
+#include <boost/filesystem.hpp>
 #include <boost/range/adaptor/map.hpp>
 
+#include <algorithm>
 #include <forward_list>
+#include <fstream>
+#include <iterator>
 
 MapIndex::MapIndex (const std::string &pBasename, int map_id, World* world)
   : basename(pBasename)
@@ -138,17 +144,19 @@ MapIndex::MapIndex (const std::string &pBasename, int map_id, World* world)
   theFile.close();
 }
 
-void MapIndex::saveall (World* world)
+void MapIndex::saveall (World* world, save_progress const& progress)
 {
   world->wait_for_all_tile_updates();
 
   saveMaxUID();
 
+  std::vector<MapTile*> tiles;
   for (MapTile* tile : loaded_tiles())
   {
-    tile->saveTile(world);
-    tile->changed = false;
+    tiles.push_back(tile);
   }
+
+  save_tiles(world, tiles, progress);
 }
 
 void MapIndex::save()
@@ -158,72 +166,25 @@ void MapIndex::save()
 
   //NOGGIT_LOG << "Saving WDT \"" << filename << "\"." << std::endl;
 
-  sExtendableArray wdtFile = sExtendableArray();
-  int curPos = 0;
-
-  // MVER
-  //  {
-  wdtFile.Extend(8 + 0x4);
-  SetChunkHeader(wdtFile, curPos, 'MVER', 4);
-
-  // MVER data
-  *(wdtFile.GetPointer<int>(8)) = 18;
-
-  curPos += 8 + 0x4;
-  //  }
-
-  // MPHD
-  //  {
-  wdtFile.Extend(8);
-  SetChunkHeader(wdtFile, curPos, 'MPHD', sizeof(MPHD));
-  curPos += 8;
-
-  wdtFile.Insert(curPos, sizeof(MPHD), (char*)&mphd);
-  curPos += sizeof(MPHD);
-  //  }
-
-  // MAIN
-  //  {
-  wdtFile.Extend(8);
-  SetChunkHeader(wdtFile, curPos, 'MAIN', 64 * 64 * 8);
-  curPos += 8;
+  std::vector<std::uint32_t> tile_flags;
+  tile_flags.reserve(64 * 64);
 
   for (int j = 0; j < 64; ++j)
   {
     for (int i = 0; i < 64; ++i)
     {
-      wdtFile.Insert(curPos, 4, (char*)&mTiles[j][i].flags);
-      wdtFile.Extend(4);
-      curPos += 8;
+      tile_flags.push_back(mTiles[j][i].flags);
     }
   }
-  //  }
 
+  boost::optional<noggit::wdt_global_wmo> global_wmo;
   if (mHasAGlobalWMO)
   {
-    // MWMO
-    //  {
-    wdtFile.Extend(8);
-    SetChunkHeader(wdtFile, curPos, 'MWMO', globalWMOName.size());
-    curPos += 8;
-
-    wdtFile.Insert(curPos, globalWMOName.size(), globalWMOName.data());
-    curPos += globalWMOName.size();
-    //  }
-
-    // MODF
-    //  {
-    wdtFile.Extend(8);
-    SetChunkHeader(wdtFile, curPos, 'MODF', sizeof(ENTRY_MODF));
-    curPos += 8;
-
-    wdtFile.Insert(curPos, sizeof(ENTRY_MODF), (char*)&wmoEntry);
-    curPos += sizeof(ENTRY_MODF);
-    //  }
+    global_wmo = noggit::wdt_global_wmo {globalWMOName, wmoEntry};
   }
 
   MPQFile f(filename.str());
-  f.setBuffer(wdtFile.data);
+  f.setBuffer(noggit::write_wdt(mphd, tile_flags, global_wmo));
   f.SaveFile();
   f.close();
 
@@ -242,6 +203,9 @@ void MapIndex::enterTile(const tile_index& tile)
   int cx = tile.x;
   int cz = tile.z;
 
+  // re-rank everything still queued around the new tile
+  AsyncLoader::instance().set_focus ({cx + 0.5f, cz + 0.5f});
+
   for (int pz = std::max(cz - 1, 0); pz < std::min(cz + 2, 63); ++pz)
   {
     for (int px = std::max(cx - 1, 0); px < std::min(cx + 2, 63); ++px)
@@ -371,6 +335,24 @@ void MapIndex::unloadTiles(const tile_index& tile)
       }
     }
 
+    // drop the tiles left behind before they even got loaded
+    for (std::size_t z = 0; z < 64; ++z)
+    {
+      for (std::size_t x = 0; x < 64; ++x)
+      {
+        tile_index const index (x, z);
+
+        if ( tileAwaitingLoading (index)
+          && tile.dist (index) > _unload_dist
+          && AsyncLoader::instance().try_cancel (mTiles[z][x].tile.get())
+           )
+        {
+          mTiles[z][x].tile.reset();
+          NOGGIT_LOG << "Cancelled loading of tile " << x << "-" << z << std::endl;
+        }
+      }
+    }
+
     _last_unload_time = clock() / CLOCKS_PER_SEC;
   }
 }
@@ -411,7 +393,7 @@ void MapIndex::saveTile(const tile_index& tile, World* world)
 	}
 }
 
-void MapIndex::saveChanged (World* world)
+void MapIndex::saveChanged (World* world, save_progress const& progress)
 {
   world->wait_for_all_tile_updates();
 
@@ -422,12 +404,57 @@ void MapIndex::saveChanged (World* world)
 
   saveMaxUID();
 
+  std::vector<MapTile*> tiles;
   for (MapTile* tile : loaded_tiles())
   {
     if (tile->changed.load())
     {
-      tile->saveTile(world);
-      tile->changed = false;
+      tiles.push_back(tile);
+    }
+  }
+
+  save_tiles(world, tiles, progress);
+}
+
+void MapIndex::save_tiles (World* world, std::vector<MapTile*> const& tiles, save_progress const& progress)
+{
+  noggit::worker_pool& workers (noggit::worker_pool::instance());
+
+  // the progress is reported between batches of a tile per thread, outside
+  // of the pool as the progress dialog processes events
+  std::size_t const batch_size (workers.thread_count());
+  std::size_t saved (0);
+
+  while (saved < tiles.size())
+  {
+    std::size_t const count (std::min (batch_size, tiles.size() - saved));
+
+    // every tile is independent: its instances are copied through the
+    // thread safe World::copy_models and each file is written on its own
+    workers.for_each
+      ( count
+      , [&] (std::size_t i)
+        {
+          MapTile* tile (tiles[saved + i]);
+
+          try
+          {
+            tile->saveTile(world);
+            tile->changed = false;
+          }
+          catch (std::exception const& e)
+          {
+            LogError << "Saving " << tile->filename << " failed: " << e.what() << std::endl;
+          }
+        }
+      );
+
+    saved += count;
+
+    if (progress && !progress (saved, tiles.size()) && saved < tiles.size())
+    {
+      LogDebug << "Saving cancelled after " << saved << " of " << tiles.size() << " tiles" << std::endl;
+      return;
     }
   }
 }
@@ -514,6 +541,182 @@ void MapIndex::convert_alphamap(bool to_big_alpha)
   }
 }
 
+bool MapIndex::convert_alphamaps (World* world, bool to_big_alpha, conversion_progress const& progress)
+{
+  world->wait_for_all_tile_updates();
+
+  std::vector<MapTile*> loaded;
+  std::vector<tile_index> streamed;
+
+  for (int z = 0; z < 64; ++z)
+  {
+    for (int x = 0; x < 64; ++x)
+    {
+      tile_index const tile (x, z);
+
+      if (!hasTile (tile))
+      {
+        continue;
+      }
+
+      if (tileLoaded (tile) || tileAwaitingLoading (tile))
+      {
+        MapTile* map_tile (mTiles[z][x].tile.get());
+        map_tile->wait_until_loaded();
+        loaded.push_back (map_tile);
+      }
+      else
+      {
+        streamed.push_back (tile);
+      }
+    }
+  }
+
+  std::size_t const total (loaded.size() + streamed.size());
+
+  auto const tile_filename
+    ( [&] (tile_index const& index)
+      {
+        std::stringstream filename;
+        filename << "World\\Maps\\" << basename << "\\" << basename << "_" << index.x << "_" << index.z << ".adt";
+        return filename.str();
+      }
+    );
+
+  // the converted tiles are staged until every one of them is, so that
+  // cancelling or failing to convert a tile leaves the map untouched
+  // instead of in both formats
+  boost::filesystem::path const staging
+    ( boost::filesystem::temp_directory_path()
+    / boost::filesystem::unique_path ("noggit-alphamaps-%%%%-%%%%-%%%%")
+    );
+  boost::filesystem::create_directories (staging);
+
+  auto const staged_file
+    ( [&] (std::size_t i)
+      {
+        return staging / std::to_string (i);
+      }
+    );
+
+  noggit::worker_pool& workers (noggit::worker_pool::instance());
+  std::vector<char> staged (streamed.size(), false);
+  std::size_t converted (0);
+
+  while (converted < streamed.size())
+  {
+    std::size_t const count (std::min (workers.thread_count(), streamed.size() - converted));
+
+    workers.for_each
+      ( count
+      , [&] (std::size_t i)
+        {
+          std::size_t const tile (converted + i);
+          std::string const filename (tile_filename (streamed[tile]));
+
+          try
+          {
+            if (!MPQFile::exists (filename))
+            {
+              throw std::runtime_error ("the file does not exist");
+            }
+
+            // without its models: the world and its instances are left alone
+            MapTile map_tile (streamed[tile].x, streamed[tile].z, filename, mBigAlpha, false, use_mclq_green_lava(), false, world);
+            map_tile.finishLoading();
+            map_tile.convert_alphamap (to_big_alpha);
+
+            std::vector<char> const data (map_tile.headless_file_data (world));
+
+            std::ofstream output (staged_file (tile).string(), std::ios_base::binary | std::ios_base::trunc);
+            output.write (data.data(), data.size());
+            output.close();
+
+            if (!output)
+            {
+              throw std::runtime_error ("writing " + staged_file (tile).string() + " failed");
+            }
+
+            staged[tile] = true;
+          }
+          catch (std::exception const& e)
+          {
+            LogError << "Converting the alphamaps of " << filename << " failed: " << e.what() << std::endl;
+          }
+        }
+      );
+
+    converted += count;
+
+    // checked between the batches of tiles
+    if (progress && !progress (converted, total))
+    {
+      LogDebug << "Alphamap conversion cancelled after " << converted << " of " << total << " tiles" << std::endl;
+
+      boost::system::error_code ec;
+      boost::filesystem::remove_all (staging, ec);
+      return false;
+    }
+  }
+
+  if (std::find (staged.begin(), staged.end(), false) != staged.end())
+  {
+    for (std::size_t i (0); i < streamed.size(); ++i)
+    {
+      if (!staged[i])
+      {
+        LogError << "Not converting the alphamaps: " << tile_filename (streamed[i]) << " failed" << std::endl;
+      }
+    }
+
+    boost::system::error_code ec;
+    boost::filesystem::remove_all (staging, ec);
+    return false;
+  }
+
+  // from here on the map is changed and it can't be cancelled anymore.
+  // The loaded tiles' unsaved changes are saved too.
+  for (MapTile* tile : loaded)
+  {
+    tile->convert_alphamap (to_big_alpha);
+  }
+
+  save_tiles ( world
+             , loaded
+             , [&] (std::size_t saved, std::size_t)
+               {
+                 if (progress)
+                 {
+                   progress (converted + saved, total);
+                 }
+                 return true;
+               }
+             );
+
+  for (MapTile* tile : loaded)
+  {
+    markOnDisc (tile->index, true);
+  }
+
+  for (std::size_t i (0); i < streamed.size(); ++i)
+  {
+    std::ifstream input (staged_file (i).string(), std::ios_base::binary);
+    std::vector<char> const data ((std::istreambuf_iterator<char> (input)), std::istreambuf_iterator<char>());
+
+    MPQFile file (tile_filename (streamed[i]));
+    file.setBuffer (data);
+    file.SaveFile();
+  }
+
+  boost::system::error_code ec;
+  boost::filesystem::remove_all (staging, ec);
+
+  convert_alphamap (to_big_alpha);
+  save();
+
+  return true;
+}
+
 
 uint32_t MapIndex::getHighestGUIDFromFile(const std::string& pFilename) const
 {
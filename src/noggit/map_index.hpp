@@ -14,6 +14,7 @@
 #include <cstdint>
 #include <ctime>
 #include <fstream>
+#include <functional>
 #include <mutex>
 #include <sstream>
 #include <string>
@@ -153,8 +154,14 @@ public:
   void setFlag(bool to, math::vector_3d const& pos, uint32_t flag);
   bool has_unsaved_changes(const tile_index& tile) const;
 
+  //! called on the calling thread each time a batch of tiles has been saved
+  //! with the number of saved and total tiles, return false to cancel the
+  //! tiles not being saved yet. Cancelled tiles keep their changed flag.
+  using save_progress = std::function<bool (std::size_t saved, std::size_t total)>;
+
   void saveTile(const tile_index& tile, World*);
-  void saveChanged (World*);
+  //! the tiles are saved in parallel, the caller waits until they are done
+  void saveChanged (World*, save_progress const& progress = save_progress());
   void reloadTile(const tile_index& tile);
   void unloadTiles(const tile_index& tile);  // unloads all tiles more then x adts away from given
   void unloadTile(const tile_index& tile);  // unload given tile
@@ -170,14 +177,25 @@ public:
   void setAdt(bool value);
 
   void save();
-  void saveall (World*);
+  void saveall (World*, save_progress const& progress = save_progress());
 
   MapTile* getTile(const tile_index& tile) const;
   MapTile* getTileAbove(MapTile* tile) const;
   MapTile* getTileLeft(MapTile* tile) const;
   uint32_t getFlag(const tile_index& tile) const;
 
-  void convert_alphamap(bool to_big_alpha);
+  //! called on the calling thread with the number of converted and total
+  //! tiles, return false to cancel. Only the tiles not loaded in the editor
+  //! can be cancelled, the result is ignored afterwards.
+  using conversion_progress = std::function<bool (std::size_t converted, std::size_t total)>;
+
+  //! convert every tile of the map between the big and old alphamap formats
+  //! and update the WDT. The tiles not loaded in the editor are converted on
+  //! the worker pool without their models or the world's instances, into a
+  //! staging directory. Once they all are, the loaded tiles are converted in
+  //! place and everything is saved. Returns false if cancelled or if a
+  //! tile failed to convert, the map is left untouched then.
+  bool convert_alphamaps (World*, bool to_big_alpha, conversion_progress const& progress = conversion_progress());
   bool hasBigAlpha() const { return mBigAlpha; }
 
   bool sort_models_by_size_class() const { return _sort_models_by_size_class; }
@@ -203,6 +221,11 @@ public:
 private:
 	uint32_t getHighestGUIDFromFile(const std::string& pFilename) const;
 
+  void save_tiles (World*, std::vector<MapTile*> const& tiles, save_progress const& progress);
+
+  //! only update the MPHD flag
+  void convert_alphamap(bool to_big_alpha);
+
   bool _uid_fix_all_in_progress = false;
 
   const std::string basename;
@@ -0,0 +1,252 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/model_skinning.hpp>
+
+#include <cmath>
+#include <utility>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+  #define NOGGIT_MODEL_SKINNING_SSE
+  #include <xmmintrin.h>
+#endif
+
+namespace noggit
+{
+  bone_pose::bone_pose (std::size_t bone_count)
+    : _columns (bone_count * columns_per_bone)
+  {}
+
+  void bone_pose::set ( std::size_t bone
+                      , math::matrix_4x4 const& matrix
+                      , math::matrix_4x4 const& rotation
+                      )
+  {
+    math::vector_4d* columns (&_columns[bone * columns_per_bone]);
+
+    for (std::size_t i (0); i < 4; ++i)
+    {
+      columns[i] = {matrix (0, i), matrix (1, i), matrix (2, i), matrix (3, i)};
+      columns[i + 4] = {rotation (0, i), rotation (1, i), rotation (2, i), rotation (3, i)};
+    }
+  }
+
+  math::matrix_4x4 bone_pose::matrix (std::size_t bone) const
+  {
+    math::vector_4d const* c (&_columns[bone * columns_per_bone]);
+
+    return { c[0].x, c[1].x, c[2].x, c[3].x
+           , c[0].y, c[1].y, c[2].y, c[3].y
+           , c[0].z, c[1].z, c[2].z, c[3].z
+           , c[0].w, c[1].w, c[2].w, c[3].w
+           };
+  }
+
+  math::matrix_4x4 bone_pose::rotation (std::size_t bone) const
+  {
+    math::vector_4d const* c (&_columns[bone * columns_per_bone + 4]);
+
+    return { c[0].x, c[1].x, c[2].x, c[3].x
+           , c[0].y, c[1].y, c[2].y, c[3].y
+           , c[0].z, c[1].z, c[2].z, c[3].z
+           , c[0].w, c[1].w, c[2].w, c[3].w
+           };
+  }
+
+  bone_pose_budget::bone_pose_budget (std::size_t byte_budget)
+    : _byte_budget (byte_budget)
+  {}
+
+  std::shared_ptr<bone_pose_budget> const& bone_pose_budget::instance()
+  {
+    // about 60 two second loops of a model with a hundred bones
+    static std::shared_ptr<bone_pose_budget> const budget
+      (std::make_shared<bone_pose_budget> (std::size_t (96) << 20));
+    return budget;
+  }
+
+  std::size_t bone_pose_budget::byte_size() const
+  {
+    std::lock_guard<std::mutex> const lock (_mutex);
+    return _byte_size;
+  }
+
+  void bone_pose_budget::make_room (std::size_t byte_size)
+  {
+    while (!_entries.empty() && _byte_size + byte_size > _byte_budget)
+    {
+      entry const& evicted (_entries.back());
+      _byte_size -= evicted.byte_size;
+      evicted.cache->_poses.erase (evicted.key);
+      _entries.pop_back();
+    }
+  }
+
+  namespace
+  {
+    std::uint64_t pose_key (std::uint32_t anim, int time)
+    {
+      return (std::uint64_t (anim) << 32) | std::uint32_t (time);
+    }
+  }
+
+  bone_pose_cache::bone_pose_cache (std::shared_ptr<bone_pose_budget> budget)
+    : _budget (std::move (budget))
+  {}
+
+  bone_pose_cache::~bone_pose_cache()
+  {
+    clear();
+  }
+
+  bool bone_pose_cache::fits (std::size_t byte_size) const
+  {
+    return byte_size <= _budget->_byte_budget;
+  }
+
+  bone_pose const* bone_pose_cache::find (std::uint32_t anim, int time)
+  {
+    std::lock_guard<std::mutex> const lock (_budget->_mutex);
+
+    auto const it (_poses.find (pose_key (anim, time)));
+    if (it == _poses.end())
+    {
+      return nullptr;
+    }
+
+    _budget->_entries.splice (_budget->_entries.begin(), _budget->_entries, it->second.entry);
+    return &it->second.pose;
+  }
+
+  bone_pose const* bone_pose_cache::insert (std::uint32_t anim, int time, bone_pose const& pose)
+  {
+    if (!fits (pose.byte_size()))
+    {
+      return nullptr;
+    }
+
+    std::lock_guard<std::mutex> const lock (_budget->_mutex);
+
+    std::uint64_t const key (pose_key (anim, time));
+    auto const it (_poses.find (key));
+    if (it != _poses.end())
+    {
+      _budget->_entries.splice (_budget->_entries.begin(), _budget->_entries, it->second.entry);
+      return &it->second.pose;
+    }
+
+    _budget->make_room (pose.byte_size());
+
+    _budget->_entries.push_front ({this, key, pose.byte_size()});
+    _budget->_byte_size += pose.byte_size();
+    return &_poses.emplace (key, cached_pose {pose, _budget->_entries.begin()}).first->second.pose;
+  }
+
+  void bone_pose_cache::clear()
+  {
+    std::lock_guard<std::mutex> const lock (_budget->_mutex);
+
+    for (auto const& cached : _poses)
+    {
+      _budget->_byte_size -= cached.second.entry->byte_size;
+      _budget->_entries.erase (cached.second.entry);
+    }
+    _poses.clear();
+  }
+
+  model_skinning::model_skinning (std::vector<ModelVertex> const& vertices)
+  {
+    _influences.reserve (vertices.size());
+    _positions.reserve (vertices.size());
+    _normals.reserve (vertices.size());
+
+    for (ModelVertex const& vertex : vertices)
+    {
+      influences i {};
+      for (std::size_t b (0); b < 4; ++b)
+      {
+        if (vertex.weights[b] > 0)
+        {
+          i.bones[i.count] = vertex.bones[b];
+          i.weights[i.count] = vertex.weights[b] / 255.0f;
+          ++i.count;
+        }
+      }
+
+      _influences.push_back (i);
+      _positions.emplace_back (vertex.position, 1.f);
+      _normals.emplace_back (vertex.normal, 1.f);
+    }
+  }
+
+  void model_skinning::apply ( bone_pose const& pose
+                             , ModelVertex* output
+                             , std::size_t begin
+                             , std::size_t end
+                             ) const
+  {
+    float const* columns (&pose._columns.data()->x);
+    std::size_t const stride (bone_pose::columns_per_bone * 4);
+
+    for (std::size_t v (begin); v < end; ++v)
+    {
+      influences const& influence (_influences[v]);
+      math::vector_4d const& p (_positions[v]);
+      math::vector_4d const& n (_normals[v]);
+
+#if defined(NOGGIT_MODEL_SKINNING_SSE)
+      __m128 m[8] = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps()
+                    , _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps()
+                    };
+
+      for (std::uint32_t b (0); b < influence.count; ++b)
+      {
+        float const* bone (columns + influence.bones[b] * stride);
+        __m128 const weight (_mm_set1_ps (influence.weights[b]));
+
+        for (std::size_t c (0); c < 8; ++c)
+        {
+          m[c] = _mm_add_ps (m[c], _mm_mul_ps (weight, _mm_loadu_ps (bone + c * 4)));
+        }
+      }
+
+      __m128 const position
+        ( _mm_add_ps ( _mm_add_ps (_mm_mul_ps (m[0], _mm_set1_ps (p.x)), _mm_mul_ps (m[1], _mm_set1_ps (p.y)))
+                     , _mm_add_ps (_mm_mul_ps (m[2], _mm_set1_ps (p.z)), _mm_mul_ps (m[3], _mm_set1_ps (p.w)))
+                     )
+        );
+      __m128 const normal
+        ( _mm_add_ps ( _mm_add_ps (_mm_mul_ps (m[4], _mm_set1_ps (n.x)), _mm_mul_ps (m[5], _mm_set1_ps (n.y)))
+                     , _mm_add_ps (_mm_mul_ps (m[6], _mm_set1_ps (n.z)), _mm_mul_ps (m[7], _mm_set1_ps (n.w)))
+                     )
+        );
+
+      float result[8];
+      _mm_storeu_ps (result, position);
+      _mm_storeu_ps (result + 4, normal);
+#else
+      float m[32] = {};
+
+      for (std::uint32_t b (0); b < influence.count; ++b)
+      {
+        float const* bone (columns + influence.bones[b] * stride);
+        float const weight (influence.weights[b]);
+
+        for (std::size_t c (0); c < 32; ++c)
+        {
+          m[c] += weight * bone[c];
+        }
+      }
+
+      float result[8];
+      for (std::size_t r (0); r < 4; ++r)
+      {
+        result[r] = m[r] * p.x + m[4 + r] * p.y + m[8 + r] * p.z + m[12 + r] * p.w;
+        result[4 + r] = m[16 + r] * n.x + m[20 + r] * n.y + m[24 + r] * n.z + m[28 + r] * n.w;
+      }
+#endif
+
+      output[v].position = {result[0], result[1], result[2]};
+      output[v].normal = math::vector_3d (result[4], result[5], result[6]).normalized();
+    }
+  }
+}
@@ -0,0 +1,156 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <math/matrix_4x4.hpp>
+#include <math/vector_3d.hpp>
+#include <math/vector_4d.hpp>
+#include <noggit/ModelHeaders.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace noggit
+{
+  //! The matrices of the bones of a model for one frame of an animation,
+  //! stored by columns so that transforming a point is a sum of scaled
+  //! columns.
+  class bone_pose
+  {
+  public:
+    explicit bone_pose (std::size_t bone_count = 0);
+
+    std::size_t size() const { return _columns.size() / columns_per_bone; }
+
+    //! rotation is the matrix applied to the normals
+    void set (std::size_t bone, math::matrix_4x4 const& matrix, math::matrix_4x4 const& rotation);
+    math::matrix_4x4 matrix (std::size_t bone) const;
+    math::matrix_4x4 rotation (std::size_t bone) const;
+
+    std::size_t byte_size() const { return _columns.size() * sizeof (math::vector_4d); }
+
+  private:
+    friend class model_skinning;
+
+    //! the columns of the matrix, then the ones of the rotation
+    static std::size_t const columns_per_bone = 8;
+
+    std::vector<math::vector_4d> _columns;
+  };
+
+  class bone_pose_cache;
+
+  //! The bytes shared by the bone pose caches of several models. Once
+  //! used up, the least recently used poses of any of the caches are
+  //! evicted to make room for the new ones.
+  class bone_pose_budget
+  {
+  public:
+    explicit bone_pose_budget (std::size_t byte_budget);
+
+    //! the budget of the models of the editor, kept alive by their caches
+    static std::shared_ptr<bone_pose_budget> const& instance();
+
+    std::size_t byte_size() const;
+
+  private:
+    friend class bone_pose_cache;
+
+    struct entry
+    {
+      bone_pose_cache* cache;
+      std::uint64_t key;
+      std::size_t byte_size;
+    };
+
+    //! evicts the least recently used entries until byte_size fits
+    void make_room (std::size_t byte_size);
+
+    mutable std::mutex _mutex;
+    //! the most recently used first
+    std::list<entry> _entries;
+    std::size_t _byte_budget;
+    std::size_t _byte_size = 0;
+  };
+
+  //! The poses of a model's bones per animation and time quantum, so that
+  //! looping animations are only evaluated once. Only usable for the
+  //! models whose bones don't depend on the view (billboards) nor on the
+  //! global time (global sequences).
+  class bone_pose_cache
+  {
+  public:
+    //! in milliseconds, the animation time is rounded down to it
+    static int const time_quantum = 20;
+
+    explicit bone_pose_cache
+      (std::shared_ptr<bone_pose_budget> budget = bone_pose_budget::instance());
+    ~bone_pose_cache();
+
+    bone_pose_cache (bone_pose_cache const&) = delete;
+    bone_pose_cache& operator= (bone_pose_cache const&) = delete;
+
+    static int quantize (int time) { return time - time % time_quantum; }
+
+    //! whether a pose of that size is cached by insert
+    bool fits (std::size_t byte_size) const;
+
+    //! time has to be quantized
+    bone_pose const* find (std::uint32_t anim, int time);
+    //! \return the cached pose, nullptr when it doesn't fit. The poses
+    //! returned stay valid until the next insert in a cache of the budget.
+    bone_pose const* insert (std::uint32_t anim, int time, bone_pose const&);
+    void clear();
+
+  private:
+    friend class bone_pose_budget;
+
+    struct cached_pose
+    {
+      bone_pose pose;
+      std::list<bone_pose_budget::entry>::iterator entry;
+    };
+
+    std::shared_ptr<bone_pose_budget> _budget;
+    std::unordered_map<std::uint64_t, cached_pose> _poses;
+  };
+
+  //! Blends the vertices of an animated model with a bone pose. The bone
+  //! influences of the vertices are prepared once, then each vertex
+  //! blends the matrices of its bones and transforms its position and
+  //! normal once.
+  class model_skinning
+  {
+  public:
+    model_skinning() = default;
+    explicit model_skinning (std::vector<ModelVertex> const& vertices);
+
+    std::size_t size() const { return _influences.size(); }
+
+    //! writes the position and normal of the vertices [begin, end) to the
+    //! ones of output, which has to hold size() vertices
+    void apply ( bone_pose const& pose
+               , ModelVertex* output
+               , std::size_t begin
+               , std::size_t end
+               ) const;
+
+  private:
+    struct influences
+    {
+      std::uint32_t count;
+      std::uint32_t bones[4];
+      float weights[4];
+    };
+
+    std::vector<influences> _influences;
+    //! w = 1, like math::matrix_4x4 * math::vector_3d
+    std::vector<math::vector_4d> _positions;
+    std::vector<math::vector_4d> _normals;
+  };
+}
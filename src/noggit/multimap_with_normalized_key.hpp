@@ -77,11 +77,10 @@ namespace noggit
 
       if (obj)
       {
-        // always make sure an async object can be deleted before deleting it
-        if (!obj->finishedLoading())
-        {
-          AsyncLoader::instance().ensure_deletable(obj);
-        }
+        // always make sure an async object can be deleted before deleting
+        // it, even a finished one may be loading again, e.g. a texture
+        // being promoted
+        AsyncLoader::instance().ensure_deletable(obj);
 
         {
           boost::mutex::scoped_lock lock(_mutex);
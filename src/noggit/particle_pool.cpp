@@ -0,0 +1,230 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/particle_pool.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+  #define NOGGIT_PARTICLE_POOL_SSE
+  #include <xmmintrin.h>
+#endif
+
+namespace noggit
+{
+  namespace
+  {
+    // most emitters never get close to their capacity
+    std::size_t const minimum_allocation = 64;
+
+    // math::interpolation::linear
+    float linear (float t, float start, float end)
+    {
+      return start * (1.0f - t) + end * t;
+    }
+
+#if defined(NOGGIT_PARTICLE_POOL_SSE)
+    __m128 linear (__m128 t, __m128 start, __m128 end)
+    {
+      return _mm_add_ps (_mm_mul_ps (start, _mm_sub_ps (_mm_set1_ps (1.0f), t)), _mm_mul_ps (end, t));
+    }
+
+    //! the first value, until mid, then the second one
+    __m128 select (__m128 first, __m128 a, __m128 b)
+    {
+      return _mm_or_ps (_mm_and_ps (first, a), _mm_andnot_ps (first, b));
+    }
+#endif
+  }
+
+  particle_pool::particle_pool (std::size_t capacity)
+    : _capacity (capacity)
+  {}
+
+  template<typename Function>
+    void particle_pool::for_each_array (Function&& function)
+  {
+    for (auto* arrays : {&_pos, &_speed, &_down, &_dir, &_origin})
+    {
+      for (auto& array : *arrays)
+      {
+        function (array);
+      }
+    }
+    for (auto& array : _corners)
+    {
+      function (array);
+    }
+    for (auto& array : _color)
+    {
+      function (array);
+    }
+    function (_particle_size);
+    function (_life);
+    function (_max_life);
+    function (_tile);
+  }
+
+  void particle_pool::grow()
+  {
+    _allocated = std::min (_capacity, std::max (minimum_allocation, _allocated * 2));
+    for_each_array ([&] (auto& array) { array.resize (_allocated); });
+  }
+
+  bool particle_pool::add (Particle const& p)
+  {
+    if (_size >= _capacity)
+    {
+      return false;
+    }
+
+    if (_size == _allocated)
+    {
+      grow();
+    }
+
+    std::size_t const i (_size++);
+
+    for (std::size_t c (0); c < 3; ++c)
+    {
+      _pos[c][i] = p.pos[c];
+      _speed[c][i] = p.speed[c];
+      _down[c][i] = p.down[c];
+      _dir[c][i] = p.dir[c];
+      _origin[c][i] = p.origin[c];
+
+      for (std::size_t corner (0); corner < 4; ++corner)
+      {
+        _corners[corner * 3 + c][i] = p.corners[corner][c];
+      }
+    }
+
+    _color[0][i] = p.color.x;
+    _color[1][i] = p.color.y;
+    _color[2][i] = p.color.z;
+    _color[3][i] = p.color.w;
+    _particle_size[i] = p.size;
+    _life[i] = p.life;
+    _max_life[i] = p.maxlife;
+    _tile[i] = p.tile;
+
+    return true;
+  }
+
+  void particle_pool::remove (std::size_t i)
+  {
+    std::size_t const last (--_size);
+    for_each_array ([&] (auto& array) { array[i] = array[last]; });
+  }
+
+  void particle_pool::update ( float dt
+                             , float gravity
+                             , float deacceleration
+                             , float slowdown
+                             , particle_ramp const& ramp
+                             )
+  {
+    std::size_t i (0);
+
+#if defined(NOGGIT_PARTICLE_POOL_SSE)
+    __m128 const time (_mm_set1_ps (dt));
+    __m128 const gravity_step (_mm_set1_ps (gravity * dt));
+    __m128 const deacceleration_step (_mm_set1_ps (deacceleration * dt));
+    __m128 const mid (_mm_set1_ps (ramp.mid));
+    __m128 const after_mid (_mm_set1_ps (1.0f - ramp.mid));
+
+    for (; i + 4 <= _size; i += 4)
+    {
+      __m128 const life (_mm_loadu_ps (&_life[i]));
+      __m128 step (time);
+
+      if (slowdown > 0)
+      {
+        float slowed[4];
+        for (std::size_t k (0); k < 4; ++k)
+        {
+          slowed[k] = std::exp (-1.0f * slowdown * _life[i + k]);
+        }
+        step = _mm_mul_ps (_mm_loadu_ps (slowed), time);
+      }
+
+      for (std::size_t c (0); c < 3; ++c)
+      {
+        __m128 speed (_mm_loadu_ps (&_speed[c][i]));
+        speed = _mm_add_ps (speed, _mm_mul_ps (_mm_loadu_ps (&_down[c][i]), gravity_step));
+        speed = _mm_sub_ps (speed, _mm_mul_ps (_mm_loadu_ps (&_dir[c][i]), deacceleration_step));
+        _mm_storeu_ps (&_speed[c][i], speed);
+
+        _mm_storeu_ps (&_pos[c][i], _mm_add_ps (_mm_loadu_ps (&_pos[c][i]), _mm_mul_ps (speed, step)));
+      }
+
+      __m128 const new_life (_mm_add_ps (life, time));
+      _mm_storeu_ps (&_life[i], new_life);
+
+      __m128 const relative_life (_mm_div_ps (new_life, _mm_loadu_ps (&_max_life[i])));
+      __m128 const first (_mm_cmple_ps (relative_life, mid));
+      __m128 const t1 (_mm_div_ps (relative_life, mid));
+      __m128 const t2 (_mm_div_ps (_mm_sub_ps (relative_life, mid), after_mid));
+
+      auto const lerp
+        ( [&] (float a, float b, float c)
+          {
+            return select ( first
+                          , linear (t1, _mm_set1_ps (a), _mm_set1_ps (b))
+                          , linear (t2, _mm_set1_ps (b), _mm_set1_ps (c))
+                          );
+          }
+        );
+
+      _mm_storeu_ps (&_particle_size[i], lerp (ramp.sizes[0], ramp.sizes[1], ramp.sizes[2]));
+      for (std::size_t c (0); c < 4; ++c)
+      {
+        _mm_storeu_ps (&_color[c][i], lerp (ramp.colors[0][c], ramp.colors[1][c], ramp.colors[2][c]));
+      }
+    }
+#endif
+
+    for (; i < _size; ++i)
+    {
+      float const step (slowdown > 0 ? std::exp (-1.0f * slowdown * _life[i]) * dt : dt);
+
+      for (std::size_t c (0); c < 3; ++c)
+      {
+        _speed[c][i] += _down[c][i] * gravity * dt - _dir[c][i] * deacceleration * dt;
+        _pos[c][i] += _speed[c][i] * step;
+      }
+
+      _life[i] += dt;
+
+      float const relative_life (_life[i] / _max_life[i]);
+      bool const first (relative_life <= ramp.mid);
+      float const t (first ? relative_life / ramp.mid : (relative_life - ramp.mid) / (1.0f - ramp.mid));
+
+      auto const lerp
+        ( [&] (float a, float b, float c)
+          {
+            return first ? linear (t, a, b) : linear (t, b, c);
+          }
+        );
+
+      _particle_size[i] = lerp (ramp.sizes[0], ramp.sizes[1], ramp.sizes[2]);
+      for (std::size_t c (0); c < 4; ++c)
+      {
+        _color[c][i] = lerp (ramp.colors[0][c], ramp.colors[1][c], ramp.colors[2][c]);
+      }
+    }
+
+    // kill off old particles
+    for (std::size_t p (0); p < _size;)
+    {
+      if (_life[p] / _max_life[p] >= 1.0f)
+      {
+        remove (p);
+      }
+      else
+      {
+        ++p;
+      }
+    }
+  }
+}
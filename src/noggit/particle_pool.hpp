@@ -0,0 +1,93 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <math/vector_3d.hpp>
+#include <math/vector_4d.hpp>
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+//! A particle as spawned by the emitters, stored by particle_pool.
+struct Particle {
+  math::vector_3d pos, speed, down, origin, dir;
+  math::vector_3d  corners[4];
+  //math::vector_3d tpos;
+  float size, life, maxlife;
+  unsigned int tile;
+  math::vector_4d color;
+};
+
+namespace noggit
+{
+  //! How the size and color of the particles change over their life:
+  //! from the first to the second value until mid, then to the third one.
+  struct particle_ramp
+  {
+    float mid;
+    std::array<float, 3> sizes;
+    std::array<math::vector_4d, 3> colors;
+  };
+
+  //! The particles of an emitter, one array per component so that they
+  //! are simulated four at a time. The arrays grow up to the capacity and
+  //! are then reused: dead particles are replaced by the last one, so
+  //! spawning and dying doesn't allocate once the emitter is warm.
+  class particle_pool
+  {
+  public:
+    explicit particle_pool (std::size_t capacity);
+
+    std::size_t size() const { return _size; }
+    std::size_t capacity() const { return _capacity; }
+    bool empty() const { return !_size; }
+
+    //! \return false when the pool is full
+    bool add (Particle const&);
+    void clear() { _size = 0; }
+
+    //! moves the particles, updates their size and color and removes the
+    //! ones at the end of their life
+    void update ( float dt
+                , float gravity
+                , float deacceleration
+                , float slowdown
+                , particle_ramp const&
+                );
+
+    math::vector_3d position (std::size_t i) const { return {_pos[0][i], _pos[1][i], _pos[2][i]}; }
+    math::vector_3d origin (std::size_t i) const { return {_origin[0][i], _origin[1][i], _origin[2][i]}; }
+    math::vector_3d corner (std::size_t i, std::size_t corner) const
+    {
+      return {_corners[corner * 3][i], _corners[corner * 3 + 1][i], _corners[corner * 3 + 2][i]};
+    }
+    float particle_size (std::size_t i) const { return _particle_size[i]; }
+    math::vector_4d color (std::size_t i) const { return {_color[0][i], _color[1][i], _color[2][i], _color[3][i]}; }
+    unsigned int tile (std::size_t i) const { return _tile[i]; }
+
+  private:
+    void grow();
+    void remove (std::size_t i);
+
+    template<typename Function>
+      void for_each_array (Function&&);
+
+    std::size_t _capacity;
+    std::size_t _size = 0;
+    //! of the arrays, grows up to _capacity
+    std::size_t _allocated = 0;
+
+    std::array<std::vector<float>, 3> _pos;
+    std::array<std::vector<float>, 3> _speed;
+    std::array<std::vector<float>, 3> _down;
+    std::array<std::vector<float>, 3> _dir;
+    std::array<std::vector<float>, 3> _origin;
+    std::array<std::vector<float>, 12> _corners;
+    std::array<std::vector<float>, 4> _color;
+    std::vector<float> _particle_size;
+    std::vector<float> _life;
+    std::vector<float> _max_life;
+    std::vector<unsigned int> _tile;
+  };
+}
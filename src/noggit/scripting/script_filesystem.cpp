@@ -1,5 +1,6 @@
 // This file is part of Noggit3, licensed under GNU General Public License (version 3).
 
+#include <noggit/MPQ.h>
 #include <noggit/scripting/script_exception.hpp>
 #include <noggit/scripting/script_filesystem.hpp>
 #include <noggit/scripting/scripting_tool.hpp>
@@ -72,7 +73,10 @@ namespace noggit
     {
       auto writable_path = get_writable_path("write_file",ctx,path);
       mkdirs(writable_path.string());
+      // it may be a project file a MPQFile is reading
+      MPQFile::prepare_overwrite(writable_path);
       std::ofstream(writable_path.string()) << input;
+      MPQFile::index_written_file(writable_path);
     }
 
     void append_file(script_context * ctx, std::string const& path, std::string const& input)
@@ -82,6 +86,8 @@ namespace noggit
       std::ofstream outfile;
       outfile.open(writable_path.string(), std::ios_base::app); // append instead of overwrite
       outfile << input;
+      outfile.close();
+      MPQFile::index_written_file(writable_path);
     }
 
     bool path_exists(std::string const& path)
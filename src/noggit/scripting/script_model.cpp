@@ -169,14 +169,20 @@ namespace noggit
       , std::vector<model> & vec
     )
     {
-      world->for_each_m2_instance([&](ModelInstance& mod) {
+      // the bounds of the instances contain their position
+      auto const overlaps = [&](math::vector_3d const& lower, math::vector_3d const& upper) {
+        return lower.x <= max.x && upper.x >= min.x
+          && lower.z <= max.z && upper.z >= min.z;
+      };
+
+      world->for_each_m2_instance_in(overlaps, [&](ModelInstance& mod) {
         if (mod.pos.x >= min.x && mod.pos.x <= max.x
           && mod.pos.z >= min.z && mod.pos.z <= max.z)
         {
           vec.push_back(model(ctx, &mod));
         }
       });
-      world->for_each_wmo_instance([&](WMOInstance& mod) {
+      world->for_each_wmo_instance_in(overlaps, [&](WMOInstance& mod) {
         if (mod.pos.x >= min.x && mod.pos.x <= max.x
           && mod.pos.z >= min.z && mod.pos.z <= max.z)
         {
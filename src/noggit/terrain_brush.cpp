@@ -0,0 +1,492 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <math/interpolation.hpp>
+#include <noggit/MapHeaders.h>
+#include <noggit/terrain_brush.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define NOGGIT_TERRAIN_BRUSH_SSE2
+  #include <emmintrin.h>
+#endif
+
+namespace noggit
+{
+  namespace terrain_brush
+  {
+    namespace
+    {
+      //! distance to (px, pz) on the xz plane
+      void distances ( float const* xs
+                     , float const* zs
+                     , std::size_t count
+                     , float px
+                     , float pz
+                     , float* output
+                     )
+      {
+        std::size_t i (0);
+#if defined(NOGGIT_TERRAIN_BRUSH_SSE2)
+        __m128 const ppx (_mm_set1_ps (px));
+        __m128 const ppz (_mm_set1_ps (pz));
+        for (; i + 4 <= count; i += 4)
+        {
+          __m128 const dx (_mm_sub_ps (_mm_loadu_ps (xs + i), ppx));
+          __m128 const dz (_mm_sub_ps (_mm_loadu_ps (zs + i), ppz));
+          _mm_storeu_ps (output + i, _mm_sqrt_ps (_mm_add_ps (_mm_mul_ps (dx, dx), _mm_mul_ps (dz, dz))));
+        }
+#endif
+        for (; i < count; ++i)
+        {
+          float const dx (xs[i] - px);
+          float const dz (zs[i] - pz);
+          output[i] = std::sqrt (dx * dx + dz * dz);
+        }
+      }
+
+      //! change * (1 - dist * factor / radius)
+      void linear_falloff ( float const* dist
+                          , std::size_t count
+                          , float change
+                          , float factor
+                          , float radius
+                          , float* output
+                          )
+      {
+        std::size_t i (0);
+#if defined(NOGGIT_TERRAIN_BRUSH_SSE2)
+        __m128 const c (_mm_set1_ps (change));
+        __m128 const f (_mm_set1_ps (factor));
+        __m128 const r (_mm_set1_ps (radius));
+        __m128 const one (_mm_set1_ps (1.f));
+        for (; i + 4 <= count; i += 4)
+        {
+          __m128 const d (_mm_loadu_ps (dist + i));
+          _mm_storeu_ps (output + i, _mm_mul_ps (c, _mm_sub_ps (one, _mm_div_ps (_mm_mul_ps (d, f), r))));
+        }
+#endif
+        for (; i < count; ++i)
+        {
+          output[i] = change * (1.0f - dist[i] * factor / radius);
+        }
+      }
+
+      //! change / (1 + dist / radius)
+      void smooth_falloff (float const* dist, std::size_t count, float change, float radius, float* output)
+      {
+        std::size_t i (0);
+#if defined(NOGGIT_TERRAIN_BRUSH_SSE2)
+        __m128 const c (_mm_set1_ps (change));
+        __m128 const r (_mm_set1_ps (radius));
+        __m128 const one (_mm_set1_ps (1.f));
+        for (; i + 4 <= count; i += 4)
+        {
+          __m128 const d (_mm_loadu_ps (dist + i));
+          _mm_storeu_ps (output + i, _mm_div_ps (c, _mm_add_ps (one, _mm_div_ps (d, r))));
+        }
+#endif
+        for (; i < count; ++i)
+        {
+          output[i] = change / (1.0f + dist[i] / radius);
+        }
+      }
+
+      //! change * (t² + t + 1) with t = dist / radius
+      void polynom_falloff (float const* dist, std::size_t count, float change, float radius, float* output)
+      {
+        std::size_t i (0);
+#if defined(NOGGIT_TERRAIN_BRUSH_SSE2)
+        __m128 const c (_mm_set1_ps (change));
+        __m128 const r (_mm_set1_ps (radius));
+        __m128 const one (_mm_set1_ps (1.f));
+        for (; i + 4 <= count; i += 4)
+        {
+          __m128 const t (_mm_div_ps (_mm_loadu_ps (dist + i), r));
+          _mm_storeu_ps (output + i, _mm_mul_ps (c, _mm_add_ps (_mm_add_ps (_mm_mul_ps (t, t), t), one)));
+        }
+#endif
+        for (; i < count; ++i)
+        {
+          float const t (dist[i] / radius);
+          output[i] = change * (t * t + t + 1.0f);
+        }
+      }
+
+      //! interpolation factor towards the target height of flatten and blur
+      void flatten_factors ( float const* dist
+                           , std::size_t count
+                           , float remain
+                           , float radius
+                           , int brush_type
+                           , float* output
+                           )
+      {
+        switch (brush_type)
+        {
+          case eFlattenType_Flat:
+            std::fill (output, output + count, remain);
+            break;
+          case eFlattenType_Linear:
+            linear_falloff (dist, count, remain, 1.f, radius, output);
+            break;
+          case eFlattenType_Smooth:
+            for (std::size_t i (0); i < count; ++i)
+            {
+              output[i] = dist[i] < radius ? std::pow (remain, 1.f + dist[i] / radius) : 0.f;
+            }
+            break;
+          default:
+            throw std::logic_error ("bad brush type");
+        }
+      }
+
+      //! weighted average of the samples closer than radius to (px, pz)
+      //! \return the total weight
+      float weighted_height ( float const* xs
+                            , float const* zs
+                            , float const* heights
+                            , std::size_t count
+                            , float px
+                            , float pz
+                            , float radius
+                            , float& total_height
+                            )
+      {
+        float sum_height (0.f);
+        float sum_weight (0.f);
+
+        std::size_t i (0);
+#if defined(NOGGIT_TERRAIN_BRUSH_SSE2)
+        __m128 const ppx (_mm_set1_ps (px));
+        __m128 const ppz (_mm_set1_ps (pz));
+        __m128 const r (_mm_set1_ps (radius));
+        __m128 const one (_mm_set1_ps (1.f));
+        __m128 height4 (_mm_setzero_ps());
+        __m128 weight4 (_mm_setzero_ps());
+        for (; i + 4 <= count; i += 4)
+        {
+          __m128 const dx (_mm_sub_ps (ppx, _mm_loadu_ps (xs + i)));
+          __m128 const dz (_mm_sub_ps (ppz, _mm_loadu_ps (zs + i)));
+          __m128 const d (_mm_sqrt_ps (_mm_add_ps (_mm_mul_ps (dx, dx), _mm_mul_ps (dz, dz))));
+          __m128 const w ( _mm_and_ps ( _mm_cmple_ps (d, r)
+                                      , _mm_sub_ps (one, _mm_div_ps (d, r))
+                                      )
+                         );
+          height4 = _mm_add_ps (height4, _mm_mul_ps (w, _mm_loadu_ps (heights + i)));
+          weight4 = _mm_add_ps (weight4, w);
+        }
+
+        float lanes[4];
+        _mm_storeu_ps (lanes, height4);
+        sum_height = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+        _mm_storeu_ps (lanes, weight4);
+        sum_weight = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+        for (; i < count; ++i)
+        {
+          float const dx (px - xs[i]);
+          float const dz (pz - zs[i]);
+          float const d (std::sqrt (dx * dx + dz * dz));
+          if (d <= radius)
+          {
+            sum_height += (1.0f - d / radius) * heights[i];
+            sum_weight += 1.0f - d / radius;
+          }
+        }
+
+        total_height = sum_height;
+        return sum_weight;
+      }
+    }
+
+    void vertices::clear()
+    {
+      x.clear();
+      y.clear();
+      z.clear();
+      changed.clear();
+    }
+
+    void vertices::append (math::vector_3d const* begin, std::size_t count)
+    {
+      std::size_t const offset (size());
+      x.resize (offset + count);
+      y.resize (offset + count);
+      z.resize (offset + count);
+      changed.resize (offset + count, 0);
+
+      for (std::size_t i (0); i < count; ++i)
+      {
+        x[offset + i] = begin[i].x;
+        y[offset + i] = begin[i].y;
+        z[offset + i] = begin[i].z;
+      }
+    }
+
+    bool change ( vertices& v
+                , math::vector_3d const& pos
+                , float change
+                , float radius
+                , int brush_type
+                , float inner_radius
+                )
+    {
+      std::size_t const count (v.size());
+      std::vector<float> dist (count);
+      std::vector<float> delta (count);
+
+      distances (v.x.data(), v.z.data(), count, pos.x, pos.z, dist.data());
+
+      switch (brush_type)
+      {
+        case eTerrainType_Flat:
+          std::fill (delta.begin(), delta.end(), change);
+          break;
+        case eTerrainType_Linear:
+          linear_falloff (dist.data(), count, change, 1.0f - inner_radius, radius, delta.data());
+          break;
+        case eTerrainType_Smooth:
+          smooth_falloff (dist.data(), count, change, radius, delta.data());
+          break;
+        case eTerrainType_Polynom:
+          polynom_falloff (dist.data(), count, change, radius, delta.data());
+          break;
+        case eTerrainType_Trigo:
+          for (std::size_t i (0); i < count; ++i)
+          {
+            delta[i] = dist[i] < radius ? change * std::cos (dist[i] / radius) : 0.f;
+          }
+          break;
+        case eTerrainType_Quadra:
+          linear_falloff (dist.data(), count, change, inner_radius, radius, delta.data());
+          break;
+        case eTerrainType_Gaussian:
+        {
+          float const sigma_sq_2 (2.f * 0.39f * 0.39f);
+          float const inner (radius * inner_radius);
+          float const plateau (change * std::exp (-(inner_radius * inner_radius) / sigma_sq_2));
+          for (std::size_t i (0); i < count; ++i)
+          {
+            float const t (dist[i] / radius);
+            delta[i] = dist[i] < inner ? plateau
+                     : dist[i] < radius ? change * std::exp (-(t * t) / sigma_sq_2)
+                     : 0.f;
+          }
+          break;
+        }
+        default:
+          throw std::logic_error ("bad brush type");
+      }
+
+      bool changed (false);
+
+      if (brush_type == eTerrainType_Quadra)
+      {
+        float const half (std::abs (radius / 2));
+        for (std::size_t i (0); i < count; ++i)
+        {
+          if (std::abs (v.x[i] - pos.x) < half && std::abs (v.z[i] - pos.z) < half)
+          {
+            v.y[i] += delta[i];
+            v.changed[i] = changed = true;
+          }
+        }
+      }
+      else
+      {
+        for (std::size_t i (0); i < count; ++i)
+        {
+          if (dist[i] < radius)
+          {
+            v.y[i] += delta[i];
+            v.changed[i] = changed = true;
+          }
+        }
+      }
+
+      return changed;
+    }
+
+    bool flatten ( vertices& v
+                 , math::vector_3d const& pos
+                 , float remain
+                 , float radius
+                 , int brush_type
+                 , flatten_mode const& mode
+                 , math::vector_3d const& origin
+                 , math::degrees angle
+                 , math::degrees orientation
+                 )
+    {
+      std::size_t const count (v.size());
+      std::vector<float> dist (count);
+      std::vector<float> target (count);
+
+      distances (v.x.data(), v.z.data(), count, pos.x, pos.z, dist.data());
+
+      // height of the plane through origin
+      float const cos_o (math::cos (orientation));
+      float const sin_o (math::sin (orientation));
+      float const tan_a (math::tan (angle));
+
+      std::size_t i (0);
+#if defined(NOGGIT_TERRAIN_BRUSH_SSE2)
+      __m128 const ox (_mm_set1_ps (origin.x));
+      __m128 const oy (_mm_set1_ps (origin.y));
+      __m128 const oz (_mm_set1_ps (origin.z));
+      __m128 const c (_mm_set1_ps (cos_o));
+      __m128 const s (_mm_set1_ps (sin_o));
+      __m128 const t (_mm_set1_ps (tan_a));
+      for (; i + 4 <= count; i += 4)
+      {
+        __m128 const dx (_mm_sub_ps (_mm_loadu_ps (&v.x[i]), ox));
+        __m128 const dz (_mm_sub_ps (_mm_loadu_ps (&v.z[i]), oz));
+        _mm_storeu_ps
+          (&target[i], _mm_add_ps (oy, _mm_mul_ps (_mm_add_ps (_mm_mul_ps (dx, c), _mm_mul_ps (dz, s)), t)));
+      }
+#endif
+      for (; i < count; ++i)
+      {
+        target[i] = origin.y + ((v.x[i] - origin.x) * cos_o + (v.z[i] - origin.z) * sin_o) * tan_a;
+      }
+
+      bool const to_origin (brush_type == eFlattenType_Origin);
+      std::vector<float> factor (to_origin ? 0 : count);
+      if (!to_origin)
+      {
+        flatten_factors (dist.data(), count, remain, radius, brush_type, factor.data());
+      }
+
+      bool changed (false);
+
+      for (std::size_t i (0); i < count; ++i)
+      {
+        if ( dist[i] >= radius
+          || (!mode.lower && target[i] < v.y[i])
+          || (!mode.raise && target[i] > v.y[i])
+           )
+        {
+          continue;
+        }
+
+        v.y[i] = to_origin ? origin.y : math::interpolation::linear (factor[i], v.y[i], target[i]);
+        v.changed[i] = changed = true;
+      }
+
+      return changed;
+    }
+
+    bool blur ( vertices& v
+              , math::vector_3d const& pos
+              , float remain
+              , float radius
+              , int brush_type
+              , flatten_mode const& mode
+              , std::function<boost::optional<float> (float, float)> const& height
+              , parallel_for const& run
+              )
+    {
+      if (brush_type == eFlattenType_Origin)
+      {
+        return false;
+      }
+
+      std::size_t const count (v.size());
+      std::vector<float> dist (count);
+
+      distances (v.x.data(), v.z.data(), count, pos.x, pos.z, dist.data());
+
+      std::vector<float> factor (count);
+      flatten_factors (dist.data(), count, remain, radius, brush_type, factor.data());
+
+      // sample the grid once: every vertex averages the same points
+      std::vector<float> sample_x;
+      std::vector<float> sample_z;
+      std::vector<float> sample_height;
+
+      int const rad (static_cast<int> (radius / UNITSIZE));
+      for (int j (-rad * 2); j <= rad * 2; ++j)
+      {
+        float const tz (pos.z + j * UNITSIZE / 2);
+        for (int k (-rad); k <= rad; ++k)
+        {
+          float const tx (pos.x + k * UNITSIZE + (j % 2) * UNITSIZE / 2.0f);
+          if (auto h = height (tx, tz))
+          {
+            sample_x.emplace_back (tx);
+            sample_z.emplace_back (tz);
+            sample_height.emplace_back (h.get());
+          }
+        }
+      }
+
+      std::vector<float> target (count);
+      std::vector<std::uint8_t> has_target (count, 0);
+
+      // a chunk's worth of vertices per block
+      std::size_t const block_size (145);
+      auto const average
+        ( [&] (std::size_t block)
+          {
+            for (std::size_t i (block * block_size); i < std::min (count, (block + 1) * block_size); ++i)
+            {
+              if (dist[i] >= radius)
+              {
+                continue;
+              }
+
+              float total_height;
+              float const total_weight
+                ( weighted_height ( sample_x.data(), sample_z.data(), sample_height.data()
+                                  , sample_x.size()
+                                  , v.x[i], v.z[i]
+                                  , radius
+                                  , total_height
+                                  )
+                );
+
+              if (total_weight > 0.f)
+              {
+                target[i] = total_height / total_weight;
+                has_target[i] = true;
+              }
+            }
+          }
+        );
+
+      std::size_t const blocks ((count + block_size - 1) / block_size);
+      if (run)
+      {
+        run (blocks, average);
+      }
+      else
+      {
+        for (std::size_t block (0); block < blocks; ++block)
+        {
+          average (block);
+        }
+      }
+
+      bool changed (false);
+
+      for (std::size_t i (0); i < count; ++i)
+      {
+        if ( !has_target[i]
+          || (target[i] > v.y[i] && !mode.raise)
+          || (target[i] < v.y[i] && !mode.lower)
+           )
+        {
+          continue;
+        }
+
+        v.y[i] = math::interpolation::linear (factor[i], v.y[i], target[i]);
+        v.changed[i] = changed = true;
+      }
+
+      return changed;
+    }
+  }
+}
@@ -0,0 +1,74 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <math/trig.hpp>
+#include <math/vector_3d.hpp>
+#include <noggit/tool_enums.hpp>
+
+#include <boost/optional.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+//! Height brushes applied to the vertices of every chunk in range at once.
+//! The vertices are gathered in structure of arrays buffers which the
+//! kernels process with SSE2 when the compiler targets it, scalar code
+//! otherwise. Only y is written, changed flags the vertices to scatter back.
+namespace noggit
+{
+  namespace terrain_brush
+  {
+    struct vertices
+    {
+      std::vector<float> x;
+      std::vector<float> y;
+      std::vector<float> z;
+      std::vector<std::uint8_t> changed;
+
+      std::size_t size() const { return x.size(); }
+
+      void clear();
+      void append (math::vector_3d const* begin, std::size_t count);
+    };
+
+    //! runs fun for every index in [0, count), possibly in parallel
+    using parallel_for
+      = std::function<void (std::size_t count, std::function<void (std::size_t)> const& fun)>;
+
+    //! \return whether any vertex changed
+    bool change ( vertices&
+                , math::vector_3d const& pos
+                , float change
+                , float radius
+                , int brush_type
+                , float inner_radius
+                );
+
+    bool flatten ( vertices&
+                 , math::vector_3d const& pos
+                 , float remain
+                 , float radius
+                 , int brush_type
+                 , flatten_mode const& mode
+                 , math::vector_3d const& origin
+                 , math::degrees angle
+                 , math::degrees orientation
+                 );
+
+    //! height is called once per point of the sampling grid around pos,
+    //! before any vertex is changed. The averages of the samples are
+    //! computed through run, by blocks of vertices, when given.
+    bool blur ( vertices&
+              , math::vector_3d const& pos
+              , float remain
+              , float radius
+              , int brush_type
+              , flatten_mode const& mode
+              , std::function<boost::optional<float> (float, float)> const& height
+              , parallel_for const& run = {}
+              );
+  }
+}
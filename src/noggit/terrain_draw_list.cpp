@@ -0,0 +1,230 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/terrain_draw_list.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace noggit
+{
+  std::size_t terrain_tile_layout::first_index (std::size_t chunk, boost::optional<int> lod_level)
+  {
+    std::size_t first (chunk * indices_per_chunk);
+
+    if (lod_level)
+    {
+      first += strip_size;
+      for (int lod (0); lod < *lod_level; ++lod)
+      {
+        first += lod_strip_sizes[lod];
+      }
+    }
+
+    return first;
+  }
+
+  namespace
+  {
+    // the 9 * 9 outer vertices and the 8 * 8 inner ones are interleaved
+    // by rows in the MCVT
+    terrain_tile_layout::index_type outer_vertex (int z, int x)
+    {
+      return static_cast<terrain_tile_layout::index_type> (z * 8 + z * 9 + x);
+    }
+
+    terrain_tile_layout::index_type inner_vertex (int z, int x)
+    {
+      return static_cast<terrain_tile_layout::index_type> ((z + 1) * 9 + z * 8 + x);
+    }
+  }
+
+  void terrain_tile_layout::build_strips ( int holes
+                                         , std::vector<index_type>& strip
+                                         , std::array<std::vector<index_type>, 4>& lod_strips
+                                         )
+  {
+    strip.clear();
+    for (auto& lod_strip : lod_strips)
+    {
+      lod_strip.clear();
+    }
+
+    for (int x = 0; x < 8; ++x)
+    {
+      for (int y = 0; y < 8; ++y)
+      {
+        if (holes & (1 << ((y / 2) * 4 + x / 2)))
+        {
+          continue;
+        }
+
+        // todo: better hole check ?
+        for (int lod_level = 0; lod_level < 4; ++lod_level)
+        {
+          int n = 1 << lod_level;
+          if ((x % n) == 0 && (y % n) == 0)
+          {
+            lod_strips[lod_level].emplace_back (outer_vertex (y, x)); //0
+            lod_strips[lod_level].emplace_back (outer_vertex (y + n, x)); //17
+            lod_strips[lod_level].emplace_back (outer_vertex (y + n, x + n)); //18
+            lod_strips[lod_level].emplace_back (outer_vertex (y + n, x + n)); //18
+            lod_strips[lod_level].emplace_back (outer_vertex (y, x + n)); //1
+            lod_strips[lod_level].emplace_back (outer_vertex (y, x)); //0
+          }
+        }
+
+        strip.emplace_back (inner_vertex (y, x)); //9
+        strip.emplace_back (outer_vertex (y, x)); //0
+        strip.emplace_back (outer_vertex (y + 1, x)); //17
+        strip.emplace_back (inner_vertex (y, x)); //9
+        strip.emplace_back (outer_vertex (y + 1, x)); //17
+        strip.emplace_back (outer_vertex (y + 1, x + 1)); //18
+        strip.emplace_back (inner_vertex (y, x)); //9
+        strip.emplace_back (outer_vertex (y + 1, x + 1)); //18
+        strip.emplace_back (outer_vertex (y, x + 1)); //1
+        strip.emplace_back (inner_vertex (y, x)); //9
+        strip.emplace_back (outer_vertex (y, x + 1)); //1
+        strip.emplace_back (outer_vertex (y, x)); //0
+      }
+    }
+  }
+
+  void terrain_alphamap_layer::write_alphas ( std::uint8_t* rgba
+                                            , std::array<std::uint8_t const*, 3> const& alphas
+                                            )
+  {
+    for (std::size_t i (0); i < texel_count; ++i)
+    {
+      for (std::size_t layer (0); layer < 3; ++layer)
+      {
+        rgba[i * 4 + layer] = alphas[layer] ? alphas[layer][i] : 0;
+      }
+    }
+  }
+
+  void terrain_alphamap_layer::write_alphas ( std::uint8_t* rgba
+                                            , std::array<float const*, 3> const& alphas
+                                            )
+  {
+    for (std::size_t i (0); i < texel_count; ++i)
+    {
+      for (std::size_t layer (0); layer < 3; ++layer)
+      {
+        float const value (alphas[layer] ? std::min (std::max (alphas[layer][i], 0.f), 255.f) : 0.f);
+        rgba[i * 4 + layer] = static_cast<std::uint8_t> (value + 0.5f);
+      }
+    }
+  }
+
+  void terrain_alphamap_layer::write_shadow (std::uint8_t* rgba, std::uint8_t const* shadow)
+  {
+    for (std::size_t i (0); i < texel_count; ++i)
+    {
+      rgba[i * 4 + 3] = shadow[i];
+    }
+  }
+
+  terrain_chunk_parameters_block::terrain_chunk_parameters_block()
+    : _parameters()
+  {
+    forget_changes();
+  }
+
+  void terrain_chunk_parameters_block::set (std::size_t chunk, terrain_chunk_parameters const& parameters)
+  {
+    if (!std::memcmp (&_parameters[chunk], &parameters, sizeof (terrain_chunk_parameters)))
+    {
+      return;
+    }
+
+    _parameters[chunk] = parameters;
+    _changed[chunk] = true;
+    _first_changed = std::min (_first_changed, chunk);
+    _last_changed = std::max (_last_changed, chunk + 1);
+  }
+
+  void terrain_chunk_parameters_block::upload_changes
+    (std::function<void (std::size_t offset, std::size_t size, void const* data)> const& upload)
+  {
+    std::size_t chunk (_first_changed);
+
+    while (chunk < _last_changed)
+    {
+      if (!_changed[chunk])
+      {
+        ++chunk;
+        continue;
+      }
+
+      std::size_t const first (chunk);
+      while (chunk < _last_changed && _changed[chunk])
+      {
+        ++chunk;
+      }
+
+      upload ( first * sizeof (terrain_chunk_parameters)
+             , (chunk - first) * sizeof (terrain_chunk_parameters)
+             , &_parameters[first]
+             );
+    }
+
+    forget_changes();
+  }
+
+  void terrain_chunk_parameters_block::forget_changes()
+  {
+    _changed.fill (false);
+    _first_changed = terrain_tile_layout::chunk_count;
+    _last_changed = 0;
+  }
+
+  void terrain_draw_list::clear()
+  {
+    _chunks.clear();
+    _batches.clear();
+    _counts.clear();
+    _index_offsets.clear();
+    _base_vertices.clear();
+  }
+
+  void terrain_draw_list::add ( texture_key const& textures
+                              , std::size_t chunk
+                              , std::size_t first_index
+                              , std::size_t count
+                              )
+  {
+    if (count)
+    {
+      _chunks.push_back ({textures, chunk, first_index, count});
+    }
+  }
+
+  void terrain_draw_list::finish()
+  {
+    // stable to keep drawing a group front to back like the chunks were
+    std::stable_sort ( _chunks.begin(), _chunks.end()
+                     , [] (chunk_draw const& lhs, chunk_draw const& rhs)
+                       {
+                         return lhs.textures < rhs.textures;
+                       }
+                     );
+
+    for (std::size_t i (0); i < _chunks.size(); ++i)
+    {
+      chunk_draw const& chunk (_chunks[i]);
+
+      if (_batches.empty() || _batches.back().textures != chunk.textures)
+      {
+        _batches.push_back ({chunk.textures, chunk.chunk, i, 0});
+      }
+      ++_batches.back().count;
+
+      _counts.push_back (static_cast<std::int32_t> (chunk.count));
+      _index_offsets.push_back
+        (reinterpret_cast<void const*> (chunk.first_index * sizeof (terrain_tile_layout::index_type)));
+      _base_vertices.push_back
+        (static_cast<std::int32_t> (chunk.chunk * terrain_tile_layout::vertices_per_chunk));
+    }
+  }
+}
@@ -0,0 +1,149 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <math/vector_4d.hpp>
+
+#include <boost/optional.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace noggit
+{
+  //! Where the chunks of a tile are in its terrain buffers. Each chunk has
+  //! its vertices after the ones of the previous chunk, and a fixed range
+  //! of indices holding its full detail strip, then its lod strips, large
+  //! enough for a chunk without holes. The indices are relative to the
+  //! first vertex of their chunk.
+  struct terrain_tile_layout
+  {
+    using index_type = std::uint16_t;
+
+    static constexpr std::size_t chunk_count = 16 * 16;
+    static constexpr std::size_t vertices_per_chunk = 9 * 9 + 8 * 8;
+    //! 8 * 8 quads of 4 triangles
+    static constexpr std::size_t strip_size = 8 * 8 * 4 * 3;
+    //! 8 * 8, 4 * 4, 2 * 2 and 1 quads of 2 triangles
+    static constexpr std::array<std::size_t, 4> lod_strip_sizes = {8 * 8 * 6, 4 * 4 * 6, 2 * 2 * 6, 6};
+    static constexpr std::size_t indices_per_chunk
+      = strip_size + lod_strip_sizes[0] + lod_strip_sizes[1] + lod_strip_sizes[2] + lod_strip_sizes[3];
+
+    //! boost::none is the full detail strip
+    static std::size_t first_index (std::size_t chunk, boost::optional<int> lod_level);
+
+    //! the strips of a chunk, without the quads of its holes (the MCNK
+    //! ones, a bit per 2 * 2 quads)
+    static void build_strips ( int holes
+                             , std::vector<index_type>& strip
+                             , std::array<std::vector<index_type>, 4>& lod_strips
+                             );
+  };
+
+  //! The layer of a chunk in the alphamap texture array of its tile, 8
+  //! bits per value like the alphamaps are saved: the alpha layers in rgb
+  //! and the shadow in a.
+  struct terrain_alphamap_layer
+  {
+    static constexpr std::size_t size = 64;
+    static constexpr std::size_t texel_count = size * size;
+
+    //! nullptr for the missing layers, written as 0
+    static void write_alphas (std::uint8_t* rgba, std::array<std::uint8_t const*, 3> const& alphas);
+    //! the values being painted, clamped to [0, 255] and rounded
+    static void write_alphas (std::uint8_t* rgba, std::array<float const*, 3> const& alphas);
+    static void write_shadow (std::uint8_t* rgba, std::uint8_t const* shadow);
+  };
+
+  //! What the terrain shader knows of a chunk, with the std140 layout of
+  //! its chunk struct.
+  struct terrain_chunk_parameters
+  {
+    //! offsets of the animated textures, two layers per vector
+    math::vector_4d texture_animations[2];
+    math::vector_4d areaid_color;
+    //! is_textured, cant_paint, impassible, unused
+    std::array<std::int32_t, 4> flags;
+  };
+  static_assert (sizeof (terrain_chunk_parameters) == 64, "std140 layout of the terrain shader's chunk");
+
+  //! The parameters of a tile's chunks and the ranges of them changed since
+  //! they were last sent, so that only those are uploaded.
+  class terrain_chunk_parameters_block
+  {
+  public:
+    terrain_chunk_parameters_block();
+
+    terrain_chunk_parameters const* data() const { return _parameters.data(); }
+    static constexpr std::size_t byte_size()
+    {
+      return terrain_tile_layout::chunk_count * sizeof (terrain_chunk_parameters);
+    }
+
+    void set (std::size_t chunk, terrain_chunk_parameters const&);
+
+    //! calls upload with the byte offset and size of every run of changed
+    //! chunks, then forgets the changes
+    void upload_changes (std::function<void (std::size_t offset, std::size_t size, void const* data)> const& upload);
+    //! once the whole block was sent
+    void forget_changes();
+
+  private:
+    std::array<terrain_chunk_parameters, terrain_tile_layout::chunk_count> _parameters;
+    std::array<bool, terrain_tile_layout::chunk_count> _changed;
+    std::size_t _first_changed;
+    std::size_t _last_changed;
+  };
+
+  //! The visible chunks of a tile grouped by the textures they use, so that
+  //! a tile is drawn with one multi draw per group instead of one draw per
+  //! chunk. The arrays of a batch are the ones glMultiDrawElementsBaseVertex
+  //! takes.
+  class terrain_draw_list
+  {
+  public:
+    //! blp ids of the texture layers, -1 for the unused ones
+    using texture_key = std::array<int, 4>;
+
+    struct batch
+    {
+      texture_key textures;
+      //! a chunk using them, to bind them
+      std::size_t chunk;
+      //! into counts(), index_offsets() and base_vertices()
+      std::size_t first;
+      std::size_t count;
+    };
+
+    void clear();
+    //! count indices of chunk, starting at first_index
+    void add (texture_key const& textures, std::size_t chunk, std::size_t first_index, std::size_t count);
+    //! groups the chunks added since clear()
+    void finish();
+
+    bool empty() const { return _chunks.empty(); }
+    std::vector<batch> const& batches() const { return _batches; }
+    std::vector<std::int32_t> const& counts() const { return _counts; }
+    //! in bytes, as pointers like the GL takes them
+    std::vector<void const*> const& index_offsets() const { return _index_offsets; }
+    std::vector<std::int32_t> const& base_vertices() const { return _base_vertices; }
+
+  private:
+    struct chunk_draw
+    {
+      texture_key textures;
+      std::size_t chunk;
+      std::size_t first_index;
+      std::size_t count;
+    };
+
+    std::vector<chunk_draw> _chunks;
+    std::vector<batch> _batches;
+    std::vector<std::int32_t> _counts;
+    std::vector<void const*> _index_offsets;
+    std::vector<std::int32_t> _base_vertices;
+  };
+}
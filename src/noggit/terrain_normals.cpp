@@ -0,0 +1,221 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/MapHeaders.h>
+#include <noggit/terrain_normals.hpp>
+
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define NOGGIT_TERRAIN_NORMALS_SSE2
+  #include <emmintrin.h>
+#endif
+
+namespace noggit
+{
+  namespace terrain_normals
+  {
+    namespace
+    {
+      std::size_t const vertex_count (9 * 9 + 8 * 8);
+
+      float inner_height (math::vector_3d const* vertices, int z, int x)
+      {
+        return vertices[17 * z + 9 + x].y;
+      }
+
+      float outer_height (math::vector_3d const* vertices, int z, int x)
+      {
+        return vertices[17 * z + x].y;
+      }
+
+      //! normals are stored with 8 bits per component
+      float quantize (float x)
+      {
+        return std::floor (x * 127) / 127;
+      }
+    }
+
+    halo make_halo (std::array<math::vector_3d const*, 9> const& chunks)
+    {
+      halo result;
+      for (auto& row : result)
+      {
+        row.fill (std::numeric_limits<float>::quiet_NaN());
+      }
+
+      for (int z (0); z < 8; ++z)
+      {
+        for (int x (0); x < 8; ++x)
+        {
+          result[z + 1][x + 1] = inner_height (chunks[4], z, x);
+        }
+      }
+
+      for (int i (0); i < 8; ++i)
+      {
+        if (chunks[1])
+        {
+          result[0][i + 1] = inner_height (chunks[1], 7, i);
+        }
+        if (chunks[7])
+        {
+          result[9][i + 1] = inner_height (chunks[7], 0, i);
+        }
+        if (chunks[3])
+        {
+          result[i + 1][0] = inner_height (chunks[3], i, 7);
+        }
+        if (chunks[5])
+        {
+          result[i + 1][9] = inner_height (chunks[5], i, 0);
+        }
+      }
+
+      if (chunks[0])
+      {
+        result[0][0] = inner_height (chunks[0], 7, 7);
+      }
+      if (chunks[2])
+      {
+        result[0][9] = inner_height (chunks[2], 7, 0);
+      }
+      if (chunks[6])
+      {
+        result[9][0] = inner_height (chunks[6], 0, 7);
+      }
+      if (chunks[8])
+      {
+        result[9][9] = inner_height (chunks[8], 0, 0);
+      }
+
+      return result;
+    }
+
+    std::size_t compute ( math::vector_3d const* vertices
+                        , halo const& heights
+                        , math::vector_3d const& min
+                        , math::vector_3d const& max
+                        , math::vector_3d* normals
+                        )
+    {
+      // heights around each vertex in the dirty area: -x-z, +x-z, +x+z, -x+z
+      std::array<int, vertex_count> indices;
+      std::array<float, vertex_count> h1, h2, h3, h4;
+      std::size_t count (0);
+
+      for (int row (0); row < 17; ++row)
+      {
+        bool const outer (row % 2 == 0);
+        int const z (row / 2);
+
+        for (int x (0); x < (outer ? 9 : 8); ++x)
+        {
+          int const index (17 * z + (outer ? 0 : 9) + x);
+          math::vector_3d const& v (vertices[index]);
+
+          if (v.x < min.x || v.x > max.x || v.z < min.z || v.z > max.z)
+          {
+            continue;
+          }
+
+          float around[4];
+          if (outer)
+          {
+            around[0] = heights[z][x];
+            around[1] = heights[z][x + 1];
+            around[2] = heights[z + 1][x + 1];
+            around[3] = heights[z + 1][x];
+          }
+          else
+          {
+            around[0] = outer_height (vertices, z, x);
+            around[1] = outer_height (vertices, z, x + 1);
+            around[2] = outer_height (vertices, z + 1, x + 1);
+            around[3] = outer_height (vertices, z + 1, x);
+          }
+
+          // a neighbour that isn't loaded falls back to the vertex' own
+          // height, like World::GetVertex failing did before
+          for (float& h : around)
+          {
+            if (std::isnan (h))
+            {
+              h = v.y;
+            }
+          }
+
+          indices[count] = index;
+          h1[count] = around[0];
+          h2[count] = around[1];
+          h3[count] = around[2];
+          h4[count] = around[3];
+          ++count;
+        }
+      }
+
+      // the sum of the four triangles' cross products simplifies to
+      // 2 * half_unit * (h1 - h2 - h3 + h4, 4 * half_unit, h1 + h2 - h3 - h4)
+      float const up (2.f * UNITSIZE);
+      std::array<float, vertex_count> nx, ny, nz;
+
+      std::size_t i (0);
+#if defined(NOGGIT_TERRAIN_NORMALS_SSE2)
+      __m128 const y (_mm_set1_ps (up));
+      __m128 const one (_mm_set1_ps (1.f));
+      __m128 const scale (_mm_set1_ps (127.f));
+
+      auto const quantize4
+        ( [&] (__m128 x)
+          {
+            // floor without SSE4.1: truncate, then step down the negative
+            // values that were rounded up
+            __m128 const scaled (_mm_mul_ps (x, scale));
+            __m128 const truncated (_mm_cvtepi32_ps (_mm_cvttps_epi32 (scaled)));
+            __m128 const floored
+              (_mm_sub_ps (truncated, _mm_and_ps (_mm_cmpgt_ps (truncated, scaled), one)));
+            return _mm_div_ps (floored, scale);
+          }
+        );
+
+      for (; i + 4 <= count; i += 4)
+      {
+        __m128 const a (_mm_loadu_ps (&h1[i]));
+        __m128 const b (_mm_loadu_ps (&h2[i]));
+        __m128 const c (_mm_loadu_ps (&h3[i]));
+        __m128 const d (_mm_loadu_ps (&h4[i]));
+
+        __m128 const x (_mm_add_ps (_mm_sub_ps (_mm_sub_ps (a, b), c), d));
+        __m128 const z (_mm_sub_ps (_mm_sub_ps (_mm_add_ps (a, b), c), d));
+        __m128 const inverse_length
+          ( _mm_div_ps
+              ( one
+              , _mm_sqrt_ps (_mm_add_ps (_mm_add_ps (_mm_mul_ps (x, x), _mm_mul_ps (y, y)), _mm_mul_ps (z, z)))
+              )
+          );
+
+        _mm_storeu_ps (&nx[i], quantize4 (_mm_mul_ps (x, inverse_length)));
+        _mm_storeu_ps (&nz[i], quantize4 (_mm_mul_ps (z, inverse_length)));
+        _mm_storeu_ps (&ny[i], quantize4 (_mm_mul_ps (y, inverse_length)));
+      }
+#endif
+      for (; i < count; ++i)
+      {
+        float const x (h1[i] - h2[i] - h3[i] + h4[i]);
+        float const z (h1[i] + h2[i] - h3[i] - h4[i]);
+        float const inverse_length (1.f / std::sqrt (x * x + up * up + z * z));
+
+        nx[i] = quantize (x * inverse_length);
+        nz[i] = quantize (z * inverse_length);
+        ny[i] = quantize (up * inverse_length);
+      }
+
+      for (i = 0; i < count; ++i)
+      {
+        normals[indices[i]] = {-nz[i], ny[i], -nx[i]};
+      }
+
+      return count;
+    }
+  }
+}
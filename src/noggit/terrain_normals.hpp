@@ -0,0 +1,38 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <math/vector_3d.hpp>
+
+#include <array>
+#include <cstddef>
+
+//! Chunk normals computed from a stitched height grid instead of world
+//! height lookups. A vertex' normal only depends on the four vertices half a
+//! unit away diagonally, which for the border vertices are the inner
+//! vertices of the neighbouring chunks.
+namespace noggit
+{
+  namespace terrain_normals
+  {
+    //! heights of the 8x8 inner vertices of a chunk with a border of one
+    //! vertex taken from its eight neighbours, indexed [z + 1][x + 1].
+    //! NaN where the neighbour isn't loaded, the vertex' own height is used
+    //! instead.
+    using halo = std::array<std::array<float, 10>, 10>;
+
+    //! chunks holds the vertices (MCVT order) of the 3x3 chunks centered on
+    //! the chunk, along x then z, nullptr for the ones not loaded
+    halo make_halo (std::array<math::vector_3d const*, 9> const& chunks);
+
+    //! recomputes the normals of the vertices inside [min, max] on the xz
+    //! plane, uses SSE2 when the compiler targets it
+    //! \return the number of recomputed normals
+    std::size_t compute ( math::vector_3d const* vertices
+                        , halo const&
+                        , math::vector_3d const& min
+                        , math::vector_3d const& max
+                        , math::vector_3d* normals
+                        );
+  }
+}
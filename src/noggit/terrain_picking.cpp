@@ -0,0 +1,277 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/terrain_picking.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace noggit
+{
+  namespace terrain_picking
+  {
+    namespace
+    {
+      int const level_offsets[4] = {0, 1, 5, 21};
+
+      int outer (int z, int x)
+      {
+        return 17 * z + x;
+      }
+
+      int inner (int z, int x)
+      {
+        return 17 * z + 9 + x;
+      }
+
+      //! the node bounds are padded so that the rounding of the slab test
+      //! never rejects a triangle the ray touches on a node's border
+      float const margin (0.01f);
+
+      //! how close in distance two grid lines have to be crossed for the
+      //! ray to be considered going through their corner
+      float const corner_margin (0.01f);
+    }
+
+    void height_quadtree::update (math::vector_3d const* vertices)
+    {
+      for (int z (0); z < 8; ++z)
+      {
+        for (int x (0); x < 8; ++x)
+        {
+          float const heights[5] = { vertices[inner (z, x)].y
+                                   , vertices[outer (z, x)].y
+                                   , vertices[outer (z, x + 1)].y
+                                   , vertices[outer (z + 1, x)].y
+                                   , vertices[outer (z + 1, x + 1)].y
+                                   };
+
+          int const index (level_offsets[3] + z * 8 + x);
+          _min[index] = *std::min_element (std::begin (heights), std::end (heights));
+          _max[index] = *std::max_element (std::begin (heights), std::end (heights));
+        }
+      }
+
+      for (int level (2); level >= 0; --level)
+      {
+        int const size (1 << level);
+
+        for (int z (0); z < size; ++z)
+        {
+          for (int x (0); x < size; ++x)
+          {
+            int const index (level_offsets[level] + z * size + x);
+            int const child (level_offsets[level + 1] + 2 * z * 2 * size + 2 * x);
+            int const children[4] = {child, child + 1, child + 2 * size, child + 2 * size + 1};
+
+            _min[index] = std::numeric_limits<float>::max();
+            _max[index] = std::numeric_limits<float>::lowest();
+
+            for (int c : children)
+            {
+              _min[index] = std::min (_min[index], _min[c]);
+              _max[index] = std::max (_max[index], _max[c]);
+            }
+          }
+        }
+      }
+    }
+
+    void height_quadtree::intersect ( math::ray const& ray
+                                    , math::vector_3d const* vertices
+                                    , hit_callback const& hit
+                                    ) const
+    {
+      intersect (0, 0, 0, ray, vertices, hit);
+    }
+
+    void height_quadtree::intersect ( int level
+                                    , int z
+                                    , int x
+                                    , math::ray const& ray
+                                    , math::vector_3d const* vertices
+                                    , hit_callback const& hit
+                                    ) const
+    {
+      int const units (8 >> level);
+      int const z0 (z * units);
+      int const x0 (x * units);
+      int const index (level_offsets[level] + z * (1 << level) + x);
+
+      math::vector_3d const& corner_min (vertices[outer (z0, x0)]);
+      math::vector_3d const& corner_max (vertices[outer (z0 + units, x0 + units)]);
+
+      if (!ray.intersect_bounds ( {corner_min.x - margin, _min[index] - margin, corner_min.z - margin}
+                                , {corner_max.x + margin, _max[index] + margin, corner_max.z + margin}
+                                )
+         )
+      {
+        return;
+      }
+
+      if (level < 3)
+      {
+        for (int dz (0); dz < 2; ++dz)
+        {
+          for (int dx (0); dx < 2; ++dx)
+          {
+            intersect (level + 1, 2 * z + dz, 2 * x + dx, ray, vertices, hit);
+          }
+        }
+        return;
+      }
+
+      int const center (inner (z, x));
+      int const around[5] = { outer (z, x)
+                            , outer (z + 1, x)
+                            , outer (z + 1, x + 1)
+                            , outer (z, x + 1)
+                            , outer (z, x)
+                            };
+
+      for (int i (0); i < 4; ++i)
+      {
+        if ( auto distance = ray.intersect_triangle
+                               (vertices[center], vertices[around[i]], vertices[around[i + 1]])
+           )
+        {
+          hit (*distance, std::make_tuple (center, around[i], around[i + 1]));
+        }
+      }
+    }
+
+    void walk_grid ( math::ray const& ray
+                   , float cell_size
+                   , int begin_x
+                   , int begin_z
+                   , int end_x
+                   , int end_z
+                   , std::function<void (int x, int z)> const& visit
+                   )
+    {
+      if (begin_x >= end_x || begin_z >= end_z)
+      {
+        return;
+      }
+
+      math::vector_3d const& origin (ray.origin());
+      math::vector_3d const& direction (ray.direction());
+
+      // part of the ray above the grid
+      float t_min (0.f);
+      float t_max (std::numeric_limits<float>::max());
+
+      auto const clip
+        ( [&] (float o, float d, int begin, int end)
+          {
+            float const low (begin * cell_size);
+            float const high (end * cell_size);
+
+            if (d == 0.f)
+            {
+              return o >= low && o <= high;
+            }
+
+            float const t1 ((low - o) / d);
+            float const t2 ((high - o) / d);
+            t_min = std::max (t_min, std::min (t1, t2));
+            t_max = std::min (t_max, std::max (t1, t2));
+            return t_min <= t_max;
+          }
+        );
+
+      if (!clip (origin.x, direction.x, begin_x, end_x) || !clip (origin.z, direction.z, begin_z, end_z))
+      {
+        return;
+      }
+
+      auto const cell
+        ( [&] (float position, int begin, int end)
+          {
+            return std::min ( end - 1
+                            , std::max (begin, static_cast<int> (std::floor (position / cell_size)))
+                            );
+          }
+        );
+
+      int x (cell (origin.x + direction.x * t_min, begin_x, end_x));
+      int z (cell (origin.z + direction.z * t_min, begin_z, end_z));
+
+      if (direction.x == 0.f && direction.z == 0.f)
+      {
+        visit (x, z);
+        return;
+      }
+
+      auto const step
+        ( [&] (float o, float d, int c, int& step, float& next, float& delta)
+          {
+            if (d == 0.f)
+            {
+              step = 0;
+              next = std::numeric_limits<float>::infinity();
+              delta = std::numeric_limits<float>::infinity();
+              return;
+            }
+
+            step = d > 0.f ? 1 : -1;
+            next = ((c + (d > 0.f ? 1 : 0)) * cell_size - o) / d;
+            delta = cell_size / std::abs (d);
+          }
+        );
+
+      int step_x, step_z;
+      float next_x, next_z, delta_x, delta_z;
+      step (origin.x, direction.x, x, step_x, next_x, delta_x);
+      step (origin.z, direction.z, z, step_z, next_z, delta_z);
+
+      auto const inside
+        ( [&] (int cx, int cz)
+          {
+            return cx >= begin_x && cx < end_x && cz >= begin_z && cz < end_z;
+          }
+        );
+
+      for (;;)
+      {
+        visit (x, z);
+
+        bool const along_x (next_x < next_z);
+        float const next (along_x ? next_x : next_z);
+
+        if (next > t_max)
+        {
+          return;
+        }
+
+        // the rounding may make the ray go through the wrong side of a
+        // corner, visit the cell on the other side too
+        if (std::abs (next_x - next_z) < corner_margin)
+        {
+          int const cx (along_x ? x : x + step_x);
+          int const cz (along_x ? z + step_z : z);
+          if (inside (cx, cz))
+          {
+            visit (cx, cz);
+          }
+        }
+
+        if (along_x)
+        {
+          x += step_x;
+          next_x += delta_x;
+        }
+        else
+        {
+          z += step_z;
+          next_z += delta_z;
+        }
+
+        if (!inside (x, z))
+        {
+          return;
+        }
+      }
+    }
+  }
+}
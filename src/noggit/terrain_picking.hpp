@@ -0,0 +1,66 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <math/ray.hpp>
+#include <math/vector_3d.hpp>
+
+#include <array>
+#include <functional>
+#include <tuple>
+
+//! Terrain ray picking which only tests the triangles of the cells the ray
+//! crosses: a grid walk finds the chunks under the ray and a min/max height
+//! quadtree per chunk finds the units in them.
+namespace noggit
+{
+  namespace terrain_picking
+  {
+    //! bounds of the heights of a chunk's 8x8 units (four triangles around
+    //! each inner vertex) and of their 4x4, 2x2 and 1x1 groups. The x and z
+    //! bounds are read from the vertices.
+    class height_quadtree
+    {
+    public:
+      using hit_callback
+        = std::function<void (float distance, std::tuple<int, int, int> const& triangle)>;
+
+      //! recomputes the bounds from the vertices (MCVT order), has to be
+      //! called whenever their heights change
+      void update (math::vector_3d const* vertices);
+
+      //! calls hit for every triangle of the chunk the ray intersects,
+      //! holes included, four per unit around its inner vertex
+      void intersect ( math::ray const&
+                     , math::vector_3d const* vertices
+                     , hit_callback const& hit
+                     ) const;
+
+    private:
+      void intersect ( int level
+                     , int z
+                     , int x
+                     , math::ray const&
+                     , math::vector_3d const* vertices
+                     , hit_callback const& hit
+                     ) const;
+
+      // 1 + 2x2 + 4x4 + 8x8 nodes, level by level, row by row
+      std::array<float, 85> _min;
+      std::array<float, 85> _max;
+    };
+
+    //! calls visit for the cells of a grid of cell_size squares aligned on
+    //! the origin whose index is in [begin, end), in the order the
+    //! projection of the ray on the xz plane crosses them. The cells
+    //! diagonal to a corner the ray goes (nearly) through are visited too.
+    void walk_grid ( math::ray const&
+                   , float cell_size
+                   , int begin_x
+                   , int begin_z
+                   , int end_x
+                   , int end_z
+                   , std::function<void (int x, int z)> const& visit
+                   );
+  }
+}
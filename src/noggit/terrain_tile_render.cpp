@@ -0,0 +1,147 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/terrain_tile_render.hpp>
+#include <opengl/context.hpp>
+#include <opengl/scoped.hpp>
+#include <opengl/shader.hpp>
+
+namespace noggit
+{
+  namespace
+  {
+    std::size_t const vertex_buffer_size
+      (terrain_tile_layout::chunk_count * terrain_tile_layout::vertices_per_chunk * sizeof (math::vector_3d));
+    std::size_t const chunk_vertices_size
+      (terrain_tile_layout::vertices_per_chunk * sizeof (math::vector_3d));
+  }
+
+  void terrain_tile_render::upload (opengl::scoped::use_program& mcnk_shader, GLuint const& tex_coord_vbo)
+  {
+    _vertex_array.upload();
+    _buffers.upload();
+
+    gl.bufferData<GL_ARRAY_BUFFER> (_vertices_vbo, vertex_buffer_size, nullptr, GL_STATIC_DRAW);
+    gl.bufferData<GL_ARRAY_BUFFER> (_normals_vbo, vertex_buffer_size, nullptr, GL_STATIC_DRAW);
+    gl.bufferData<GL_ARRAY_BUFFER> (_mccv_vbo, vertex_buffer_size, nullptr, GL_STATIC_DRAW);
+    gl.bufferData<GL_UNIFORM_BUFFER> ( _parameters_buffer
+                                     , terrain_chunk_parameters_block::byte_size()
+                                     , _parameters.data()
+                                     , GL_DYNAMIC_DRAW
+                                     );
+    _parameters.forget_changes();
+
+    {
+      opengl::scoped::vao_binder const _ (_vao);
+
+      mcnk_shader.attrib (_, "position", _vertices_vbo, 3, GL_FLOAT, GL_FALSE, 0, 0);
+      mcnk_shader.attrib (_, "normal", _normals_vbo, 3, GL_FLOAT, GL_FALSE, 0, 0);
+      mcnk_shader.attrib (_, "mccv", _mccv_vbo, 3, GL_FLOAT, GL_FALSE, 0, 0);
+      mcnk_shader.attrib (_, "texcoord", tex_coord_vbo, 2, GL_FLOAT, GL_FALSE, 0, 0);
+
+      // the index buffer stays bound to the vao
+      gl.bindBuffer (GL_ELEMENT_ARRAY_BUFFER, _indices_buffer);
+      gl.bufferData ( GL_ELEMENT_ARRAY_BUFFER
+                    , terrain_tile_layout::chunk_count * terrain_tile_layout::indices_per_chunk
+                    * sizeof (terrain_tile_layout::index_type)
+                    , nullptr
+                    , GL_STATIC_DRAW
+                    );
+    }
+
+    _alphamaps.bind();
+    gl.texImage3D ( GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8
+                  , terrain_alphamap_layer::size, terrain_alphamap_layer::size, terrain_tile_layout::chunk_count
+                  , 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr
+                  );
+    gl.texParameteri (GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    gl.texParameteri (GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    gl.texParameteri (GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    gl.texParameteri (GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    _uploaded = true;
+  }
+
+  void terrain_tile_render::set_vertices (std::size_t chunk, math::vector_3d const* vertices)
+  {
+    gl.bufferSubData<GL_ARRAY_BUFFER> (_vertices_vbo, chunk * chunk_vertices_size, chunk_vertices_size, vertices);
+  }
+
+  void terrain_tile_render::set_normals (std::size_t chunk, math::vector_3d const* normals)
+  {
+    gl.bufferSubData<GL_ARRAY_BUFFER> (_normals_vbo, chunk * chunk_vertices_size, chunk_vertices_size, normals);
+  }
+
+  void terrain_tile_render::set_colors (std::size_t chunk, math::vector_3d const* mccv)
+  {
+    gl.bufferSubData<GL_ARRAY_BUFFER> (_mccv_vbo, chunk * chunk_vertices_size, chunk_vertices_size, mccv);
+  }
+
+  void terrain_tile_render::set_indices
+    ( std::size_t chunk
+    , std::vector<terrain_tile_layout::index_type> const& strip
+    , std::array<std::vector<terrain_tile_layout::index_type>, 4> const& lod_strips
+    )
+  {
+    opengl::scoped::vao_binder const _ (_vao);
+
+    auto const write
+      ( [&] (boost::optional<int> lod_level, std::vector<terrain_tile_layout::index_type> const& indices)
+        {
+          gl.bufferSubData ( GL_ELEMENT_ARRAY_BUFFER
+                           , terrain_tile_layout::first_index (chunk, lod_level) * sizeof (terrain_tile_layout::index_type)
+                           , indices.size() * sizeof (terrain_tile_layout::index_type)
+                           , indices.data()
+                           );
+        }
+      );
+
+    write (boost::none, strip);
+    for (int lod_level = 0; lod_level < 4; ++lod_level)
+    {
+      write (lod_level, lod_strips[lod_level]);
+    }
+  }
+
+  void terrain_tile_render::set_alphamap (std::size_t chunk, std::uint8_t const* rgba)
+  {
+    _alphamaps.bind();
+    gl.texSubImage3D ( GL_TEXTURE_2D_ARRAY, 0, 0, 0, chunk
+                     , terrain_alphamap_layer::size, terrain_alphamap_layer::size, 1
+                     , GL_RGBA, GL_UNSIGNED_BYTE, rgba
+                     );
+  }
+
+  void terrain_tile_render::draw ( terrain_draw_list const& draw_list
+                                 , std::function<void (std::size_t chunk)> const& bind_textures
+                                 )
+  {
+    // most chunks keep their parameters from one frame to the next, only
+    // the animated textures and overlays change them
+    _parameters.upload_changes
+      ( [&] (std::size_t offset, std::size_t size, void const* data)
+        {
+          gl.bufferSubData<GL_UNIFORM_BUFFER> (_parameters_buffer, offset, size, data);
+        }
+      );
+    gl.bindBufferBase (GL_UNIFORM_BUFFER, parameters_binding, _parameters_buffer);
+
+    opengl::texture::set_active_texture (0);
+    _alphamaps.bind();
+
+    opengl::scoped::vao_binder const _ (_vao);
+
+    for (terrain_draw_list::batch const& batch : draw_list.batches())
+    {
+      bind_textures (batch.chunk);
+
+      gl.multiDrawElementsBaseVertex ( GL_TRIANGLES
+                                     , draw_list.counts().data() + batch.first
+                                     , GL_UNSIGNED_SHORT
+                                     , opengl::index_buffer_is_already_bound{}
+                                     , draw_list.index_offsets().data() + batch.first
+                                     , batch.count
+                                     , draw_list.base_vertices().data() + batch.first
+                                     );
+    }
+  }
+}
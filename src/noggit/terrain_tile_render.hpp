@@ -0,0 +1,69 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <math/vector_3d.hpp>
+#include <noggit/terrain_draw_list.hpp>
+#include <opengl/scoped.hpp>
+#include <opengl/shader.fwd.hpp>
+#include <opengl/texture.hpp>
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace noggit
+{
+  //! The GL objects of a tile's terrain: its 256 chunks share the vertex
+  //! buffers, the index buffer (see terrain_tile_layout), one alphamap
+  //! texture array and the buffer of their shader parameters, so that a
+  //! tile is drawn with a multi draw per terrain_draw_list batch.
+  class terrain_tile_render
+  {
+  public:
+    //! where the "chunks" uniform block of the terrain shader is bound
+    static constexpr GLuint parameters_binding = 0;
+
+    bool uploaded() const { return _uploaded; }
+    void upload (opengl::scoped::use_program& mcnk_shader, GLuint const& tex_coord_vbo);
+
+    //! terrain_tile_layout::vertices_per_chunk values each
+    void set_vertices (std::size_t chunk, math::vector_3d const* vertices);
+    void set_normals (std::size_t chunk, math::vector_3d const* normals);
+    void set_colors (std::size_t chunk, math::vector_3d const* mccv);
+    void set_indices ( std::size_t chunk
+                     , std::vector<terrain_tile_layout::index_type> const& strip
+                     , std::array<std::vector<terrain_tile_layout::index_type>, 4> const& lod_strips
+                     );
+    //! see terrain_alphamap_layer
+    void set_alphamap (std::size_t chunk, std::uint8_t const* rgba);
+
+    //! only sent by draw if they changed
+    void set_parameters (std::size_t chunk, terrain_chunk_parameters const& parameters)
+    {
+      _parameters.set (chunk, parameters);
+    }
+
+    //! bind_textures binds the ground textures of a batch, given its chunk
+    void draw ( terrain_draw_list const&
+              , std::function<void (std::size_t chunk)> const& bind_textures
+              );
+
+  private:
+    bool _uploaded = false;
+
+    opengl::scoped::deferred_upload_vertex_arrays<1> _vertex_array;
+    GLuint const& _vao = _vertex_array[0];
+    opengl::scoped::deferred_upload_buffers<5> _buffers;
+    GLuint const& _vertices_vbo = _buffers[0];
+    GLuint const& _normals_vbo = _buffers[1];
+    GLuint const& _mccv_vbo = _buffers[2];
+    GLuint const& _indices_buffer = _buffers[3];
+    GLuint const& _parameters_buffer = _buffers[4];
+
+    opengl::texture_array _alphamaps;
+
+    terrain_chunk_parameters_block _parameters;
+  };
+}
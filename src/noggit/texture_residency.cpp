@@ -0,0 +1,188 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/texture_residency.hpp>
+
+#include <algorithm>
+#include <utility>
+
+namespace noggit
+{
+  texture_residency::texture_residency (std::size_t budget, std::uint64_t idle_frames)
+    : _budget (budget)
+    , _idle_frames (idle_frames)
+  {}
+
+  void texture_residency::set_budget (std::size_t bytes)
+  {
+    std::lock_guard<std::mutex> const lock (_mutex);
+    _budget = bytes;
+  }
+
+  void texture_residency::add (texture_id id)
+  {
+    std::lock_guard<std::mutex> const lock (_mutex);
+    _entries[id].last_used = _frame;
+  }
+
+  void texture_residency::remove (texture_id id)
+  {
+    std::lock_guard<std::mutex> const lock (_mutex);
+
+    auto const it (_entries.find (id));
+    if (it == _entries.end())
+    {
+      return;
+    }
+
+    _cpu_bytes -= it->second.cpu_bytes;
+    _gpu_bytes -= it->second.gpu_bytes;
+    _reserved_bytes -= it->second.reserved_bytes;
+    _entries.erase (it);
+  }
+
+  void texture_residency::set_cpu_bytes (texture_id id, std::size_t bytes)
+  {
+    std::lock_guard<std::mutex> const lock (_mutex);
+
+    entry& texture (_entries[id]);
+    _cpu_bytes = _cpu_bytes - texture.cpu_bytes + bytes;
+    texture.cpu_bytes = bytes;
+  }
+
+  void texture_residency::set_gpu_bytes (texture_id id, std::size_t bytes, bool full_detail)
+  {
+    std::lock_guard<std::mutex> const lock (_mutex);
+
+    entry& texture (_entries[id]);
+    _gpu_bytes = _gpu_bytes - texture.gpu_bytes + bytes;
+    _reserved_bytes -= texture.reserved_bytes;
+    texture.gpu_bytes = bytes;
+    texture.reserved_bytes = 0;
+    texture.full_detail = full_detail;
+  }
+
+  void texture_residency::used (texture_id id)
+  {
+    std::lock_guard<std::mutex> const lock (_mutex);
+    _entries[id].last_used = _frame;
+  }
+
+  bool texture_residency::try_promote (texture_id id, std::size_t full_detail_bytes)
+  {
+    std::lock_guard<std::mutex> const lock (_mutex);
+
+    entry& texture (_entries[id]);
+    if (texture.full_detail || texture.reserved_bytes)
+    {
+      return false;
+    }
+
+    std::size_t const additional_bytes
+      (full_detail_bytes > texture.gpu_bytes ? full_detail_bytes - texture.gpu_bytes : 0);
+    if (_gpu_bytes + _reserved_bytes + additional_bytes > _budget)
+    {
+      // a texture is asked to be promoted each time it is drawn
+      if (texture.refused_frame != _frame)
+      {
+        _refused_bytes += additional_bytes;
+        texture.refused_frame = _frame;
+      }
+      return false;
+    }
+
+    // at least one byte, to know it is in progress
+    texture.reserved_bytes = std::max<std::size_t> (additional_bytes, 1);
+    _reserved_bytes += texture.reserved_bytes;
+    ++_promotions;
+
+    return true;
+  }
+
+  void texture_residency::promotion_failed (texture_id id)
+  {
+    std::lock_guard<std::mutex> const lock (_mutex);
+
+    entry& texture (_entries[id]);
+    _reserved_bytes -= texture.reserved_bytes;
+    texture.reserved_bytes = 0;
+  }
+
+  void texture_residency::promotion_loaded (texture_id id)
+  {
+    std::lock_guard<std::mutex> const lock (_mutex);
+    _loaded_promotions.emplace_back (id);
+  }
+
+  std::vector<texture_residency::texture_id> texture_residency::take_loaded_promotions()
+  {
+    std::lock_guard<std::mutex> const lock (_mutex);
+
+    std::vector<texture_id> loaded;
+    std::swap (loaded, _loaded_promotions);
+    return loaded;
+  }
+
+  std::vector<texture_residency::texture_id> texture_residency::next_frame()
+  {
+    std::lock_guard<std::mutex> const lock (_mutex);
+
+    ++_frame;
+
+    std::vector<texture_id> demoted;
+
+    // room is also made for the promotions refused this frame
+    std::size_t used_bytes (_gpu_bytes + _reserved_bytes + _refused_bytes);
+    _refused_bytes = 0;
+
+    if (used_bytes <= _budget)
+    {
+      return demoted;
+    }
+
+    std::vector<std::pair<std::uint64_t, texture_id>> candidates;
+    for (auto const& texture : _entries)
+    {
+      if ( texture.second.full_detail
+        && !texture.second.reserved_bytes
+        && _frame - texture.second.last_used >= _idle_frames
+         )
+      {
+        candidates.emplace_back (texture.second.last_used, texture.first);
+      }
+    }
+    std::sort (candidates.begin(), candidates.end());
+
+    // counted as freed entirely, the low detail levels are a fraction of it
+    for (auto const& candidate : candidates)
+    {
+      if (used_bytes <= _budget)
+      {
+        break;
+      }
+
+      used_bytes -= _entries.at (candidate.second).gpu_bytes;
+      demoted.emplace_back (candidate.second);
+      ++_demotions;
+    }
+
+    return demoted;
+  }
+
+  texture_residency::counters texture_residency::stats() const
+  {
+    std::lock_guard<std::mutex> const lock (_mutex);
+
+    std::size_t const low_detail_textures
+      ( std::count_if ( _entries.begin(), _entries.end()
+                      , [] (std::pair<texture_id const, entry> const& texture)
+                        {
+                          return !texture.second.full_detail;
+                        }
+                      )
+      );
+
+    return { _budget, _cpu_bytes, _gpu_bytes, _entries.size(), low_detail_textures
+           , _promotions, _demotions
+           };
+  }
+}
@@ -0,0 +1,106 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <boost/optional.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace noggit
+{
+  //! Memory accounting of the textures, which are loaded with their low
+  //! detail mip levels only and promoted to all of them once drawn, if
+  //! they fit in the budget. When the GPU memory and the refused promotions
+  //! exceed it, the least recently drawn textures not drawn for idle_frames
+  //! are demoted back to their low detail levels to make room.
+  //! \note thread safe, the textures are loaded on other threads
+  class texture_residency
+  {
+  public:
+    using texture_id = int;
+
+    struct counters
+    {
+      std::size_t budget;
+      std::size_t cpu_bytes;
+      std::size_t gpu_bytes;
+      std::size_t textures;
+      std::size_t low_detail_textures;
+      std::uint64_t promotions;
+      std::uint64_t demotions;
+    };
+
+    //! levels of at most this size are the low detail ones
+    static constexpr int low_detail_size = 64;
+
+    explicit texture_residency (std::size_t budget, std::uint64_t idle_frames = 300);
+
+    void set_budget (std::size_t bytes);
+
+    void add (texture_id);
+    void remove (texture_id);
+
+    //! what the texture holds in memory, e.g. levels waiting to be uploaded
+    void set_cpu_bytes (texture_id, std::size_t bytes);
+    //! what the texture's uploaded levels take
+    void set_gpu_bytes (texture_id, std::size_t bytes, bool full_detail);
+
+    //! the texture is drawn this frame
+    void used (texture_id);
+
+    //! reserves the room to promote a low detail texture to full_detail_bytes
+    //! if it fits in the budget. The reservation ends with set_gpu_bytes.
+    //! A refused promotion makes the next frame demote idle textures, the
+    //! room refused to a texture counting once per frame.
+    bool try_promote (texture_id, std::size_t full_detail_bytes);
+
+    //! ends the reservation of a promotion which couldn't be loaded, the
+    //! texture keeping its gpu bytes
+    void promotion_failed (texture_id);
+    //! the levels of a promotion are loaded and wait to be uploaded
+    void promotion_loaded (texture_id);
+    //! the textures whose promotion was loaded since the last call, to be
+    //! uploaded even if they aren't drawn anymore
+    std::vector<texture_id> take_loaded_promotions();
+
+    //! ends the frame and returns the textures to demote, least recently
+    //! used first, which are expected to be demoted before the next one
+    std::vector<texture_id> next_frame();
+
+    counters stats() const;
+
+  private:
+    struct entry
+    {
+      std::size_t cpu_bytes = 0;
+      std::size_t gpu_bytes = 0;
+      //! room taken for a promotion in progress
+      std::size_t reserved_bytes = 0;
+      bool full_detail = false;
+      std::uint64_t last_used = 0;
+      //! the last frame a promotion of the texture was refused
+      boost::optional<std::uint64_t> refused_frame;
+    };
+
+    mutable std::mutex _mutex;
+
+    std::size_t _budget;
+    std::uint64_t const _idle_frames;
+    std::uint64_t _frame = 0;
+
+    std::unordered_map<texture_id, entry> _entries;
+
+    std::size_t _cpu_bytes = 0;
+    std::size_t _gpu_bytes = 0;
+    std::size_t _reserved_bytes = 0;
+    //! by try_promote since the last frame
+    std::size_t _refused_bytes = 0;
+    std::vector<texture_id> _loaded_promotions;
+    std::uint64_t _promotions = 0;
+    std::uint64_t _demotions = 0;
+  };
+}
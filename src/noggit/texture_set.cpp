@@ -6,6 +6,8 @@
 #include <noggit/Misc.h>
 #include <noggit/TextureManager.h> // TextureManager, Texture
 #include <noggit/World.h>
+#include <noggit/alphamap_codec.hpp>
+#include <noggit/terrain_draw_list.hpp>
 #include <noggit/texture_set.hpp>
 
 #include <algorithm>    // std::min
@@ -373,27 +375,30 @@ int TextureSet::get_texture_index_or_add (scoped_blp_texture_reference texture,
   return addTexture (std::move (texture));
 }
 
-bool TextureSet::paintTexture(float xbase, float zbase, float x, float z, Brush* brush, float strength, float pressure, scoped_blp_texture_reference texture)
+int TextureSet::prepare_paint(float xbase, float zbase, float x, float z, Brush* brush, float strength, scoped_blp_texture_reference texture)
 {
-  bool changed = false;
-
-  float zPos, xPos, dist, radius;
-
   int tex_layer = get_texture_index_or_add (std::move (texture), strength);
 
-  if (tex_layer == -1 || nTextures == 1)
+  if ( tex_layer == -1 || nTextures == 1
+    || misc::getShortestDist(x, z, xbase, zbase, CHUNKSIZE) > brush->getRadius()
+     )
   {
-    return nTextures == 1;
+    return -1;
   }
 
-  radius = brush->getRadius();
+  create_temporary_alphamaps_if_needed();
 
-  if (misc::getShortestDist(x, z, xbase, zbase, CHUNKSIZE) > radius)
-  {
-    return changed;
-  }
+  return tex_layer;
+}
+
+bool TextureSet::paint_layer(float xbase, float zbase, float x, float z, Brush* brush, float strength, float pressure, int tex_layer)
+{
+  bool changed = false;
+
+  float zPos, xPos, dist, radius;
+
+  radius = brush->getRadius();
 
-  create_temporary_alphamaps_if_needed();
   auto& amaps = tmp_edit_values.get();
 
   zPos = zbase;
@@ -513,18 +518,16 @@ bool TextureSet::paintTexture(float xbase, float zbase, float x, float z, Brush*
     zPos += TEXDETAILSIZE;
   }
 
-  if (!changed)
-  {
-    return false;
-  }
+  return changed;
+}
 
+void TextureSet::finish_paint()
+{
   // cleanup
   eraseUnusedTextures();
 
   _need_amap_update = true;
   _need_lod_texture_map_update = true;
-
-  return true;
 }
 
 bool TextureSet::replace_texture( float xbase
@@ -701,26 +704,11 @@ std::vector<std::vector<uint8_t>> TextureSet::save_alpha(bool big_alphamap)
       {
         alphas_to_old_alpha(tab);
       }
-      
-
-      auto const combine_nibble
-      (
-        [&] (int layer, int pos)
-        {
-          int index = layer * 4096 + pos * 2;
-          return ((tab[index] & 0xF0) >> 4) | (tab[index + 1] & 0xF0);
-        }
-      );
 
       for (size_t layer = 0; layer < nTextures - 1; ++layer)
       {
-        amaps.emplace_back(2048);
-        auto& layer_data = amaps.back();
-
-        for (int i = 0; i < 2048; ++i)
-        {
-          layer_data[i] = combine_nibble(layer, i);
-        }
+        amaps.emplace_back(noggit::alphamap_codec::packed_4bit_size);
+        noggit::alphamap_codec::pack_4bit(tab + layer * 4096, amaps.back().data());
       }
     }
   }
@@ -890,62 +878,28 @@ bool TextureSet::removeDuplicate()
   return changed;
 }
 
-void TextureSet::bind_alpha(std::size_t id)
+void TextureSet::write_alphamaps(std::uint8_t* rgba)
 {
-  opengl::texture::set_active_texture(id);
-  amap_gl_tex.bind();
-
-  if (_need_amap_update)
+  if (tmp_edit_values)
   {
-    if (nTextures)
-    {
-      if (tmp_edit_values)
-      {
-        std::vector<float> amap(3 * 64 * 64);
-        auto& tmp_amaps = tmp_edit_values.get();
-
-        for (int i = 0; i < 64 * 64; ++i)
-        {
-          for (int alpha_id = 0; alpha_id < 3; ++alpha_id)
-          {
-            amap[i * 3 + alpha_id] = tmp_amaps[alpha_id + 1][i] / 255.f;
-          }
-        }
-
-        gl.texImage2D(GL_TEXTURE_2D, 0, GL_RGB, 64, 64, 0, GL_RGB, GL_FLOAT, amap.data());
-      }
-      else
-      {
-        std::vector<uint8_t> amap(3 * 64 * 64);
-        uint8_t const* alpha_ptr[3];
+    auto& tmp_amaps = tmp_edit_values.get();
 
-        for (int i = 0; i < nTextures - 1; ++i)
-        {
-          alpha_ptr[i] = alphamaps[i]->getAlpha();
-        }
-
-        for (int i = 0; i < 64 * 64; ++i)
-        {
-          for (int alpha_id = 0; alpha_id < 3; ++alpha_id)
-          {
-            amap[i * 3 + alpha_id] = (alpha_id < nTextures - 1)
-                                   ? *(alpha_ptr[alpha_id]++)
-                                   : 0
-                                   ;
-          }
-        }
+    noggit::terrain_alphamap_layer::write_alphas
+      (rgba, {tmp_amaps[1].data(), tmp_amaps[2].data(), tmp_amaps[3].data()});
+  }
+  else
+  {
+    std::array<std::uint8_t const*, 3> alphas = {nullptr, nullptr, nullptr};
 
-        gl.texImage2D(GL_TEXTURE_2D, 0, GL_RGB, 64, 64, 0, GL_RGB, GL_UNSIGNED_BYTE, amap.data());
-      }
+    for (int i = 0; i < static_cast<int>(nTextures) - 1; ++i)
+    {
+      alphas[i] = alphamaps[i]->getAlpha();
     }
 
-    gl.texParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    gl.texParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    gl.texParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    gl.texParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-    _need_amap_update = false;
+    noggit::terrain_alphamap_layer::write_alphas(rgba, alphas);
   }
+
+  _need_amap_update = false;
 }
 
 namespace
@@ -33,6 +33,7 @@ public:
   math::vector_2d anim_uv_offset(int id, int animtime) const;
 
   void bindTexture(size_t id, size_t activeTexture, std::vector<int>& textures_bound);
+  int blp_id(size_t id) const { return textures[id].blp_id(); }
 
   int addTexture(scoped_blp_texture_reference texture);
   void eraseTexture(size_t id);
@@ -41,7 +42,16 @@ public:
   bool eraseUnusedTextures();
   void swap_layers(int layer_1, int layer_2);
   void replace_texture(scoped_blp_texture_reference const& texture_to_replace, scoped_blp_texture_reference replacement_texture);
-  bool paintTexture(float xbase, float zbase, float x, float z, Brush* brush, float strength, float pressure, scoped_blp_texture_reference texture);
+  //! painting is split in three steps so that chunks can be painted in
+  //! parallel: adding and releasing textures may create or delete GL
+  //! textures, so prepare_paint and finish_paint run on the GL thread while
+  //! paint_layer only touches the chunk's alphamaps.
+  //! \return the layer to paint or -1 if there is nothing to paint
+  int prepare_paint(float xbase, float zbase, float x, float z, Brush* brush, float strength, scoped_blp_texture_reference texture);
+  //! \return true if the alphamaps changed
+  bool paint_layer(float xbase, float zbase, float x, float z, Brush* brush, float strength, float pressure, int tex_layer);
+  //! to call once the alphamaps changed
+  void finish_paint();
   bool replace_texture( float xbase
                       , float zbase
                       , float x
@@ -71,7 +81,10 @@ public:
 
   scoped_blp_texture_reference texture(size_t id);
 
-  void bind_alpha(std::size_t id);
+  bool alphamaps_changed() const { return _need_amap_update; }
+  //! writes the alpha layers in the rgb of the 64 * 64 rgba pixels, 0 for
+  //! the missing layers, leaving the alpha untouched
+  void write_alphamaps(std::uint8_t* rgba);
 
   std::vector<uint8_t> lod_texture_map();
 
@@ -92,7 +105,6 @@ private:
 
   std::vector<scoped_blp_texture_reference> textures;
   std::array<boost::optional<Alphamap>, 3> alphamaps;
-  opengl::texture amap_gl_tex;
   bool _need_amap_update = true;
 
   std::vector<uint8_t> _lod_texture_map;
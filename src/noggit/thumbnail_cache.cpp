@@ -0,0 +1,116 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/thumbnail_cache.hpp>
+
+#include <noggit/Log.h>
+#include <noggit/MPQ.h>
+#include <noggit/blp_decoder.hpp>
+
+#include <QtCore/QDir>
+#include <QtCore/QSaveFile>
+#include <QtCore/QStandardPaths>
+
+#include <boost/optional.hpp>
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace noggit
+{
+  namespace
+  {
+    std::uint64_t stamp_hash (std::string const& stamp)
+    {
+      // fnv-1a
+      std::uint64_t hash (0xcbf29ce484222325ull ^ thumbnail_cache::version);
+      for (char c : stamp)
+      {
+        hash = (hash ^ static_cast<unsigned char> (c)) * 0x100000001b3ull;
+      }
+      return hash;
+    }
+
+    std::string const missing_texture ("textures/shanecube.blp");
+  }
+
+  thumbnail_cache& thumbnail_cache::instance()
+  {
+    static thumbnail_cache cache
+      ( QStandardPaths::writableLocation (QStandardPaths::CacheLocation)
+      + "/thumbnails"
+      );
+    return cache;
+  }
+
+  thumbnail_cache::thumbnail_cache (QString directory)
+    : _directory (std::move (directory))
+  {
+    QDir().mkpath (_directory);
+  }
+
+  QImage thumbnail_cache::thumbnail (std::string const& blp_filename, int width, int height)
+  {
+    boost::optional<std::string> stamp (MPQFile::content_stamp (blp_filename));
+    std::string const& filename (stamp ? blp_filename : missing_texture);
+
+    if (!stamp)
+    {
+      LogError << "file not found: '" << blp_filename << "'" << std::endl;
+      stamp = MPQFile::content_stamp (missing_texture);
+    }
+
+    if (!stamp)
+    {
+      throw std::runtime_error ("File " + blp_filename + " does not exists");
+    }
+
+    QString const path
+      ( QString ("%1/%2-%3x%4.png")
+          .arg (_directory)
+          .arg (stamp_hash (*stamp), 16, 16, QChar ('0'))
+          .arg (width)
+          .arg (height)
+      );
+
+    QImage cached;
+    if (cached.load (path, "PNG"))
+    {
+      return cached;
+    }
+
+    MPQFile file (filename);
+    if (file.isEof())
+    {
+      throw std::runtime_error ("File " + blp_filename + " does not exists");
+    }
+
+    blp::image const image (blp::decode (file.getPointer(), file.getSize(), width, height));
+
+    // the alpha channel of textures is not opacity, e.g. the specular of tilesets
+    QImage const decoded
+      ( reinterpret_cast<uchar const*> (image.pixels.data())
+      , image.width
+      , image.height
+      , QImage::Format_RGBX8888
+      );
+
+    QImage const result
+      ( width > 0 && height > 0 && (width != image.width || height != image.height)
+      ? decoded.scaled (width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation)
+      : decoded.copy()
+      );
+
+    // written aside and renamed so that no other thread reads half of it
+    QSaveFile cache_file (path);
+    if ( !cache_file.open (QIODevice::WriteOnly)
+      || !result.save (&cache_file, "PNG")
+      || !cache_file.commit()
+       )
+    {
+      LogError << "could not cache the thumbnail of '" << blp_filename << "'" << std::endl;
+    }
+
+    return result;
+  }
+}
@@ -0,0 +1,37 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <QtCore/QString>
+#include <QtGui/QImage>
+
+#include <cstdint>
+#include <string>
+
+namespace noggit
+{
+  //! Images of BLP files decoded on the CPU, without a GL context, and kept
+  //! on disk between runs. A thumbnail is found by the MPQFile::content_stamp
+  //! of its file, so a modified file gets a new one and a file is only read
+  //! when its thumbnail isn't cached yet.
+  class thumbnail_cache
+  {
+  public:
+    //! bumped when the thumbnails change, to not use the old ones
+    static constexpr std::uint32_t version = 2;
+
+    //! in the application's cache location
+    static thumbnail_cache& instance();
+
+    explicit thumbnail_cache (QString directory);
+
+    //! the file stretched to width * height, -1 being its own size. A
+    //! missing file is replaced by the missing texture texture.
+    //! \note thread safe
+    //! \throws std::runtime_error if the file can't be decoded
+    QImage thumbnail (std::string const& blp_filename, int width = -1, int height = -1);
+
+  private:
+    QString const _directory;
+  };
+}
@@ -0,0 +1,247 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/triangle_bvh.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace noggit
+{
+  namespace
+  {
+    std::uint32_t const max_leaf_size (4);
+    std::size_t const bin_count (12);
+    //! also bounds the traversal stack
+    std::uint32_t const max_depth (48);
+
+    float half_area (math::vector_3d const& min, math::vector_3d const& max)
+    {
+      math::vector_3d const size (max - min);
+      return size.x * size.y + size.y * size.z + size.z * size.x;
+    }
+
+    struct bounds
+    {
+      math::vector_3d min = math::vector_3d::max();
+      math::vector_3d max = math::vector_3d::min();
+
+      void extend (math::vector_3d const& point)
+      {
+        min = math::min (min, point);
+        max = math::max (max, point);
+      }
+
+      void extend (bounds const& other)
+      {
+        min = math::min (min, other.min);
+        max = math::max (max, other.max);
+      }
+    };
+  }
+
+  triangle_bvh::triangle_bvh (std::vector<triangle> triangles)
+    : _triangles (std::move (triangles))
+  {
+    if (_triangles.empty())
+    {
+      return;
+    }
+
+    std::vector<math::vector_3d> centers;
+    centers.reserve (_triangles.size());
+    for (auto const& t : _triangles)
+    {
+      centers.emplace_back ((t[0] + t[1] + t[2]) * (1.f / 3.f));
+    }
+
+    _nodes.reserve (2 * _triangles.size() / max_leaf_size + 1);
+    build (0, static_cast<std::uint32_t> (_triangles.size()), centers, 0);
+  }
+
+  std::uint32_t triangle_bvh::build ( std::uint32_t first
+                                    , std::uint32_t count
+                                    , std::vector<math::vector_3d>& centers
+                                    , std::uint32_t depth
+                                    )
+  {
+    std::uint32_t const index (static_cast<std::uint32_t> (_nodes.size()));
+    _nodes.emplace_back();
+
+    bounds box, center_box;
+    for (std::uint32_t i (first); i < first + count; ++i)
+    {
+      for (auto const& point : _triangles[i])
+      {
+        box.extend (point);
+      }
+      center_box.extend (centers[i]);
+    }
+
+    // so that the rounding of the slab test never rejects a triangle the
+    // ray touches on the border of the box
+    float const largest
+      ( std::max ( { std::abs (box.min.x), std::abs (box.min.y), std::abs (box.min.z)
+                   , std::abs (box.max.x), std::abs (box.max.y), std::abs (box.max.z)
+                   }
+                 )
+      );
+    math::vector_3d const pad ((1.f + largest) * 1e-5f, (1.f + largest) * 1e-5f, (1.f + largest) * 1e-5f);
+    _nodes[index].min = box.min - pad;
+    _nodes[index].max = box.max + pad;
+
+    math::vector_3d const extent (center_box.max - center_box.min);
+    int const axis (extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2));
+    float const axis_min (center_box.min._data[axis]);
+    float const axis_extent (extent._data[axis]);
+
+    if (count <= max_leaf_size || depth >= max_depth || axis_extent <= 0.f)
+    {
+      _nodes[index].index = first;
+      _nodes[index].count = count;
+      return index;
+    }
+
+    // binned surface area heuristic along the longest axis of the centers
+    auto const bin_of
+      ( [&] (math::vector_3d const& center)
+        {
+          return std::min
+            ( bin_count - 1
+            , static_cast<std::size_t> ((center._data[axis] - axis_min) / axis_extent * bin_count)
+            );
+        }
+      );
+
+    std::array<bounds, bin_count> bins;
+    std::array<std::uint32_t, bin_count> bin_sizes {};
+    for (std::uint32_t i (first); i < first + count; ++i)
+    {
+      std::size_t const bin (bin_of (centers[i]));
+      ++bin_sizes[bin];
+      for (auto const& point : _triangles[i])
+      {
+        bins[bin].extend (point);
+      }
+    }
+
+    std::array<float, bin_count - 1> left_costs;
+    bounds left;
+    std::uint32_t left_count (0);
+    for (std::size_t i (0); i < bin_count - 1; ++i)
+    {
+      left.extend (bins[i]);
+      left_count += bin_sizes[i];
+      left_costs[i] = left_count ? half_area (left.min, left.max) * left_count : 0.f;
+    }
+
+    std::size_t best_split (0);
+    float best_cost (std::numeric_limits<float>::max());
+    bounds right;
+    std::uint32_t right_count (0);
+    for (std::size_t i (bin_count - 1); i > 0; --i)
+    {
+      right.extend (bins[i]);
+      right_count += bin_sizes[i];
+      float const cost (left_costs[i - 1] + half_area (right.min, right.max) * right_count);
+      if (right_count < count && cost < best_cost)
+      {
+        best_cost = cost;
+        best_split = i;
+      }
+    }
+
+    std::uint32_t middle (first);
+    for (std::uint32_t i (first); i < first + count; ++i)
+    {
+      if (bin_of (centers[i]) < best_split)
+      {
+        std::swap (_triangles[i], _triangles[middle]);
+        std::swap (centers[i], centers[middle]);
+        ++middle;
+      }
+    }
+
+    build (first, middle - first, centers, depth + 1);
+    std::uint32_t const second (build (middle, first + count - middle, centers, depth + 1));
+
+    _nodes[index].index = second;
+    _nodes[index].count = 0;
+    return index;
+  }
+
+  void triangle_bvh::intersect (math::ray const& ray, std::vector<float>* results) const
+  {
+    if (_nodes.empty())
+    {
+      return;
+    }
+
+    math::vector_3d const& origin (ray.origin());
+    math::vector_3d const& direction (ray.direction());
+    math::vector_3d const inverse ( direction.x != 0.f ? 1.f / direction.x : 0.f
+                                  , direction.y != 0.f ? 1.f / direction.y : 0.f
+                                  , direction.z != 0.f ? 1.f / direction.z : 0.f
+                                  );
+
+    auto const hits
+      ( [&] (node const& n)
+        {
+          float t_min (0.f);
+          float t_max (std::numeric_limits<float>::max());
+
+          for (int axis (0); axis < 3; ++axis)
+          {
+            float const o (origin._data[axis]);
+
+            if (direction._data[axis] == 0.f)
+            {
+              if (o < n.min._data[axis] || o > n.max._data[axis])
+              {
+                return false;
+              }
+              continue;
+            }
+
+            float const t1 ((n.min._data[axis] - o) * inverse._data[axis]);
+            float const t2 ((n.max._data[axis] - o) * inverse._data[axis]);
+            t_min = std::max (t_min, std::min (t1, t2));
+            t_max = std::min (t_max, std::max (t1, t2));
+          }
+
+          return t_min <= t_max;
+        }
+      );
+
+    std::uint32_t stack[max_depth + 2];
+    std::size_t stack_size (0);
+    stack[stack_size++] = 0;
+
+    while (stack_size)
+    {
+      std::uint32_t const index (stack[--stack_size]);
+      node const& n (_nodes[index]);
+
+      if (!hits (n))
+      {
+        continue;
+      }
+
+      if (!n.count)
+      {
+        stack[stack_size++] = n.index;
+        stack[stack_size++] = index + 1;
+        continue;
+      }
+
+      for (std::uint32_t i (n.index); i < n.index + n.count; ++i)
+      {
+        if (auto distance = ray.intersect_triangle (_triangles[i][0], _triangles[i][1], _triangles[i][2]))
+        {
+          results->emplace_back (*distance);
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,51 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <math/ray.hpp>
+#include <math/vector_3d.hpp>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace noggit
+{
+  //! Bounding volume hierarchy over the static triangles of a model, built
+  //! once when the model is loaded and shared by all of its instances, which
+  //! query it in model space.
+  class triangle_bvh
+  {
+  public:
+    using triangle = std::array<math::vector_3d, 3>;
+
+    triangle_bvh() = default;
+    explicit triangle_bvh (std::vector<triangle> triangles);
+
+    //! appends the distance of every triangle the ray intersects
+    void intersect (math::ray const&, std::vector<float>* results) const;
+
+    bool empty() const { return _triangles.empty(); }
+
+  private:
+    struct node
+    {
+      math::vector_3d min;
+      math::vector_3d max;
+      //! leaves: first triangle, inner nodes: second child, the first one
+      //! being right after the node
+      std::uint32_t index;
+      //! 0 for inner nodes
+      std::uint32_t count;
+    };
+
+    std::uint32_t build ( std::uint32_t first
+                        , std::uint32_t count
+                        , std::vector<math::vector_3d>& centers
+                        , std::uint32_t depth
+                        );
+
+    std::vector<node> _nodes;
+    std::vector<triangle> _triangles;
+  };
+}
@@ -323,6 +323,7 @@ namespace noggit
       connect(clearListButton, &QPushButton::clicked, [=]() {
         ModelManager::clear_hidden_models();
         WMOManager::clear_hidden_wmos();
+        world->instance_visibility_changed();
       });
 
       connect(toTxt, &QPushButton::clicked, [=]() {
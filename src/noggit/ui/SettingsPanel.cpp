@@ -16,6 +16,7 @@
 
 
 #include <algorithm>
+#include <atomic>
 
 namespace util
 {
@@ -56,6 +57,16 @@ namespace noggit
 {
   namespace ui
   {
+    namespace
+    {
+      std::atomic<std::size_t> settings_saved_count (0);
+    }
+
+    std::size_t settings::saved_count()
+    {
+      return settings_saved_count;
+    }
+
     settings::settings(QWidget* parent)
       : QDialog (parent)
       , _settings (new QSettings (this))
@@ -162,6 +173,15 @@ namespace noggit
       layout->addRow ("Adt unloading check interval (sec)", _adt_unload_check_interval = new QSpinBox(this));
       _adt_unload_check_interval->setMinimum(1);
 
+      layout->addRow ("File loading threads", _async_loader_threads = new QSpinBox(this));
+      _async_loader_threads->setRange(0, 256);
+      _async_loader_threads->setSpecialValueText("Auto");
+      _async_loader_threads->setToolTip("Require restart, auto uses one thread per cpu core");
+
+      layout->addRow ("Texture memory budget (MB)", _texture_budget = new QSpinBox(this));
+      _texture_budget->setRange(64, 65536);
+      _texture_budget->setToolTip("Textures not drawn for a while are reduced to their low detail levels above it");
+
       layout->addRow ("Always check for max UID", _uid_cb = new QCheckBox(this));
 
       layout->addRow ("Tablet support", tabletModeCheck = new QCheckBox(this));
@@ -170,6 +190,8 @@ namespace noggit
       layout->addRow("Undock quick access texture palette", _undock_small_texture_palette = new QCheckBox(this));
 
       layout->addRow("Additional file loading log", _additional_file_loading_log = new QCheckBox(this));
+      layout->addRow("Memory map project files", _mmap_loose_files = new QCheckBox(this));
+      _mmap_loose_files->setToolTip("Require restart");
 
 #ifdef NOGGIT_HAS_SCRIPTING
       layout->addRow("Allow scripts to write to any file",_allow_scripts_write_any_file = new QCheckBox(this));
@@ -228,8 +250,11 @@ namespace noggit
       _fullscreen_cb->setChecked (_settings->value ("fullscreen", false).toBool());
       _adt_unload_dist->setValue(_settings->value("unload_dist", 5).toInt());
       _adt_unload_check_interval->setValue(_settings->value("unload_interval", 5).toInt());
+      _async_loader_threads->setValue(_settings->value("async_loader/threads", 0).toInt());
+      _texture_budget->setValue(_settings->value("texture_budget", 1024).toInt());
       _uid_cb->setChecked(_settings->value("uid_startup_check", true).toBool());
       _additional_file_loading_log->setChecked(_settings->value("additional_file_loading_log", false).toBool());
+      _mmap_loose_files->setChecked(_settings->value("mmap_loose_files", true).toBool());
 #ifdef NOGGIT_HAS_SCRIPTING
       _allow_scripts_write_any_file->setChecked(_settings->value("allow_scripts_write_any_file",false).toBool());
 #endif
@@ -263,8 +288,12 @@ namespace noggit
       _settings->setValue ("fullscreen", _fullscreen_cb->isChecked());
       _settings->setValue ("unload_dist", _adt_unload_dist->value());
       _settings->setValue ("unload_interval", _adt_unload_check_interval->value());
+      _settings->setValue ("async_loader/threads", _async_loader_threads->value());
+      _settings->setValue ("texture_budget", _texture_budget->value());
+      TextureManager::residency().set_budget (std::size_t (_texture_budget->value()) << 20);
       _settings->setValue ("uid_startup_check", _uid_cb->isChecked());
       _settings->setValue ("additional_file_loading_log", _additional_file_loading_log->isChecked());
+      _settings->setValue ("mmap_loose_files", _mmap_loose_files->isChecked());
 
 #ifdef NOGGIT_HAS_SCRIPTING
       _settings->setValue ("allow_scripts_write_any_file", _allow_scripts_write_any_file->isChecked());
@@ -284,6 +313,8 @@ namespace noggit
       _settings->setValue ("wireframe/color", _wireframe_color->color());      
 
 	  _settings->sync();
+
+      ++settings_saved_count;
     }
   }
 }
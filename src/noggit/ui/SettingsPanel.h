@@ -14,6 +14,8 @@
 #include <QtWidgets/QSpinBox>
 #include <QtWidgets/QWidget>
 
+#include <cstddef>
+
 namespace util
 {
   struct file_line_edit : public QWidget
@@ -45,6 +47,8 @@ namespace noggit
       QDoubleSpinBox* farZField;
       QSpinBox* _adt_unload_dist;
       QSpinBox* _adt_unload_check_interval;
+      QSpinBox* _async_loader_threads;
+      QSpinBox* _texture_budget;
       QCheckBox* _uid_cb;
 
       QCheckBox* tabletModeCheck;
@@ -53,6 +57,7 @@ namespace noggit
       QCheckBox* _vsync_cb;
 
       QCheckBox* _additional_file_loading_log;
+      QCheckBox* _mmap_loose_files;
 
 #ifdef NOGGIT_HAS_SCRIPTING
       QCheckBox* _allow_scripts_write_any_file;
@@ -78,6 +83,10 @@ namespace noggit
       settings(QWidget* parent = nullptr);
       void discard_changes();
       void save_changes();
+
+      //! incremented each time the settings are saved, for the ones read
+      //! once and cached
+      static std::size_t saved_count();
     };
   }
 }
@@ -14,7 +14,10 @@
 #include <noggit/MPQ.h>
 #include <noggit/TextureManager.h> // TextureManager, Texture
 #include <noggit/ui/TextureList.hpp>
+#include <noggit/ui/thumbnail_loader.hpp>
 
+#include <memory>
+#include <unordered_map>
 #include <unordered_set>
 
 #include <QtCore/QSettings>
@@ -34,29 +37,30 @@ namespace noggit
   {
     struct model_item : QStandardItem
     {
-      model_item (QString const& display_role)
+      model_item (QString const& display_role, thumbnail_loader* thumbnails)
         : QStandardItem (display_role)
+        , _thumbnails (thumbnails)
       {}
 
       virtual QVariant data (int role) const
       {
-        if (role == Qt::DecorationRole)
+        if (role == Qt::DecorationRole && !_requested)
         {
-          if (!_rendered)
-          {
-            //! \note The one time Qt is const correct and we don't want that.
-            auto that (const_cast<model_item*> (this));
-            that->_rendered = true;
-            that->_pixmap = render_blp_to_pixmap (data (Qt::DisplayRole).toString().prepend ("tileset/").toStdString(), 256, 256);
-          }
-          return QIcon(_pixmap);
+          //! \note The one time Qt is const correct and we don't want that.
+          const_cast<model_item*> (this)->_requested = true;
+          _thumbnails->request (filename());
         }
 
         return QStandardItem::data (role);
       }
 
-      bool _rendered = false;
-      QPixmap _pixmap;
+      std::string filename() const
+      {
+        return QStandardItem::data (Qt::DisplayRole).toString().prepend ("tileset/").toStdString();
+      }
+
+      thumbnail_loader* _thumbnails;
+      bool _requested = false;
     };
 
     tileset_chooser::tileset_chooser (QWidget* parent)
@@ -135,17 +139,33 @@ namespace noggit
       auto model (new QStandardItemModel);
       constexpr int const has_specular_role = Qt::UserRole;
 
+      auto thumbnails (new thumbnail_loader (256, 256, this));
+      auto items (std::make_shared<std::unordered_map<std::string, model_item*>>());
+
       for (auto const& texture : tilesets)
       {
         auto item ( new model_item
-                      (QString::fromStdString (texture).remove ("tileset/"))
+                      (QString::fromStdString (texture).remove ("tileset/"), thumbnails)
                   );
         item->setData ( tilesets_with_specular_variant.count (texture) ? "true" : "false"
                       , has_specular_role
                       );
         model->appendRow (item);
+        items->emplace (item->filename(), item);
       }
 
+      connect ( thumbnails, &thumbnail_loader::loaded
+              , this
+              , [=] (QString blp_filename, QImage thumbnail)
+                {
+                  auto const it (items->find (blp_filename.toStdString()));
+                  if (it != items->end())
+                  {
+                    it->second->setData (QIcon (QPixmap::fromImage (thumbnail)), Qt::DecorationRole);
+                  }
+                }
+              );
+
       auto specular_filter (new QSortFilterProxyModel);
       specular_filter->setSourceModel (model);
       specular_filter->setFilterRole (has_specular_role);
@@ -57,7 +57,7 @@ namespace noggit
 
       for (DBCFile::Iterator i = gLiquidTypeDB.begin(); i != gLiquidTypeDB.end(); ++i)
       {
-        int liquid_id = i->getInt(LiquidTypeDB::ID);
+        int liquid_id = i->get<LiquidTypeDB::ID>();
 
         std::stringstream ss;
         ss << liquid_id << "-" << LiquidTypeDB::getLiquidName(liquid_id);
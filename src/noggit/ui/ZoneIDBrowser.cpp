@@ -43,10 +43,10 @@ namespace noggit
 
       for (DBCFile::Iterator i = gMapDB.begin(); i != gMapDB.end(); ++i)
       {
-        if (i->getInt(MapDB::MapID) == id)
+        if (i->get<MapDB::MapID>() == id)
         {
           std::stringstream ss;
-          ss << id << "-" << i->getString(MapDB::InternalName);
+          ss << id << "-" << i->get<MapDB::InternalName>();
           _area_tree->setHeaderLabel(ss.str().c_str());
         }
       }
@@ -82,9 +82,9 @@ namespace noggit
       //  Read out Area List.
       for (DBCFile::Iterator i = gAreaDB.begin(); i != gAreaDB.end(); ++i)
       {
-        if (i->getInt(AreaDB::Continent) == mapID)
+        if (i->get<AreaDB::Continent>() == mapID)
         {
-          add_area(i->getInt(AreaDB::AreaID));
+          add_area(i->get<AreaDB::AreaID>());
         }
       }
     }
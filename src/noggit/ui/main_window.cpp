@@ -160,9 +160,9 @@ namespace noggit
 
       for (DBCFile::Iterator it = gMapDB.begin(); it != gMapDB.end(); ++it)
       {
-        if (it->getInt(MapDB::MapID) == mapID)
+        if (it->get<MapDB::MapID>() == mapID)
         {
-          _world = std::make_unique<World> (it->getString(MapDB::InternalName), mapID);
+          _world = std::make_unique<World> (it->get<MapDB::InternalName>(), mapID);
           _minimap->world (_world.get());
 
           return;
@@ -200,9 +200,9 @@ namespace noggit
       for (DBCFile::Iterator i = gMapDB.begin(); i != gMapDB.end(); ++i)
       {
         MapEntry e;
-        e.mapID = i->getInt(MapDB::MapID);
-        e.name = i->getLocalizedString(MapDB::Name);
-        e.areaType = i->getUInt(MapDB::AreaType);
+        e.mapID = i->get<MapDB::MapID>();
+        e.name = i->get<MapDB::Name>();
+        e.areaType = i->get<MapDB::AreaType>();
 
         if (e.areaType < 0 || e.areaType > 4 || !World::IsEditableWorld(e.mapID))
           continue;
@@ -237,9 +237,9 @@ namespace noggit
 
                            for (DBCFile::Iterator it = gMapDB.begin(); it != gMapDB.end(); ++it)
                            {
-                             if (it->getInt(MapDB::MapID) == entry.mapID)
+                             if (it->get<MapDB::MapID>() == entry.mapID)
                              {
-                               _world = std::make_unique<World> (it->getString(MapDB::InternalName), entry.mapID);
+                               _world = std::make_unique<World> (it->get<MapDB::InternalName>(), entry.mapID);
                                check_uid_then_enter_map ( entry.pos
                                                         , math::degrees (entry.camera_pitch)
                                                         , math::degrees (entry.camera_yaw)
@@ -0,0 +1,71 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/ui/thumbnail_loader.hpp>
+
+#include <noggit/AsyncLoader.h>
+#include <noggit/AsyncObject.h>
+#include <noggit/Log.h>
+#include <noggit/thumbnail_cache.hpp>
+
+#include <exception>
+
+namespace noggit
+{
+  namespace ui
+  {
+    class thumbnail_loader::thumbnail_request : public AsyncObject
+    {
+    public:
+      thumbnail_request (thumbnail_loader& loader, std::string const& blp_filename)
+        : AsyncObject (blp_filename)
+        , _loader (loader)
+      {}
+
+      virtual void finishLoading()
+      {
+        try
+        {
+          emit _loader.loaded
+            ( QString::fromStdString (filename)
+            , thumbnail_cache::instance().thumbnail (filename, _loader._width, _loader._height)
+            );
+        }
+        catch (std::exception const& e)
+        {
+          LogError << "no thumbnail for '" << filename << "': " << e.what() << std::endl;
+        }
+
+        finished = true;
+        _state_changed.notify_all();
+      }
+
+      virtual async_priority loading_priority() const
+      {
+        return async_priority::low;
+      }
+
+    private:
+      thumbnail_loader& _loader;
+    };
+
+    thumbnail_loader::thumbnail_loader (int width, int height, QObject* parent)
+      : QObject (parent)
+      , _width (width)
+      , _height (height)
+    {}
+
+    thumbnail_loader::~thumbnail_loader()
+    {
+      for (auto& request : _requests)
+      {
+        AsyncLoader::instance().ensure_deletable (request.get());
+      }
+    }
+
+    void thumbnail_loader::request (std::string const& blp_filename)
+    {
+      _requests.emplace_back (std::make_unique<thumbnail_request> (*this, blp_filename));
+      AsyncLoader::instance().queue_for_load (_requests.back().get());
+    }
+  }
+}
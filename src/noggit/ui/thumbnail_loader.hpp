@@ -0,0 +1,44 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <QtCore/QObject>
+#include <QtCore/QString>
+#include <QtGui/QImage>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace noggit
+{
+  namespace ui
+  {
+    //! Gets the thumbnails of BLP files from the thumbnail_cache on the
+    //! AsyncLoader's threads, after the objects of the world.
+    class thumbnail_loader : public QObject
+    {
+      Q_OBJECT
+
+    public:
+      thumbnail_loader (int width, int height, QObject* parent = nullptr);
+      ~thumbnail_loader();
+
+      void request (std::string const& blp_filename);
+
+    signals:
+      //! emitted from a loader thread, connect with a receiver to get it
+      //! in the receiver's thread
+      void loaded (QString blp_filename, QImage thumbnail);
+
+    private:
+      class thumbnail_request;
+
+      int const _width;
+      int const _height;
+
+      //! kept until the loader is destroyed, they may still be queued
+      std::vector<std::unique_ptr<thumbnail_request>> _requests;
+    };
+  }
+}
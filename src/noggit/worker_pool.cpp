@@ -0,0 +1,132 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/worker_pool.hpp>
+
+#include <algorithm>
+
+namespace noggit
+{
+  worker_pool::worker_pool (std::size_t worker_count)
+    : _next_index (0)
+  {
+    if (!worker_count)
+    {
+      worker_count = std::max (1u, std::thread::hardware_concurrency()) - 1;
+    }
+
+    for (std::size_t i (0); i < worker_count; ++i)
+    {
+      _threads.emplace_back (&worker_pool::work, this);
+    }
+  }
+
+  worker_pool& worker_pool::instance()
+  {
+    static worker_pool workers;
+    return workers;
+  }
+
+  worker_pool::~worker_pool()
+  {
+    {
+      std::lock_guard<std::mutex> const lock (_mutex);
+      _stop = true;
+    }
+    _job_available.notify_all();
+
+    for (auto& thread : _threads)
+    {
+      thread.join();
+    }
+  }
+
+  void worker_pool::for_each (std::size_t count, std::function<void (std::size_t)> const& fun)
+  {
+    // not worth waking the workers up
+    if (_threads.empty() || count < 2)
+    {
+      for (std::size_t i (0); i < count; ++i)
+      {
+        fun (i);
+      }
+      return;
+    }
+
+    std::lock_guard<std::mutex> const for_each_lock (_for_each_mutex);
+
+    {
+      std::lock_guard<std::mutex> const lock (_mutex);
+      _job = &fun;
+      _job_size = count;
+      _next_index = 0;
+      _error = nullptr;
+      _busy_workers = _threads.size();
+      ++_generation;
+    }
+    _job_available.notify_all();
+
+    run_job();
+
+    std::exception_ptr error;
+    {
+      std::unique_lock<std::mutex> lock (_mutex);
+      _job_done.wait (lock, [&] { return _busy_workers == 0; });
+      _job = nullptr;
+      std::swap (error, _error);
+    }
+
+    if (error)
+    {
+      std::rethrow_exception (error);
+    }
+  }
+
+  void worker_pool::work()
+  {
+    std::size_t generation (0);
+
+    for (;;)
+    {
+      {
+        std::unique_lock<std::mutex> lock (_mutex);
+        _job_available.wait (lock, [&] { return _stop || _generation != generation; });
+
+        if (_stop)
+        {
+          return;
+        }
+
+        generation = _generation;
+      }
+
+      run_job();
+
+      {
+        std::lock_guard<std::mutex> const lock (_mutex);
+        if (--_busy_workers == 0)
+        {
+          _job_done.notify_all();
+        }
+      }
+    }
+  }
+
+  void worker_pool::run_job()
+  {
+    for (std::size_t i; (i = _next_index++) < _job_size;)
+    {
+      try
+      {
+        (*_job) (i);
+      }
+      catch (...)
+      {
+        std::lock_guard<std::mutex> const lock (_mutex);
+        if (!_error)
+        {
+          _error = std::current_exception();
+        }
+      }
+    }
+  }
+}
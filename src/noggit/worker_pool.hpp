@@ -0,0 +1,60 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace noggit
+{
+  //! Threads kept alive to split work the caller waits for, like a brush
+  //! stroke. The calling thread takes part in the work.
+  class worker_pool
+  {
+  public:
+    //! 0 uses one thread per core, including the calling one
+    explicit worker_pool (std::size_t worker_count = 0);
+    ~worker_pool();
+
+    worker_pool (worker_pool const&) = delete;
+    worker_pool& operator= (worker_pool const&) = delete;
+
+    //! the pool shared by the editor, one thread per core
+    static worker_pool& instance();
+
+    //! the workers and the calling thread
+    std::size_t thread_count() const { return _threads.size() + 1; }
+
+    //! calls fun for every index in [0, count) and returns once all the
+    //! calls are done, rethrowing the first exception thrown by one of
+    //! them. Calls from several threads are run one after another, calls
+    //! from inside fun would deadlock.
+    void for_each (std::size_t count, std::function<void (std::size_t)> const& fun);
+
+  private:
+    void work();
+    void run_job();
+
+    std::mutex _for_each_mutex;
+
+    std::mutex _mutex;
+    std::condition_variable _job_available;
+    std::condition_variable _job_done;
+    std::size_t _generation = 0;
+    std::size_t _busy_workers = 0;
+    bool _stop = false;
+
+    std::function<void (std::size_t)> const* _job = nullptr;
+    std::size_t _job_size = 0;
+    std::atomic<std::size_t> _next_index;
+    std::exception_ptr _error;
+
+    std::vector<std::thread> _threads;
+  };
+}
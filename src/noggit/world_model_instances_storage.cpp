@@ -4,8 +4,86 @@
 
 #include <noggit/World.h>
 
+#include <algorithm>
+#include <cmath>
+
 namespace noggit
 {
+  namespace
+  {
+    float farthest_corner(math::vector_3d const& min, math::vector_3d const& max)
+    {
+      return math::vector_3d ( std::max(std::abs(min.x), std::abs(max.x))
+                             , std::max(std::abs(min.y), std::abs(max.y))
+                             , std::max(std::abs(min.z), std::abs(max.z))
+                             ).length();
+    }
+
+    // radius of a sphere around the instance's position containing the
+    // sphere used by ModelInstance::is_visible and its boxes, any rotation
+    boost::optional<float> bounding_radius(ModelInstance& instance)
+    {
+      if (!instance.model->finishedLoading())
+      {
+        return boost::none;
+      }
+      if (instance.model->loading_failed())
+      {
+        return 0.f;
+      }
+
+      // brings the transform up to date when the model finished loading
+      // after the instance was created, picking relies on it
+      instance.extents();
+
+      auto const& header = instance.model->header;
+
+      return instance.scale * std::max ( { instance.model->rad
+                                         , farthest_corner(header.bounding_box_min, header.bounding_box_max)
+                                         , farthest_corner(header.collision_box_min, header.collision_box_max)
+                                         }
+                                       );
+    }
+
+    // contains all the groups, and so the doodads drawn with them
+    boost::optional<float> bounding_radius(WMOInstance& instance)
+    {
+      if (!instance.wmo->finishedLoading())
+      {
+        return boost::none;
+      }
+      if (instance.wmo->loading_failed())
+      {
+        return 0.f;
+      }
+
+      float radius = farthest_corner(instance.wmo->extents[0], instance.wmo->extents[1]);
+
+      for (auto const& group : instance.wmo->groups)
+      {
+        radius = std::max(radius, farthest_corner(group.BoundingBoxMin, group.BoundingBoxMax));
+      }
+
+      return radius;
+    }
+
+    template<typename Instance>
+      bool index_instance(instance_grid& grid, std::uint32_t uid, Instance& instance)
+    {
+      auto const radius = bounding_radius(instance);
+
+      if (!radius)
+      {
+        grid.insert(uid, instance.pos, instance_grid::unbounded_min, instance_grid::unbounded_max);
+        return false;
+      }
+
+      math::vector_3d const extent(*radius, *radius, *radius);
+      grid.insert(uid, instance.pos, instance.pos - extent, instance.pos + extent);
+      return true;
+    }
+  }
+
   world_model_instances_storage::world_model_instances_storage(World* world)
     : _world(world)
   {
@@ -47,6 +125,7 @@ namespace noggit
     {
       _m2s.emplace(uid, instance);
       _instance_count_per_uid[uid] = 1;
+      unsafe_update_spatial_index(uid);
       return uid;
     }
 
@@ -94,6 +173,7 @@ namespace noggit
     {
       _wmos.emplace(uid, instance);
       _instance_count_per_uid[uid] = 1;
+      unsafe_update_spatial_index(uid);
       return uid;
     }
 
@@ -114,6 +194,7 @@ namespace noggit
       {
         _world->updateTilesModel(&it->second, model_update::remove);
         _instance_count_per_uid.erase(it->first);
+        unsafe_remove_from_spatial_index(it->first);
         it = _m2s.erase(it);
       }
       else
@@ -127,6 +208,7 @@ namespace noggit
       {
         _world->updateTilesWMO(&it->second, model_update::remove);
         _instance_count_per_uid.erase(it->first);
+        unsafe_remove_from_spatial_index(it->first);
         it = _wmos.erase(it);
       }
       else
@@ -149,6 +231,7 @@ namespace noggit
         _world->updateTilesModel(instance, model_update::remove);
 
         _instance_count_per_uid.erase(instance->uid);
+        unsafe_remove_from_spatial_index(instance->uid);
         _m2s.erase(instance->uid);
       }
       else if (it.which() == eEntry_WMO)
@@ -158,6 +241,7 @@ namespace noggit
         _world->updateTilesWMO(instance, model_update::remove);
 
         _instance_count_per_uid.erase(instance->mUniqueID);
+        unsafe_remove_from_spatial_index(instance->mUniqueID);
         _wmos.erase(instance->mUniqueID);
       }
     }
@@ -168,6 +252,7 @@ namespace noggit
     std::unique_lock<std::mutex> const lock (_mutex);
 
     _instance_count_per_uid.erase(uid);
+    unsafe_remove_from_spatial_index(uid);
     _m2s.erase(uid);
     _wmos.erase(uid);
   }
@@ -187,6 +272,7 @@ namespace noggit
       _world->remove_from_selection(uid);
 
       _instance_count_per_uid.erase(uid);
+      unsafe_remove_from_spatial_index(uid);
       _m2s.erase(uid);
       _wmos.erase(uid);
     }
@@ -199,6 +285,10 @@ namespace noggit
     _instance_count_per_uid.clear();
     _m2s.clear();
     _wmos.clear();
+    _m2_grid.clear();
+    _wmo_grid.clear();
+    _unbounded_instances.clear();
+    ++_version;
   }
 
   boost::optional<ModelInstance*> world_model_instances_storage::get_model_instance(std::uint32_t uid)
@@ -264,6 +354,41 @@ namespace noggit
     }
   }
 
+  std::vector<std::uint32_t> world_model_instances_storage::copy_instances
+    ( std::vector<std::uint32_t> const& uids
+    , std::vector<ModelInstance>& models
+    , std::vector<WMOInstance>& wmos
+    )
+  {
+    std::vector<std::uint32_t> missing;
+
+    std::unique_lock<std::mutex> const lock (_mutex);
+
+    for (std::uint32_t uid : uids)
+    {
+      auto wmo_it = _wmos.find(uid);
+
+      if (wmo_it != _wmos.end())
+      {
+        wmos.emplace_back(wmo_it->second);
+        continue;
+      }
+
+      auto m2_it = _m2s.find(uid);
+
+      if (m2_it != _m2s.end())
+      {
+        models.emplace_back(m2_it->second);
+      }
+      else
+      {
+        missing.push_back(uid);
+      }
+    }
+
+    return missing;
+  }
+
   bool world_model_instances_storage::unsafe_uid_is_used(std::uint32_t uid) const
   {
     return _instance_count_per_uid.find(uid) != _instance_count_per_uid.end();
@@ -286,6 +411,7 @@ namespace noggit
           _world->updateTilesWMO(&rhs->second, model_update::remove);
 
           _instance_count_per_uid.erase(rhs->second.mUniqueID);
+          unsafe_remove_from_spatial_index(rhs->second.mUniqueID);
           rhs = _wmos.erase(rhs);
           deleted_uids++;
         }
@@ -307,6 +433,7 @@ namespace noggit
           _world->updateTilesModel(&rhs->second, model_update::remove);
 
           _instance_count_per_uid.erase(rhs->second.uid);
+          unsafe_remove_from_spatial_index(rhs->second.uid);
           rhs = _m2s.erase(rhs);
           deleted_uids++;
         }
@@ -319,4 +446,71 @@ namespace noggit
 
     NOGGIT_LOG << "Deleted " << deleted_uids << " duplicate Model/WMO" << std::endl;
   }
+
+  void world_model_instances_storage::update_spatial_index(std::uint32_t uid)
+  {
+    std::unique_lock<std::mutex> const lock (_mutex);
+    unsafe_update_spatial_index(uid);
+  }
+
+  void world_model_instances_storage::unsafe_update_spatial_index(std::uint32_t uid)
+  {
+    bool bounded = true;
+
+    if (auto m2 = unsafe_get_model_instance(uid))
+    {
+      bounded = index_instance(_m2_grid, uid, *m2.get());
+    }
+    else if (auto wmo = unsafe_get_wmo_instance(uid))
+    {
+      bounded = index_instance(_wmo_grid, uid, *wmo.get());
+    }
+
+    if (bounded)
+    {
+      _unbounded_instances.erase(uid);
+    }
+    else
+    {
+      _unbounded_instances.emplace(uid);
+    }
+
+    ++_version;
+  }
+
+  void world_model_instances_storage::unsafe_remove_from_spatial_index(std::uint32_t uid)
+  {
+    _m2_grid.remove(uid);
+    _wmo_grid.remove(uid);
+    ++_version;
+    _unbounded_instances.erase(uid);
+  }
+
+  void world_model_instances_storage::unsafe_update_unbounded_instances()
+  {
+    for (auto it = _unbounded_instances.begin(); it != _unbounded_instances.end();)
+    {
+      std::uint32_t const uid = *it;
+      bool bounded = false;
+
+      if (auto m2 = unsafe_get_model_instance(uid))
+      {
+        bounded = index_instance(_m2_grid, uid, *m2.get());
+      }
+      else if (auto wmo = unsafe_get_wmo_instance(uid))
+      {
+        bounded = index_instance(_wmo_grid, uid, *wmo.get());
+      }
+
+      if (bounded)
+      {
+        it = _unbounded_instances.erase(it);
+        ++_version;
+      }
+      else
+      {
+        ++it;
+      }
+    }
+  }
 }
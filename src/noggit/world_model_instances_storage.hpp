@@ -4,6 +4,7 @@
 
 #include <noggit/ModelInstance.h>
 #include <noggit/Selection.h>
+#include <noggit/instance_grid.hpp>
 #include <noggit/tile_index.hpp>
 #include <noggit/WMOInstance.h>
 
@@ -12,6 +13,8 @@
 #include <functional>
 #include <mutex>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 class World;
 
@@ -39,6 +42,13 @@ namespace noggit
     boost::optional<ModelInstance*> get_model_instance(std::uint32_t uid);
     boost::optional<WMOInstance*> get_wmo_instance(std::uint32_t uid);
     boost::optional<selection_type> get_instance(std::uint32_t uid);
+    // copy the instances while holding the lock, unlike the pointers
+    // returned by get_instance the copies stay valid if the storage changes,
+    // return the uids which aren't used by any instance
+    std::vector<std::uint32_t> copy_instances ( std::vector<std::uint32_t> const& uids
+                                              , std::vector<ModelInstance>& models
+                                              , std::vector<WMOInstance>& wmos
+                                              );
 
     void delete_instances_from_tile(tile_index const& tile);
     void delete_instances(std::vector<selection_type> const& instances);
@@ -49,11 +59,21 @@ namespace noggit
 
     void clear_duplicates();
 
+    //! to call when an instance moved, rotated or was scaled, or when the
+    //! doodads of a wmo instance changed
+    void update_spatial_index(std::uint32_t uid);
+
     bool uid_duplicates_found() const
     {
       return _uid_duplicates_found.load();
     }
 
+    //! changes whenever an instance is added, removed or reindexed
+    std::size_t version() const
+    {
+      return _version.load();
+    }
+
   private: // private functions aren't thread safe
     inline bool unsafe_uid_is_used(std::uint32_t uid) const;
 
@@ -62,6 +82,11 @@ namespace noggit
     boost::optional<ModelInstance*> unsafe_get_model_instance(std::uint32_t uid);
     boost::optional<WMOInstance*> unsafe_get_wmo_instance(std::uint32_t uid);
 
+    void unsafe_update_spatial_index(std::uint32_t uid);
+    void unsafe_remove_from_spatial_index(std::uint32_t uid);
+    // the instances whose model wasn't loaded when they were indexed
+    void unsafe_update_unbounded_instances();
+
   public:
     template<typename Fun>
       void for_each_wmo_instance(Fun&& function)
@@ -101,14 +126,39 @@ namespace noggit
       }
     }
 
+    // only the instances whose bounds may pass the test, the ones whose
+    // model isn't loaded yet always do
+    template<typename Fun>
+      void for_each_m2_instance_in(instance_grid::bounds_test const& test, Fun&& function)
+    {
+      std::unique_lock<std::mutex> const lock (_mutex);
+
+      unsafe_update_unbounded_instances();
+      _m2_grid.query(test, [&] (std::uint32_t uid) { function(_m2s.at(uid)); });
+    }
+
+    template<typename Fun>
+      void for_each_wmo_instance_in(instance_grid::bounds_test const& test, Fun&& function)
+    {
+      std::unique_lock<std::mutex> const lock (_mutex);
+
+      unsafe_update_unbounded_instances();
+      _wmo_grid.query(test, [&] (std::uint32_t uid) { function(_wmos.at(uid)); });
+    }
+
   private:
     World* _world;
     std::mutex _mutex;
     std::atomic<bool> _uid_duplicates_found = {false};
+    std::atomic<std::size_t> _version = {0};
 
     m2_instance_umap _m2s;
     wmo_instance_umap _wmos;
 
     std::unordered_map<std::uint32_t, int> _instance_count_per_uid;
+
+    instance_grid _m2_grid;
+    instance_grid _wmo_grid;
+    std::unordered_set<std::uint32_t> _unbounded_instances;
   };
 }
@@ -295,6 +295,16 @@ namespace opengl
     verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
     return _current_context->functions()->glTexImage2D (target, level, internal_format, width, height, border, format, type, data);
   }
+  void context::texImage3D (GLenum target, GLint level, GLint internal_format, GLsizei width, GLsizei height, GLsizei depth, GLint border, GLenum format, GLenum type, GLvoid const* data)
+  {
+    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    return _3_3_core_func->glTexImage3D (target, level, internal_format, width, height, depth, border, format, type, data);
+  }
+  void context::texSubImage3D (GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, GLvoid const* data)
+  {
+    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    return _3_3_core_func->glTexSubImage3D (target, level, xoffset, yoffset, zoffset, width, height, depth, format, type, data);
+  }
   void context::compressedTexImage2D (GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLint border, GLsizei imageSize, GLvoid const* data)
   {
     verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
@@ -367,6 +377,16 @@ namespace opengl
     verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
     return _current_context->functions()->glBufferData (target, size, data, usage);
   }
+  void context::bufferSubData (GLenum target, GLintptr offset, GLsizeiptr size, GLvoid const* data)
+  {
+    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    return _current_context->functions()->glBufferSubData (target, offset, size, data);
+  }
+  void context::bindBufferBase (GLenum target, GLuint index, GLuint buffer)
+  {
+    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    return _3_3_core_func->glBindBufferBase (target, index, buffer);
+  }
   GLvoid* context::mapBuffer (GLenum target, GLenum access)
   {
     verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
@@ -393,6 +413,11 @@ namespace opengl
     verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
     return _3_3_core_func->glDrawRangeElements (mode, start, end, count, type, reinterpret_cast<void*> (indices_offset));
   }
+  void context::multiDrawElementsBaseVertex (GLenum mode, GLsizei const* count, GLenum type, index_buffer_is_already_bound, GLvoid const* const* indices_offsets, GLsizei drawcount, GLint const* basevertex)
+  {
+    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    return _3_3_core_func->glMultiDrawElementsBaseVertex (mode, count, type, indices_offsets, drawcount, basevertex);
+  }
 
   void context::drawElements (GLenum mode, GLsizei count, GLenum type, GLuint index_buffer, std::intptr_t indices_offset)
   {
@@ -666,6 +691,21 @@ namespace opengl
     }
     return val;
   }
+  GLuint context::getUniformBlockIndex (GLuint program, GLchar const* name)
+  {
+    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    auto val (_3_3_core_func->glGetUniformBlockIndex (program, name));
+    if (val == GL_INVALID_INDEX)
+    {
+      throw std::logic_error ("unknown uniform block " + std::string (name));
+    }
+    return val;
+  }
+  void context::uniformBlockBinding (GLuint program, GLuint block_index, GLuint binding)
+  {
+    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    return _3_3_core_func->glUniformBlockBinding (program, block_index, binding);
+  }
 
   void context::uniform1i (GLint location, GLint value)
   {
@@ -777,6 +817,7 @@ namespace opengl
   }
   template void context::bufferData<GL_ARRAY_BUFFER> (GLuint buffer, GLsizeiptr size, GLvoid const* data, GLenum usage);
   template void context::bufferData<GL_ELEMENT_ARRAY_BUFFER> (GLuint buffer, GLsizeiptr size, GLvoid const* data, GLenum usage);
+  template void context::bufferData<GL_UNIFORM_BUFFER> (GLuint buffer, GLsizeiptr size, GLvoid const* data, GLenum usage);
 
   template<GLenum target, typename T>
     void context::bufferData(GLuint buffer, std::vector<T> const& data, GLenum usage)
@@ -792,4 +833,13 @@ namespace opengl
   template void context::bufferData<GL_ELEMENT_ARRAY_BUFFER, std::uint8_t>(GLuint buffer, std::vector<std::uint8_t> const& data, GLenum usage);
   template void context::bufferData<GL_ELEMENT_ARRAY_BUFFER, std::uint16_t>(GLuint buffer, std::vector<std::uint16_t> const& data, GLenum usage);
   template void context::bufferData<GL_ELEMENT_ARRAY_BUFFER, std::uint32_t>(GLuint buffer, std::vector<std::uint32_t> const& data, GLenum usage);
+
+  template<GLenum target>
+    void context::bufferSubData (GLuint buffer, GLintptr offset, GLsizeiptr size, GLvoid const* data)
+  {
+    scoped::buffer_binder<target> const _ (buffer);
+    return bufferSubData (target, offset, size, data);
+  }
+  template void context::bufferSubData<GL_ARRAY_BUFFER> (GLuint buffer, GLintptr offset, GLsizeiptr size, GLvoid const* data);
+  template void context::bufferSubData<GL_UNIFORM_BUFFER> (GLuint buffer, GLintptr offset, GLsizeiptr size, GLvoid const* data);
 }
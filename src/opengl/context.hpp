@@ -79,6 +79,8 @@ namespace opengl
     void deleteTextures (GLuint, GLuint*);
     void bindTexture (GLenum target, GLuint);
     void texImage2D (GLenum target, GLint level, GLint internal_format, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, GLvoid const* data);
+    void texImage3D (GLenum target, GLint level, GLint internal_format, GLsizei width, GLsizei height, GLsizei depth, GLint border, GLenum format, GLenum type, GLvoid const* data);
+    void texSubImage3D (GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, GLvoid const* data);
     void compressedTexImage2D (GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLint border, GLsizei imageSize, GLvoid const* data);
     void generateMipmap (GLenum);
     void activeTexture (GLenum);
@@ -96,6 +98,8 @@ namespace opengl
     void deleteBuffers (GLuint, GLuint*);
     void bindBuffer (GLenum, GLuint);
     void bufferData (GLenum target, GLsizeiptr size, GLvoid const* data, GLenum usage);
+    void bufferSubData (GLenum target, GLintptr offset, GLsizeiptr size, GLvoid const* data);
+    void bindBufferBase (GLenum target, GLuint index, GLuint buffer);
     GLvoid* mapBuffer (GLenum target, GLenum access);
     GLboolean unmapBuffer (GLenum);
 
@@ -119,6 +123,7 @@ namespace opengl
     template<typename T>
       void drawElementsInstanced (GLenum mode, GLsizei count, GLsizei instancecount, std::vector<T> const& indices,            std::intptr_t indices_offset = 0);
     void drawRangeElements (GLenum mode, GLuint start, GLuint end, GLsizei count, GLenum type, index_buffer_is_already_bound, std::intptr_t indices_offset = 0);
+    void multiDrawElementsBaseVertex (GLenum mode, GLsizei const* count, GLenum type, index_buffer_is_already_bound, GLvoid const* const* indices_offsets, GLsizei drawcount, GLint const* basevertex);
 
     void genPrograms (GLsizei programs, GLuint*);
     void deletePrograms (GLsizei programs, GLuint*);
@@ -157,6 +162,8 @@ namespace opengl
     void disableVertexAttribArray (GLuint index);
 
     GLint getUniformLocation (GLuint program, GLchar const* name);
+    GLuint getUniformBlockIndex (GLuint program, GLchar const* name);
+    void uniformBlockBinding (GLuint program, GLuint block_index, GLuint binding);
     void uniform1i (GLint location, GLint value);
     void uniform1f (GLint location, GLfloat value);
     void uniform1iv (GLint location, GLsizei count, GLint const* value);
@@ -185,6 +192,8 @@ namespace opengl
       void bufferData (GLuint buffer, GLsizeiptr size, GLvoid const* data, GLenum usage);
     template<GLenum target, typename T>
       void bufferData(GLuint buffer, std::vector<T> const& data, GLenum usage);
+    template<GLenum target>
+      void bufferSubData (GLuint buffer, GLintptr offset, GLsizeiptr size, GLvoid const* data);
   };
 }
 
@@ -14,6 +14,7 @@
 #include <QFile>
 #include <QTextStream>
 
+#include <cstring>
 #include <stdexcept>
 #include <list>
 #include <regex>
@@ -128,10 +129,30 @@ namespace opengl
     }
   }
 
-  //! \todo cache lookups?
-  GLuint program::uniform_location (std::string const& name) const
+  program::uniform_state& program::uniform (uniform_name const& name) const
   {
-    return gl.getUniformLocation (*_handle, name.c_str());
+    auto it (_uniforms.find (name.hash()));
+
+    if (it == _uniforms.end())
+    {
+      GLint const location (gl.getUniformLocation (*_handle, name.c_str()));
+      if (location == -1)
+      {
+        throw std::invalid_argument ("uniform " + std::string (name.c_str()) + " does not exist in shader\n");
+      }
+
+      it = _uniforms.emplace (name.hash(), uniform_state()).first;
+      it->second.name = name.c_str();
+      it->second.location = location;
+    }
+    else if ( it->second.name.size() != name.size()
+           || it->second.name.compare (0, name.size(), name.c_str(), name.size())
+            )
+    {
+      throw std::logic_error ("uniforms " + it->second.name + " and " + name.c_str() + " have the same hash");
+    }
+
+    return it->second;
   }
   GLuint program::attrib_location (std::string const& name) const
   {
@@ -151,42 +172,82 @@ namespace opengl
       gl.useProgram (_old);
     }
 
-    void use_program::uniform (std::string const& name, GLint value)
+    template<typename Set>
+      void use_program::set_uniform (uniform_name const& name, void const* value, std::size_t size, Set&& set)
+    {
+      program::uniform_state& state (_program.uniform (name));
+
+      bool const can_be_kept (size <= sizeof (state.value));
+
+      if (can_be_kept && state.value_size == size && !std::memcmp (state.value.data(), value, size))
+      {
+        return;
+      }
+
+      set (state.location);
+
+      state.value_size = can_be_kept ? size : 0;
+      if (can_be_kept)
+      {
+        std::memcpy (state.value.data(), value, size);
+      }
+    }
+
+    void use_program::uniform (uniform_name const& name, GLint value)
     {
-      gl.uniform1i (uniform_location (name), value);
+      set_uniform ( name, &value, sizeof (value)
+                  , [&] (GLint location) { gl.uniform1i (location, value); }
+                  );
     }
-    void use_program::uniform (std::string const& name, GLfloat value)
+    void use_program::uniform (uniform_name const& name, GLfloat value)
     {
-      gl.uniform1f (uniform_location (name), value);
+      set_uniform ( name, &value, sizeof (value)
+                  , [&] (GLint location) { gl.uniform1f (location, value); }
+                  );
     }
-    void use_program::uniform (std::string const& name, std::vector<int> const& value)
+    void use_program::uniform (uniform_name const& name, std::vector<int> const& value)
     {
-      gl.uniform1iv (uniform_location(name), value.size(), value.data());
+      set_uniform ( name, value.data(), value.size() * sizeof (int)
+                  , [&] (GLint location) { gl.uniform1iv (location, value.size(), value.data()); }
+                  );
     }
-    void use_program::uniform (std::string const& name, math::vector_2d const& value)
+    void use_program::uniform (uniform_name const& name, math::vector_2d const& value)
     {
-      gl.uniform2fv (uniform_location (name), 1, value);
+      set_uniform ( name, &value, sizeof (value)
+                  , [&] (GLint location) { gl.uniform2fv (location, 1, value); }
+                  );
     }
-    void use_program::uniform (std::string const& name, math::vector_3d const& value)
+    void use_program::uniform (uniform_name const& name, math::vector_3d const& value)
     {
-      gl.uniform3fv (uniform_location (name), 1, value);
+      set_uniform ( name, &value, sizeof (value)
+                  , [&] (GLint location) { gl.uniform3fv (location, 1, value); }
+                  );
     }
-    void use_program::uniform (std::string const& name, math::vector_4d const& value)
+    void use_program::uniform (uniform_name const& name, math::vector_4d const& value)
     {
-      gl.uniform4fv (uniform_location (name), 1, value);
+      set_uniform ( name, &value, sizeof (value)
+                  , [&] (GLint location) { gl.uniform4fv (location, 1, value); }
+                  );
     }
-    void use_program::uniform (std::string const& name, math::matrix_4x4 const& value)
+    void use_program::uniform (uniform_name const& name, math::matrix_4x4 const& value)
     {
-      gl.uniformMatrix4fv (uniform_location (name), 1, GL_FALSE, value);
+      set_uniform ( name, &value, sizeof (value)
+                  , [&] (GLint location) { gl.uniformMatrix4fv (location, 1, GL_FALSE, value); }
+                  );
     }
 
-    void use_program::sampler (std::string const& name, GLenum texture_slot, texture* tex)
+    void use_program::sampler (uniform_name const& name, GLenum texture_slot, texture* tex)
     {
       uniform (name, GLint (texture_slot - GL_TEXTURE0));
       texture::set_active_texture (texture_slot - GL_TEXTURE0);
       tex->bind();
     }
 
+    void use_program::uniform_block (std::string const& name, GLuint binding)
+    {
+      gl.uniformBlockBinding (*_program._handle, gl.getUniformBlockIndex (*_program._handle, name.c_str()), binding);
+    }
+
     void use_program::attrib (vao_binder const&, std::string const& name, array_buffer_is_already_bound const&, math::matrix_4x4 const* data, GLuint divisor)
     {
       GLuint const location (attrib_location (name));
@@ -222,23 +283,6 @@ namespace opengl
       }
     }
 
-    GLuint use_program::uniform_location (std::string const& name)
-    {
-      auto it = _uniforms.find (name);
-      if (it != _uniforms.end())
-      {
-        return it->second;
-      }
-
-      GLuint loc = _program.uniform_location (name);
-      if (loc == -1)
-      {
-        throw std::invalid_argument ("uniform " + name + " does not exist in shader\n");
-      }
-      _uniforms[name] = loc;      
-      return loc;
-    }
-
     GLuint use_program::attrib_location (std::string const& name)
     {
       auto it = _attribs.find (name);
@@ -7,6 +7,9 @@
 
 #include <boost/optional.hpp>
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <initializer_list>
 #include <map>
 #include <set>
@@ -27,6 +30,51 @@ namespace opengl
   // The caller guarantees that the array buffer is already bound.
   struct array_buffer_is_already_bound{};
 
+  //! A uniform's name and its hash, computed at compile time for literals,
+  //! which is what program caches the uniforms by. It doesn't own the name.
+  class uniform_name
+  {
+  public:
+    constexpr uniform_name (char const* name)
+      : _name (name)
+      , _size (length (name))
+      , _hash (fnv1a (name, _size))
+    {}
+    uniform_name (std::string const& name)
+      : _name (name.c_str())
+      , _size (name.size())
+      , _hash (fnv1a (_name, _size))
+    {}
+
+    char const* c_str() const { return _name; }
+    std::size_t size() const { return _size; }
+    std::uint64_t hash() const { return _hash; }
+
+  private:
+    static constexpr std::size_t length (char const* name)
+    {
+      std::size_t size (0);
+      while (name[size])
+      {
+        ++size;
+      }
+      return size;
+    }
+    static constexpr std::uint64_t fnv1a (char const* name, std::size_t size)
+    {
+      std::uint64_t hash (14695981039346656037ull);
+      for (std::size_t i (0); i < size; ++i)
+      {
+        hash = (hash ^ static_cast<unsigned char> (name[i])) * 1099511628211ull;
+      }
+      return hash;
+    }
+
+    char const* _name;
+    std::size_t _size;
+    std::uint64_t _hash;
+  };
+
   struct shader
   {
     shader(GLenum type, std::string const& source);
@@ -57,12 +105,24 @@ namespace opengl
     program& operator= (program&&) = delete;
 
   private:
-    inline GLuint uniform_location (std::string const& name) const;
+    //! a uniform's location, looked up once, and the last value it was set
+    //! to, as the program keeps it until it is set again
+    struct uniform_state
+    {
+      std::string name;
+      GLint location;
+      std::array<std::uint32_t, 16> value;
+      //! in bytes, 0 when unknown or too large to be kept
+      std::size_t value_size = 0;
+    };
+
+    uniform_state& uniform (uniform_name const&) const;
     inline GLuint attrib_location (std::string const& name) const;
 
     friend struct scoped::use_program;
 
     boost::optional<GLuint> _handle;
+    mutable std::unordered_map<std::uint64_t, uniform_state> _uniforms;
   };
 
   namespace scoped
@@ -79,16 +139,20 @@ namespace opengl
       use_program& operator= (use_program const&) = delete;
       use_program& operator= (use_program&&) = delete;
 
-      void uniform (std::string const& name, std::vector<int> const&);
-      void uniform (std::string const& name, GLint);
-      void uniform (std::string const& name, GLfloat);
-      void uniform (std::string const& name, math::vector_2d const&);
-      void uniform (std::string const& name, math::vector_3d const&);
-      void uniform (std::string const& name, math::vector_4d const&);
-      void uniform (std::string const& name, math::matrix_4x4 const&);
-      template<typename T> void uniform (std::string const&, T) = delete;
+      void uniform (uniform_name const& name, std::vector<int> const&);
+      void uniform (uniform_name const& name, GLint);
+      void uniform (uniform_name const& name, GLfloat);
+      void uniform (uniform_name const& name, math::vector_2d const&);
+      void uniform (uniform_name const& name, math::vector_3d const&);
+      void uniform (uniform_name const& name, math::vector_4d const&);
+      void uniform (uniform_name const& name, math::matrix_4x4 const&);
+      template<typename T> void uniform (uniform_name const&, T) = delete;
+
+      void sampler (uniform_name const& name, GLenum texture_slot, texture*);
 
-      void sampler (std::string const& name, GLenum texture_slot, texture*);
+      //! the uniform block name reads the buffer bound to binding with
+      //! glBindBufferBase (GL_UNIFORM_BUFFER, binding, ...)
+      void uniform_block (std::string const& name, GLuint binding);
 
       // \note All attrib*() functions implicitly modify the state of the currently bound VAO.
       // Thus they ensure there is a VAO bound and the caller is aware of it being modified, by taking a reference to it.
@@ -100,10 +164,11 @@ namespace opengl
       void attrib_divisor(vao_binder const&, std::string const& name, GLuint divisor, GLsizei range = 1);
 
     private:
-      GLuint uniform_location (std::string const& name);
+      //! calls set with the location unless the uniform already has value
+      template<typename Set>
+        void set_uniform (uniform_name const& name, void const* value, std::size_t size, Set&& set);
       GLuint attrib_location (std::string const& name);
-    
-      std::unordered_map<std::string, GLuint> _uniforms;
+
       std::unordered_map<std::string, GLuint> _attribs;
 
       program const& _program;
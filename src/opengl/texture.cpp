@@ -42,6 +42,15 @@ namespace opengl
     gl.bindTexture (GL_TEXTURE_2D, _id);
   }
 
+  void texture_array::bind()
+  {
+    if (_id == 0)
+    {
+      gl.genTextures (1, &_id);
+    }
+    gl.bindTexture (GL_TEXTURE_2D_ARRAY, _id);
+  }
+
   void texture::set_active_texture (size_t num)
   {
     gl.activeTexture (GL_TEXTURE0 + num);
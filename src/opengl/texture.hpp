@@ -26,4 +26,11 @@ namespace opengl
 
     internal_type _id;
   };
+
+  //! layers of the same size, bound to GL_TEXTURE_2D_ARRAY
+  class texture_array : public texture
+  {
+  public:
+    virtual void bind() override;
+  };
 }
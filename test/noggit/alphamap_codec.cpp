@@ -0,0 +1,363 @@
+#include <boost/test/unit_test.hpp>
+
+#include <noggit/alphamap_codec.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace
+{
+  using alphamap = std::array<std::uint8_t, 4096>;
+
+  // The byte-at-a-time implementations the codec replaced.
+  namespace legacy
+  {
+    void expand_4bit (std::uint8_t const* abuf, std::uint8_t* amap, bool do_not_fix_alpha_map)
+    {
+      for (std::size_t x(0); x < 64; ++x)
+      {
+        for (std::size_t y(0); y < 64; y += 2)
+        {
+          amap[x * 64 + y + 0] = ((*abuf & 0x0f) << 4) | (*abuf & 0x0f);
+          amap[x * 64 + y + 1] = ((*abuf & 0xf0) >> 4) | (*abuf & 0xf0);
+          ++abuf;
+        }
+      }
+
+      if (!do_not_fix_alpha_map)
+      {
+        for (std::size_t i(0); i < 64; ++i)
+        {
+          amap[i * 64 + 63] = amap[i * 64 + 62];
+          amap[63 * 64 + i] = amap[62 * 64 + i];
+        }
+        amap[63 * 64 + 63] = amap[62 * 64 + 62];
+      }
+    }
+
+    void pack_4bit (std::uint8_t const* tab, std::uint8_t* layer_data)
+    {
+      for (int i = 0; i < 2048; ++i)
+      {
+        layer_data[i] = ((tab[i * 2] & 0xF0) >> 4) | (tab[i * 2 + 1] & 0xF0);
+      }
+    }
+
+    void decompress (std::uint8_t const* input, std::uint8_t* amap)
+    {
+      for (std::size_t offset_output(0); offset_output < 4096;)
+      {
+        int count = *input & 0x7f;
+        bool const fill = *input & 0x80;
+
+        if (offset_output + count > 4096)
+        {
+          count = 4096 - offset_output;
+        }
+
+        ++input;
+
+        if (count == 0)
+        {
+          continue;
+        }
+
+        if (fill)
+        {
+          std::memset(&amap[offset_output], *input, count);
+          ++input;
+        }
+        else
+        {
+          std::memcpy(&amap[offset_output], input, count);
+          input += count;
+        }
+
+        offset_output += count;
+      }
+    }
+
+    std::vector<std::uint8_t> compress (std::uint8_t const* amap)
+    {
+      std::vector<std::uint8_t> data(amap, amap + 4096);
+      auto current (data.begin());
+      auto const end (data.end());
+      int column_pos = 0;
+
+      auto const consume_fill
+      (
+        [&]
+        {
+          int8_t count (0);
+          column_pos %= 64;
+
+          while ((current + 1 < end) && *current == *(current + 1) && column_pos < 63)
+          {
+            ++current;
+            ++count;
+            ++column_pos;
+          }
+
+          if (count)
+          {
+            ++count;
+            ++column_pos;
+          }
+
+          return count;
+        }
+      );
+
+      std::vector<std::uint8_t> result;
+      std::size_t copy_entry (0);
+      bool has_copy_entry (false);
+
+      for (; current != end; ++current)
+      {
+        auto const fill (consume_fill());
+        if (fill)
+        {
+          has_copy_entry = false;
+
+          result.emplace_back(0x80 | fill);
+          result.emplace_back(*current);
+
+          column_pos %= 64;
+        }
+        else
+        {
+          if (!has_copy_entry || column_pos == 64)
+          {
+            has_copy_entry = true;
+            copy_entry = result.size();
+            result.emplace_back(1);
+            result.emplace_back(*current);
+
+            column_pos %= 64;
+          }
+          else
+          {
+            result.emplace_back(*current);
+            result[copy_entry] = (result[copy_entry] & 0x80) | ((result[copy_entry] + 1) & 0x7f);
+          }
+
+          column_pos++;
+        }
+      }
+
+      return result;
+    }
+  }
+
+  //! runs of random length so that both entry kinds are used
+  alphamap generate (std::mt19937& engine, int max_run)
+  {
+    std::uniform_int_distribution<int> value (0, 255);
+    std::uniform_int_distribution<int> run (1, max_run);
+
+    alphamap result;
+    for (std::size_t i (0); i < result.size();)
+    {
+      std::uint8_t const v (value (engine));
+      for (int n (run (engine)); n > 0 && i < result.size(); --n)
+      {
+        result[i++] = v;
+      }
+    }
+    return result;
+  }
+
+  //! the legacy compressor merges copy entries across rows (overflowing
+  //! their 7 bit count), ending each row with a fill avoids that case
+  void end_rows_with_fill (alphamap& amap)
+  {
+    for (std::size_t row (0); row < 64; ++row)
+    {
+      amap[row * 64 + 63] = amap[row * 64 + 62];
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE (expand_4bit_matches_legacy)
+{
+  std::mt19937 engine (1);
+  std::uniform_int_distribution<int> value (0, 255);
+
+  for (int fix (0); fix < 2; ++fix)
+  {
+    std::array<std::uint8_t, 2048> packed;
+    for (auto& v : packed) { v = value (engine); }
+
+    alphamap expected, actual;
+    legacy::expand_4bit (packed.data(), expected.data(), !fix);
+
+    noggit::alphamap_codec::expand_4bit (packed.data(), actual.data());
+    if (fix)
+    {
+      noggit::alphamap_codec::fix_last_row_and_column (actual.data());
+    }
+
+    BOOST_REQUIRE (expected == actual);
+  }
+}
+
+BOOST_AUTO_TEST_CASE (pack_4bit_matches_legacy)
+{
+  std::mt19937 engine (2);
+  alphamap const amap (generate (engine, 1));
+
+  std::array<std::uint8_t, 2048> expected, actual;
+  legacy::pack_4bit (amap.data(), expected.data());
+  noggit::alphamap_codec::pack_4bit (amap.data(), actual.data());
+
+  BOOST_REQUIRE (expected == actual);
+
+  // packing and expanding keeps the high nibbles
+  alphamap expanded;
+  noggit::alphamap_codec::expand_4bit (actual.data(), expanded.data());
+  for (std::size_t i (0); i < amap.size(); ++i)
+  {
+    BOOST_REQUIRE_EQUAL (expanded[i] & 0xf0, amap[i] & 0xf0);
+  }
+}
+
+BOOST_AUTO_TEST_CASE (compress_round_trip)
+{
+  std::mt19937 engine (3);
+
+  for (int max_run : {1, 2, 3, 8, 70, 5000})
+  {
+    for (int i (0); i < 16; ++i)
+    {
+      alphamap const amap (generate (engine, max_run));
+
+      std::array<std::uint8_t, noggit::alphamap_codec::max_compressed_size> compressed;
+      std::size_t const size (noggit::alphamap_codec::compress (amap.data(), compressed.data()));
+      BOOST_REQUIRE_LE (size, compressed.size());
+
+      alphamap decompressed, legacy_decompressed;
+      bool valid (false);
+      BOOST_REQUIRE_EQUAL
+        (noggit::alphamap_codec::decompress (compressed.data(), size, decompressed.data(), &valid), size);
+      BOOST_REQUIRE (valid);
+      BOOST_REQUIRE (decompressed == amap);
+
+      legacy::decompress (compressed.data(), legacy_decompressed.data());
+      BOOST_REQUIRE (legacy_decompressed == amap);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE (compress_matches_legacy)
+{
+  std::mt19937 engine (4);
+
+  for (int max_run : {1, 2, 3, 8, 70})
+  {
+    for (int i (0); i < 16; ++i)
+    {
+      alphamap amap (generate (engine, max_run));
+      end_rows_with_fill (amap);
+
+      std::array<std::uint8_t, noggit::alphamap_codec::max_compressed_size> compressed;
+      std::size_t const size (noggit::alphamap_codec::compress (amap.data(), compressed.data()));
+      std::vector<std::uint8_t> const expected (legacy::compress (amap.data()));
+
+      BOOST_REQUIRE_EQUAL_COLLECTIONS
+        (expected.begin(), expected.end(), compressed.begin(), compressed.begin() + size);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE (decompress_rejects_truncated_input)
+{
+  std::uint8_t const truncated[] = {0x80 | 10, 42, 20, 1, 2};
+
+  alphamap amap;
+  amap.fill (7);
+  bool valid (true);
+
+  BOOST_REQUIRE_EQUAL (noggit::alphamap_codec::decompress (truncated, sizeof (truncated), amap.data(), &valid), 3u);
+  BOOST_REQUIRE (!valid);
+  BOOST_REQUIRE_EQUAL (amap[9], 42);
+  BOOST_REQUIRE_EQUAL (amap[10], 7);
+}
+
+// run with --run_test=benchmark
+BOOST_AUTO_TEST_CASE (benchmark, *boost::unit_test::disabled())
+{
+  std::mt19937 engine (5);
+  std::vector<alphamap> amaps;
+  for (int i (0); i < 1024; ++i)
+  {
+    amaps.emplace_back (generate (engine, 1 + i % 16));
+  }
+
+  auto const measure
+    ( [&] (char const* name, auto&& function)
+      {
+        auto const start (std::chrono::steady_clock::now());
+        std::size_t checksum (0);
+        for (int repeat (0); repeat < 16; ++repeat)
+        {
+          for (auto const& amap : amaps)
+          {
+            checksum += function (amap);
+          }
+        }
+        std::chrono::duration<double, std::milli> const duration (std::chrono::steady_clock::now() - start);
+        std::cout << name << ": " << duration.count() << " ms (" << checksum << ")" << std::endl;
+      }
+    );
+
+  measure ( "legacy compress"
+          , [] (alphamap const& amap) { return legacy::compress (amap.data()).size(); }
+          );
+  measure ( "codec compress"
+          , [] (alphamap const& amap)
+            {
+              std::array<std::uint8_t, noggit::alphamap_codec::max_compressed_size> out;
+              return noggit::alphamap_codec::compress (amap.data(), out.data());
+            }
+          );
+
+  measure ( "legacy expand"
+          , [] (alphamap const& amap)
+            {
+              alphamap out;
+              legacy::expand_4bit (amap.data(), out.data(), false);
+              return std::size_t (out[100]);
+            }
+          );
+  measure ( "codec expand"
+          , [] (alphamap const& amap)
+            {
+              alphamap out;
+              noggit::alphamap_codec::expand_4bit (amap.data(), out.data());
+              noggit::alphamap_codec::fix_last_row_and_column (out.data());
+              return std::size_t (out[100]);
+            }
+          );
+
+  measure ( "legacy pack"
+          , [] (alphamap const& amap)
+            {
+              std::array<std::uint8_t, 2048> out;
+              legacy::pack_4bit (amap.data(), out.data());
+              return std::size_t (out[100]);
+            }
+          );
+  measure ( "codec pack"
+          , [] (alphamap const& amap)
+            {
+              std::array<std::uint8_t, 2048> out;
+              noggit::alphamap_codec::pack_4bit (amap.data(), out.data());
+              return std::size_t (out[100]);
+            }
+          );
+}
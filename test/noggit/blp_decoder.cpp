@@ -0,0 +1,210 @@
+#include <boost/test/unit_test.hpp>
+
+#include <noggit/blp_decoder.hpp>
+
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+  std::uint32_t rgba (std::uint32_t r, std::uint32_t g, std::uint32_t b, std::uint32_t a)
+  {
+    return r | (g << 8) | (b << 16) | (a << 24);
+  }
+
+  //! a file with the given mip levels, with a palette if palettized
+  std::vector<char> make_blp ( noggit::blp::compression compression
+                             , std::uint8_t alpha_depth
+                             , std::uint8_t alpha_type
+                             , int width
+                             , int height
+                             , std::vector<std::vector<std::uint8_t>> const& levels
+                             , std::vector<std::uint32_t> const& palette = {}
+                             )
+  {
+    BLPHeader header;
+    std::memset (&header, 0, sizeof (header));
+    std::memcpy (&header.magix, "BLP2", 4);
+    header.version = 1;
+    header.attr_0_compression = static_cast<std::uint8_t> (compression);
+    header.attr_1_alphadepth = alpha_depth;
+    header.attr_2_alphatype = alpha_type;
+    header.attr_3_mipmaplevels = levels.size() > 1;
+    header.resx = width;
+    header.resy = height;
+
+    std::vector<char> file (sizeof (BLPHeader) + 256 * sizeof (std::uint32_t), 0);
+    std::memcpy (file.data() + sizeof (BLPHeader), palette.data(), palette.size() * sizeof (std::uint32_t));
+
+    for (std::size_t level (0); level < levels.size(); ++level)
+    {
+      header.offsets[level] = static_cast<std::int32_t> (file.size());
+      header.sizes[level] = static_cast<std::int32_t> (levels[level].size());
+      file.insert (file.end(), levels[level].begin(), levels[level].end());
+    }
+
+    std::memcpy (file.data(), &header, sizeof (header));
+    return file;
+  }
+
+  std::vector<std::uint8_t> dxt1_block (std::uint16_t c0, std::uint16_t c1, std::uint32_t indices)
+  {
+    return { std::uint8_t (c0), std::uint8_t (c0 >> 8), std::uint8_t (c1), std::uint8_t (c1 >> 8)
+           , std::uint8_t (indices), std::uint8_t (indices >> 8)
+           , std::uint8_t (indices >> 16), std::uint8_t (indices >> 24)
+           };
+  }
+
+  // every row is 0 1 2 3
+  std::uint32_t const column_indices (0xe4e4e4e4);
+  std::uint16_t const red (0xf800);
+  std::uint16_t const blue (0x001f);
+}
+
+BOOST_AUTO_TEST_CASE (palettized_levels_are_decoded_to_rgba)
+{
+  // bgra
+  std::vector<std::uint32_t> const palette = {0x11223344, 0xff0000ff, 0x8000ff00};
+
+  auto const file
+    ( make_blp ( noggit::blp::compression::palettized, 8, 8, 2, 2
+               , { {0, 1, 2, 0, /* alpha */ 0xff, 0x80, 0x40, 0x00}
+                 , {1, /* alpha */ 0x7f}
+                 }
+               , palette
+               )
+    );
+
+  auto const full (noggit::blp::decode (file.data(), file.size()));
+  BOOST_REQUIRE_EQUAL (full.width, 2);
+  BOOST_REQUIRE_EQUAL (full.height, 2);
+  BOOST_REQUIRE_EQUAL (full.pixels[0], rgba (0x22, 0x33, 0x44, 0xff));
+  BOOST_REQUIRE_EQUAL (full.pixels[1], rgba (0x00, 0x00, 0xff, 0x80));
+  BOOST_REQUIRE_EQUAL (full.pixels[2], rgba (0x00, 0xff, 0x00, 0x40));
+  BOOST_REQUIRE_EQUAL (full.pixels[3], rgba (0x22, 0x33, 0x44, 0x00));
+
+  auto const small (noggit::blp::decode (file.data(), file.size(), 1, 1));
+  BOOST_REQUIRE_EQUAL (small.width, 1);
+  BOOST_REQUIRE_EQUAL (small.height, 1);
+  BOOST_REQUIRE_EQUAL (small.pixels[0], rgba (0x00, 0x00, 0xff, 0x7f));
+}
+
+BOOST_AUTO_TEST_CASE (palettized_alpha_depths)
+{
+  std::vector<std::uint32_t> const palette = {0x00000000};
+  std::vector<std::uint8_t> indices (8, 0);
+
+  auto one_bit (indices);
+  one_bit.push_back (0x05);
+  auto const one_bit_file
+    (make_blp (noggit::blp::compression::palettized, 1, 1, 4, 2, {one_bit}, palette));
+  auto const one_bit_image (noggit::blp::decode (one_bit_file.data(), one_bit_file.size()));
+  BOOST_REQUIRE_EQUAL (one_bit_image.pixels[0] >> 24, 0xff);
+  BOOST_REQUIRE_EQUAL (one_bit_image.pixels[1] >> 24, 0);
+  BOOST_REQUIRE_EQUAL (one_bit_image.pixels[2] >> 24, 0xff);
+  BOOST_REQUIRE_EQUAL (one_bit_image.pixels[7] >> 24, 0);
+
+  auto four_bits (indices);
+  four_bits.insert (four_bits.end(), {0xf0, 0x08, 0x00, 0x00});
+  auto const four_bits_file
+    (make_blp (noggit::blp::compression::palettized, 4, 1, 4, 2, {four_bits}, palette));
+  auto const four_bits_image (noggit::blp::decode (four_bits_file.data(), four_bits_file.size()));
+  BOOST_REQUIRE_EQUAL (four_bits_image.pixels[0] >> 24, 0);
+  BOOST_REQUIRE_EQUAL (four_bits_image.pixels[1] >> 24, 0xff);
+  BOOST_REQUIRE_EQUAL (four_bits_image.pixels[2] >> 24, 0x88);
+}
+
+BOOST_AUTO_TEST_CASE (dxt1_blocks)
+{
+  auto const opaque_file
+    ( make_blp ( noggit::blp::compression::dxt, 0, 0, 4, 4
+               , {dxt1_block (red, blue, column_indices)}
+               )
+    );
+  auto const opaque (noggit::blp::decode (opaque_file.data(), opaque_file.size()));
+  BOOST_REQUIRE_EQUAL (opaque.pixels[0], rgba (0xff, 0, 0, 0xff));
+  BOOST_REQUIRE_EQUAL (opaque.pixels[1], rgba (0, 0, 0xff, 0xff));
+  BOOST_REQUIRE_EQUAL (opaque.pixels[2], rgba (0xaa, 0, 0x55, 0xff));
+  BOOST_REQUIRE_EQUAL (opaque.pixels[15], rgba (0x55, 0, 0xaa, 0xff));
+
+  // c0 <= c1: three colors and black, transparent if the file has alpha
+  for (std::uint8_t alpha_depth : {0, 1})
+  {
+    auto const file
+      ( make_blp ( noggit::blp::compression::dxt, alpha_depth, 0, 4, 4
+                 , {dxt1_block (blue, red, column_indices)}
+                 )
+      );
+    auto const image (noggit::blp::decode (file.data(), file.size()));
+    BOOST_REQUIRE_EQUAL (image.pixels[2], rgba (0x7f, 0, 0x7f, 0xff));
+    BOOST_REQUIRE_EQUAL (image.pixels[3], rgba (0, 0, 0, alpha_depth ? 0 : 0xff));
+  }
+}
+
+BOOST_AUTO_TEST_CASE (dxt3_and_dxt5_alpha)
+{
+  auto color (dxt1_block (blue, red, 0));
+
+  std::vector<std::uint8_t> dxt3 = {0xf0, 0x08, 0, 0, 0, 0, 0, 0};
+  dxt3.insert (dxt3.end(), color.begin(), color.end());
+  auto const dxt3_file (make_blp (noggit::blp::compression::dxt, 8, 1, 4, 4, {dxt3}));
+  auto const dxt3_image (noggit::blp::decode (dxt3_file.data(), dxt3_file.size()));
+  BOOST_REQUIRE_EQUAL (dxt3_image.pixels[0], rgba (0, 0, 0xff, 0));
+  BOOST_REQUIRE_EQUAL (dxt3_image.pixels[1] >> 24, 0xff);
+  BOOST_REQUIRE_EQUAL (dxt3_image.pixels[2] >> 24, 0x88);
+
+  // indices 0 1 2 then 7 for the others
+  std::vector<std::uint8_t> dxt5 = {0xff, 0x00, 0x88, 0xfe, 0xff, 0xff, 0xff, 0xff};
+  dxt5.insert (dxt5.end(), color.begin(), color.end());
+  auto const dxt5_file (make_blp (noggit::blp::compression::dxt, 8, 7, 4, 4, {dxt5}));
+  auto const dxt5_image (noggit::blp::decode (dxt5_file.data(), dxt5_file.size()));
+  BOOST_REQUIRE_EQUAL (dxt5_image.pixels[0] >> 24, 0xff);
+  BOOST_REQUIRE_EQUAL (dxt5_image.pixels[1] >> 24, 0);
+  BOOST_REQUIRE_EQUAL (dxt5_image.pixels[2] >> 24, 6 * 0xff / 7);
+  BOOST_REQUIRE_EQUAL (dxt5_image.pixels[3] >> 24, 0xff / 7);
+}
+
+BOOST_AUTO_TEST_CASE (small_dxt_levels)
+{
+  // the first level is a block short
+  auto const with_levels
+    ( make_blp ( noggit::blp::compression::dxt, 0, 0, 8, 2
+               , { dxt1_block (red, blue, 0x55555555)
+                 , dxt1_block (red, blue, column_indices)
+                 }
+               )
+    );
+
+  auto const first (noggit::blp::decode (with_levels.data(), with_levels.size()));
+  BOOST_REQUIRE_EQUAL (first.pixels.size(), 16);
+  BOOST_REQUIRE_EQUAL (first.pixels[0], rgba (0, 0, 0xff, 0xff));
+  // the missing block is black
+  BOOST_REQUIRE_EQUAL (first.pixels[4], rgba (0, 0, 0, 0xff));
+
+  auto const second (noggit::blp::decode (with_levels.data(), with_levels.size(), 4, 1));
+  BOOST_REQUIRE_EQUAL (second.width, 4);
+  BOOST_REQUIRE_EQUAL (second.height, 1);
+  BOOST_REQUIRE_EQUAL (second.pixels[3], rgba (0x55, 0, 0xaa, 0xff));
+}
+
+BOOST_AUTO_TEST_CASE (truncated_files_throw)
+{
+  auto file
+    ( make_blp ( noggit::blp::compression::palettized, 8, 8, 4, 4
+               , {std::vector<std::uint8_t> (32, 0)}
+               , {0}
+               )
+    );
+
+  BOOST_REQUIRE_NO_THROW (noggit::blp::decode (file.data(), file.size()));
+  BOOST_REQUIRE_THROW (noggit::blp::decode (file.data(), file.size() - 1), std::runtime_error);
+  BOOST_REQUIRE_THROW (noggit::blp::decode (file.data(), sizeof (BLPHeader) - 1), std::runtime_error);
+
+  file[offsetof (BLPHeader, attr_0_compression)] = 3;
+  BOOST_REQUIRE_THROW (noggit::blp::decode (file.data(), file.size()), std::runtime_error);
+
+  auto const without_levels (make_blp (noggit::blp::compression::dxt, 0, 0, 4, 4, {}));
+  BOOST_REQUIRE_THROW (noggit::blp::decode (without_levels.data(), without_levels.size()), std::runtime_error);
+}
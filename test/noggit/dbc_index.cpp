@@ -0,0 +1,151 @@
+#include <boost/test/unit_test.hpp>
+
+#include <noggit/DBCFile.h>
+#include <noggit/dbc_index.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace
+{
+  std::size_t const field_count (4);
+  std::size_t const record_size (field_count * 4);
+
+  struct table
+  {
+    std::size_t record_count;
+    std::vector<unsigned char> data;
+
+    std::uint32_t value (std::size_t record, std::size_t field) const
+    {
+      return *reinterpret_cast<std::uint32_t const*> (data.data() + record * record_size + field * 4);
+    }
+
+    //! the lookup DBCFile::getByID used to do
+    std::size_t linear_find (std::uint32_t id, std::size_t field) const
+    {
+      for (std::size_t i (0); i < record_count; ++i)
+      {
+        if (value (i, field) == id)
+        {
+          return i;
+        }
+      }
+      return noggit::dbc_index::npos;
+    }
+  };
+
+  //! ids in field 0 with gaps every stride, field 1 has few distinct
+  //! values, field 2 is sparse
+  table generate (std::size_t record_count, std::uint32_t stride, unsigned seed)
+  {
+    std::mt19937 engine (seed);
+    std::uniform_int_distribution<std::uint32_t> few (0, 15);
+    std::uniform_int_distribution<std::uint32_t> any;
+
+    table result {record_count, std::vector<unsigned char> (record_count * record_size)};
+    auto* values (reinterpret_cast<std::uint32_t*> (result.data.data()));
+
+    for (std::size_t i (0); i < record_count; ++i)
+    {
+      values[i * field_count + 0] = 1 + std::uint32_t (i) * stride;
+      values[i * field_count + 1] = few (engine);
+      values[i * field_count + 2] = any (engine);
+      values[i * field_count + 3] = 0;
+    }
+
+    return result;
+  }
+
+  void require_same_lookups (table const& t, std::size_t field, std::vector<std::uint32_t> const& keys)
+  {
+    noggit::dbc_index const index (t.data.data(), t.record_count, record_size, field);
+
+    for (std::uint32_t key : keys)
+    {
+      BOOST_REQUIRE_EQUAL (index.find (key), t.linear_find (key, field));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE (index_matches_linear_lookup)
+{
+  for (std::uint32_t stride : {1u, 3u, 1000u})
+  {
+    table const t (generate (500, stride, stride));
+
+    std::vector<std::uint32_t> keys {0, 0xffffffff};
+    for (std::size_t i (0); i < t.record_count; ++i)
+    {
+      keys.push_back (t.value (i, 0));
+      keys.push_back (t.value (i, 0) + 1);
+      keys.push_back (t.value (i, 1));
+      keys.push_back (t.value (i, 2));
+    }
+
+    for (std::size_t field (0); field < field_count; ++field)
+    {
+      require_same_lookups (t, field, keys);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE (index_of_empty_table)
+{
+  noggit::dbc_index const index (nullptr, 0, record_size, 0);
+  BOOST_REQUIRE_EQUAL (index.find (0), noggit::dbc_index::npos);
+  BOOST_REQUIRE_EQUAL (index.find (1), noggit::dbc_index::npos);
+}
+
+BOOST_AUTO_TEST_CASE (typed_fields_cover_their_columns)
+{
+  using id = dbc::field<std::uint32_t, 0>;
+  using values = dbc::field<float, 18, 16>;
+  using name = dbc::field<dbc::localized_string, 5>;
+
+  static_assert (dbc::fields_end<id>() == 1, "");
+  static_assert (dbc::fields_end<id, values>() == 34, "");
+  static_assert (dbc::fields_end<name, id>() == 14, "");
+  static_assert (dbc::fields_end<>() == 0, "");
+}
+
+// run with --run_test=benchmark
+BOOST_AUTO_TEST_CASE (benchmark, *boost::unit_test::disabled())
+{
+  // about the size of AreaTable.dbc
+  table const t (generate (4000, 1, 1));
+
+  std::mt19937 engine (2);
+  std::uniform_int_distribution<std::uint32_t> key (0, 4100);
+  std::vector<std::uint32_t> keys (100000);
+  for (auto& k : keys)
+  {
+    k = key (engine);
+  }
+
+  auto const measure
+    ( [&] (char const* name, auto&& find)
+      {
+        auto const start (std::chrono::steady_clock::now());
+        std::size_t checksum (0);
+        for (std::uint32_t k : keys)
+        {
+          checksum += find (k);
+        }
+        std::chrono::duration<double, std::milli> const duration (std::chrono::steady_clock::now() - start);
+        std::cout << name << ": " << duration.count() << " ms (" << checksum << ")" << std::endl;
+      }
+    );
+
+  measure ("linear", [&] (std::uint32_t k) { return t.linear_find (k, 0); });
+
+  noggit::dbc_index const dense (t.data.data(), t.record_count, record_size, 0);
+  measure ("dense", [&] (std::uint32_t k) { return dense.find (k); });
+
+  table const sparse_table (generate (4000, 1000, 1));
+  noggit::dbc_index const sparse (sparse_table.data.data(), sparse_table.record_count, record_size, 0);
+  measure ("hashed", [&] (std::uint32_t k) { return sparse.find (1 + (k - 1) * 1000); });
+}
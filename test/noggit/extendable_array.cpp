@@ -0,0 +1,661 @@
+#include <boost/test/unit_test.hpp>
+
+#include <noggit/MapHeaders.h>
+#include <noggit/Misc.h>
+#include <noggit/map_file_layout.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+// The ADT and WDT writers used to grow the file with Extend and Insert and
+// now allocate it once with the sizes of noggit/map_file_layout. These
+// tests replay the Extend/Insert writers as they were before and compare
+// them with the sizes and bytes of the functions the writers use now.
+
+namespace
+{
+  struct layer
+  {
+    std::uint64_t subchunks;
+    int liquid_id;
+    int vertex_format;
+    float minimum;
+    float maximum;
+    std::vector<math::vector_3d> vertices;
+    std::vector<float> depth;
+    std::vector<math::vector_2d> tex_coords;
+  };
+
+  struct chunk_water
+  {
+    bool has_render;
+    MH2O_Render render;
+    std::vector<layer> layers;
+  };
+
+  std::vector<chunk_water> generate_water (unsigned seed)
+  {
+    std::mt19937_64 engine (seed);
+    std::uniform_int_distribution<int> layer_count (0, 2);
+    std::uniform_int_distribution<int> vertex_format (0, 2);
+    std::uniform_real_distribution<float> value (0.f, 1.2f);
+
+    std::vector<chunk_water> water (256);
+
+    for (chunk_water& chunk : water)
+    {
+      chunk.has_render = engine() & 1;
+      chunk.render.fishable = engine();
+      chunk.render.fatigue = engine();
+
+      for (int i (layer_count (engine)); i > 0; --i)
+      {
+        layer l;
+        // empty layers are removed before saving
+        switch (engine() % 3)
+        {
+        case 0: l.subchunks = std::uint64_t (-1); break;
+        case 1: l.subchunks = engine() & engine() & engine(); break;
+        default: l.subchunks = engine(); break;
+        }
+        if (!l.subchunks)
+        {
+          l.subchunks = 1;
+        }
+
+        l.liquid_id = 1 + engine() % 20;
+        l.vertex_format = vertex_format (engine);
+        l.minimum = value (engine);
+        l.maximum = l.minimum + value (engine);
+
+        for (int v (0); v < 9 * 9; ++v)
+        {
+          l.vertices.emplace_back (value (engine), value (engine) * 100.f, value (engine));
+          l.depth.emplace_back (value (engine));
+          l.tex_coords.emplace_back (value (engine) * 300.f, value (engine));
+        }
+
+        chunk.layers.emplace_back (std::move (l));
+      }
+    }
+
+    return water;
+  }
+
+  // liquid_layer::save before the single pass writer
+  void legacy_layer_save (sExtendableArray& adt, int base_pos, int& info_pos, int& current_pos, layer const& l)
+  {
+    auto const hasSubchunk ([&] (int x, int z) { return (l.subchunks >> (z * 8 + x)) & 1; });
+
+    int min_x = 9, min_z = 9, max_x = 0, max_z = 0;
+    bool filled = true;
+
+    for (int z = 0; z < 8; ++z)
+    {
+      for (int x = 0; x < 8; ++x)
+      {
+        if (hasSubchunk(x, z))
+        {
+          min_x = std::min(x, min_x);
+          min_z = std::min(z, min_z);
+          max_x = std::max(x + 1, max_x);
+          max_z = std::max(z + 1, max_z);
+        }
+        else
+        {
+          filled = false;
+        }
+      }
+    }
+
+    MH2O_Information info;
+    std::uint64_t mask = 0;
+
+    info.liquid_id = l.liquid_id;
+    info.liquid_vertex_format = l.vertex_format;
+    info.minHeight = l.minimum;
+    info.maxHeight = l.maximum;
+    info.xOffset = min_x;
+    info.yOffset = min_z;
+    info.width = max_x - min_x;
+    info.height = max_z - min_z;
+
+    if (filled)
+    {
+      info.ofsInfoMask = 0;
+    }
+    else
+    {
+      std::uint64_t value = 1;
+      for (int z = info.yOffset; z < info.yOffset + info.height; ++z)
+      {
+        for (int x = info.xOffset; x < info.xOffset + info.width; ++x)
+        {
+          if (hasSubchunk(x, z))
+          {
+            mask |= value;
+          }
+          value <<= 1;
+        }
+      }
+
+      if (mask > 0)
+      {
+        info.ofsInfoMask = current_pos - base_pos;
+        adt.Insert(current_pos, 8, reinterpret_cast<char*>(&mask));
+        current_pos += 8;
+      }
+    }
+
+    info.ofsHeightMap = current_pos - base_pos;
+
+    int vertices_count = (info.width + 1) * (info.height + 1);
+
+    if (l.vertex_format == 0 || l.vertex_format == 1)
+    {
+      adt.Extend(vertices_count * sizeof(float));
+
+      for (int z = info.yOffset; z <= info.yOffset + info.height; ++z)
+      {
+        for (int x = info.xOffset; x <= info.xOffset + info.width; ++x)
+        {
+          memcpy(adt.GetPointer<char>(current_pos), &l.vertices[z * 9 + x].y, sizeof(float));
+          current_pos += sizeof(float);
+        }
+      }
+    }
+
+    if (l.vertex_format == 1)
+    {
+      adt.Extend(vertices_count * sizeof(mh2o_uv));
+
+      for (int z = info.yOffset; z <= info.yOffset + info.height; ++z)
+      {
+        for (int x = info.xOffset; x <= info.xOffset + info.width; ++x)
+        {
+          mh2o_uv uv;
+          uv.x = static_cast<std::uint16_t>(std::min(l.tex_coords[z * 9 + x].x * 255.f, 65535.f));
+          uv.y = static_cast<std::uint16_t>(std::min(l.tex_coords[z * 9 + x].y * 255.f, 65535.f));
+
+          memcpy(adt.GetPointer<char>(current_pos), &uv, sizeof(mh2o_uv));
+          current_pos += sizeof(mh2o_uv);
+        }
+      }
+    }
+
+    if (l.vertex_format == 0 || l.vertex_format == 2)
+    {
+      adt.Extend(vertices_count * sizeof(std::uint8_t));
+
+      for (int z = info.yOffset; z <= info.yOffset + info.height; ++z)
+      {
+        for (int x = info.xOffset; x <= info.xOffset + info.width; ++x)
+        {
+          std::uint8_t depth = static_cast<std::uint8_t>(std::min(l.depth[z * 9 + x] * 255.0f, 255.f));
+          memcpy(adt.GetPointer<char>(current_pos), &depth, sizeof(std::uint8_t));
+          current_pos += sizeof(std::uint8_t);
+        }
+      }
+    }
+
+    memcpy(adt.GetPointer<char>(info_pos), &info, sizeof(MH2O_Information));
+    info_pos += sizeof(MH2O_Information);
+  }
+
+  // TileWater::saveToFile and ChunkWater::save before the single pass writer
+  void legacy_mh2o (sExtendableArray& adt, int& current_pos, std::vector<chunk_water> const& water)
+  {
+    int ofsW = current_pos + 0x8;
+    int headers_size = 256 * sizeof(MH2O_Header);
+    adt.Extend(8 + headers_size);
+    current_pos = ofsW + headers_size;
+    int header_pos = ofsW;
+
+    for (chunk_water const& chunk : water)
+    {
+      MH2O_Header header;
+
+      if (!chunk.layers.empty())
+      {
+        header.nLayers = chunk.layers.size();
+
+        if (chunk.has_render)
+        {
+          header.ofsRenderMask = current_pos - ofsW;
+          adt.Insert(current_pos, sizeof(MH2O_Render), reinterpret_cast<char const*>(&chunk.render));
+          current_pos += sizeof(MH2O_Render);
+        }
+        else
+        {
+          header.ofsRenderMask = 0;
+        }
+
+        header.ofsInformation = current_pos - ofsW;
+        int info_pos = current_pos;
+
+        std::size_t info_size = sizeof(MH2O_Information) * chunk.layers.size();
+        current_pos += info_size;
+
+        adt.Extend(info_size);
+
+        for (layer const& l : chunk.layers)
+        {
+          legacy_layer_save(adt, ofsW, info_pos, current_pos, l);
+        }
+      }
+
+      memcpy(adt.GetPointer<char>(header_pos), &header, sizeof(MH2O_Header));
+      header_pos += sizeof(MH2O_Header);
+    }
+
+    SetChunkHeader(adt, ofsW - 8, 'MH2O', current_pos - ofsW);
+  }
+
+  MH2O_Information save_info (layer const& l, std::uint64_t& mask)
+  {
+    MH2O_Information info (noggit::mh2o::layer_info (l.subchunks, mask));
+    info.liquid_id = l.liquid_id;
+    info.liquid_vertex_format = l.vertex_format;
+    info.minHeight = l.minimum;
+    info.maxHeight = l.maximum;
+    return info;
+  }
+
+  // the framing of TileWater::save_size and ChunkWater::save_size
+  std::size_t mh2o_size (std::vector<chunk_water> const& water)
+  {
+    std::size_t size (8 + 256 * sizeof (MH2O_Header));
+
+    for (chunk_water const& chunk : water)
+    {
+      if (chunk.layers.empty())
+      {
+        continue;
+      }
+
+      size += (chunk.has_render ? sizeof (MH2O_Render) : 0)
+            + sizeof (MH2O_Information) * chunk.layers.size();
+
+      for (layer const& l : chunk.layers)
+      {
+        std::uint64_t mask;
+        MH2O_Information const info (save_info (l, mask));
+        size += noggit::mh2o::layer_size (info, mask);
+      }
+    }
+
+    return size;
+  }
+
+  // the framing of TileWater::saveToFile and ChunkWater::save
+  void single_pass_mh2o (sExtendableArray& adt, int& current_pos, std::vector<chunk_water> const& water)
+  {
+    int const base_pos (current_pos + 8);
+    int header_pos (base_pos);
+    current_pos = base_pos + 256 * sizeof (MH2O_Header);
+
+    for (chunk_water const& chunk : water)
+    {
+      MH2O_Header header;
+
+      if (!chunk.layers.empty())
+      {
+        header.nLayers = chunk.layers.size();
+
+        if (chunk.has_render)
+        {
+          header.ofsRenderMask = current_pos - base_pos;
+          adt.Write (current_pos, sizeof (MH2O_Render), reinterpret_cast<char const*> (&chunk.render));
+          current_pos += sizeof (MH2O_Render);
+        }
+
+        header.ofsInformation = current_pos - base_pos;
+        int info_pos (current_pos);
+        current_pos += sizeof (MH2O_Information) * chunk.layers.size();
+
+        for (layer const& l : chunk.layers)
+        {
+          std::uint64_t mask;
+          MH2O_Information const info (save_info (l, mask));
+          noggit::mh2o::write_layer
+            (adt, base_pos, info_pos, current_pos, info, mask, l.vertices, l.depth, l.tex_coords);
+        }
+      }
+
+      adt.Write (header_pos, sizeof (MH2O_Header), reinterpret_cast<char const*> (&header));
+      header_pos += sizeof (MH2O_Header);
+    }
+
+    SetChunkHeader (adt, base_pos - 8, 'MH2O', current_pos - base_pos);
+  }
+
+  noggit::mcnk_layout generate_mcnk (std::mt19937_64& engine)
+  {
+    noggit::mcnk_layout layout;
+    layout.has_mccv = engine() & 1;
+    layout.texture_layers = engine() % 5;
+    layout.references = engine() % 40;
+    layout.has_shadow_map = engine() & 1;
+    layout.alphamaps_size = 0;
+    for (std::size_t i (1); i < layout.texture_layers; ++i)
+    {
+      layout.alphamaps_size += engine() % 2 ? 2048 : 4096;
+    }
+    return layout;
+  }
+
+  // the growth of the file in MapChunk::save before the single pass writer.
+  // Returns the size of the chunk, which is what it moves the position by.
+  int legacy_mcnk (sExtendableArray& adt, int& current_pos, noggit::mcnk_layout const& layout)
+  {
+    int const mapbufsize (9 * 9 + 8 * 8);
+    char const header[0x80] = {};
+
+    int lMCNK_Size = 0x80;
+    int lMCNK_Position = current_pos;
+    adt.Extend(8 + 0x80);
+    SetChunkHeader(adt, current_pos, 'MCNK', lMCNK_Size);
+    adt.Insert(current_pos + 8, 0x80, header);
+    current_pos += 8 + 0x80;
+
+    int lMCVT_Size = mapbufsize * 4;
+    adt.Extend(8 + lMCVT_Size);
+    current_pos += 8 + lMCVT_Size;
+    lMCNK_Size += 8 + lMCVT_Size;
+
+    if (layout.has_mccv)
+    {
+      int lMCCV_Size = mapbufsize * sizeof(unsigned int);
+      adt.Extend(8 + lMCCV_Size);
+      current_pos += 8 + lMCCV_Size;
+      lMCNK_Size += 8 + lMCCV_Size;
+    }
+
+    int lMCNR_Size = mapbufsize * 3;
+    adt.Extend(8 + lMCNR_Size);
+    current_pos += 8 + lMCNR_Size;
+    lMCNK_Size += 8 + lMCNR_Size;
+
+    adt.Extend(13);
+    current_pos += 13;
+    lMCNK_Size += 13;
+
+    std::size_t lMCLY_Size = layout.texture_layers * 0x10;
+    adt.Extend(8 + lMCLY_Size);
+    current_pos += 8 + lMCLY_Size;
+    lMCNK_Size += 8 + lMCLY_Size;
+
+    int lMCRF_Size = 4 * layout.references;
+    adt.Extend(8 + lMCRF_Size);
+    current_pos += 8 + lMCRF_Size;
+    lMCNK_Size += 8 + lMCRF_Size;
+
+    if (layout.has_shadow_map)
+    {
+      int lMCSH_Size = 0x200;
+      adt.Extend(8 + lMCSH_Size);
+      current_pos += 8 + lMCSH_Size;
+      lMCNK_Size += 8 + lMCSH_Size;
+    }
+
+    int lMCAL_Size = layout.alphamaps_size;
+    adt.Extend(8 + lMCAL_Size);
+    current_pos += 8 + lMCAL_Size;
+    lMCNK_Size += 8 + lMCAL_Size;
+
+    int lMCSE_Size = 0;
+    adt.Extend(8 + lMCSE_Size);
+    current_pos += 8 + lMCSE_Size;
+    lMCNK_Size += 8 + lMCSE_Size;
+
+    adt.GetPointer<sChunkHeader>(lMCNK_Position)->mSize = lMCNK_Size;
+
+    return lMCNK_Size + sizeof (sChunkHeader);
+  }
+}
+
+BOOST_AUTO_TEST_CASE (write_matches_insert_at_end)
+{
+  std::string const data ("some/texture.blp");
+
+  sExtendableArray inserted;
+  inserted.Extend (8);
+  inserted.Insert (8, data.size() + 1, data.c_str());
+
+  sExtendableArray written;
+  written.Allocate (8 + data.size() + 1);
+  written.Write (8, data.size() + 1, data.c_str());
+
+  BOOST_REQUIRE (inserted.data == written.data);
+}
+
+BOOST_AUTO_TEST_CASE (mh2o_is_byte_identical_to_the_legacy_writer)
+{
+  for (unsigned seed (0); seed < 32; ++seed)
+  {
+    std::vector<chunk_water> const water (generate_water (seed));
+
+    sExtendableArray legacy;
+    int legacy_position (0);
+    legacy_mh2o (legacy, legacy_position, water);
+
+    BOOST_REQUIRE_EQUAL (mh2o_size (water), legacy.data.size());
+
+    sExtendableArray single_pass;
+    single_pass.Allocate (mh2o_size (water));
+    int position (0);
+    single_pass_mh2o (single_pass, position, water);
+
+    BOOST_REQUIRE_EQUAL (position, single_pass.data.size());
+    BOOST_REQUIRE_EQUAL (legacy_position, position);
+    BOOST_REQUIRE_EQUAL_COLLECTIONS ( legacy.data.begin(), legacy.data.end()
+                                    , single_pass.data.begin(), single_pass.data.end()
+                                    );
+  }
+}
+
+BOOST_AUTO_TEST_CASE (mcnk_size_matches_the_legacy_writer)
+{
+  std::mt19937_64 engine (7);
+
+  for (int i (0); i < 256; ++i)
+  {
+    noggit::mcnk_layout const layout (generate_mcnk (engine));
+
+    sExtendableArray legacy;
+    int position (0);
+    int const size (legacy_mcnk (legacy, position, layout));
+
+    BOOST_REQUIRE_EQUAL (size, position);
+    BOOST_REQUIRE_EQUAL (noggit::mcnk_size (layout), size);
+    // the inserted header was left unused at the end of the file
+    BOOST_REQUIRE_EQUAL (legacy.data.size(), size + 0x80);
+  }
+}
+
+BOOST_AUTO_TEST_CASE (adt_size_matches_the_legacy_writer)
+{
+  std::mt19937_64 engine (11);
+
+  for (unsigned seed (0); seed < 16; ++seed)
+  {
+    std::vector<std::string> names[3];
+    for (auto& chunk_names : names)
+    {
+      for (int i (engine() % 12); i > 0; --i)
+      {
+        chunk_names.emplace_back (1 + engine() % 60, char ('a' + engine() % 26));
+      }
+    }
+    std::size_t const model_instances (engine() % 100);
+    std::size_t const object_instances (engine() % 20);
+    bool const has_mfbo (engine() & 1);
+    bool const has_water (seed % 4);
+    std::vector<chunk_water> const water (generate_water (seed));
+
+    // MapTile::saveTile before the single pass writer
+    sExtendableArray legacy;
+    int position (0);
+
+    legacy.Extend (8 + 0x4);
+    position += 8 + 0x4;
+    legacy.Extend (8 + 0x40);
+    position += 8 + 0x40;
+    legacy.Extend (8 + 256 * 0x10);
+    position += 8 + 256 * 0x10;
+
+    std::size_t names_size[3] = {0, 0, 0};
+    for (int chunk (0); chunk < 3; ++chunk)
+    {
+      legacy.Extend (8);
+      position += 8;
+      for (auto const& name : names[chunk])
+      {
+        legacy.Insert (position, name.size() + 1, name.c_str());
+        position += name.size() + 1;
+        names_size[chunk] += name.size() + 1;
+      }
+
+      // MMID and MWID after MMDX and MWMO
+      if (chunk > 0)
+      {
+        legacy.Extend (8 + 4 * names[chunk].size());
+        position += 8 + 4 * names[chunk].size();
+      }
+    }
+
+    legacy.Extend (8 + 0x24 * model_instances);
+    position += 8 + 0x24 * model_instances;
+    legacy.Extend (8 + 0x40 * object_instances);
+    position += 8 + 0x40 * object_instances;
+
+    std::size_t water_size (0);
+    if (has_water)
+    {
+      legacy_mh2o (legacy, position, water);
+      water_size = mh2o_size (water);
+    }
+
+    std::size_t chunks_size (0);
+    for (int i (0); i < 256; ++i)
+    {
+      noggit::mcnk_layout const layout (generate_mcnk (engine));
+      legacy_mcnk (legacy, position, layout);
+      chunks_size += noggit::mcnk_size (layout);
+    }
+
+    if (has_mfbo)
+    {
+      legacy.Extend (8 + sizeof (std::int16_t) * 9 * 2);
+      position += 8 + sizeof (std::int16_t) * 9 * 2;
+    }
+
+    // cleaning unused nulls at the end of file
+    legacy.Extend (position - legacy.data.size());
+
+    std::size_t const size
+      ( noggit::adt_size ({ names_size[0]
+                          , names_size[1]
+                          , names_size[2]
+                          , names[1].size()
+                          , names[2].size()
+                          , model_instances
+                          , object_instances
+                          , water_size
+                          , has_mfbo
+                          , chunks_size
+                          }
+                         )
+      );
+
+    BOOST_REQUIRE_EQUAL (legacy.data.size(), size);
+  }
+}
+
+BOOST_AUTO_TEST_CASE (wdt_is_byte_identical_to_the_legacy_writer)
+{
+  std::mt19937 engine (3);
+
+  MPHD mphd;
+  mphd.flags = 0x8e;
+  mphd.something = engine();
+  for (auto& unused : mphd.unused)
+  {
+    unused = 0;
+  }
+
+  std::vector<std::uint32_t> flags (64 * 64);
+  for (std::uint32_t& flag : flags)
+  {
+    flag = engine() % 3 ? 1 : 0;
+  }
+
+  ENTRY_MODF wmoEntry;
+  std::memset (&wmoEntry, 0, sizeof (wmoEntry));
+  wmoEntry.uniqueID = engine();
+  wmoEntry.pos[1] = 12.5f;
+  wmoEntry.doodadSet = 2;
+  std::string const globalWMOName ("World\\wmo\\Dungeon\\some_dungeon.wmo");
+
+  for (bool mHasAGlobalWMO : {false, true})
+  {
+    // MapIndex::save before the single pass writer
+    sExtendableArray wdtFile = sExtendableArray();
+    int curPos = 0;
+
+    wdtFile.Extend(8 + 0x4);
+    SetChunkHeader(wdtFile, curPos, 'MVER', 4);
+    *(wdtFile.GetPointer<int>(8)) = 18;
+    curPos += 8 + 0x4;
+
+    wdtFile.Extend(8);
+    SetChunkHeader(wdtFile, curPos, 'MPHD', sizeof(MPHD));
+    curPos += 8;
+    wdtFile.Insert(curPos, sizeof(MPHD), (char*)&mphd);
+    curPos += sizeof(MPHD);
+
+    wdtFile.Extend(8);
+    SetChunkHeader(wdtFile, curPos, 'MAIN', 64 * 64 * 8);
+    curPos += 8;
+
+    for (int j = 0; j < 64; ++j)
+    {
+      for (int i = 0; i < 64; ++i)
+      {
+        wdtFile.Insert(curPos, 4, (char*)&flags[j * 64 + i]);
+        wdtFile.Extend(4);
+        curPos += 8;
+      }
+    }
+
+    if (mHasAGlobalWMO)
+    {
+      wdtFile.Extend(8);
+      SetChunkHeader(wdtFile, curPos, 'MWMO', globalWMOName.size());
+      curPos += 8;
+      wdtFile.Insert(curPos, globalWMOName.size(), globalWMOName.data());
+      curPos += globalWMOName.size();
+
+      wdtFile.Extend(8);
+      SetChunkHeader(wdtFile, curPos, 'MODF', sizeof(ENTRY_MODF));
+      curPos += 8;
+      wdtFile.Insert(curPos, sizeof(ENTRY_MODF), (char*)&wmoEntry);
+      curPos += sizeof(ENTRY_MODF);
+    }
+
+    boost::optional<noggit::wdt_global_wmo> global_wmo;
+    if (mHasAGlobalWMO)
+    {
+      global_wmo = noggit::wdt_global_wmo {globalWMOName, wmoEntry};
+    }
+
+    std::vector<char> const single_pass (noggit::write_wdt (mphd, flags, global_wmo));
+
+    BOOST_REQUIRE_EQUAL_COLLECTIONS ( wdtFile.data.begin(), wdtFile.data.end()
+                                    , single_pass.begin(), single_pass.end()
+                                    );
+  }
+}
@@ -0,0 +1,218 @@
+#include <boost/test/unit_test.hpp>
+
+#include <math/frustum.hpp>
+#include <math/projection.hpp>
+#include <noggit/instance_batches.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//! only used as a key by the batches
+class Model
+{
+public:
+  std::string filename;
+  float radius;
+};
+
+namespace
+{
+  struct instance
+  {
+    Model* model;
+    math::vector_3d position;
+    math::matrix_4x4 transform;
+  };
+
+  noggit::instance_view make_view (math::vector_3d const& eye)
+  {
+    noggit::instance_view view;
+    view.model_view = math::look_at (eye, eye + math::vector_3d (1.f, -0.3f, 1.f), {0.f, 1.f, 0.f}).transposed();
+    view.projection = math::perspective (math::degrees (54.f), 16.f / 9.f, 1.f, 2048.f).transposed();
+    view.cull_distance = 1000.f;
+    view.draw_models = true;
+    return view;
+  }
+
+  // what ModelInstance::is_visible tests, without the size categories
+  bool is_visible ( instance const& i
+                  , math::frustum const& frustum
+                  , math::vector_3d const& camera
+                  , float cull_distance
+                  )
+  {
+    return (i.position - camera).length() - i.model->radius < cull_distance
+      && frustum.intersectsSphere (i.position, i.model->radius);
+  }
+
+  void gather ( noggit::instance_batches& batches
+              , std::vector<instance> const& instances
+              , noggit::instance_view const& view
+              , math::vector_3d const& camera
+              , std::size_t version
+              )
+  {
+    math::frustum const frustum (view.model_view * view.projection);
+
+    batches.begin_update (view, version);
+    for (auto const& i : instances)
+    {
+      if (is_visible (i, frustum, camera, view.cull_distance))
+      {
+        batches.add (i.model, i.transform);
+      }
+    }
+    batches.end_update (true);
+  }
+}
+
+BOOST_AUTO_TEST_CASE (batches_are_only_updated_when_needed)
+{
+  Model a, b;
+  noggit::instance_view const view (make_view ({0.f, 0.f, 0.f}));
+  noggit::instance_batches batches;
+
+  BOOST_REQUIRE (batches.need_update (view, 0));
+
+  batches.begin_update (view, 0);
+  batches.add (&a, math::matrix_4x4 (math::matrix_4x4::translation, {1.f, 0.f, 0.f}));
+  batches.add (&a, math::matrix_4x4 (math::matrix_4x4::translation, {2.f, 0.f, 0.f}));
+  batches.add (&b, math::matrix_4x4 (math::matrix_4x4::translation, {3.f, 0.f, 0.f}));
+  batches.end_update (true);
+
+  BOOST_REQUIRE (!batches.need_update (view, 0));
+  BOOST_REQUIRE (batches.need_update (view, 1));
+  BOOST_REQUIRE (batches.need_update (make_view ({0.f, 1.f, 0.f}), 0));
+
+  noggit::instance_view hidden (view);
+  hidden.draw_hidden_models = true;
+  BOOST_REQUIRE (batches.need_update (hidden, 0));
+
+  BOOST_REQUIRE_EQUAL (batches.batches().size(), 2);
+  BOOST_REQUIRE_EQUAL (batches.batches()[&a].transforms.size(), 2);
+  std::size_t const version_a (batches.batches()[&a].version);
+  std::size_t const version_b (batches.batches()[&b].version);
+  BOOST_REQUIRE (version_a && version_b && version_a != version_b);
+
+  // same transforms for a, b gone, a still loading
+  batches.invalidate();
+  BOOST_REQUIRE (batches.need_update (view, 0));
+  batches.begin_update (view, 0);
+  batches.add (&a, math::matrix_4x4 (math::matrix_4x4::translation, {1.f, 0.f, 0.f}));
+  batches.add (&a, math::matrix_4x4 (math::matrix_4x4::translation, {2.f, 0.f, 0.f}));
+  batches.end_update (false);
+
+  BOOST_REQUIRE (batches.need_update (view, 0));
+  BOOST_REQUIRE_EQUAL (batches.batches().size(), 1);
+  BOOST_REQUIRE_EQUAL (batches.batches()[&a].version, version_a);
+
+  // moved
+  batches.begin_update (view, 0);
+  batches.add (&a, math::matrix_4x4 (math::matrix_4x4::translation, {1.f, 0.f, 0.f}));
+  batches.add (&a, math::matrix_4x4 (math::matrix_4x4::translation, {2.f, 5.f, 0.f}));
+  batches.end_update (true);
+
+  BOOST_REQUIRE (!batches.need_update (view, 0));
+  BOOST_REQUIRE (batches.batches()[&a].version != version_a);
+}
+
+// run with --run_test=benchmark
+BOOST_AUTO_TEST_CASE (benchmark, *boost::unit_test::disabled())
+{
+  // the instances in view distance of a dense zone, a few hundred models
+  std::mt19937 engine (3);
+  std::uniform_real_distribution<float> position (-1500.f, 1500.f);
+  std::uniform_real_distribution<float> radius (1.f, 20.f);
+
+  std::vector<Model> models (300);
+  for (std::size_t i (0); i < models.size(); ++i)
+  {
+    models[i].filename = "world/generic/doodads/model_" + std::to_string (i) + ".m2";
+    models[i].radius = radius (engine);
+  }
+
+  std::vector<instance> instances;
+  for (int i (0); i < 20000; ++i)
+  {
+    math::vector_3d const p (position (engine), position (engine) * 0.05f, position (engine));
+    instances.push_back ({&models[engine() % models.size()], p, math::matrix_4x4 (math::matrix_4x4::translation, p)});
+  }
+
+  int const frames (200);
+  math::vector_3d const camera (-200.f, 50.f, -200.f);
+
+  auto const measure
+    ( [&] (char const* name, auto&& frame)
+      {
+        std::size_t drawn (0);
+        auto const start (std::chrono::steady_clock::now());
+        for (int i (0); i < frames; ++i)
+        {
+          drawn += frame (i);
+        }
+        std::chrono::duration<double, std::milli> const duration (std::chrono::steady_clock::now() - start);
+        std::cout << name << ": " << duration.count() / frames << " ms per frame (" << drawn / frames << " drawn)" << std::endl;
+      }
+    );
+
+  // World::draw and Model::draw before the batches: the instances grouped
+  // by filename, then culled and their transforms copied for each model
+  measure ( "per frame lists"
+          , [&] (int)
+            {
+              noggit::instance_view const view (make_view (camera));
+              math::frustum const frustum (view.model_view * view.projection);
+
+              std::unordered_map<std::string, std::vector<instance const*>> by_filename;
+              for (auto const& i : instances)
+              {
+                by_filename[i.model->filename].push_back (&i);
+              }
+
+              std::size_t drawn (0);
+              for (auto const& it : by_filename)
+              {
+                std::vector<math::matrix_4x4> transforms;
+                for (instance const* i : it.second)
+                {
+                  if (is_visible (*i, frustum, camera, view.cull_distance))
+                  {
+                    transforms.push_back (i->transform);
+                  }
+                }
+                drawn += transforms.size();
+              }
+              return drawn;
+            }
+          );
+
+  auto const cached
+    ( [&] (noggit::instance_batches& batches, math::vector_3d const& eye)
+      {
+        noggit::instance_view const view (make_view (eye));
+        if (batches.need_update (view, 0))
+        {
+          gather (batches, instances, view, eye, 0);
+        }
+
+        std::size_t drawn (0);
+        for (auto const& it : batches.batches())
+        {
+          drawn += it.second.transforms.size();
+        }
+        return drawn;
+      }
+    );
+
+  noggit::instance_batches still;
+  measure ("batches, still camera", [&] (int) { return cached (still, camera); });
+
+  noggit::instance_batches moving;
+  measure ( "batches, moving camera"
+          , [&] (int frame) { return cached (moving, camera + math::vector_3d (frame * 0.5f, 0.f, 0.f)); }
+          );
+}
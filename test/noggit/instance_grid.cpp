@@ -0,0 +1,144 @@
+#include <boost/test/unit_test.hpp>
+
+#include <noggit/instance_grid.hpp>
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <vector>
+
+namespace
+{
+  struct instance
+  {
+    math::vector_3d position;
+    math::vector_3d min;
+    math::vector_3d max;
+  };
+
+  float const world_size (64.f * 533.33333f);
+
+  instance make_instance (std::mt19937& engine, float max_radius)
+  {
+    std::uniform_real_distribution<float> position (0.f, world_size);
+    std::uniform_real_distribution<float> height (-500.f, 500.f);
+    std::uniform_real_distribution<float> radius (0.f, max_radius);
+
+    math::vector_3d const p (position (engine), height (engine), position (engine));
+    float const r (radius (engine));
+    return {p, p - math::vector_3d (r, r, r), p + math::vector_3d (r, r, r)};
+  }
+
+  bool overlaps ( math::vector_3d const& min_a, math::vector_3d const& max_a
+                , math::vector_3d const& min_b, math::vector_3d const& max_b
+                )
+  {
+    return min_a.x <= max_b.x && max_a.x >= min_b.x
+        && min_a.y <= max_b.y && max_a.y >= min_b.y
+        && min_a.z <= max_b.z && max_a.z >= min_b.z;
+  }
+
+  void require_same_instances ( noggit::instance_grid const& grid
+                              , std::map<std::uint32_t, instance> const& instances
+                              , math::vector_3d const& min
+                              , math::vector_3d const& max
+                              )
+  {
+    std::vector<std::uint32_t> expected;
+    for (auto const& it : instances)
+    {
+      if (overlaps (it.second.min, it.second.max, min, max))
+      {
+        expected.push_back (it.first);
+      }
+    }
+
+    std::vector<std::uint32_t> actual;
+    grid.query ( [&] (math::vector_3d const& lower, math::vector_3d const& upper)
+                 {
+                   return overlaps (lower, upper, min, max);
+                 }
+               , [&] (std::uint32_t uid) { actual.push_back (uid); }
+               );
+
+    std::sort (actual.begin(), actual.end());
+    BOOST_REQUIRE_EQUAL_COLLECTIONS (expected.begin(), expected.end(), actual.begin(), actual.end());
+  }
+
+  void require_same_instances ( noggit::instance_grid const& grid
+                              , std::map<std::uint32_t, instance> const& instances
+                              , std::mt19937& engine
+                              )
+  {
+    BOOST_REQUIRE_EQUAL (grid.size(), instances.size());
+
+    for (int i (0); i < 50; ++i)
+    {
+      instance const query (make_instance (engine, 1500.f));
+      require_same_instances (grid, instances, query.min, query.max);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE (query_finds_every_overlapping_instance)
+{
+  std::mt19937 engine (1);
+  noggit::instance_grid grid;
+  std::map<std::uint32_t, instance> instances;
+
+  for (std::uint32_t uid (0); uid < 5000; ++uid)
+  {
+    // a few very large ones, sticking out of their chunk and tile
+    instances[uid] = make_instance (engine, uid % 100 ? 30.f : 1000.f);
+    grid.insert (uid, instances[uid].position, instances[uid].min, instances[uid].max);
+  }
+  require_same_instances (grid, instances, engine);
+
+  // moving them around
+  for (std::uint32_t uid (0); uid < 5000; uid += 3)
+  {
+    instances[uid] = make_instance (engine, 30.f);
+    grid.insert (uid, instances[uid].position, instances[uid].min, instances[uid].max);
+  }
+  require_same_instances (grid, instances, engine);
+
+  for (std::uint32_t uid (0); uid < 5000; uid += 2)
+  {
+    instances.erase (uid);
+    grid.remove (uid);
+  }
+  // the large ones are gone, the bounds must have shrunk back
+  require_same_instances (grid, instances, engine);
+
+  // outside of the map
+  instances[9000] = {{-100.f, 0.f, -100.f}, {-110.f, -10.f, -110.f}, {-90.f, 10.f, -90.f}};
+  instances[9001] = {{world_size + 100.f, 0.f, 5.f}, {world_size + 90.f, -10.f, -5.f}, {world_size + 110.f, 10.f, 15.f}};
+  for (auto uid : {9000u, 9001u})
+  {
+    grid.insert (uid, instances[uid].position, instances[uid].min, instances[uid].max);
+  }
+  require_same_instances (grid, instances, {-200.f, -50.f, -200.f}, {0.f, 50.f, 0.f});
+  require_same_instances (grid, instances, {world_size, -50.f, 0.f}, {world_size + 200.f, 50.f, 10.f});
+
+  grid.clear();
+  instances.clear();
+  require_same_instances (grid, instances, engine);
+}
+
+BOOST_AUTO_TEST_CASE (unbounded_instances_are_always_found)
+{
+  noggit::instance_grid grid;
+  grid.insert (1, {100.f, 0.f, 100.f}, {90.f, -10.f, 90.f}, {110.f, 10.f, 110.f});
+  grid.insert (2, {100.f, 0.f, 100.f}, noggit::instance_grid::unbounded_min, noggit::instance_grid::unbounded_max);
+
+  std::vector<std::uint32_t> found;
+  grid.query ( [] (math::vector_3d const& min, math::vector_3d const& max)
+               {
+                 return overlaps (min, max, {5000.f, 0.f, 5000.f}, {5001.f, 1.f, 5001.f});
+               }
+             , [&] (std::uint32_t uid) { found.push_back (uid); }
+             );
+
+  BOOST_REQUIRE_EQUAL (found.size(), 1);
+  BOOST_REQUIRE_EQUAL (found[0], 2);
+}
@@ -0,0 +1,150 @@
+#include <boost/test/unit_test.hpp>
+
+#include <noggit/liquid_draw_list.hpp>
+
+#include <random>
+#include <vector>
+
+namespace
+{
+  using lod_indices = noggit::liquid_lod_indices;
+
+  bool has_subchunk (std::uint64_t subchunks, int x, int z, int size)
+  {
+    for (int pz (z); pz < z + size; ++pz)
+    {
+      for (int px (x); px < x + size; ++px)
+      {
+        if ((subchunks >> (pz * 8 + px)) & 1)
+        {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  // what liquid_layer::update_indices built for each layer
+  std::vector<lod_indices::index_type> layer_indices (std::uint64_t subchunks, int lod_level)
+  {
+    std::vector<lod_indices::index_type> indices;
+    int const n (1 << lod_level);
+
+    for (int z (0); z < 8; z += n)
+    {
+      for (int x (0); x < 8; x += n)
+      {
+        if (has_subchunk (subchunks, x, z, n))
+        {
+          int const p (z * 9 + x);
+          for (int i : {p, p + n * 9, p + n * 9 + n, p + n * 9 + n, p + n, p})
+          {
+            indices.emplace_back (i);
+          }
+        }
+      }
+    }
+
+    return indices;
+  }
+
+  std::vector<lod_indices::index_type> shared_indices (std::uint64_t subchunks, int lod_level)
+  {
+    static std::vector<lod_indices::index_type> const indices (lod_indices::indices());
+
+    std::vector<lod_indices::index_type> drawn;
+    for (auto const& range : lod_indices::ranges (subchunks, lod_level))
+    {
+      drawn.insert (drawn.end(), indices.begin() + range.first, indices.begin() + range.first + range.count);
+    }
+    return drawn;
+  }
+}
+
+BOOST_AUTO_TEST_CASE (lod_levels_are_after_each_other)
+{
+  BOOST_REQUIRE_EQUAL (lod_indices::indices().size(), 384 + 96 + 24 + 6);
+  BOOST_REQUIRE_EQUAL (lod_indices::first_index (0), 0);
+  BOOST_REQUIRE_EQUAL (lod_indices::first_index (1), 384);
+  BOOST_REQUIRE_EQUAL (lod_indices::first_index (3), 384 + 96 + 24);
+
+  for (lod_indices::index_type index : lod_indices::indices())
+  {
+    BOOST_REQUIRE_LT (index, lod_indices::vertices_per_layer);
+  }
+}
+
+BOOST_AUTO_TEST_CASE (ranges_draw_what_each_layer_drew)
+{
+  std::mt19937_64 random (4);
+
+  std::vector<std::uint64_t> masks = {0, std::uint64_t (-1), 1, std::uint64_t (1) << 63, 0xff00ff00ff00ff00};
+  for (int i (0); i < 200; ++i)
+  {
+    masks.emplace_back (random() & random());
+  }
+
+  for (std::uint64_t mask : masks)
+  {
+    for (int lod_level (0); lod_level < lod_indices::lod_count; ++lod_level)
+    {
+      auto const expected (layer_indices (mask, lod_level));
+      auto const drawn (shared_indices (mask, lod_level));
+      BOOST_REQUIRE_EQUAL_COLLECTIONS (drawn.begin(), drawn.end(), expected.begin(), expected.end());
+    }
+  }
+
+  // a full layer is a single range per lod level
+  for (int lod_level (0); lod_level < lod_indices::lod_count; ++lod_level)
+  {
+    auto const ranges (lod_indices::ranges (std::uint64_t (-1), lod_level));
+    BOOST_REQUIRE_EQUAL (ranges.size(), 1);
+    BOOST_REQUIRE_EQUAL (ranges[0].first, lod_indices::first_index (lod_level));
+    BOOST_REQUIRE_EQUAL (ranges[0].count, lod_indices::lod_sizes[lod_level]);
+  }
+
+  // the end of a row and the start of the next are consecutive quads
+  auto const rows (lod_indices::ranges (0x0000000000000180, 0));
+  BOOST_REQUIRE_EQUAL (rows.size(), 1);
+  BOOST_REQUIRE_EQUAL (rows[0].first, 7 * 6);
+  BOOST_REQUIRE_EQUAL (rows[0].count, 2 * 6);
+}
+
+BOOST_AUTO_TEST_CASE (layers_are_grouped_by_liquid)
+{
+  int const water (1);
+  int const magma (3);
+
+  noggit::liquid_draw_list list;
+
+  list.add (water, 0, lod_indices::ranges (std::uint64_t (-1), 0));
+  list.add (magma, 1, lod_indices::ranges (std::uint64_t (-1), 1));
+  // two ranges
+  list.add (water, 2, lod_indices::ranges (0x0000000000000005, 0));
+  list.add (magma, 3, lod_indices::ranges (0, 0));
+  list.finish();
+
+  BOOST_REQUIRE_EQUAL (list.batches().size(), 2);
+  BOOST_REQUIRE_EQUAL (list.counts().size(), 4);
+
+  auto const& water_batch (list.batches()[0]);
+  BOOST_REQUIRE_EQUAL (water_batch.liquid_id, water);
+  BOOST_REQUIRE_EQUAL (water_batch.count, 3);
+  BOOST_REQUIRE_EQUAL (list.counts()[water_batch.first], 384);
+  BOOST_REQUIRE_EQUAL (list.base_vertices()[water_batch.first], 0);
+  BOOST_REQUIRE_EQUAL (list.counts()[water_batch.first + 2], 6);
+  BOOST_REQUIRE_EQUAL ( reinterpret_cast<std::size_t> (list.index_offsets()[water_batch.first + 2])
+                      , 2 * 6 * sizeof (lod_indices::index_type)
+                      );
+  BOOST_REQUIRE_EQUAL (list.base_vertices()[water_batch.first + 2], 2 * 81);
+
+  auto const& magma_batch (list.batches()[1]);
+  BOOST_REQUIRE_EQUAL (magma_batch.liquid_id, magma);
+  BOOST_REQUIRE_EQUAL (magma_batch.count, 1);
+  BOOST_REQUIRE_EQUAL ( reinterpret_cast<std::size_t> (list.index_offsets()[magma_batch.first])
+                      , 384 * sizeof (lod_indices::index_type)
+                      );
+
+  list.clear();
+  BOOST_REQUIRE (list.empty());
+}
@@ -0,0 +1,333 @@
+#include <boost/test/unit_test.hpp>
+
+#include <math/matrix_4x4.hpp>
+#include <noggit/model_skinning.hpp>
+#include <noggit/worker_pool.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace
+{
+  struct bone
+  {
+    int parent;
+    math::vector_3d pivot;
+    math::matrix_4x4 mat = math::matrix_4x4::unit;
+    math::matrix_4x4 mrot = math::matrix_4x4::unit;
+  };
+
+  //! a chain of limbs like the skeletons of creatures, bone i moving with
+  //! its parent
+  std::vector<bone> make_skeleton (std::mt19937& engine, std::size_t count)
+  {
+    std::uniform_real_distribution<float> offset (-1.f, 1.f);
+    std::vector<bone> bones;
+    for (std::size_t i (0); i < count; ++i)
+    {
+      bones.push_back ({ i ? static_cast<int> (engine() % i) : -1
+                       , math::vector_3d (offset (engine), offset (engine), offset (engine))
+                       }
+                      );
+    }
+    return bones;
+  }
+
+  //! what Bone::calcMatrix does for a rotated and translated bone
+  void animate (std::vector<bone>& bones, int time)
+  {
+    for (std::size_t i (0); i < bones.size(); ++i)
+    {
+      float const angle ((time % 1000) * 0.00628f + i);
+      math::quaternion const q (0.f, std::sin (angle * 0.5f), 0.f, std::cos (angle * 0.5f));
+
+      math::matrix_4x4 m (math::matrix_4x4::translation, bones[i].pivot);
+      m *= math::matrix_4x4 (math::matrix_4x4::translation, math::vector_3d (0.f, 0.1f * std::sin (angle), 0.f));
+      m *= math::matrix_4x4 (math::matrix_4x4::rotation, q);
+      m *= math::matrix_4x4 (math::matrix_4x4::translation, -bones[i].pivot);
+
+      math::matrix_4x4 const rotation (math::matrix_4x4::rotation, q);
+
+      if (bones[i].parent >= 0)
+      {
+        bones[i].mat = bones[bones[i].parent].mat * m;
+        bones[i].mrot = bones[bones[i].parent].mrot * rotation;
+      }
+      else
+      {
+        bones[i].mat = m;
+        bones[i].mrot = rotation;
+      }
+    }
+  }
+
+  std::vector<ModelVertex> make_vertices (std::mt19937& engine, std::size_t count, std::size_t bone_count, int max_influences)
+  {
+    std::uniform_real_distribution<float> position (-5.f, 5.f);
+    std::vector<ModelVertex> vertices (count);
+
+    for (auto& vertex : vertices)
+    {
+      vertex.position = {position (engine), position (engine), position (engine)};
+      vertex.normal = math::vector_3d (position (engine), position (engine), position (engine)).normalized();
+
+      int const influences (1 + engine() % max_influences);
+      int remaining (255);
+      for (int b (0); b < 4; ++b)
+      {
+        vertex.bones[b] = engine() % bone_count;
+        vertex.weights[b] = b >= influences ? 0 : b == influences - 1 ? remaining : engine() % (remaining + 1);
+        remaining -= vertex.weights[b];
+      }
+    }
+
+    return vertices;
+  }
+
+  noggit::bone_pose make_pose (std::vector<bone> const& bones)
+  {
+    noggit::bone_pose pose (bones.size());
+    for (std::size_t i (0); i < bones.size(); ++i)
+    {
+      pose.set (i, bones[i].mat, bones[i].mrot);
+    }
+    return pose;
+  }
+
+  // Model::animate before the skinning was prepared
+  void reference_skinning ( std::vector<ModelVertex> const& vertices
+                          , std::vector<bone> const& bones
+                          , std::vector<ModelVertex>& output
+                          )
+  {
+    output = vertices;
+
+    for (auto& vertex : output)
+    {
+      math::vector_3d v (0, 0, 0), n (0, 0, 0);
+
+      for (std::size_t b (0); b < 4; ++b)
+      {
+        if (vertex.weights[b] <= 0)
+          continue;
+
+        math::vector_3d tv = bones[vertex.bones[b]].mat * vertex.position;
+        math::vector_3d tn = bones[vertex.bones[b]].mrot * vertex.normal;
+
+        v += tv * (static_cast<float> (vertex.weights[b]) / 255.0f);
+        n += tn * (static_cast<float> (vertex.weights[b]) / 255.0f);
+      }
+
+      vertex.position = v;
+      vertex.normal = n.normalized();
+    }
+  }
+
+  void require_close (math::vector_3d const& a, math::vector_3d const& b)
+  {
+    BOOST_REQUIRE_SMALL ((a - b).length(), 1e-3f);
+  }
+}
+
+BOOST_AUTO_TEST_CASE (skinning_matches_the_per_bone_transforms)
+{
+  std::mt19937 engine (1);
+  std::vector<bone> bones (make_skeleton (engine, 60));
+  std::vector<ModelVertex> const vertices (make_vertices (engine, 2000, bones.size(), 4));
+  noggit::model_skinning const skinning (vertices);
+
+  for (int time : {0, 130, 777})
+  {
+    animate (bones, time);
+
+    std::vector<ModelVertex> expected;
+    reference_skinning (vertices, bones, expected);
+
+    std::vector<ModelVertex> actual (vertices);
+    noggit::bone_pose const pose (make_pose (bones));
+    skinning.apply (pose, actual.data(), 0, 1000);
+    skinning.apply (pose, actual.data(), 1000, actual.size());
+
+    for (std::size_t i (0); i < vertices.size(); ++i)
+    {
+      require_close (expected[i].position, actual[i].position);
+      require_close (expected[i].normal, actual[i].normal);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE (pose_keeps_the_matrices)
+{
+  std::mt19937 engine (2);
+  std::vector<bone> bones (make_skeleton (engine, 10));
+  animate (bones, 333);
+  noggit::bone_pose const pose (make_pose (bones));
+
+  for (std::size_t i (0); i < bones.size(); ++i)
+  {
+    math::matrix_4x4 const matrix (pose.matrix (i));
+    math::matrix_4x4 const rotation (pose.rotation (i));
+    BOOST_REQUIRE (std::equal (&matrix._data[0], &matrix._data[16], &bones[i].mat._data[0]));
+    BOOST_REQUIRE (std::equal (&rotation._data[0], &rotation._data[16], &bones[i].mrot._data[0]));
+  }
+}
+
+BOOST_AUTO_TEST_CASE (pose_cache_quantizes_the_time)
+{
+  BOOST_REQUIRE_EQUAL (noggit::bone_pose_cache::quantize (0), 0);
+  BOOST_REQUIRE_EQUAL (noggit::bone_pose_cache::quantize (noggit::bone_pose_cache::time_quantum - 1), 0);
+  BOOST_REQUIRE_EQUAL ( noggit::bone_pose_cache::quantize (noggit::bone_pose_cache::time_quantum * 3 + 1)
+                      , noggit::bone_pose_cache::time_quantum * 3
+                      );
+}
+
+BOOST_AUTO_TEST_CASE (pose_caches_share_their_budget)
+{
+  noggit::bone_pose const pose (10);
+  auto const budget (std::make_shared<noggit::bone_pose_budget> (pose.byte_size() * 3));
+  noggit::bone_pose_cache first (budget);
+  noggit::bone_pose_cache second (budget);
+
+  BOOST_REQUIRE (first.fits (pose.byte_size()));
+  BOOST_REQUIRE (!first.fits (pose.byte_size() * 4));
+  BOOST_REQUIRE (!first.insert (0, 0, noggit::bone_pose (40)));
+
+  BOOST_REQUIRE (!first.find (0, 0));
+  BOOST_REQUIRE (first.insert (0, 0, pose));
+  BOOST_REQUIRE (first.insert (0, 20, pose));
+  BOOST_REQUIRE (second.insert (0, 0, pose));
+  BOOST_REQUIRE_EQUAL (budget->byte_size(), pose.byte_size() * 3);
+
+  // inserting the same pose again doesn't use more of the budget
+  BOOST_REQUIRE (second.insert (0, 0, pose));
+  BOOST_REQUIRE_EQUAL (budget->byte_size(), pose.byte_size() * 3);
+
+  // the least recently used pose of any cache is evicted
+  BOOST_REQUIRE (first.find (0, 0));
+  BOOST_REQUIRE (second.insert (1, 0, pose));
+  BOOST_REQUIRE (first.find (0, 0));
+  BOOST_REQUIRE (!first.find (0, 20));
+  BOOST_REQUIRE (second.find (0, 0));
+  BOOST_REQUIRE (second.find (1, 0));
+  BOOST_REQUIRE_EQUAL (budget->byte_size(), pose.byte_size() * 3);
+
+  first.clear();
+  BOOST_REQUIRE (!first.find (0, 0));
+  BOOST_REQUIRE_EQUAL (budget->byte_size(), pose.byte_size() * 2);
+
+  {
+    noggit::bone_pose_cache third (budget);
+    BOOST_REQUIRE (third.insert (0, 0, pose));
+    BOOST_REQUIRE_EQUAL (budget->byte_size(), pose.byte_size() * 3);
+  }
+
+  // a destroyed cache gives its bytes back
+  BOOST_REQUIRE_EQUAL (budget->byte_size(), pose.byte_size() * 2);
+  BOOST_REQUIRE (second.find (0, 0));
+  BOOST_REQUIRE (second.find (1, 0));
+}
+
+BOOST_AUTO_TEST_CASE (pose_cache_keeps_its_budget_alive)
+{
+  auto budget (std::make_shared<noggit::bone_pose_budget> (1 << 20));
+  noggit::bone_pose_cache cache (budget);
+  BOOST_REQUIRE (cache.insert (0, 0, noggit::bone_pose (10)));
+
+  // like the caches of the models destroyed after the shared budget
+  budget.reset();
+  BOOST_REQUIRE (cache.find (0, 0));
+}
+
+// run with --run_test=benchmark
+BOOST_AUTO_TEST_CASE (benchmark, *boost::unit_test::disabled())
+{
+  struct model
+  {
+    char const* name;
+    std::size_t vertices;
+    std::size_t bones;
+    int influences;
+  };
+
+  std::vector<model> const models
+    { {"doodad (plant)", 300, 8, 1}
+    , {"creature", 3000, 70, 4}
+    , {"large creature", 20000, 120, 4}
+    };
+
+  noggit::worker_pool workers;
+  std::mt19937 engine (5);
+  int const frames (500);
+
+  for (auto const& m : models)
+  {
+    std::vector<bone> bones (make_skeleton (engine, m.bones));
+    std::vector<ModelVertex> const vertices (make_vertices (engine, m.vertices, m.bones, m.influences));
+    noggit::model_skinning const skinning (vertices);
+    std::vector<ModelVertex> output (vertices);
+
+    auto const measure
+      ( [&] (char const* name, auto&& frame)
+        {
+          auto const start (std::chrono::steady_clock::now());
+          for (int i (0); i < frames; ++i)
+          {
+            frame (i * 16);
+          }
+          std::chrono::duration<double, std::milli> const duration (std::chrono::steady_clock::now() - start);
+          std::cout << m.name << ", " << name << ": " << duration.count() / frames << " ms per frame" << std::endl;
+        }
+      );
+
+    measure ( "bones and per bone transforms"
+            , [&] (int time)
+              {
+                animate (bones, time);
+                reference_skinning (vertices, bones, output);
+              }
+            );
+
+    measure ( "bones and blended skinning"
+            , [&] (int time)
+              {
+                animate (bones, time);
+                skinning.apply (make_pose (bones), output.data(), 0, output.size());
+              }
+            );
+
+    // a 2 second loop, cached after its first iteration when it fits
+    noggit::bone_pose_cache cache;
+    noggit::bone_pose uncached;
+    noggit::bone_pose const* pose (nullptr);
+    measure ( "cached bones and threaded skinning"
+            , [&] (int time)
+              {
+                time = noggit::bone_pose_cache::quantize (time % 2000);
+                if (!(pose = cache.find (0, time)))
+                {
+                  animate (bones, time);
+                  uncached = make_pose (bones);
+                  if (!(pose = cache.insert (0, time, uncached)))
+                  {
+                    pose = &uncached;
+                  }
+                }
+
+                std::size_t const block_size (4096);
+                workers.for_each ( (output.size() + block_size - 1) / block_size
+                                 , [&] (std::size_t block)
+                                   {
+                                     skinning.apply ( *pose, output.data(), block * block_size
+                                                    , std::min (output.size(), (block + 1) * block_size)
+                                                    );
+                                   }
+                                 );
+              }
+            );
+  }
+}
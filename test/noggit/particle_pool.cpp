@@ -0,0 +1,229 @@
+#include <boost/test/unit_test.hpp>
+
+#include <math/interpolation.hpp>
+#include <noggit/particle_pool.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <list>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+  noggit::particle_ramp const ramp
+    { 0.3f
+    , {0.5f, 2.f, 0.25f}
+    , { math::vector_4d (1.f, 0.8f, 0.2f, 0.f)
+      , math::vector_4d (1.f, 0.4f, 0.1f, 1.f)
+      , math::vector_4d (0.2f, 0.2f, 0.2f, 0.f)
+      }
+    };
+
+  // ParticleSystem::update before the pools
+  template<class T>
+  T lifeRamp(float life, float mid, const T &a, const T &b, const T &c)
+  {
+    if (life <= mid) return math::interpolation::linear(life / mid, a, b);
+    else return math::interpolation::linear((life - mid) / (1.0f - mid), b, c);
+  }
+
+  void reference_update ( std::list<Particle>& particles
+                        , float dt
+                        , float grav
+                        , float deaccel
+                        , float slowdown
+                        )
+  {
+    float mspeed = 1.0f;
+
+    for (std::list<Particle>::iterator it = particles.begin(); it != particles.end();) {
+      Particle &p = *it;
+      p.speed += p.down * grav * dt - p.dir * deaccel * dt;
+
+      if (slowdown>0) {
+        mspeed = expf(-1.0f * slowdown * p.life);
+      }
+      p.pos += p.speed * mspeed * dt;
+
+      p.life += dt;
+      float rlife = p.life / p.maxlife;
+      p.size = lifeRamp<float>(rlife, ramp.mid, ramp.sizes[0], ramp.sizes[1], ramp.sizes[2]);
+      p.color = lifeRamp<math::vector_4d>(rlife, ramp.mid, ramp.colors[0], ramp.colors[1], ramp.colors[2]);
+
+      if (rlife >= 1.0f)
+      {
+        it = particles.erase (it);
+      }
+      else
+      {
+        ++it;
+      }
+    }
+  }
+
+  //! a fire: particles going up and slowing down, the tile is used as id
+  Particle spawn (std::mt19937& engine, unsigned int id)
+  {
+    std::uniform_real_distribution<float> spread (-1.f, 1.f);
+    std::uniform_real_distribution<float> life (0.5f, 2.f);
+
+    Particle p;
+    p.pos = {spread (engine), 0.f, spread (engine)};
+    p.origin = p.pos;
+    p.dir = math::vector_3d (spread (engine) * 0.2f, 1.f, spread (engine) * 0.2f).normalize();
+    p.speed = p.dir * 3.f;
+    p.down = {0.f, -1.f, 0.f};
+    for (auto& corner : p.corners)
+    {
+      corner = {spread (engine), 0.f, spread (engine)};
+    }
+    p.size = 0.f;
+    p.life = 0.f;
+    p.maxlife = life (engine);
+    p.tile = id;
+    p.color = ramp.colors[0];
+    return p;
+  }
+
+  void require_close (float a, float b)
+  {
+    BOOST_REQUIRE_SMALL (a - b, 1e-4f);
+  }
+}
+
+BOOST_AUTO_TEST_CASE (pool_simulates_like_the_list)
+{
+  for (float slowdown : {0.f, 0.8f})
+  {
+    std::mt19937 engine (7);
+    std::list<Particle> expected;
+    noggit::particle_pool pool (1000);
+    unsigned int id (0);
+
+    for (int frame (0); frame < 200; ++frame)
+    {
+      for (int i (0); i < 5; ++i)
+      {
+        Particle const p (spawn (engine, id++));
+        expected.push_back (p);
+        BOOST_REQUIRE (pool.add (p));
+      }
+
+      float const dt (frame % 7 ? 1.f / 60.f : 0.1f);
+      reference_update (expected, dt, 0.5f, 0.3f, slowdown);
+      pool.update (dt, 0.5f, 0.3f, slowdown, ramp);
+
+      // the dead particles are replaced by the last one, the order differs
+      BOOST_REQUIRE_EQUAL (pool.size(), expected.size());
+      std::unordered_map<unsigned int, std::size_t> index;
+      for (std::size_t i (0); i < pool.size(); ++i)
+      {
+        index[pool.tile (i)] = i;
+      }
+
+      for (Particle const& p : expected)
+      {
+        BOOST_REQUIRE (index.count (p.tile));
+        std::size_t const i (index[p.tile]);
+
+        for (std::size_t c (0); c < 3; ++c)
+        {
+          require_close (pool.position (i)[c], p.pos[c]);
+          require_close (pool.origin (i)[c], p.origin[c]);
+          require_close (pool.corner (i, 2)[c], p.corners[2][c]);
+        }
+        for (std::size_t c (0); c < 4; ++c)
+        {
+          require_close (pool.color (i)[c], p.color[c]);
+        }
+        require_close (pool.particle_size (i), p.size);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE (pool_stops_at_its_capacity)
+{
+  std::mt19937 engine (8);
+  noggit::particle_pool pool (100);
+
+  for (unsigned int i (0); i < 100; ++i)
+  {
+    BOOST_REQUIRE (pool.add (spawn (engine, i)));
+  }
+  BOOST_REQUIRE (!pool.add (spawn (engine, 100)));
+  BOOST_REQUIRE_EQUAL (pool.size(), 100);
+
+  pool.update (10.f, 0.f, 0.f, 0.f, ramp);
+  BOOST_REQUIRE (pool.empty());
+  BOOST_REQUIRE (pool.add (spawn (engine, 101)));
+}
+
+// run with --run_test=benchmark
+BOOST_AUTO_TEST_CASE (benchmark, *boost::unit_test::disabled())
+{
+  // a zone with many fire and smoke emitters, a few hundred particles each
+  std::size_t const emitters (300);
+  int const frames (600);
+  float const dt (1.f / 60.f);
+  int const spawned_per_frame (4);
+
+  auto const measure
+    ( [&] (char const* name, auto&& frame)
+      {
+        std::size_t alive (0);
+        auto const start (std::chrono::steady_clock::now());
+        for (int i (0); i < frames; ++i)
+        {
+          alive = frame();
+        }
+        std::chrono::duration<double, std::milli> const duration (std::chrono::steady_clock::now() - start);
+        std::cout << name << ": " << duration.count() / frames << " ms per frame (" << alive << " particles)" << std::endl;
+      }
+    );
+
+  {
+    std::mt19937 engine (9);
+    std::vector<std::list<Particle>> lists (emitters);
+    measure ( "std::list"
+            , [&]
+              {
+                std::size_t alive (0);
+                for (auto& particles : lists)
+                {
+                  for (int i (0); i < spawned_per_frame; ++i)
+                  {
+                    particles.push_back (spawn (engine, 0));
+                  }
+                  reference_update (particles, dt, 0.5f, 0.3f, 0.8f);
+                  alive += particles.size();
+                }
+                return alive;
+              }
+            );
+  }
+
+  {
+    std::mt19937 engine (9);
+    std::vector<noggit::particle_pool> pools (emitters, noggit::particle_pool (10000));
+    measure ( "pools"
+            , [&]
+              {
+                std::size_t alive (0);
+                for (auto& particles : pools)
+                {
+                  for (int i (0); i < spawned_per_frame; ++i)
+                  {
+                    particles.add (spawn (engine, 0));
+                  }
+                  particles.update (dt, 0.5f, 0.3f, 0.8f, ramp);
+                  alive += particles.size();
+                }
+                return alive;
+              }
+            );
+  }
+}
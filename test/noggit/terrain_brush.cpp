@@ -0,0 +1,389 @@
+#include <boost/test/unit_test.hpp>
+
+#include <math/interpolation.hpp>
+#include <noggit/MapHeaders.h>
+#include <noggit/terrain_brush.hpp>
+
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+  std::size_t const chunk_vertices (9 * 9 + 8 * 8);
+
+  // The per chunk implementations the kernels replaced, minus the
+  // chunk bookkeeping.
+  namespace legacy
+  {
+    float dist (float x1, float z1, float x2, float z2)
+    {
+      float const xdiff (x2 - x1);
+      float const zdiff (z2 - z1);
+      return std::sqrt (xdiff * xdiff + zdiff * zdiff);
+    }
+
+    bool change (std::vector<math::vector_3d>& vertices, math::vector_3d const& pos, float change, float radius, int BrushType, float inner_radius)
+    {
+      float dist, xdiff, zdiff;
+      bool changed = false;
+
+      for (auto& vertex : vertices)
+      {
+        xdiff = vertex.x - pos.x;
+        zdiff = vertex.z - pos.z;
+        if (BrushType == eTerrainType_Quadra)
+        {
+          if ((std::abs(xdiff) < std::abs(radius / 2)) && (std::abs(zdiff) < std::abs(radius / 2)))
+          {
+            dist = std::sqrt(xdiff*xdiff + zdiff*zdiff);
+            vertex.y += change * (1.0f - dist * inner_radius / radius);
+            changed = true;
+          }
+        }
+        else
+        {
+          dist = std::sqrt(xdiff*xdiff + zdiff*zdiff);
+          if (dist < radius)
+          {
+            changed = true;
+
+            switch (BrushType)
+            {
+              case eTerrainType_Flat:
+                vertex.y += change;
+                break;
+              case eTerrainType_Linear:
+                vertex.y += change * (1.0f - dist * (1.0f - inner_radius) / radius);
+                break;
+              case eTerrainType_Smooth:
+                vertex.y += change / (1.0f + dist / radius);
+                break;
+              case eTerrainType_Polynom:
+                vertex.y += change*((dist / radius)*(dist / radius) + dist / radius + 1.0f);
+                break;
+              case eTerrainType_Trigo:
+                vertex.y += change*cos(dist / radius);
+                break;
+              case eTerrainType_Gaussian:
+                vertex.y += dist < radius * inner_radius ? change * std::exp(-(std::pow(radius * inner_radius / radius, 2) / (2 * std::pow(0.39f, 2)))) : change * std::exp(-(std::pow(dist / radius, 2) / (2 * std::pow(0.39f, 2))));
+                break;
+            }
+          }
+        }
+      }
+      return changed;
+    }
+
+    bool flatten ( std::vector<math::vector_3d>& vertices
+                 , math::vector_3d const& pos
+                 , float remain
+                 , float radius
+                 , int BrushType
+                 , flatten_mode const& mode
+                 , math::vector_3d const& origin
+                 , math::degrees angle
+                 , math::degrees orientation
+                 )
+    {
+      bool changed (false);
+
+      for (auto& vertex : vertices)
+      {
+        float const dist (legacy::dist (vertex.x, vertex.z, pos.x, pos.z));
+
+        if (dist >= radius)
+        {
+          continue;
+        }
+
+        float const ah(origin.y
+          + ((vertex.x - origin.x) * math::cos(orientation)
+            + (vertex.z - origin.z) * math::sin(orientation)
+            ) * math::tan(angle)
+        );
+
+        if ((!mode.lower && ah < vertex.y)
+          || (!mode.raise && ah > vertex.y)
+          )
+        {
+          continue;
+        }
+
+        if (BrushType == eFlattenType_Origin)
+        {
+          vertex.y = origin.y;
+          changed = true;
+          continue;
+        }
+
+        vertex.y = math::interpolation::linear
+          ( BrushType == eFlattenType_Flat ? remain
+          : BrushType == eFlattenType_Linear ? remain * (1.f - dist / radius)
+          : BrushType == eFlattenType_Smooth ? pow (remain, 1.f + dist / radius)
+          : throw std::logic_error ("bad brush type")
+          , vertex.y
+          , ah
+          );
+
+        changed = true;
+      }
+
+      return changed;
+    }
+
+    bool blur ( std::vector<math::vector_3d>& vertices
+              , math::vector_3d const& pos
+              , float remain
+              , float radius
+              , int BrushType
+              , flatten_mode const& mode
+              , std::function<boost::optional<float> (float, float)> height
+              )
+    {
+      bool changed (false);
+
+      if (BrushType == eFlattenType_Origin)
+      {
+        return false;
+      }
+
+      for (auto& vertex : vertices)
+      {
+        float const dist (legacy::dist (vertex.x, vertex.z, pos.x, pos.z));
+
+        if (dist >= radius)
+        {
+          continue;
+        }
+
+        int Rad = (int)(radius / UNITSIZE);
+        float TotalHeight = 0;
+        float TotalWeight = 0;
+        for (int j = -Rad * 2; j <= Rad * 2; ++j)
+        {
+          float tz = pos.z + j * UNITSIZE / 2;
+          for (int k = -Rad; k <= Rad; ++k)
+          {
+            float tx = pos.x + k*UNITSIZE + (j % 2) * UNITSIZE / 2.0f;
+            float dist2 = legacy::dist (tx, tz, vertex.x, vertex.z);
+            if (dist2 > radius)
+              continue;
+            auto h (height (tx, tz));
+            if (h)
+            {
+              TotalHeight += (1.0f - dist2 / radius) * h.get();
+              TotalWeight += (1.0f - dist2 / radius);
+            }
+          }
+        }
+
+        float target = TotalHeight / TotalWeight;
+        float& y = vertex.y;
+
+        if ((target > y && !mode.raise) || (target < y && !mode.lower))
+        {
+          continue;
+        }
+
+        y = math::interpolation::linear
+          ( BrushType == eFlattenType_Flat ? remain
+          : BrushType == eFlattenType_Linear ? remain * (1.f - dist / radius)
+          : BrushType == eFlattenType_Smooth ? pow (remain, 1.f + dist / radius)
+          : throw std::logic_error ("bad brush type")
+          , y
+          , target
+          );
+
+        changed = true;
+      }
+
+      return changed;
+    }
+  }
+
+  //! vertices of size x size chunks laid out like MCVT, random heights
+  std::vector<math::vector_3d> generate (int size, unsigned seed)
+  {
+    std::mt19937 engine (seed);
+    std::uniform_real_distribution<float> height (-20.f, 20.f);
+
+    std::vector<math::vector_3d> result;
+    for (int cz (0); cz < size; ++cz)
+    {
+      for (int cx (0); cx < size; ++cx)
+      {
+        for (int row (0); row < 17; ++row)
+        {
+          float const offset (row % 2 ? UNITSIZE / 2 : 0.f);
+          for (int column (0); column < (row % 2 ? 8 : 9); ++column)
+          {
+            result.emplace_back ( cx * CHUNKSIZE + column * UNITSIZE + offset
+                                , height (engine)
+                                , cz * CHUNKSIZE + row / 2 * UNITSIZE + offset
+                                );
+          }
+        }
+      }
+    }
+    return result;
+  }
+
+  noggit::terrain_brush::vertices gather (std::vector<math::vector_3d> const& vertices)
+  {
+    noggit::terrain_brush::vertices result;
+    for (std::size_t i (0); i < vertices.size(); i += chunk_vertices)
+    {
+      result.append (vertices.data() + i, chunk_vertices);
+    }
+    return result;
+  }
+
+  float height_at (float x, float z)
+  {
+    return 10.f * std::sin (x * 0.05f) + 5.f * std::cos (z * 0.03f);
+  }
+
+  boost::optional<float> height (float x, float z)
+  {
+    if (x < 0.f || z < 0.f)
+    {
+      return boost::none;
+    }
+    return height_at (x, z);
+  }
+
+  void require_same_heights ( std::vector<math::vector_3d> const& expected
+                            , std::vector<math::vector_3d> const& original
+                            , noggit::terrain_brush::vertices const& actual
+                            )
+  {
+    BOOST_REQUIRE_EQUAL (expected.size(), actual.size());
+    for (std::size_t i (0); i < expected.size(); ++i)
+    {
+      BOOST_REQUIRE_SMALL (expected[i].y - actual.y[i], 1e-3f);
+      BOOST_REQUIRE_EQUAL (bool (actual.changed[i]), expected[i].y != original[i].y);
+    }
+  }
+
+  math::vector_3d const center (2 * CHUNKSIZE + 3.f, 0.f, 2 * CHUNKSIZE - 7.f);
+}
+
+BOOST_AUTO_TEST_CASE (change_matches_legacy)
+{
+  std::vector<math::vector_3d> const original (generate (4, 1));
+
+  for ( int type : { eTerrainType_Flat, eTerrainType_Linear, eTerrainType_Smooth, eTerrainType_Polynom
+                   , eTerrainType_Trigo, eTerrainType_Quadra, eTerrainType_Gaussian
+                   }
+      )
+  {
+    for (float radius : {5.f, 40.f, 100.f})
+    {
+      auto expected (original);
+      auto actual (gather (original));
+
+      bool const expected_changed (legacy::change (expected, center, 2.5f, radius, type, 0.4f));
+      BOOST_REQUIRE_EQUAL
+        (noggit::terrain_brush::change (actual, center, 2.5f, radius, type, 0.4f), expected_changed);
+      require_same_heights (expected, original, actual);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE (flatten_matches_legacy)
+{
+  std::vector<math::vector_3d> const original (generate (4, 2));
+  math::vector_3d const origin (center.x - 10.f, 3.f, center.z + 5.f);
+
+  for (int type : {eFlattenType_Flat, eFlattenType_Linear, eFlattenType_Smooth, eFlattenType_Origin})
+  {
+    for (flatten_mode const mode : {flatten_mode (true, true), flatten_mode (true, false), flatten_mode (false, true)})
+    {
+      for (float angle : {0.f, 25.f})
+      {
+        auto expected (original);
+        auto actual (gather (original));
+
+        bool const expected_changed
+          ( legacy::flatten
+              (expected, center, 0.3f, 50.f, type, mode, origin, math::degrees (angle), math::degrees (60.f))
+          );
+        BOOST_REQUIRE_EQUAL
+          ( noggit::terrain_brush::flatten
+              (actual, center, 0.3f, 50.f, type, mode, origin, math::degrees (angle), math::degrees (60.f))
+          , expected_changed
+          );
+        require_same_heights (expected, original, actual);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE (blur_matches_legacy)
+{
+  std::vector<math::vector_3d> const original (generate (4, 3));
+
+  for (int type : {eFlattenType_Flat, eFlattenType_Linear, eFlattenType_Smooth, eFlattenType_Origin})
+  {
+    for (flatten_mode const mode : {flatten_mode (true, true), flatten_mode (true, false), flatten_mode (false, true)})
+    {
+      for (float radius : {6.f, 30.f})
+      {
+        auto expected (original);
+        auto actual (gather (original));
+
+        bool const expected_changed (legacy::blur (expected, center, 0.5f, radius, type, mode, &height));
+        BOOST_REQUIRE_EQUAL
+          (noggit::terrain_brush::blur (actual, center, 0.5f, radius, type, mode, &height), expected_changed);
+        require_same_heights (expected, original, actual);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE (blur_by_blocks_matches_serial)
+{
+  std::vector<math::vector_3d> const original (generate (4, 6));
+  auto serial (gather (original));
+  auto blocks (gather (original));
+
+  noggit::terrain_brush::blur (serial, center, 0.5f, 30.f, eFlattenType_Linear, flatten_mode (true, true), &height);
+
+  // in reverse order, like workers finishing in any order would
+  std::size_t block_count (0);
+  noggit::terrain_brush::blur
+    ( blocks, center, 0.5f, 30.f, eFlattenType_Linear, flatten_mode (true, true), &height
+    , [&] (std::size_t count, std::function<void (std::size_t)> const& fun)
+      {
+        block_count = count;
+        for (std::size_t i (count); i-- > 0;)
+        {
+          fun (i);
+        }
+      }
+    );
+
+  BOOST_REQUIRE_EQUAL (block_count, original.size() / chunk_vertices);
+  BOOST_REQUIRE (serial.y == blocks.y);
+  BOOST_REQUIRE (serial.changed == blocks.changed);
+}
+
+BOOST_AUTO_TEST_CASE (blur_skips_vertices_without_samples)
+{
+  // only the vertex at the origin is in range, all samples are outside
+  // of the map
+  std::vector<math::vector_3d> const original (generate (1, 4));
+  auto actual (gather (original));
+
+  BOOST_REQUIRE ( !noggit::terrain_brush::blur
+                    ( actual, math::vector_3d (-1.f, 0.f, -1.f), 0.5f, 2.f, eFlattenType_Flat, flatten_mode (true, true)
+                    , [] (float x, float z) { return x < 0.f || z < 0.f ? boost::none : boost::make_optional (0.f); }
+                    )
+                );
+  for (std::size_t i (0); i < original.size(); ++i)
+  {
+    BOOST_REQUIRE_EQUAL (actual.y[i], original[i].y);
+  }
+}
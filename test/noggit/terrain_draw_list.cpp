@@ -0,0 +1,351 @@
+#include <boost/test/unit_test.hpp>
+
+#include <noggit/terrain_draw_list.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+  using layout = noggit::terrain_tile_layout;
+
+  noggit::terrain_draw_list::texture_key const grass = {1, 2, -1, -1};
+  noggit::terrain_draw_list::texture_key const rock = {3, -1, -1, -1};
+
+  std::string read_shader (std::string const& name)
+  {
+    std::ifstream file (std::string (NOGGIT_GLSL_DIRECTORY) + "/" + name);
+    BOOST_REQUIRE_MESSAGE (file, "can't open " << name);
+    return {std::istreambuf_iterator<char> (file), std::istreambuf_iterator<char>()};
+  }
+
+  struct glsl_member
+  {
+    std::string name;
+    std::size_t offset;
+    std::size_t count;
+  };
+
+  //! the std140 offsets of the members of a struct of vec4 and ivec4, or
+  //! arrays of them, which are all 16 bytes aligned
+  std::vector<glsl_member> std140_members (std::string const& source, std::string const& struct_name)
+  {
+    std::size_t const begin (source.find ("struct " + struct_name));
+    BOOST_REQUIRE (begin != std::string::npos);
+    std::size_t const open (source.find ('{', begin));
+    std::size_t const close (source.find ('}', open));
+
+    std::vector<glsl_member> members;
+    std::size_t offset (0);
+    std::istringstream body (source.substr (open + 1, close - open - 1));
+    std::string line;
+
+    while (std::getline (body, line))
+    {
+      std::istringstream words (line.substr (0, line.find ("//")));
+      std::string type;
+      std::string name;
+      if (!(words >> type >> name))
+      {
+        continue;
+      }
+
+      BOOST_REQUIRE_MESSAGE (type == "vec4" || type == "ivec4", "unexpected " << type << " in the chunk parameters");
+
+      name = name.substr (0, name.find (';'));
+      std::size_t count (1);
+      std::size_t const bracket (name.find ('['));
+      if (bracket != std::string::npos)
+      {
+        count = std::stoul (name.substr (bracket + 1));
+        name = name.substr (0, bracket);
+      }
+
+      members.push_back ({name, offset, count});
+      offset += 16 * count;
+    }
+
+    return members;
+  }
+}
+
+BOOST_AUTO_TEST_CASE (chunk_index_ranges_do_not_overlap)
+{
+  BOOST_REQUIRE_EQUAL (layout::indices_per_chunk, 768 + 384 + 96 + 24 + 6);
+  BOOST_REQUIRE_EQUAL (layout::first_index (0, boost::none), 0);
+  BOOST_REQUIRE_EQUAL (layout::first_index (0, 0), 768);
+  BOOST_REQUIRE_EQUAL (layout::first_index (0, 3), 768 + 384 + 96 + 24);
+  BOOST_REQUIRE_EQUAL (layout::first_index (1, boost::none), layout::indices_per_chunk);
+  BOOST_REQUIRE_EQUAL ( layout::first_index (layout::chunk_count - 1, 3) + layout::lod_strip_sizes[3]
+                      , layout::chunk_count * layout::indices_per_chunk
+                      );
+}
+
+BOOST_AUTO_TEST_CASE (chunks_are_grouped_by_textures)
+{
+  noggit::terrain_draw_list list;
+
+  list.add (grass, 0, layout::first_index (0, boost::none), 768);
+  list.add (rock, 1, layout::first_index (1, 0), 384);
+  list.add (grass, 2, layout::first_index (2, 1), 90);
+  // fully covered by holes
+  list.add (rock, 3, layout::first_index (3, boost::none), 0);
+  list.add (rock, 5, layout::first_index (5, 3), 6);
+  list.finish();
+
+  BOOST_REQUIRE_EQUAL (list.batches().size(), 2);
+  BOOST_REQUIRE_EQUAL (list.counts().size(), 4);
+
+  for (auto const& batch : list.batches())
+  {
+    BOOST_REQUIRE_EQUAL (batch.count, 2);
+    for (std::size_t i (batch.first); i < batch.first + batch.count; ++i)
+    {
+      std::size_t const chunk (list.base_vertices()[i] / layout::vertices_per_chunk);
+      BOOST_REQUIRE ((chunk % 2 == 0) == (batch.textures == grass));
+    }
+  }
+
+  auto const& grass_batch (list.batches()[0].textures == grass ? list.batches()[0] : list.batches()[1]);
+  BOOST_REQUIRE_EQUAL (grass_batch.chunk, 0);
+  // in the order they were added
+  BOOST_REQUIRE_EQUAL (list.counts()[grass_batch.first], 768);
+  BOOST_REQUIRE_EQUAL (list.counts()[grass_batch.first + 1], 90);
+  BOOST_REQUIRE_EQUAL ( reinterpret_cast<std::size_t> (list.index_offsets()[grass_batch.first + 1])
+                      , layout::first_index (2, 1) * sizeof (layout::index_type)
+                      );
+  BOOST_REQUIRE_EQUAL (list.base_vertices()[grass_batch.first + 1], 2 * layout::vertices_per_chunk);
+
+  list.clear();
+  BOOST_REQUIRE (list.empty());
+  list.finish();
+  BOOST_REQUIRE (list.batches().empty());
+  BOOST_REQUIRE (list.counts().empty());
+}
+
+BOOST_AUTO_TEST_CASE (chunk_parameters_match_the_shader_block)
+{
+  std::string const shader (read_shader ("terrain_frag.glsl"));
+
+  std::vector<glsl_member> const members (std140_members (shader, "chunk_parameters"));
+  BOOST_REQUIRE_EQUAL (members.size(), 3);
+
+  BOOST_REQUIRE_EQUAL (members[0].name, "texture_animations");
+  BOOST_REQUIRE_EQUAL (members[0].offset, offsetof (noggit::terrain_chunk_parameters, texture_animations));
+  BOOST_REQUIRE_EQUAL (members[0].count, 2);
+  BOOST_REQUIRE_EQUAL (members[1].name, "areaid_color");
+  BOOST_REQUIRE_EQUAL (members[1].offset, offsetof (noggit::terrain_chunk_parameters, areaid_color));
+  BOOST_REQUIRE_EQUAL (members[2].name, "flags");
+  BOOST_REQUIRE_EQUAL (members[2].offset, offsetof (noggit::terrain_chunk_parameters, flags));
+  BOOST_REQUIRE_EQUAL (members[2].offset + 16, sizeof (noggit::terrain_chunk_parameters));
+
+  std::smatch block;
+  BOOST_REQUIRE (std::regex_search (shader, block, std::regex ("uniform chunks\\s*\\{\\s*chunk_parameters chunk\\[(\\d+)\\];")));
+  BOOST_REQUIRE_EQUAL (std::stoul (block[1]), layout::chunk_count);
+
+  // GL_MAX_UNIFORM_BLOCK_SIZE is at least 16 KB
+  BOOST_REQUIRE_LE (noggit::terrain_chunk_parameters_block::byte_size(), 16384);
+}
+
+BOOST_AUTO_TEST_CASE (vertex_id_gives_the_chunk_of_a_base_vertex)
+{
+  std::string const shader (read_shader ("terrain_vert.glsl"));
+
+  // gl_VertexID includes the base vertex of glMultiDrawElementsBaseVertex
+  std::smatch constant;
+  BOOST_REQUIRE (std::regex_search (shader, constant, std::regex ("vertices_per_chunk = (\\d+) \\* (\\d+) \\+ (\\d+) \\* (\\d+);")));
+  BOOST_REQUIRE_EQUAL ( std::stoul (constant[1]) * std::stoul (constant[2]) + std::stoul (constant[3]) * std::stoul (constant[4])
+                      , layout::vertices_per_chunk
+                      );
+  BOOST_REQUIRE (shader.find ("vary_chunk = gl_VertexID / vertices_per_chunk;") != std::string::npos);
+
+  std::vector<layout::index_type> strip;
+  std::array<std::vector<layout::index_type>, 4> lod_strips;
+
+  std::mt19937 engine (11);
+  std::uniform_int_distribution<int> random_holes (0, 0xFFFF);
+  std::vector<int> holes {0, 0xFFFF};
+  for (int bit (0); bit < 16; ++bit)
+  {
+    holes.push_back (1 << bit);
+  }
+  for (int i (0); i < 200; ++i)
+  {
+    holes.push_back (random_holes (engine));
+  }
+
+  for (int chunk_holes : holes)
+  {
+    layout::build_strips (chunk_holes, strip, lod_strips);
+
+    if (!chunk_holes)
+    {
+      BOOST_REQUIRE_EQUAL (strip.size(), layout::strip_size);
+      for (int lod (0); lod < 4; ++lod)
+      {
+        BOOST_REQUIRE_EQUAL (lod_strips[lod].size(), layout::lod_strip_sizes[lod]);
+      }
+    }
+
+    // fits in the range of the chunk, not overwriting the next one
+    BOOST_REQUIRE_LE (strip.size(), layout::strip_size);
+    for (int lod (0); lod < 4; ++lod)
+    {
+      BOOST_REQUIRE_LE (lod_strips[lod].size(), layout::lod_strip_sizes[lod]);
+    }
+
+    // no index of a chunk reaches the vertices of the next one
+    std::size_t highest (0);
+    for (auto const& indices : {strip, lod_strips[0], lod_strips[1], lod_strips[2], lod_strips[3]})
+    {
+      for (auto index : indices)
+      {
+        highest = std::max<std::size_t> (highest, index);
+      }
+    }
+    BOOST_REQUIRE_LT (highest, layout::vertices_per_chunk);
+  }
+
+  noggit::terrain_draw_list list;
+  for (std::size_t chunk (0); chunk < layout::chunk_count; ++chunk)
+  {
+    list.add (chunk % 3 ? grass : rock, chunk, layout::first_index (chunk, boost::none), layout::strip_size);
+  }
+  list.finish();
+
+  std::vector<bool> drawn (layout::chunk_count, false);
+  for (auto const& batch : list.batches())
+  {
+    for (std::size_t i (batch.first); i < batch.first + batch.count; ++i)
+    {
+      std::size_t const base_vertex (list.base_vertices()[i]);
+      std::size_t const first_index
+        (reinterpret_cast<std::size_t> (list.index_offsets()[i]) / sizeof (layout::index_type));
+      std::size_t const chunk (first_index / layout::indices_per_chunk);
+
+      BOOST_REQUIRE_EQUAL (base_vertex / layout::vertices_per_chunk, chunk);
+      BOOST_REQUIRE_EQUAL ((base_vertex + layout::vertices_per_chunk - 1) / layout::vertices_per_chunk, chunk);
+      drawn[chunk] = true;
+    }
+  }
+  BOOST_REQUIRE (std::all_of (drawn.begin(), drawn.end(), [] (bool d) { return d; }));
+}
+
+BOOST_AUTO_TEST_CASE (alphamap_layers_are_8_bits)
+{
+  using alphamap = noggit::terrain_alphamap_layer;
+
+  std::vector<std::uint8_t> rgba (alphamap::texel_count * 4, 7);
+  std::vector<std::uint8_t> first (alphamap::texel_count);
+  std::vector<std::uint8_t> second (alphamap::texel_count);
+  std::vector<std::uint8_t> shadow (alphamap::texel_count);
+  for (std::size_t i (0); i < alphamap::texel_count; ++i)
+  {
+    first[i] = static_cast<std::uint8_t> (i);
+    second[i] = static_cast<std::uint8_t> (255 - i % 256);
+    shadow[i] = i % 3 ? 0 : 255;
+  }
+
+  alphamap::write_alphas (rgba.data(), {first.data(), second.data(), nullptr});
+  for (std::size_t i (0); i < alphamap::texel_count; ++i)
+  {
+    BOOST_REQUIRE_EQUAL (rgba[i * 4], first[i]);
+    BOOST_REQUIRE_EQUAL (rgba[i * 4 + 1], second[i]);
+    BOOST_REQUIRE_EQUAL (rgba[i * 4 + 2], 0);
+    // left to the shadow
+    BOOST_REQUIRE_EQUAL (rgba[i * 4 + 3], 7);
+  }
+
+  alphamap::write_shadow (rgba.data(), shadow.data());
+  for (std::size_t i (0); i < alphamap::texel_count; ++i)
+  {
+    BOOST_REQUIRE_EQUAL (rgba[i * 4], first[i]);
+    BOOST_REQUIRE_EQUAL (rgba[i * 4 + 3], shadow[i]);
+  }
+
+  // the values being painted are rounded to the nearest of the 256 the
+  // texture has, like they are once saved
+  std::vector<float> painted (alphamap::texel_count, 0.f);
+  std::vector<int> expected (alphamap::texel_count, 0);
+  std::vector<std::pair<float, int>> const values
+    {{0.f, 0}, {0.49f, 0}, {0.5f, 1}, {127.4f, 127}, {127.6f, 128}, {254.5f, 255}, {255.f, 255}, {-3.f, 0}, {300.f, 255}};
+  for (std::size_t i (0); i < values.size(); ++i)
+  {
+    painted[i] = values[i].first;
+    expected[i] = values[i].second;
+  }
+
+  alphamap::write_alphas (rgba.data(), {painted.data(), nullptr, painted.data()});
+  for (std::size_t i (0); i < alphamap::texel_count; ++i)
+  {
+    BOOST_REQUIRE_EQUAL (rgba[i * 4], expected[i]);
+    BOOST_REQUIRE_EQUAL (rgba[i * 4 + 1], 0);
+    BOOST_REQUIRE_EQUAL (rgba[i * 4 + 2], expected[i]);
+    BOOST_REQUIRE_EQUAL (rgba[i * 4 + 3], shadow[i]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE (only_the_changed_chunk_parameters_are_uploaded)
+{
+  noggit::terrain_chunk_parameters_block block;
+  std::vector<std::pair<std::size_t, std::size_t>> uploads;
+  auto const upload_changes
+    ( [&]
+      {
+        uploads.clear();
+        block.upload_changes
+          ( [&] (std::size_t offset, std::size_t size, void const* data)
+            {
+              BOOST_REQUIRE_EQUAL (data, reinterpret_cast<char const*> (block.data()) + offset);
+              uploads.emplace_back (offset, size);
+            }
+          );
+      }
+    );
+
+  upload_changes();
+  BOOST_REQUIRE (uploads.empty());
+
+  noggit::terrain_chunk_parameters animated {};
+  animated.texture_animations[0].x = 0.25f;
+  animated.flags = {1, 0, 0, 0};
+  noggit::terrain_chunk_parameters const still {};
+
+  block.set (3, animated);
+  block.set (4, animated);
+  block.set (10, still);
+  block.set (200, animated);
+  upload_changes();
+
+  std::size_t const size (sizeof (noggit::terrain_chunk_parameters));
+  BOOST_REQUIRE_EQUAL (uploads.size(), 2);
+  BOOST_REQUIRE_EQUAL (uploads[0].first, 3 * size);
+  BOOST_REQUIRE_EQUAL (uploads[0].second, 2 * size);
+  BOOST_REQUIRE_EQUAL (uploads[1].first, 200 * size);
+  BOOST_REQUIRE_EQUAL (uploads[1].second, size);
+  BOOST_REQUIRE_EQUAL (block.data()[4].texture_animations[0].x, 0.25f);
+
+  // the same parameters the next frame
+  block.set (3, animated);
+  block.set (200, animated);
+  upload_changes();
+  BOOST_REQUIRE (uploads.empty());
+
+  animated.texture_animations[0].x = 0.5f;
+  block.set (4, animated);
+  upload_changes();
+  BOOST_REQUIRE_EQUAL (uploads.size(), 1);
+  BOOST_REQUIRE_EQUAL (uploads[0].first, 4 * size);
+
+  block.set (5, animated);
+  block.forget_changes();
+  upload_changes();
+  BOOST_REQUIRE (uploads.empty());
+}
@@ -0,0 +1,241 @@
+#include <boost/test/unit_test.hpp>
+
+#include <noggit/MapHeaders.h>
+#include <noggit/terrain_normals.hpp>
+
+#include <boost/optional.hpp>
+
+#include <array>
+#include <cmath>
+#include <functional>
+#include <random>
+#include <vector>
+
+namespace
+{
+  std::size_t const chunk_vertices (9 * 9 + 8 * 8);
+  using chunk = std::array<math::vector_3d, chunk_vertices>;
+
+  //! a 3x3 area of chunks with consistent heights on their shared edges
+  struct area
+  {
+    std::array<chunk, 9> chunks;
+    std::array<bool, 9> loaded;
+
+    area (unsigned seed)
+    {
+      std::mt19937 engine (seed);
+      std::uniform_real_distribution<float> phase (0.f, 10.f);
+      float const a (phase (engine));
+      float const b (phase (engine));
+
+      for (int cz (0); cz < 3; ++cz)
+      {
+        for (int cx (0); cx < 3; ++cx)
+        {
+          auto& vertices (chunks[cz * 3 + cx]);
+          loaded[cz * 3 + cx] = true;
+
+          std::size_t i (0);
+          for (int row (0); row < 17; ++row)
+          {
+            float const offset (row % 2 ? UNITSIZE / 2 : 0.f);
+            for (int column (0); column < (row % 2 ? 8 : 9); ++column)
+            {
+              float const x (cx * CHUNKSIZE + column * UNITSIZE + offset);
+              float const z (cz * CHUNKSIZE + row / 2 * UNITSIZE + offset);
+              vertices[i++] = { x
+                              , 20.f * std::sin (x * 0.3f + a) + 15.f * std::cos (z * 0.2f + b) + 3.f * std::sin (x * z)
+                              , z
+                              };
+            }
+          }
+        }
+      }
+    }
+
+    //! World::GetVertex, except that the vertices on the edges are also
+    //! found when only one of the chunks sharing them is loaded
+    boost::optional<float> height (float x, float z) const
+    {
+      for (std::size_t c (0); c < 9; ++c)
+      {
+        if (!loaded[c])
+        {
+          continue;
+        }
+
+        for (auto const& v : chunks[c])
+        {
+          if (std::abs (v.x - x) < 0.01f && std::abs (v.z - z) < 0.01f)
+          {
+            return v.y;
+          }
+        }
+      }
+
+      return boost::none;
+    }
+
+    //! World::GetVertex
+    boost::optional<float> snapped_height (float x, float z) const
+    {
+      int const cx (static_cast<int> (std::floor (x / CHUNKSIZE)));
+      int const cz (static_cast<int> (std::floor (z / CHUNKSIZE)));
+      if (cx < 0 || cz < 0 || cx > 2 || cz > 2 || !loaded[cz * 3 + cx])
+      {
+        return boost::none;
+      }
+
+      float const xdiff (x - cx * CHUNKSIZE);
+      float const zdiff (z - cz * CHUNKSIZE);
+
+      const int row = static_cast<int>(zdiff / (UNITSIZE * 0.5f) + 0.5f);
+      const int column = static_cast<int>((xdiff - UNITSIZE * 0.5f * (row % 2)) / UNITSIZE + 0.5f);
+      if ((row < 0) || (column < 0) || (row > 16) || (column >((row % 2) ? 8 : 9)))
+        return boost::none;
+
+      return chunks[cz * 3 + cx][17 * (row / 2) + ((row % 2) ? 9 : 0) + column].y;
+    }
+
+    noggit::terrain_normals::halo halo() const
+    {
+      std::array<math::vector_3d const*, 9> neighbours;
+      for (std::size_t i (0); i < 9; ++i)
+      {
+        neighbours[i] = loaded[i] ? chunks[i].data() : nullptr;
+      }
+      return noggit::terrain_normals::make_halo (neighbours);
+    }
+  };
+
+  // MapChunk::recalcNorms before the height grid
+  void legacy_normals ( chunk const& vertices
+                      , std::function<boost::optional<float> (float, float)> height
+                      , math::vector_3d* normals
+                      )
+  {
+    auto point
+    (
+      [&] (math::vector_3d const& v, float xdiff, float zdiff)
+      {
+        return math::vector_3d
+               ( v.x + xdiff
+               , height (v.x + xdiff, v.z + zdiff).get_value_or (v.y)
+               , v.z + zdiff
+               );
+      }
+    );
+
+    float const half_unit = UNITSIZE / 2.f;
+
+    for (std::size_t i = 0; i < chunk_vertices; ++i)
+    {
+      math::vector_3d const P1 (point(vertices[i], -half_unit, -half_unit));
+      math::vector_3d const P2 (point(vertices[i],  half_unit, -half_unit));
+      math::vector_3d const P3 (point(vertices[i],  half_unit,  half_unit));
+      math::vector_3d const P4 (point(vertices[i], -half_unit,  half_unit));
+
+      math::vector_3d const N1 ((P2 - vertices[i]) % (P1 - vertices[i]));
+      math::vector_3d const N2 ((P3 - vertices[i]) % (P2 - vertices[i]));
+      math::vector_3d const N3 ((P4 - vertices[i]) % (P3 - vertices[i]));
+      math::vector_3d const N4 ((P1 - vertices[i]) % (P4 - vertices[i]));
+
+      math::vector_3d Norm (N1 + N2 + N3 + N4);
+      Norm.normalize();
+
+      Norm.x = std::floor(Norm.x * 127) / 127;
+      Norm.y = std::floor(Norm.y * 127) / 127;
+      Norm.z = std::floor(Norm.z * 127) / 127;
+
+      normals[i] = {-Norm.z, Norm.y, -Norm.x};
+    }
+  }
+
+  math::vector_3d const everywhere_min (-1e6f, 0.f, -1e6f);
+  math::vector_3d const everywhere_max (1e6f, 0.f, 1e6f);
+
+  void require_same_normals (area const& a)
+  {
+    chunk const& center (a.chunks[4]);
+
+    chunk expected, actual;
+    legacy_normals (center, [&] (float x, float z) { return a.height (x, z); }, expected.data());
+    BOOST_REQUIRE_EQUAL
+      ( noggit::terrain_normals::compute (center.data(), a.halo(), everywhere_min, everywhere_max, actual.data())
+      , chunk_vertices
+      );
+
+    // the quantization may round the tiny differences either way
+    for (std::size_t i (0); i < chunk_vertices; ++i)
+    {
+      BOOST_REQUIRE_SMALL (expected[i].x - actual[i].x, 1.f / 127 + 1e-4f);
+      BOOST_REQUIRE_SMALL (expected[i].y - actual[i].y, 1.f / 127 + 1e-4f);
+      BOOST_REQUIRE_SMALL (expected[i].z - actual[i].z, 1.f / 127 + 1e-4f);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE (normals_match_world_lookups)
+{
+  for (unsigned seed (0); seed < 8; ++seed)
+  {
+    require_same_normals (area (seed));
+  }
+}
+
+BOOST_AUTO_TEST_CASE (normals_without_neighbours)
+{
+  for (std::size_t missing (0); missing < 9; ++missing)
+  {
+    if (missing == 4)
+    {
+      continue;
+    }
+
+    area a (missing);
+    a.loaded[missing] = false;
+    require_same_normals (a);
+  }
+
+  area alone (42);
+  alone.loaded.fill (false);
+  alone.loaded[4] = true;
+  require_same_normals (alone);
+}
+
+BOOST_AUTO_TEST_CASE (only_dirty_normals_are_written)
+{
+  area const a (1);
+  chunk const& center (a.chunks[4]);
+
+  math::vector_3d const min (center[20].x - 0.1f, 0.f, center[20].z - 0.1f);
+  math::vector_3d const max (center[40].x + 0.1f, 0.f, center[40].z + 0.1f);
+
+  chunk all, partial;
+  partial.fill ({0.f, 0.f, 0.f});
+  noggit::terrain_normals::compute (center.data(), a.halo(), everywhere_min, everywhere_max, all.data());
+  std::size_t const count
+    (noggit::terrain_normals::compute (center.data(), a.halo(), min, max, partial.data()));
+
+  std::size_t inside (0);
+  for (std::size_t i (0); i < chunk_vertices; ++i)
+  {
+    math::vector_3d const& v (center[i]);
+    if (v.x >= min.x && v.x <= max.x && v.z >= min.z && v.z <= max.z)
+    {
+      ++inside;
+      BOOST_REQUIRE_EQUAL (partial[i].x, all[i].x);
+      BOOST_REQUIRE_EQUAL (partial[i].y, all[i].y);
+      BOOST_REQUIRE_EQUAL (partial[i].z, all[i].z);
+    }
+    else
+    {
+      BOOST_REQUIRE_EQUAL (partial[i].y, 0.f);
+    }
+  }
+
+  BOOST_REQUIRE_EQUAL (count, inside);
+  BOOST_REQUIRE_GT (count, 0u);
+  BOOST_REQUIRE_LT (count, chunk_vertices);
+}
@@ -0,0 +1,201 @@
+#include <boost/test/unit_test.hpp>
+
+#include <noggit/MapHeaders.h>
+#include <noggit/terrain_picking.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <random>
+#include <set>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace
+{
+  std::size_t const chunk_vertices (9 * 9 + 8 * 8);
+  using chunk = std::array<math::vector_3d, chunk_vertices>;
+
+  chunk make_chunk (float xbase, float zbase, std::mt19937& engine, float roughness)
+  {
+    std::uniform_real_distribution<float> noise (-roughness, roughness);
+    chunk vertices;
+
+    std::size_t i (0);
+    for (int row (0); row < 17; ++row)
+    {
+      float const offset (row % 2 ? UNITSIZE * 0.5f : 0.f);
+      for (int column (0); column < (row % 2 ? 8 : 9); ++column)
+      {
+        float const x (xbase + column * UNITSIZE + offset);
+        float const z (zbase + row * 0.5f * UNITSIZE);
+        vertices[i++] = {x, 30.f * std::sin (x * 0.01f) + 20.f * std::cos (z * 0.02f) + noise (engine), z};
+      }
+    }
+
+    return vertices;
+  }
+
+  using hit = std::pair<std::tuple<int, int, int>, float>;
+
+  // MapChunk::intersect before the quadtree
+  std::vector<hit> legacy_intersect (chunk const& vertices, math::ray const& ray)
+  {
+    std::vector<hit> hits;
+
+    for (int x (0); x < 8; ++x)
+    {
+      for (int z (0); z < 8; ++z)
+      {
+        int const center (17 * z + 9 + x);
+        int const around[5] = {17 * z + x, 17 * (z + 1) + x, 17 * (z + 1) + x + 1, 17 * z + x + 1, 17 * z + x};
+
+        for (int i (0); i < 4; ++i)
+        {
+          if ( auto distance = ray.intersect_triangle
+                                 (vertices[center], vertices[around[i]], vertices[around[i + 1]])
+             )
+          {
+            hits.emplace_back (std::make_tuple (center, around[i], around[i + 1]), *distance);
+          }
+        }
+      }
+    }
+
+    std::sort (hits.begin(), hits.end());
+    return hits;
+  }
+
+  std::vector<hit> quadtree_intersect
+    (noggit::terrain_picking::height_quadtree const& quadtree, chunk const& vertices, math::ray const& ray)
+  {
+    std::vector<hit> hits;
+    quadtree.intersect
+      ( ray, vertices.data()
+      , [&] (float distance, std::tuple<int, int, int> const& triangle)
+        {
+          hits.emplace_back (triangle, distance);
+        }
+      );
+
+    std::sort (hits.begin(), hits.end());
+    return hits;
+  }
+
+  void require_same_hits (chunk const& vertices, math::ray const& ray)
+  {
+    noggit::terrain_picking::height_quadtree quadtree;
+    quadtree.update (vertices.data());
+
+    std::vector<hit> const expected (legacy_intersect (vertices, ray));
+    std::vector<hit> const actual (quadtree_intersect (quadtree, vertices, ray));
+
+    BOOST_REQUIRE_EQUAL (expected.size(), actual.size());
+    for (std::size_t i (0); i < expected.size(); ++i)
+    {
+      BOOST_REQUIRE (expected[i].first == actual[i].first);
+      BOOST_REQUIRE_EQUAL (expected[i].second, actual[i].second);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE (quadtree_finds_every_triangle_hit)
+{
+  std::mt19937 engine (3);
+  float const xbase (31.f * TILESIZE + 5 * CHUNKSIZE);
+  float const zbase (29.f * TILESIZE + 11 * CHUNKSIZE);
+
+  for (float roughness : {0.f, 5.f, 60.f})
+  {
+    chunk const vertices (make_chunk (xbase, zbase, engine, roughness));
+
+    std::uniform_real_distribution<float> inside (0.f, CHUNKSIZE);
+    std::uniform_real_distribution<float> around (-200.f, 200.f);
+
+    for (int i (0); i < 500; ++i)
+    {
+      math::vector_3d const target (xbase + inside (engine), 0.f, zbase + inside (engine));
+      math::vector_3d const origin (target.x + around (engine), 150.f + around (engine), target.z + around (engine));
+      require_same_hits (vertices, {origin, target - origin});
+      require_same_hits (vertices, {target - (target - origin) * 3.f, target - origin});
+    }
+
+    // straight down through the vertices and unit borders, the hits are on
+    // the edges shared by several triangles
+    for (auto const& v : vertices)
+    {
+      require_same_hits (vertices, {{v.x, 500.f, v.z}, {0.f, -1.f, 0.f}});
+      require_same_hits (vertices, {{v.x + UNITSIZE * 0.25f, 500.f, v.z}, {0.f, -1.f, 0.f}});
+    }
+
+    // grazing the chunk
+    for (int i (0); i < 100; ++i)
+    {
+      math::vector_3d const origin (xbase - 50.f, 10.f + around (engine) * 0.1f, zbase + inside (engine));
+      require_same_hits (vertices, {origin, {1.f, 0.f, around (engine) * 0.001f}});
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE (grid_walk_visits_the_crossed_cells)
+{
+  std::mt19937 engine (5);
+  std::uniform_real_distribution<float> position (-5.f * CHUNKSIZE, 25.f * CHUNKSIZE);
+  std::uniform_real_distribution<float> direction (-1.f, 1.f);
+
+  int const begin (3);
+  int const end (19);
+
+  for (int i (0); i < 2000; ++i)
+  {
+    math::vector_3d const origin (position (engine), 100.f, position (engine));
+    math::ray const ray (origin, {direction (engine), direction (engine), direction (engine) * (i % 2)});
+
+    std::set<std::pair<int, int>> visited;
+    noggit::terrain_picking::walk_grid
+      ( ray, CHUNKSIZE, begin, begin, end, end
+      , [&] (int x, int z)
+        {
+          BOOST_REQUIRE (x >= begin && x < end && z >= begin && z < end);
+          visited.emplace (x, z);
+        }
+      );
+
+    math::vector_3d const& o (ray.origin());
+    math::vector_3d const& d (ray.direction());
+
+    for (int z (begin); z < end; ++z)
+    {
+      for (int x (begin); x < end; ++x)
+      {
+        // does the ray (t >= 0) go through the cell, its borders excluded
+        float t_min (0.f);
+        float t_max (1e9f);
+        bool crossed (true);
+
+        for (auto const& axis : { std::make_tuple (o.x, d.x, x), std::make_tuple (o.z, d.z, z) })
+        {
+          float const low (std::get<2> (axis) * CHUNKSIZE + 0.05f);
+          float const high ((std::get<2> (axis) + 1) * CHUNKSIZE - 0.05f);
+          float const p (std::get<0> (axis));
+          float const v (std::get<1> (axis));
+
+          if (v == 0.f)
+          {
+            crossed = crossed && p > low && p < high;
+            continue;
+          }
+
+          t_min = std::max (t_min, std::min ((low - p) / v, (high - p) / v));
+          t_max = std::min (t_max, std::max ((low - p) / v, (high - p) / v));
+        }
+
+        if (crossed && t_min < t_max)
+        {
+          BOOST_REQUIRE (visited.count ({x, z}));
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,200 @@
+#include <boost/test/unit_test.hpp>
+
+#include <noggit/texture_residency.hpp>
+
+#include <vector>
+
+BOOST_AUTO_TEST_CASE (bytes_are_accounted_per_texture)
+{
+  noggit::texture_residency residency (1000, 10);
+
+  residency.add (1);
+  residency.add (2);
+  residency.set_cpu_bytes (1, 30);
+  residency.set_cpu_bytes (2, 20);
+  residency.set_gpu_bytes (1, 100, false);
+  residency.set_gpu_bytes (2, 200, true);
+  residency.set_cpu_bytes (1, 10);
+
+  auto stats (residency.stats());
+  BOOST_REQUIRE_EQUAL (stats.cpu_bytes, 30);
+  BOOST_REQUIRE_EQUAL (stats.gpu_bytes, 300);
+  BOOST_REQUIRE_EQUAL (stats.textures, 2);
+  BOOST_REQUIRE_EQUAL (stats.low_detail_textures, 1);
+
+  residency.remove (2);
+  stats = residency.stats();
+  BOOST_REQUIRE_EQUAL (stats.cpu_bytes, 10);
+  BOOST_REQUIRE_EQUAL (stats.gpu_bytes, 100);
+  BOOST_REQUIRE_EQUAL (stats.textures, 1);
+}
+
+BOOST_AUTO_TEST_CASE (promotions_fit_in_the_budget)
+{
+  noggit::texture_residency residency (1000, 10);
+
+  for (int id (0); id < 3; ++id)
+  {
+    residency.add (id);
+    residency.set_gpu_bytes (id, 100, false);
+  }
+
+  BOOST_REQUIRE (residency.try_promote (0, 500));
+  // already in progress
+  BOOST_REQUIRE (!residency.try_promote (0, 500));
+  // 300 + 400 reserved + 400 > 1000
+  BOOST_REQUIRE (!residency.try_promote (1, 500));
+
+  residency.set_gpu_bytes (0, 500, true);
+  BOOST_REQUIRE (!residency.try_promote (0, 500));
+  // 700 + 200
+  BOOST_REQUIRE (residency.try_promote (1, 300));
+  BOOST_REQUIRE_EQUAL (residency.stats().promotions, 2);
+
+  residency.set_budget (2000);
+  BOOST_REQUIRE (residency.try_promote (2, 500));
+}
+
+BOOST_AUTO_TEST_CASE (least_recently_used_textures_are_demoted_over_budget)
+{
+  noggit::texture_residency residency (1000, 10);
+
+  for (int id (0); id < 4; ++id)
+  {
+    residency.add (id);
+    residency.set_gpu_bytes (id, 300, true);
+  }
+  // a low detail texture has nothing to free
+  residency.add (4);
+  residency.set_gpu_bytes (4, 10, false);
+
+  for (int frame (0); frame < 20; ++frame)
+  {
+    if (frame < 5)
+    {
+      residency.used (2);
+      residency.used (4);
+    }
+    if (frame < 8)
+    {
+      residency.used (0);
+    }
+    // drawn every frame
+    residency.used (3);
+
+    std::vector<int> const demoted (residency.next_frame());
+    if (frame < 9)
+    {
+      // nothing was idle long enough
+      BOOST_REQUIRE (demoted.empty());
+    }
+    else if (frame == 9)
+    {
+      // 1210 bytes: 1 is the only one unused for 10 frames
+      BOOST_REQUIRE_EQUAL (demoted.size(), 1);
+      BOOST_REQUIRE_EQUAL (demoted[0], 1);
+      residency.set_gpu_bytes (1, 20, false);
+    }
+    else if (frame < 14)
+    {
+      // 930 bytes
+      BOOST_REQUIRE (demoted.empty());
+    }
+  }
+
+  BOOST_REQUIRE_EQUAL (residency.stats().demotions, 1);
+
+  residency.set_budget (500);
+  std::vector<int> const demoted (residency.next_frame());
+  BOOST_REQUIRE_EQUAL (demoted.size(), 2);
+  BOOST_REQUIRE_EQUAL (demoted[0], 2);
+  BOOST_REQUIRE_EQUAL (demoted[1], 0);
+}
+
+BOOST_AUTO_TEST_CASE (refused_promotions_demote_idle_textures)
+{
+  noggit::texture_residency residency (1000, 1);
+
+  residency.add (0);
+  residency.set_gpu_bytes (0, 900, true);
+  residency.add (1);
+  residency.set_gpu_bytes (1, 10, false);
+
+  residency.used (0);
+  BOOST_REQUIRE (residency.next_frame().empty());
+
+  // 910 + 490 > 1000 although the gpu memory is within the budget
+  BOOST_REQUIRE (!residency.try_promote (1, 500));
+  std::vector<int> const demoted (residency.next_frame());
+  BOOST_REQUIRE_EQUAL (demoted.size(), 1);
+  BOOST_REQUIRE_EQUAL (demoted[0], 0);
+  residency.set_gpu_bytes (0, 10, false);
+
+  BOOST_REQUIRE (residency.try_promote (1, 500));
+}
+
+BOOST_AUTO_TEST_CASE (refused_bytes_are_counted_once_per_texture_per_frame)
+{
+  noggit::texture_residency residency (1000, 1);
+
+  for (int id (0); id < 2; ++id)
+  {
+    residency.add (id);
+    residency.set_gpu_bytes (id, 300, true);
+  }
+  residency.add (2);
+  residency.set_gpu_bytes (2, 10, false);
+
+  BOOST_REQUIRE (residency.next_frame().empty());
+
+  // drawn several times in the frame, 610 + 490 > 1000
+  for (int draw (0); draw < 3; ++draw)
+  {
+    BOOST_REQUIRE (!residency.try_promote (2, 500));
+  }
+
+  std::vector<int> const demoted (residency.next_frame());
+  BOOST_REQUIRE_EQUAL (demoted.size(), 1);
+  residency.set_gpu_bytes (demoted[0], 10, false);
+
+  // 320 + 490 fits in the next frame
+  BOOST_REQUIRE (residency.try_promote (2, 500));
+}
+
+BOOST_AUTO_TEST_CASE (loaded_promotions_are_taken_once)
+{
+  noggit::texture_residency residency (1000, 10);
+
+  BOOST_REQUIRE (residency.take_loaded_promotions().empty());
+
+  residency.promotion_loaded (3);
+  residency.promotion_loaded (1);
+
+  std::vector<int> const loaded (residency.take_loaded_promotions());
+  BOOST_REQUIRE_EQUAL (loaded.size(), 2);
+  BOOST_REQUIRE_EQUAL (loaded[0], 3);
+  BOOST_REQUIRE_EQUAL (loaded[1], 1);
+
+  BOOST_REQUIRE (residency.take_loaded_promotions().empty());
+}
+
+BOOST_AUTO_TEST_CASE (failed_promotions_give_their_reservation_back)
+{
+  noggit::texture_residency residency (1000, 10);
+
+  residency.add (0);
+  residency.set_gpu_bytes (0, 100, false);
+  residency.add (1);
+  residency.set_gpu_bytes (1, 100, false);
+
+  BOOST_REQUIRE (residency.try_promote (0, 700));
+  // 200 + 600 reserved + 400 > 1000
+  BOOST_REQUIRE (!residency.try_promote (1, 500));
+
+  residency.promotion_failed (0);
+  auto const stats (residency.stats());
+  BOOST_REQUIRE_EQUAL (stats.gpu_bytes, 200);
+  BOOST_REQUIRE_EQUAL (stats.low_detail_textures, 2);
+
+  BOOST_REQUIRE (residency.try_promote (1, 500));
+}
@@ -0,0 +1,210 @@
+#include <boost/test/unit_test.hpp>
+
+#include <math/matrix_4x4.hpp>
+#include <noggit/triangle_bvh.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace
+{
+  using triangle = noggit::triangle_bvh::triangle;
+
+  //! a bumpy sheet folded around y, like a large building
+  std::vector<triangle> make_mesh (std::mt19937& engine, int size, float scale)
+  {
+    std::uniform_real_distribution<float> noise (-0.3f, 0.3f);
+    std::vector<math::vector_3d> points;
+    for (int z (0); z <= size; ++z)
+    {
+      for (int x (0); x <= size; ++x)
+      {
+        float const angle (x * 6.f / size);
+        points.emplace_back ( scale * (std::cos (angle) + noise (engine) * 0.05f)
+                            , scale * (z * 2.f / size - 1.f)
+                            , scale * (std::sin (angle) + noise (engine) * 0.05f)
+                            );
+      }
+    }
+
+    std::vector<triangle> triangles;
+    for (int z (0); z < size; ++z)
+    {
+      for (int x (0); x < size; ++x)
+      {
+        auto const& a (points[z * (size + 1) + x]);
+        auto const& b (points[z * (size + 1) + x + 1]);
+        auto const& c (points[(z + 1) * (size + 1) + x]);
+        auto const& d (points[(z + 1) * (size + 1) + x + 1]);
+        triangles.push_back ({a, b, c});
+        triangles.push_back ({b, d, c});
+      }
+    }
+
+    return triangles;
+  }
+
+  std::vector<triangle> make_soup (std::mt19937& engine, std::size_t count)
+  {
+    std::uniform_real_distribution<float> position (-50.f, 50.f);
+    std::uniform_real_distribution<float> offset (-3.f, 3.f);
+
+    std::vector<triangle> triangles;
+    for (std::size_t i (0); i < count; ++i)
+    {
+      math::vector_3d const p (position (engine), position (engine), position (engine));
+      triangles.push_back ({ p
+                           , p + math::vector_3d (offset (engine), offset (engine), offset (engine))
+                           , p + math::vector_3d (offset (engine), offset (engine), offset (engine))
+                           }
+                          );
+    }
+
+    // flat and axis aligned ones
+    triangles.push_back ({math::vector_3d (0.f, 0.f, 0.f), math::vector_3d (10.f, 0.f, 0.f), math::vector_3d (0.f, 0.f, 10.f)});
+    triangles.push_back ({math::vector_3d (0.f, 0.f, 0.f), math::vector_3d (0.f, 10.f, 0.f), math::vector_3d (0.f, 0.f, 10.f)});
+    return triangles;
+  }
+
+  // WMOGroup::intersect and Model::intersect before the bvh
+  std::vector<float> brute_force (std::vector<triangle> const& triangles, math::ray const& ray)
+  {
+    std::vector<float> results;
+    for (auto const& t : triangles)
+    {
+      if (auto distance = ray.intersect_triangle (t[0], t[1], t[2]))
+      {
+        results.emplace_back (*distance);
+      }
+    }
+    return results;
+  }
+
+  void require_same_hits (std::vector<triangle> const& triangles, noggit::triangle_bvh const& bvh, math::ray const& ray)
+  {
+    std::vector<float> expected (brute_force (triangles, ray));
+    std::vector<float> actual;
+    bvh.intersect (ray, &actual);
+
+    std::sort (expected.begin(), expected.end());
+    std::sort (actual.begin(), actual.end());
+    BOOST_REQUIRE_EQUAL_COLLECTIONS (expected.begin(), expected.end(), actual.begin(), actual.end());
+  }
+
+  void require_same_hits (std::vector<triangle> const& triangles, std::mt19937& engine, float range)
+  {
+    noggit::triangle_bvh const bvh (triangles);
+    std::uniform_real_distribution<float> position (-range, range);
+
+    for (int i (0); i < 300; ++i)
+    {
+      math::vector_3d const origin (position (engine), position (engine), position (engine));
+      math::vector_3d const target (position (engine) * 0.5f, position (engine) * 0.5f, position (engine) * 0.5f);
+      require_same_hits (triangles, bvh, {origin, target - origin});
+    }
+
+    // axis aligned rays, through the triangles' vertices
+    for (std::size_t i (0); i < triangles.size(); i += 7)
+    {
+      math::vector_3d const& p (triangles[i][1]);
+      require_same_hits (triangles, bvh, {p + math::vector_3d (0.f, 2.f * range, 0.f), {0.f, -1.f, 0.f}});
+      require_same_hits (triangles, bvh, {p - math::vector_3d (2.f * range, 0.f, 0.f), {1.f, 0.f, 0.f}});
+      require_same_hits (triangles, bvh, {p, {0.f, 0.f, 1.f}});
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE (bvh_finds_every_triangle_hit)
+{
+  std::mt19937 engine (1);
+  require_same_hits (make_mesh (engine, 40, 20.f), engine, 40.f);
+  require_same_hits (make_mesh (engine, 60, 600.f), engine, 1000.f);
+  require_same_hits (make_soup (engine, 3000), engine, 60.f);
+  require_same_hits (make_soup (engine, 3), engine, 60.f);
+}
+
+BOOST_AUTO_TEST_CASE (bvh_handles_degenerate_input)
+{
+  noggit::triangle_bvh const empty;
+  std::vector<float> results;
+  empty.intersect ({{0.f, 10.f, 0.f}, {0.f, -1.f, 0.f}}, &results);
+  BOOST_REQUIRE (results.empty());
+
+  // all centers at the same place
+  std::vector<triangle> const stacked
+    (100, triangle {math::vector_3d (-1.f, 0.f, -1.f), math::vector_3d (1.f, 0.f, -1.f), math::vector_3d (0.f, 0.f, 2.f)});
+  noggit::triangle_bvh const bvh (stacked);
+  bvh.intersect ({{0.f, 10.f, 0.f}, {0.f, -1.f, 0.f}}, &results);
+  BOOST_REQUIRE_EQUAL (results.size(), stacked.size());
+}
+
+// run with --run_test=benchmark
+BOOST_AUTO_TEST_CASE (benchmark, *boost::unit_test::disabled())
+{
+  // a city: a few large buildings and hundreds of doodads sharing a mesh,
+  // picked through their inverse transform like ModelInstance::intersect
+  std::mt19937 engine (7);
+  std::vector<triangle> const building (make_mesh (engine, 120, 100.f));
+  std::vector<triangle> const doodad (make_mesh (engine, 25, 3.f));
+  noggit::triangle_bvh const building_bvh (building);
+  noggit::triangle_bvh const doodad_bvh (doodad);
+
+  std::uniform_real_distribution<float> position (-400.f, 400.f);
+  std::vector<math::matrix_4x4> buildings, doodads;
+  for (int i (0); i < 6; ++i)
+  {
+    buildings.emplace_back
+      (math::matrix_4x4 (math::matrix_4x4::translation, {position (engine), 0.f, position (engine)}).inverted());
+  }
+  for (int i (0); i < 500; ++i)
+  {
+    doodads.emplace_back
+      (math::matrix_4x4 (math::matrix_4x4::translation, {position (engine), 0.f, position (engine)}).inverted());
+  }
+
+  std::vector<math::ray> rays;
+  for (int i (0); i < 20; ++i)
+  {
+    rays.emplace_back (math::vector_3d (0.f, 300.f, 0.f), math::vector_3d (position (engine), -300.f, position (engine)));
+  }
+
+  auto const measure
+    ( [&] (char const* name, auto&& intersect)
+      {
+        std::size_t hits (0);
+        auto const start (std::chrono::steady_clock::now());
+        for (auto const& ray : rays)
+        {
+          for (auto const& transform : buildings)
+          {
+            hits += intersect (building, building_bvh, math::ray (transform, ray));
+          }
+          for (auto const& transform : doodads)
+          {
+            hits += intersect (doodad, doodad_bvh, math::ray (transform, ray));
+          }
+        }
+        std::chrono::duration<double, std::milli> const duration (std::chrono::steady_clock::now() - start);
+        std::cout << name << ": " << duration.count() / rays.size() << " ms per pick (" << hits << " hits)" << std::endl;
+      }
+    );
+
+  measure ( "brute force"
+          , [] (std::vector<triangle> const& triangles, noggit::triangle_bvh const&, math::ray const& ray)
+            {
+              return brute_force (triangles, ray).size();
+            }
+          );
+  measure ( "bvh"
+          , [] (std::vector<triangle> const&, noggit::triangle_bvh const& bvh, math::ray const& ray)
+            {
+              std::vector<float> results;
+              bvh.intersect (ray, &results);
+              return results.size();
+            }
+          );
+}
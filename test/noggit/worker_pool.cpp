@@ -0,0 +1,158 @@
+#include <boost/test/unit_test.hpp>
+
+#include <noggit/worker_pool.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  void require_every_index_once (noggit::worker_pool& pool, std::size_t count)
+  {
+    std::vector<std::atomic<int>> calls (count);
+    for (auto& call : calls)
+    {
+      call = 0;
+    }
+
+    pool.for_each (count, [&] (std::size_t i) { ++calls[i]; });
+
+    for (std::size_t i (0); i < count; ++i)
+    {
+      BOOST_REQUIRE_EQUAL (calls[i].load(), 1);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE (every_index_is_called_once)
+{
+  for (std::size_t workers : {0, 1, 3})
+  {
+    noggit::worker_pool pool (workers);
+    require_every_index_once (pool, 1000);
+  }
+}
+
+BOOST_AUTO_TEST_CASE (zero_and_one_index)
+{
+  noggit::worker_pool pool (2);
+
+  pool.for_each (0, [] (std::size_t) { BOOST_FAIL ("called without any index"); });
+
+  std::thread::id caller;
+  pool.for_each (1, [&] (std::size_t i)
+                    {
+                      BOOST_REQUIRE_EQUAL (i, 0);
+                      caller = std::this_thread::get_id();
+                    }
+                );
+  // not worth waking the workers up
+  BOOST_REQUIRE (caller == std::this_thread::get_id());
+}
+
+BOOST_AUTO_TEST_CASE (a_single_worker_shares_the_work_with_the_caller)
+{
+  noggit::worker_pool pool (1);
+  BOOST_REQUIRE_EQUAL (pool.thread_count(), 2);
+
+  require_every_index_once (pool, 2);
+  require_every_index_once (pool, 257);
+}
+
+BOOST_AUTO_TEST_CASE (repeated_jobs_on_the_same_pool)
+{
+  noggit::worker_pool pool (3);
+
+  for (std::size_t job (0); job < 500; ++job)
+  {
+    std::size_t const count (job % 37);
+    std::atomic<std::size_t> sum (0);
+
+    pool.for_each (count, [&] (std::size_t i) { sum += i + 1; });
+
+    BOOST_REQUIRE_EQUAL (sum.load(), count * (count + 1) / 2);
+  }
+}
+
+BOOST_AUTO_TEST_CASE (exceptions_are_rethrown_after_every_call)
+{
+  noggit::worker_pool pool (3);
+
+  for (int attempt (0); attempt < 20; ++attempt)
+  {
+    std::atomic<std::size_t> calls (0);
+
+    BOOST_REQUIRE_THROW
+      ( pool.for_each ( 100
+                      , [&] (std::size_t i)
+                        {
+                          ++calls;
+                          if (i % 10 == 3)
+                          {
+                            throw std::runtime_error ("failed");
+                          }
+                        }
+                      )
+      , std::runtime_error
+      );
+
+    // the other indices still ran
+    BOOST_REQUIRE_EQUAL (calls.load(), 100);
+  }
+
+  // the pool is usable after a failed job
+  require_every_index_once (pool, 100);
+}
+
+BOOST_AUTO_TEST_CASE (calls_from_several_threads_run_one_after_another)
+{
+  noggit::worker_pool pool (2);
+  std::atomic<int> running (0);
+  std::atomic<bool> overlapped (false);
+
+  std::vector<std::thread> callers;
+  for (int caller (0); caller < 4; ++caller)
+  {
+    callers.emplace_back
+      ( [&]
+        {
+          for (int job (0); job < 50; ++job)
+          {
+            pool.for_each ( 8
+                          , [&] (std::size_t i)
+                            {
+                              if (i == 0 && running++ != 0)
+                              {
+                                overlapped = true;
+                              }
+                              std::this_thread::yield();
+                              if (i == 0)
+                              {
+                                --running;
+                              }
+                            }
+                          );
+          }
+        }
+      );
+  }
+
+  for (auto& caller : callers)
+  {
+    caller.join();
+  }
+
+  BOOST_REQUIRE (!overlapped);
+}
+
+BOOST_AUTO_TEST_CASE (the_shared_pool_is_a_single_one)
+{
+  noggit::worker_pool& pool (noggit::worker_pool::instance());
+  BOOST_REQUIRE_EQUAL (&pool, &noggit::worker_pool::instance());
+  BOOST_REQUIRE_GE (pool.thread_count(), 1);
+
+  require_every_index_once (pool, 64);
+}